@@ -4,6 +4,7 @@
 
 #ifndef YEDIS_INCLUDE_BTREE_NODE_HPP_
 #define YEDIS_INCLUDE_BTREE_NODE_HPP_
+#include <mutex>
 #include <string>
 #include "yedis.hpp"
 #include "config.hpp"
@@ -52,6 +53,9 @@ class BTree {
   std::string file_name_;
   YedisInstance* yedis_instance_;
   BTreeOptions options_;
+  // one latch for the whole tree until the buffer pool is thread safe,
+  // then per-page latches for crabbing
+  std::mutex latch_;
 };
 }
 #endif //YEDIS_INCLUDE_BTREE_NODE_HPP_
@@ -59,7 +59,7 @@ namespace yedis {
     }
     // set parent id
     inline void SetParentPageID(page_id_t parent) {
-      SPDLOG_INFO("current page {} set to to parent {}", GetPageID(), parent);
+      SPDLOG_TRACE("current page {} set to to parent {}", GetPageID(), parent);
       EncodeFixed32(GetData() + PARENT_OFFSET, parent);
     }
 
@@ -95,7 +95,7 @@ namespace yedis {
     }
 
     inline void SetNextPageID(page_id_t page_id) {
-      SPDLOG_INFO("current page_id {}, next_page_id {}", GetPageID(), page_id);
+      SPDLOG_TRACE("current page_id {}, next_page_id {}", GetPageID(), page_id);
       assert(page_id != 0);
       EncodeFixed32(GetData() + NEXT_NODE_PAGE_ID_OFFSET, page_id);
     }
@@ -38,7 +38,7 @@ class BufferPoolManager {
     auto ret = std::vector<page_id_t>();
     for (auto [page_id, _]: records_) {
       if (page_id != 0) {
-        SPDLOG_INFO("memory recorded page_id {}", page_id);
+        SPDLOG_TRACE("memory recorded page_id {}", page_id);
         ret.push_back(page_id);
       }
     }
@@ -0,0 +1,50 @@
+//
+// Hook to drop entries while flushes and compactions rewrite them.
+//
+
+#ifndef YEDIS_COMPACTION_FILTER_H
+#define YEDIS_COMPACTION_FILTER_H
+
+#include <cstdint>
+#include <string>
+
+namespace yedis {
+class Slice;
+
+// Decides which entries are dead.  Flushes and compactions drop them, or
+// turn them into deletion markers while older versions of the key may
+// still exist below the output level.  Reads treat them as missing, so
+// results do not depend on when compactions run.
+//
+// Must be thread safe, it is called from flush and compaction threads and
+// from readers concurrently.
+class CompactionFilter {
+public:
+  virtual ~CompactionFilter();
+
+  virtual const char* Name() const = 0;
+
+  // Return true if the entry "key" -> "value" should be removed.  Only
+  // called for values, never for deletion markers.
+  virtual bool Filter(const Slice& key, const Slice& value) const = 0;
+
+  // Return false if readers can never reach the entries this filter
+  // removes, e.g. members of deleted collections, so that reads skip it.
+  virtual bool FilterReads() const { return true; }
+};
+
+// Values checked by the TTL filter end with a fixed64 expiration time in
+// milliseconds since the epoch, 0 means the value never expires.
+void AppendExpiration(std::string* value, uint64_t expire_at_ms);
+
+// Split "stored" into the user value and its expiration time.  Returns
+// false if "stored" is too short to carry one.
+bool ParseExpiration(const Slice& stored, Slice* value, uint64_t* expire_at_ms);
+
+// Removes values whose expiration time has passed.  Values without an
+// expiration suffix are kept.  The caller owns the result.
+const CompactionFilter* NewTTLCompactionFilter();
+
+}
+
+#endif //YEDIS_COMPACTION_FILTER_H
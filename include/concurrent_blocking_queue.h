@@ -5,60 +5,111 @@
 #ifndef YEDIS_CONCURRENT_BLOCKING_QUEUE_H
 #define YEDIS_CONCURRENT_BLOCKING_QUEUE_H
 
-#include <mutex>
 #include <condition_variable>
-#include <queue>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 #include <vector>
 
+#include "mpmc_queue.h"
+
 namespace yedis {
 
+// take() and takeAll() wait for an item.  By default the queue is
+// unbounded: a mutex around a deque, put() never waits.
+//
+// Constructed with a capacity it is a lock-free BlockingMPMCQueue
+// instead, and put() waits while it holds "capacity" items.  That needs
+// T to be default constructible.
 template <typename T>
 class ConcurrentBlockingQueue {
 public:
+  ConcurrentBlockingQueue() = default;
+
+  explicit ConcurrentBlockingQueue(size_t capacity)
+      : bounded_(std::make_unique<BlockingMPMCQueue<T>>(capacity)) {
+    static_assert(std::is_default_constructible_v<T>, "a bounded queue needs default constructible items");
+  }
+
   void put(const T& item) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    not_full_.wait(lock, [&] { return queue_.size() < max_size_; });
-    queue_.push(item);
+    if (bounded_ != nullptr) {
+      bounded_->push(item);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(item);
+    }
     not_empty_.notify_one();
   }
 
   T take() {
+    if constexpr (std::is_default_constructible_v<T>) {
+      if (bounded_ != nullptr) {
+        return bounded_->pop();
+      }
+    }
     std::unique_lock<std::mutex> lock(mutex_);
-    not_empty_.wait(lock, [&] { return !queue_.empty();});
-    T item = queue_.front();
-    queue_.pop();
-    not_full_.notify_one();
+    not_empty_.wait(lock, [&] { return !queue_.empty(); });
+    T item = std::move(queue_.front());
+    queue_.pop_front();
     return item;
   }
 
+  // Waits for an item, then takes everything queued.
   std::vector<T> takeAll() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    not_empty_.wait(lock, [&] { return !queue_.empty();});
-    std::vector<T> result;
-    while(!queue_.empty()) {
-      result.push_back(queue_.front());
-      queue_.pop();
+    if constexpr (std::is_default_constructible_v<T>) {
+      if (bounded_ != nullptr) {
+        return TakeAllBounded();
+      }
     }
-    not_full_.notify_one();
-    return result;
+    std::deque<T> items;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_empty_.wait(lock, [&] { return !queue_.empty(); });
+      items.swap(queue_);
+    }
+    return std::vector<T>(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
   }
 
   bool empty() const {
+    if (bounded_ != nullptr) {
+      return bounded_->empty();
+    }
     std::lock_guard<std::mutex> lock(mutex_);
     return queue_.empty();
   }
 
   size_t size() const {
+    if (bounded_ != nullptr) {
+      return bounded_->size();
+    }
     std::lock_guard<std::mutex> lock(mutex_);
     return queue_.size();
   }
 private:
-  std::queue<T> queue_;
+  static constexpr size_t kTakeBatch = 64;
+
+  // Pops in batches of kTakeBatch and more until the queue runs empty.
+  std::vector<T> TakeAllBounded() {
+    std::vector<T> result(kTakeBatch);
+    size_t n = bounded_->pop_n(result.data(), result.size());
+    while (n == result.size()) {
+      result.resize(2 * n);
+      n += bounded_->try_pop_n(result.data() + n, result.size() - n);
+    }
+    result.resize(n);
+    return result;
+  }
+
+  // set if constructed with a capacity, the members below are unused then
+  const std::unique_ptr<BlockingMPMCQueue<T>> bounded_;
+
+  std::deque<T> queue_;
   mutable std::mutex mutex_;
   std::condition_variable not_empty_;
-  std::condition_variable not_full_;
-  size_t max_size_ = std::numeric_limits<size_t>::max();
-
 };
 
 }
@@ -5,6 +5,9 @@
 #ifndef YEDIS_DB_H
 #define YEDIS_DB_H
 
+#include <string>
+#include <vector>
+
 #include "common/status.h"
 #include "iterator.h"
 
@@ -15,23 +18,73 @@ struct ReadOptions;
 struct WriteOptions;
 class WriteBatch;
 
+extern const char* kDefaultColumnFamilyName;
+
+// A column family is an independent keyspace of a DB: it has its own
+// memtables, table files and table options, but shares the WAL, the
+// MANIFEST and the sequence numbers with all other column families, so a
+// WriteBatch spanning several of them is still atomic.
+class ColumnFamilyHandle {
+  public:
+    virtual ~ColumnFamilyHandle();
+    virtual const std::string& GetName() const = 0;
+    virtual uint32_t GetID() const = 0;
+};
+
+struct ColumnFamilyDescriptor {
+    std::string name;
+    // Only the memtable and table related fields are used, e.g.
+    // write_buffer_size, block_size, block_cache, filter_policy and
+    // compression.  All column families share the DB comparator.
+    const Options* options;
+};
+
 class DB {
   public:
     static Status Open(const Options& options, const std::string& name,
                        DB** dbptr);
+
+    // Open the DB with the given column families.  Column families found
+    // in the DB but not listed use "options", listed ones that do not
+    // exist yet are created.  The default column family always uses
+    // "options".  On success "*handles" holds one handle per descriptor,
+    // in order.  Handles are owned by the DB and stay valid
+    // until it is deleted.
+    static Status Open(const Options& options, const std::string& name,
+                       const std::vector<ColumnFamilyDescriptor>& column_families,
+                       std::vector<ColumnFamilyHandle*>* handles, DB** dbptr);
     DB() = default;
 
     DB(const DB&) = delete;
     DB& operator=(const DB&) = delete;
 
+    // Create a column family named "name", "options" is used as in
+    // ColumnFamilyDescriptor.  The handle is owned by the DB.
+    virtual Status CreateColumnFamily(const Options& options, const std::string& name,
+                                      ColumnFamilyHandle** handle) = 0;
+
+    virtual ColumnFamilyHandle* DefaultColumnFamily() const = 0;
+
     virtual Status Put(const WriteOptions& options, const Slice& key,
                        const Slice& value) = 0;
+    virtual Status Put(const WriteOptions& options, ColumnFamilyHandle* column_family,
+                       const Slice& key, const Slice& value) = 0;
 
     // Remove the database entry (if any) for "key".  Returns OK on
     // success, and a non-OK status on error.  It is not an error if "key"
     // did not exist in the database.
     // Note: consider setting options.sync = true.
     virtual Status Delete(const WriteOptions& options, const Slice& key) = 0;
+    virtual Status Delete(const WriteOptions& options, ColumnFamilyHandle* column_family,
+                          const Slice& key) = 0;
+
+    // Record "value" as a merge operand of "key", reads see the merge
+    // operator of the column family applied to the current value and
+    // "value".  Returns NotSupported if the column family has no merge
+    // operator.
+    virtual Status Merge(const WriteOptions& options, const Slice& key, const Slice& value) = 0;
+    virtual Status Merge(const WriteOptions& options, ColumnFamilyHandle* column_family,
+                         const Slice& key, const Slice& value) = 0;
 
     // Apply the specified updates to the database.
     // Returns OK on success, non-OK on failure.
@@ -47,6 +100,8 @@ class DB {
     // May return some other Status on an error.
     virtual Status Get(const ReadOptions& options, const Slice& key,
                        std::string* value) = 0;
+    virtual Status Get(const ReadOptions& options, ColumnFamilyHandle* column_family,
+                       const Slice& key, std::string* value) = 0;
 
     // Return a heap-allocated iterator over the contents of the database.
     // The result of NewIterator() is initially invalid (caller must
@@ -55,6 +110,24 @@ class DB {
     // Caller should delete the iterator when it is no longer needed.
     // The returned iterator should be deleted before this db is deleted.
     virtual Iterator* NewIterator(const ReadOptions& options) = 0;
+    virtual Iterator* NewIterator(const ReadOptions& options, ColumnFamilyHandle* column_family) = 0;
+
+    // DB implementations can export properties about their state
+    // via this method.  If "property" is a valid property understood by this
+    // DB implementation, fills "*value" with its current value and returns
+    // true.  Otherwise returns false.
+    //
+    // Valid property names include:
+    //
+    //  "ydb.num-files-at-level<N>" - return the number of files at level <N>,
+    //     where <N> is an ASCII representation of a level number (e.g. "0").
+    //  "ydb.pending-compaction-bytes" - estimated bytes compactions still
+    //     have to move out of their level.
+    //  "ydb.write-stall" - number and total time of writes slowed down or
+    //     stopped while compactions catch up.
+    //  "ydb.stats" - counters and latency histograms of options.statistics,
+    //     false if it is not set.
+    virtual bool GetProperty(const Slice& property, std::string* value) = 0;
 
     virtual ~DB();
 
@@ -32,10 +32,14 @@ class DiskManager {
 
   page_id_t AllocatePage();
 
+  // pages allocated so far, including the ones found in the file when
+  // it was opened
+  page_id_t NumPages() const { return next_page_id_; }
+
   void Destroy();
 
  private:
-  int GetFileSize(const std::string &file_name);
+  int64_t GetFileSize(const std::string &file_name);
 
   std::string file_name_;
   int fd_;
@@ -0,0 +1,99 @@
+//
+// Sampled, structured trace of the few events worth keeping in builds
+// that compile logging out.
+//
+
+#ifndef YEDIS_EVENT_TRACE_H
+#define YEDIS_EVENT_TRACE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+
+namespace yedis {
+
+enum class TraceEventType : uint8_t {
+  // a buffer pool frame was reused for another page
+  kPageEvict = 0,
+  // the btree grew a level
+  kBTreeRootSplit,
+  kMemTableSwitch,
+  kFlush,
+  kCompaction,
+  // a write was slowed down or stopped
+  kWriteStall,
+  kTraceEventTypeMax
+};
+
+const char* TraceEventTypeName(TraceEventType type);
+
+struct TraceEventField {
+  const char* name;
+  int64_t value;
+};
+
+struct TraceEvent {
+  static constexpr int kMaxFields = 6;
+
+  TraceEventType type;
+  uint64_t timestamp_micros;  // since the epoch
+  int num_fields;
+  TraceEventField fields[kMaxFields];
+
+  // "event=flush ts=1700000000000000 cf=0 file=12 bytes=4096"
+  std::string ToString() const;
+};
+
+// Receives the recorded events, from any thread.
+class EventTraceSink {
+public:
+  EventTraceSink() = default;
+  EventTraceSink(const EventTraceSink&) = delete;
+  EventTraceSink& operator=(const EventTraceSink&) = delete;
+
+  virtual ~EventTraceSink() = default;
+
+  virtual void Write(const TraceEvent& event) = 0;
+};
+
+// Logs every event it gets at info level.
+EventTraceSink* NewLogEventTraceSink();
+
+// Records one in "sample_every" events of each type into "sink", process
+// wide.  nullptr stops recording, the previous sink may still see events
+// that were being recorded concurrently, so it has to outlive them.
+void SetEventTraceSink(EventTraceSink* sink, uint32_t sample_every = 1);
+
+namespace event_trace {
+
+extern std::atomic<EventTraceSink*> sink;
+
+// Counts the event and returns true if it is to be recorded.
+bool Sample(TraceEventType type);
+// Fields past TraceEvent::kMaxFields are dropped.
+void Record(TraceEventType type, std::initializer_list<TraceEventField> fields);
+
+}
+
+// Costs one relaxed load while no sink is set, the fields are evaluated
+// only for recorded events.  More than TraceEvent::kMaxFields fields do
+// not compile:
+//
+//   YEDIS_TRACE_EVENT(TraceEventType::kFlush, {"file", number}, {"bytes", size});
+#define YEDIS_TRACE_EVENT(type, ...)                                               \
+  do {                                                                             \
+    static_assert(std::tuple_size_v<decltype(std::to_array<                       \
+                      ::yedis::TraceEventField>({__VA_ARGS__}))>                   \
+                      <= ::yedis::TraceEvent::kMaxFields,                          \
+                  "too many trace event fields");                                  \
+    if (::yedis::event_trace::sink.load(std::memory_order_relaxed) != nullptr      \
+        && ::yedis::event_trace::Sample(type)) {                                   \
+      ::yedis::event_trace::Record(type, {__VA_ARGS__});                           \
+    }                                                                              \
+  } while (0)
+
+}
+
+#endif //YEDIS_EVENT_TRACE_H
@@ -20,6 +20,25 @@ public:
   virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const = 0;
 };
 
-const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
+// Filter formats written by the built-in policies.  Version 1 hashes keys
+// with the 32-bit Hash, version 2 with the 64-bit Hash64: faster on long
+// keys and, for Bloom filters, not limited to 2^32 bit positions, which
+// keeps the fp rate on very large tables.  The policies read filters of
+// every version, format_version only picks what new tables get; use 1 while
+// binaries that predate version 2 still have to read the tables, they treat
+// version 2 filters as matching every key.
+static constexpr int kLegacyFilterFormatVersion = 1;
+static constexpr int kFilterFormatVersion = 2;
+
+const FilterPolicy* NewBloomFilterPolicy(int bits_per_key, int format_version = kFilterFormatVersion);
+
+// Bloom filter whose probes for a key all hit one 64-byte cache line.
+// Slightly higher fp rate than NewBloomFilterPolicy at the same bits_per_key.
+const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key, int format_version = kFilterFormatVersion);
+
+// Standard Ribbon filter.  bits_per_key is the Bloom-equivalent setting: the
+// fp rate matches NewBloomFilterPolicy(bits_per_key) while using about 30%
+// less space.  Construction is slower than for Bloom filters.
+const FilterPolicy* NewRibbonFilterPolicy(int bits_per_key, int format_version = kFilterFormatVersion);
 }
 #endif //YEDIS_FILTER_POLICY_H
@@ -0,0 +1,50 @@
+//
+// Read-modify-write operators applied by reads and compactions.
+//
+
+#ifndef YEDIS_MERGE_OPERATOR_H
+#define YEDIS_MERGE_OPERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace yedis {
+class Slice;
+
+// A Merge write records an operand instead of a new value.  Reads fold
+// the operands of a key on top of its latest value, and compactions fold
+// them as soon as they meet that value, so a counter update costs a blind
+// write instead of a Get followed by a Put.
+//
+// Must be thread safe, it is called from compaction threads and from
+// readers concurrently.
+class MergeOperator {
+public:
+  virtual ~MergeOperator();
+
+  virtual const char* Name() const = 0;
+
+  // Store in "*new_value" the result of applying "operands" (oldest
+  // first) to "existing_value", which is nullptr if the key has no value
+  // or was deleted.  Returns false if the operands are malformed, the
+  // read or compaction then fails with a corruption error.
+  virtual bool FullMerge(const Slice& key, const Slice* existing_value,
+                         const std::vector<Slice>& operands,
+                         std::string* new_value) const = 0;
+
+  // Combine "operands" (oldest first) into the single operand "*new_value"
+  // without knowing the value below them.  Returns false if they cannot
+  // be combined, compactions then keep them as they are.
+  virtual bool PartialMerge(const Slice& key, const std::vector<Slice>& operands,
+                            std::string* new_value) const;
+};
+
+// Values and operands are fixed64 encoded int64 numbers, operands are
+// added to the value.  A missing value counts as 0.  The caller owns the
+// result.
+const MergeOperator* NewInt64AddOperator();
+
+}
+
+#endif //YEDIS_MERGE_OPERATOR_H
@@ -0,0 +1,256 @@
+//
+// Bounded lock-free multi-producer multi-consumer queue.
+//
+
+#ifndef YEDIS_MPMC_QUEUE_H
+#define YEDIS_MPMC_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace yedis {
+
+// Ring buffer of "capacity" cells, each with a sequence number telling
+// whose turn it is (D. Vyukov's bounded MPMC queue).  The cell for
+// position pos is free for the producer of pos when its sequence is pos,
+// and full for the consumer of pos when it is pos + 1.  Producers and
+// consumers claim positions with one CAS on their own counter, so they
+// never wait for each other unless the queue is full or empty.
+//
+// The batched calls claim a run of cells with a single CAS.
+//
+// T must be default constructible and movable.
+template <typename T>
+class MPMCQueue {
+public:
+  // "capacity" is rounded up to a power of 2.
+  explicit MPMCQueue(size_t capacity)
+      : capacity_(RoundUpToPowerOf2(capacity)),
+        mask_(capacity_ - 1),
+        cells_(new Cell[capacity_]),
+        enqueue_pos_(0),
+        dequeue_pos_(0) {
+    for (size_t i = 0; i < capacity_; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MPMCQueue(const MPMCQueue&) = delete;
+  MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+  size_t capacity() const { return capacity_; }
+
+  // Returns false if the queue is full, "item" is left alone then.
+  bool try_push(T&& item) {
+    return try_push_n(&item, 1) == 1;
+  }
+
+  bool try_push(const T& item) {
+    T copy(item);
+    return try_push(std::move(copy));
+  }
+
+  // Returns false if the queue is empty.
+  bool try_pop(T* item) {
+    return try_pop_n(item, 1) == 1;
+  }
+
+  // Moves up to "n" items from "items" to the queue, in order, and returns
+  // how many were pushed: fewer than "n" only if the queue filled up.
+  size_t try_push_n(T* items, size_t n) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t k;
+    while (true) {
+      k = CountCells(pos, n, 0);
+      if (k == 0) {
+        const size_t seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+        if (seq < pos) {
+          // the consumer of the previous lap is not done, full
+          return 0;
+        }
+        // another producer took pos
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (size_t i = 0; i < k; i++) {
+      Cell& cell = cells_[(pos + i) & mask_];
+      cell.item = std::move(items[i]);
+      cell.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    return k;
+  }
+
+  // Moves up to "n" items, oldest first, to "items" and returns how many:
+  // fewer than "n" only if the queue ran empty.
+  size_t try_pop_n(T* items, size_t n) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    size_t k;
+    while (true) {
+      k = CountCells(pos, n, 1);
+      if (k == 0) {
+        const size_t seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+        if (seq < pos + 1) {
+          // the producer of pos is not done, empty
+          return 0;
+        }
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (dequeue_pos_.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (size_t i = 0; i < k; i++) {
+      Cell& cell = cells_[(pos + i) & mask_];
+      items[i] = std::move(cell.item);
+      cell.sequence.store(pos + i + capacity_, std::memory_order_release);
+    }
+    return k;
+  }
+
+  // Approximate while other threads push or pop.
+  size_t size() const {
+    const size_t dequeue = dequeue_pos_.load(std::memory_order_relaxed);
+    const size_t enqueue = enqueue_pos_.load(std::memory_order_relaxed);
+    return enqueue > dequeue ? enqueue - dequeue : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T item;
+  };
+
+  static size_t RoundUpToPowerOf2(size_t n) {
+    size_t result = 1;
+    while (result < n) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  // Number of the cells from position "pos" on, at most "n", whose
+  // sequence is their position plus "offset": free cells for producers
+  // (0), full cells for consumers (1).  A cell in that state stays in it
+  // until the thread that claims its position moves it on.
+  size_t CountCells(size_t pos, size_t n, size_t offset) const {
+    n = std::min(n, capacity_);
+    size_t k = 0;
+    while (k < n && cells_[(pos + k) & mask_].sequence.load(std::memory_order_acquire) == pos + k + offset) {
+      k++;
+    }
+    return k;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  const std::unique_ptr<Cell[]> cells_;
+  // producers and consumers do not share a cache line
+  alignas(64) std::atomic<size_t> enqueue_pos_;
+  alignas(64) std::atomic<size_t> dequeue_pos_;
+};
+
+// MPMCQueue whose push and pop wait while it is full or empty.  Waiting
+// threads sleep in the kernel (a futex on Linux), the fast paths only
+// check whether anyone sleeps.
+template <typename T>
+class BlockingMPMCQueue {
+public:
+  explicit BlockingMPMCQueue(size_t capacity): queue_(capacity), pushes_(0), pops_(0) {}
+
+  size_t capacity() const { return queue_.capacity(); }
+
+  void push(T item) {
+    while (true) {
+      const uint32_t pops = pops_.load(std::memory_order_acquire);
+      if (queue_.try_push(std::move(item))) {
+        break;
+      }
+      pops_.wait(pops, std::memory_order_acquire);
+    }
+    pushes_.fetch_add(1, std::memory_order_release);
+    pushes_.notify_one();
+  }
+
+  T pop() {
+    T item;
+    while (true) {
+      const uint32_t pushes = pushes_.load(std::memory_order_acquire);
+      if (queue_.try_pop(&item)) {
+        break;
+      }
+      pushes_.wait(pushes, std::memory_order_acquire);
+    }
+    pops_.fetch_add(1, std::memory_order_release);
+    pops_.notify_one();
+    return item;
+  }
+
+  // Waits for at least one item, then moves up to "n" items to "items".
+  size_t pop_n(T* items, size_t n) {
+    size_t k;
+    while (true) {
+      const uint32_t pushes = pushes_.load(std::memory_order_acquire);
+      k = queue_.try_pop_n(items, n);
+      if (k > 0) {
+        break;
+      }
+      pushes_.wait(pushes, std::memory_order_acquire);
+    }
+    pops_.fetch_add(1, std::memory_order_release);
+    // room for more than one producer
+    pops_.notify_all();
+    return k;
+  }
+
+  bool try_push(T item) {
+    if (!queue_.try_push(std::move(item))) {
+      return false;
+    }
+    pushes_.fetch_add(1, std::memory_order_release);
+    pushes_.notify_one();
+    return true;
+  }
+
+  bool try_pop(T* item) {
+    if (!queue_.try_pop(item)) {
+      return false;
+    }
+    pops_.fetch_add(1, std::memory_order_release);
+    pops_.notify_one();
+    return true;
+  }
+
+  size_t try_pop_n(T* items, size_t n) {
+    const size_t k = queue_.try_pop_n(items, n);
+    if (k > 0) {
+      pops_.fetch_add(1, std::memory_order_release);
+      pops_.notify_all();
+    }
+    return k;
+  }
+
+  size_t size() const { return queue_.size(); }
+  bool empty() const { return queue_.empty(); }
+
+private:
+  MPMCQueue<T> queue_;
+  // Bumped after every push and pop, sleepers wait for them to change.
+  // They wrap around, a sleeper only needs to see a different value.
+  std::atomic<uint32_t> pushes_;
+  std::atomic<uint32_t> pops_;
+};
+
+}  // namespace yedis
+
+#endif //YEDIS_MPMC_QUEUE_H
@@ -17,6 +17,9 @@ namespace config {
 
   static const int kNumLevels = 7;
 
+  // Level-0 compaction is started when we hit this many files.
+  static const int kL0_CompactionTrigger = 4;
+
 }
 }
 #endif //YEDIS_INCLUDE_OPTION_HPP_
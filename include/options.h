@@ -23,6 +23,10 @@ namespace yedis {
 
   class Snapshot;
   class FileSystem;
+  class RateLimiter;
+  class Statistics;
+  class CompactionFilter;
+  class MergeOperator;
 
 // DB contents are stored in a set of blocks, each of which holds a
 // sequence of key,value pairs.  Each block may be compressed before
@@ -35,6 +39,20 @@ namespace yedis {
     kSnappyCompression = 0x1
   };
 
+// The layout of the index (and, optionally, the filter) of a table.
+  enum IndexType {
+    // NOTE: do not change the values of existing entries, as these are
+    // part of the persistent format on disk.
+
+    // A single index block holding one entry per data block.  The whole
+    // block is loaded into memory when the table is opened.
+    kBinarySearch = 0x0,
+    // The index is cut into partitions of about metadata_block_size bytes.
+    // Only the top-level index over the partitions stays resident, the
+    // partitions themselves are read on demand through block_cache.
+    kTwoLevelIndexSearch = 0x1
+  };
+
 // Options to control the behavior of a database (passed to DB::Open)
   struct Options {
     // Create an Options object with default values for all fields.
@@ -81,12 +99,20 @@ namespace yedis {
     // on disk) before converting to a sorted on-disk file.
     //
     // Larger values increase performance, especially during bulk loads.
-    // Up to two write buffers may be held in memory at the same time,
-    // so you may wish to adjust this parameter to control memory usage.
+    // Up to max_write_buffer_number write buffers may be held in memory
+    // at the same time, so you may wish to adjust this parameter to
+    // control memory usage.
     // Also, a larger write buffer will result in a longer recovery time
     // the next time the database is opened.
     size_t write_buffer_size = 4 * 1024 * 1024;
 
+    // Maximum number of write buffers held in memory, the one being
+    // written included.  Full buffers queue up for flush while writes go
+    // on into a new one, writes wait only when all of them are full.
+    // Buffers that queued up behind a running flush are merged into one
+    // level-0 file by the next flush.
+    int max_write_buffer_number = 2;
+
     // Number of open files that can be used by the DB.  You may need to
     // increase this if your database has a large working set (budget
     // one open file per 2MB of working set).
@@ -142,11 +168,95 @@ namespace yedis {
     // Default: currently false, but may become true later.
     bool reuse_logs = false;
 
+    // If true, table files are memory mapped and blocks are read straight
+    // out of the mapping without a copy.  Mapped blocks bypass block_cache,
+    // the OS page cache holds them instead.
+    bool allow_mmap_reads = false;
+
+    // If true, table files written by flushes and compactions are opened
+    // with O_DIRECT, so this background traffic does not evict hot pages
+    // from the OS page cache.  Writes are staged in aligned buffers of
+    // writable_file_max_buffer_size bytes.
+    bool use_direct_io_for_flush_and_compaction = false;
+
+    size_t writable_file_max_buffer_size = 1024 * 1024;
+
+    // Size of the aligned read-ahead buffer used when compaction inputs are
+    // read with direct I/O.  Rounded up to the sector size.
+    size_t compaction_readahead_size = 2 * 1024 * 1024;
+
+    // If non-null, flush and compaction writes are throttled through this
+    // limiter, flushes ahead of compactions.  It may be shared by several
+    // DBs.  Reads served from tables report their latency to it, which an
+    // auto-tuned limiter uses to back off.
+    RateLimiter* rate_limiter = nullptr;
+
+    // If non-null, operations record counters and latencies into it, see
+    // CreateDBStatistics() and the "ydb.stats" property.  It may be shared
+    // by several DBs.
+    Statistics* statistics = nullptr;
+
+    // Number of threads that flush immutable memtables to level-0.
+    int max_background_flushes = 1;
+
+    // Maximum number of compactions running at the same time.  Concurrent
+    // compactions never share input files nor write overlapping key ranges
+    // into the same level.
+    int max_background_compactions = 1;
+
+    // A compaction is split into up to this many key-range shards that are
+    // merged in parallel on the compaction thread pool.  1 disables
+    // subcompactions.
+    uint32_t max_subcompactions = 1;
+
+    // Once level-0 holds level0_slowdown_writes_trigger files every write
+    // is delayed by write_stall_delay_micros, one more delay per file
+    // above the trigger, so that compactions can catch up.  Writes stop
+    // until a compaction finishes at level0_stop_writes_trigger files.
+    int level0_slowdown_writes_trigger = 8;
+    int level0_stop_writes_trigger = 12;
+
+    // The same for the estimated number of bytes compactions still have to
+    // move out of their level.  0 disables the limit.
+    uint64_t soft_pending_compaction_bytes_limit = 64ull * 1024 * 1024 * 1024;
+    uint64_t hard_pending_compaction_bytes_limit = 256ull * 1024 * 1024 * 1024;
+
+    uint64_t write_stall_delay_micros = 1000;
+
     // If non-null, use the specified filter policy to reduce disk reads.
     // Many applications will benefit from passing the result of
     // NewBloomFilterPolicy() here.
     const FilterPolicy *filter_policy = nullptr;
 
+    // If true, build a single filter over all keys of a table instead of
+    // one filter per 2KB of file offset.  A lookup then probes the filter
+    // once before touching the index.  Ignored when partition_filters is
+    // in effect.
+    bool full_filter = false;
+
+    // Layout of the index block written by TableBuilder.  Readers detect
+    // the layout from the table itself, so this only affects new tables.
+    IndexType index_type = kBinarySearch;
+
+    // If true and index_type is kTwoLevelIndexSearch, the filter is cut at
+    // the same boundaries as the index partitions and only the top-level
+    // filter index stays resident.
+    bool partition_filters = false;
+
+    // Approximate size of an index or filter partition.  Only used when
+    // index_type is kTwoLevelIndexSearch.
+    size_t metadata_block_size = 4 * 1024;
+
+    // If non-null, flushes and compactions consult it for every value
+    // they rewrite and remove the ones it rejects, e.g. expired keys with
+    // NewTTLCompactionFilter().  Gets do not return rejected values either.
+    const CompactionFilter* compaction_filter = nullptr;
+
+    // Required to use Merge.  Reads and compactions apply it to combine
+    // merge operands with the value below them, e.g. NewInt64AddOperator()
+    // for counters.
+    const MergeOperator* merge_operator = nullptr;
+
     FileSystem* file_system;
 
   };
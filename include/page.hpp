@@ -20,7 +20,7 @@ namespace yedis {
     }
     Page(): Page(BTreeOptions{}) {}
     ~Page() {
-      delete data_;
+      free(data_);
     };
 
     inline char *GetData() { return data_; }
@@ -45,12 +45,12 @@ namespace yedis {
     }
 
     inline void Pin() {
-      SPDLOG_INFO("page_id {} pinned", GetPageId());
+      SPDLOG_TRACE("page_id {} pinned", GetPageId());
       pinned_ = true;
     }
 
     inline void UnPin() {
-      SPDLOG_INFO("page_id {} unpinned", GetPageId());
+      SPDLOG_TRACE("page_id {} unpinned", GetPageId());
       pinned_ = false;
     }
 
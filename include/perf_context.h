@@ -0,0 +1,111 @@
+//
+// Per-thread counters of where the time of a single request went.
+//
+
+#ifndef YEDIS_PERF_CONTEXT_H
+#define YEDIS_PERF_CONTEXT_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace yedis {
+
+// How much the calling thread records into its PerfContext.
+enum class PerfLevel : int {
+  kDisable = 0,
+  // counters only
+  kEnableCount = 1,
+  // counters and timers, every timer reads the clock twice
+  kEnableTime = 2,
+};
+
+// Applies to the calling thread only, kDisable by default.
+void SetPerfLevel(PerfLevel level);
+PerfLevel GetPerfLevel();
+
+// Accumulates until Reset(), so a caller resets it, runs one request and
+// reads what that request did.  Times are in nanoseconds.
+struct PerfContext {
+  // memtable lookups of Get
+  uint64_t get_from_memtable_count;
+  uint64_t get_from_memtable_time;
+  // table lookups of Get, one per table file searched
+  uint64_t get_from_table_count;
+  uint64_t get_from_table_time;
+  // data and index blocks
+  uint64_t block_read_count;
+  uint64_t block_read_byte;
+  uint64_t block_read_time;
+  uint64_t block_cache_hit_count;
+  // filter probes and how many of them ruled out the key
+  uint64_t bloom_filter_checked;
+  uint64_t bloom_filter_useful;
+  // value bytes returned by Get
+  uint64_t get_read_bytes;
+  // waiting for the db mutex
+  uint64_t db_mutex_lock_time;
+  // waiting for the writes queued ahead, before the db mutex
+  uint64_t write_thread_wait_time;
+
+  void Reset();
+  // "name = value" pairs, zeros left out if exclude_zero_counters.
+  std::string ToString(bool exclude_zero_counters = false) const;
+};
+
+// The PerfContext of the calling thread.
+PerfContext* get_perf_context();
+
+namespace perf {
+
+extern thread_local PerfLevel perf_level;
+extern thread_local PerfContext perf_context;
+
+inline void Count(uint64_t PerfContext::*counter, uint64_t n = 1) {
+  if (perf_level >= PerfLevel::kEnableCount) {
+    perf_context.*counter += n;
+  }
+}
+
+// Adds the time from construction (or Start()) to Stop() or destruction
+// to "metric", if the thread records times.
+class Timer {
+public:
+  explicit Timer(uint64_t PerfContext::*metric, bool auto_start = true)
+    : metric_(metric), running_(false) {
+    if (auto_start) {
+      Start();
+    }
+  }
+
+  Timer(const Timer&) = delete;
+  Timer& operator=(const Timer&) = delete;
+
+  ~Timer() { Stop(); }
+
+  void Start() {
+    if (perf_level >= PerfLevel::kEnableTime) {
+      start_ = std::chrono::steady_clock::now();
+      running_ = true;
+    }
+  }
+
+  void Stop() {
+    if (running_) {
+      auto elapsed = std::chrono::steady_clock::now() - start_;
+      perf_context.*metric_ += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+      running_ = false;
+    }
+  }
+
+private:
+  uint64_t PerfContext::* const metric_;
+  bool running_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}
+
+}
+
+#endif //YEDIS_PERF_CONTEXT_H
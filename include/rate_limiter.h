@@ -0,0 +1,51 @@
+//
+// Token bucket shared by background writers.
+//
+
+#ifndef YEDIS_RATE_LIMITER_H
+#define YEDIS_RATE_LIMITER_H
+
+#include <cstdint>
+
+namespace yedis {
+
+class RateLimiter {
+public:
+  // Flushes are served before compactions, a blocked flush eventually
+  // stalls foreground writes.
+  enum Priority { kLow = 0, kHigh = 1, kNumPriorities = 2 };
+
+  RateLimiter() = default;
+  RateLimiter(const RateLimiter&) = delete;
+  RateLimiter& operator=(const RateLimiter&) = delete;
+
+  virtual ~RateLimiter() = default;
+
+  virtual void SetBytesPerSecond(int64_t bytes_per_second) = 0;
+  virtual int64_t GetBytesPerSecond() const = 0;
+
+  // Blocks until bytes may be written.  Requests larger than
+  // GetSingleBurstBytes() must be split by the caller.
+  virtual void Request(int64_t bytes, Priority pri) = 0;
+
+  // Largest amount of bytes a single Request() can be granted.
+  virtual int64_t GetSingleBurstBytes() const = 0;
+
+  virtual int64_t GetTotalBytesThrough(Priority pri) const = 0;
+
+  // Feedback from foreground reads, only used when auto tuning.
+  virtual void RecordReadLatency(uint64_t micros) {}
+};
+
+// Create a token bucket allowing rate_bytes_per_sec, refilled every
+// refill_period_us.  If auto_tuned is set, the rate is lowered (down to
+// 1/20 of rate_bytes_per_sec) while the average latency reported through
+// RecordReadLatency() is above target_read_latency_us and raised back
+// while it is below.
+RateLimiter* NewGenericRateLimiter(int64_t rate_bytes_per_sec,
+                                   int64_t refill_period_us = 100 * 1000,
+                                   bool auto_tuned = false,
+                                   uint64_t target_read_latency_us = 1000);
+}
+
+#endif //YEDIS_RATE_LIMITER_H
@@ -1,53 +1,129 @@
-
 #ifndef YEDIS_READER_WRITER_LATCH_H_
 #define YEDIS_READER_WRITER_LATCH_H_
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <mutex>
-#include <condition_variable>
-#include <climits>
-
-#include <spdlog/spdlog.h>
+#include <thread>
 
 namespace yedis {
 
+// Reader-writer latch whose readers only touch their own counter.  The
+// reader count is spread over cache line sized stripes, a thread always
+// uses the same one, so readers on different cores do not bounce a shared
+// line.  Writers are serialized by a mutex, announce themselves and then
+// wait for every stripe to drain.  Writers have preference: a reader that
+// sees a writer announced backs off until it is done.
 class ReaderWriterLatch {
   public:
+    ReaderWriterLatch(): writer_(false) {
+      for (auto& stripe: readers_) {
+        stripe.count.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    ReaderWriterLatch(const ReaderWriterLatch&) = delete;
+    ReaderWriterLatch& operator=(const ReaderWriterLatch&) = delete;
+
     void WLock() {
-      std::unique_lock<std::mutex> lk(mu_);
-      // why need this, implement w-w mutex
-      reader_cond_.wait(lk, [&]{return !writers_entered_;});
-      writers_entered_ = true;
-      writer_cond_.wait(lk, [&]{ return readers_cnt_ == 0;});
+      writer_mu_.lock();
+      writer_.store(true, std::memory_order_seq_cst);
+      for (auto& stripe: readers_) {
+        int readers;
+        while ((readers = stripe.count.load(std::memory_order_seq_cst)) != 0) {
+          stripe.count.wait(readers, std::memory_order_seq_cst);
+        }
+      }
     }
     void WUnLock() {
-      std::lock_guard<std::mutex> lk(mu_);
-      writers_entered_ = false;
-      reader_cond_.notify_all();
+      writer_.store(false, std::memory_order_release);
+      writer_.notify_all();
+      writer_mu_.unlock();
     }
     void RLock() {
-      std::unique_lock<std::mutex> lk(mu_);
-      reader_cond_.wait(lk, [&]{ return !writers_entered_ && readers_cnt_ < INT_MAX;});
-      readers_cnt_++;
+      std::atomic<int>& count = readers_[Stripe()].count;
+      while (true) {
+        count.fetch_add(1, std::memory_order_seq_cst);
+        if (!writer_.load(std::memory_order_seq_cst)) {
+          return;
+        }
+        Leave(count);
+        writer_.wait(true, std::memory_order_acquire);
+      }
     }
     void RUnLock() {
-      std::lock_guard<std::mutex> lock_guard(mu_);
-      readers_cnt_--;
-      if (writers_entered_) {
-        if (readers_cnt_ == 0) {
-          writer_cond_.notify_one();
-        }
-      } else {
-        if (readers_cnt_ == INT_MAX - 1) {
-          reader_cond_.notify_one();
-        }
+      Leave(readers_[Stripe()].count);
+    }
+  private:
+    static constexpr size_t kStripes = 8;
+
+    struct alignas(64) ReaderCount {
+      std::atomic<int> count;
+    };
+
+    // Stripes are handed out to threads round robin on first use.
+    static size_t Stripe() {
+      static std::atomic<size_t> next{0};
+      thread_local size_t stripe = next.fetch_add(1, std::memory_order_relaxed) % kStripes;
+      return stripe;
+    }
+
+    // Either the writer sees the decrement, or we see the writer and wake it.
+    void Leave(std::atomic<int>& count) {
+      count.fetch_sub(1, std::memory_order_seq_cst);
+      if (writer_.load(std::memory_order_seq_cst)) {
+        count.notify_all();
+      }
+    }
+
+    ReaderCount readers_[kStripes];
+    alignas(64) std::atomic<bool> writer_;
+    std::mutex writer_mu_;
+};
+
+// Version lock for readers that do not write shared memory at all: they
+// read, then validate that no writer ran meanwhile, and retry if one did.
+// The version is odd while a writer holds the latch.
+//
+//   uint64_t v;
+//   do {
+//     v = latch.ReadBegin();
+//     ... copy what is needed, trust nothing yet ...
+//   } while (!latch.Validate(v));
+class OptimisticLatch {
+  public:
+    OptimisticLatch(): version_(0) {}
+
+    OptimisticLatch(const OptimisticLatch&) = delete;
+    OptimisticLatch& operator=(const OptimisticLatch&) = delete;
+
+    // Waits out a running writer.
+    uint64_t ReadBegin() const {
+      uint64_t version;
+      while ((version = version_.load(std::memory_order_acquire)) & 1) {
+        std::this_thread::yield();
       }
+      return version;
+    }
+    // Returns true if no writer started since ReadBegin() returned "version".
+    bool Validate(uint64_t version) const {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return version_.load(std::memory_order_relaxed) == version;
+    }
+
+    void WLock() {
+      writer_mu_.lock();
+      version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+    }
+    void WUnLock() {
+      version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+      writer_mu_.unlock();
     }
   private:
-    std::mutex mu_;
-    std::condition_variable reader_cond_;
-    std::condition_variable writer_cond_;
-    int readers_cnt_{0};
-    bool writers_entered_{false};
+    std::atomic<uint64_t> version_;
+    std::mutex writer_mu_;
 };
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,118 @@
+//
+// Counters and latency histograms of DB operations.
+//
+
+#ifndef YEDIS_STATISTICS_H
+#define YEDIS_STATISTICS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace yedis {
+
+enum Tickers : uint32_t {
+  kBytesWritten = 0,
+  kKeysWritten,
+  // values returned by Get
+  kBytesRead,
+  kKeysRead,
+  kBlockCacheHit,
+  kBlockCacheMiss,
+  // a filter ruled out a table or block, a block read was saved
+  kBloomFilterUseful,
+  // Get answered by a memtable, or not
+  kMemtableHit,
+  kMemtableMiss,
+  // writes slowed down or stopped while compactions catch up
+  kStallMicros,
+  kWALSyncs,
+  // table files opened by a table cache miss
+  kTableFileOpens,
+  kTickerMax
+};
+
+enum Histograms : uint32_t {
+  kGetMicros = 0,
+  kPutMicros,
+  kWriteMicros,
+  kFlushMicros,
+  kCompactionMicros,
+  kHistogramMax
+};
+
+const char* TickerName(uint32_t ticker);
+const char* HistogramName(uint32_t histogram);
+
+struct HistogramData {
+  uint64_t count;
+  uint64_t sum;
+  uint64_t min;
+  uint64_t max;
+  double average;
+  double median;
+  double percentile95;
+  double percentile99;
+};
+
+// Thread safe.  Recording is meant to be cheap enough for every operation.
+class Statistics {
+public:
+  Statistics() = default;
+  Statistics(const Statistics&) = delete;
+  Statistics& operator=(const Statistics&) = delete;
+
+  virtual ~Statistics() = default;
+
+  virtual void RecordTick(uint32_t ticker, uint64_t count = 1) = 0;
+  virtual void MeasureTime(uint32_t histogram, uint64_t micros) = 0;
+
+  // Sums over all threads, a concurrent update may or may not be seen.
+  virtual uint64_t GetTickerCount(uint32_t ticker) const = 0;
+  virtual void GetHistogramData(uint32_t histogram, HistogramData* data) const = 0;
+
+  virtual void Reset() = 0;
+
+  // One line per ticker and histogram.
+  virtual std::string ToString() const = 0;
+};
+
+// Each thread records into its own cache line aligned shard, a read sums
+// them up.
+Statistics* CreateDBStatistics();
+
+inline void RecordTick(Statistics* statistics, uint32_t ticker, uint64_t count = 1) {
+  if (statistics != nullptr) {
+    statistics->RecordTick(ticker, count);
+  }
+}
+
+// Records the time between its construction and destruction, the clock is
+// not read at all without statistics.
+class StopWatch {
+public:
+  StopWatch(Statistics* statistics, uint32_t histogram)
+    : statistics_(statistics),
+      histogram_(histogram),
+      start_(statistics != nullptr ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()) {}
+
+  StopWatch(const StopWatch&) = delete;
+  StopWatch& operator=(const StopWatch&) = delete;
+
+  ~StopWatch() {
+    if (statistics_ != nullptr) {
+      auto elapsed = std::chrono::steady_clock::now() - start_;
+      statistics_->MeasureTime(histogram_,
+                               std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+  }
+
+private:
+  Statistics* const statistics_;
+  const uint32_t histogram_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+}
+
+#endif //YEDIS_STATISTICS_H
@@ -24,22 +24,27 @@ public:
   ~Table();
 
   Iterator* NewIterator(const ReadOptions&) const;
+
+  // Calls (*handle_result)(arg, ...) with the entries found from Seek(key)
+  // on, until it returns false.  No call is made if the filter policy says
+  // that key is not present, and the scan stops at the first data block
+  // whose filter rules it out.
+  Status InternalGet(const ReadOptions&, const Slice& key, void* arg,
+                     bool (*handle_result)(void* arg, const Slice& k,
+                                           const Slice& v));
 private:
   struct Rep;
 
 
   static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
+  // Iterator over the data block handles, hides a partitioned index.
+  Iterator* NewIndexIterator(const ReadOptions&) const;
   explicit Table(Rep* rep) : rep_(rep) {}
 
-  // Calls (*handle_result)(arg, ...) with the entry found after a call
-  // to Seek(key).  May not make such a call if filter policy says
-  // that key is not present.
-  Status InternalGet(const ReadOptions&, const Slice& key, void* arg,
-                     void (*handle_result)(void* arg, const Slice& k,
-                                           const Slice& v));
-
   void ReadMeta(const Footer& footer);
-  void ReadFilter(const Slice& filter_handle_value);
+  void ReadFilter(const Slice& filter_handle_value, bool full);
+  void ReadFilterIndex(const Slice& filter_index_handle_value);
+  bool PartitionedFilterMayMatch(const ReadOptions&, const Slice& key);
 
   Rep* const rep_;
 };
@@ -55,6 +55,12 @@ bool GetLengthPrefixedSlice(Slice* input, Slice* result);
 
 uint32_t Hash(const char *data, size_t n, uint32_t seed);
 
+// 64-bit XXH3 style hash, vectorized for long inputs.  The results are part
+// of the filter format and the same on every platform.
+uint64_t Hash64(const char *data, size_t n, uint64_t seed);
+// Hash64 without SIMD, for testing.
+uint64_t Hash64Portable(const char *data, size_t n, uint64_t seed);
+
 std::string TableFileName(const std::string& dbname, uint64_t number);
 std::string DescriptorFileName(const std::string& dbname, uint64_t number);
 std::string TempFileName(const std::string& dbname, uint64_t number);
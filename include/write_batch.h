@@ -9,6 +9,7 @@
 #include <common/status.h>
 
 namespace yedis {
+  class ColumnFamilyHandle;
 
   class WriteBatch {
   public:
@@ -19,6 +20,14 @@ namespace yedis {
       virtual void Put(const Slice &key, const Slice &value) = 0;
 
       virtual void Delete(const Slice &key) = 0;
+
+      virtual void Merge(const Slice &key, const Slice &value) = 0;
+
+      // Records of non-default column families, handlers that do not
+      // care about column families see them through Put, Delete and Merge.
+      virtual void PutCF(uint32_t column_family_id, const Slice &key, const Slice &value);
+      virtual void DeleteCF(uint32_t column_family_id, const Slice &key);
+      virtual void MergeCF(uint32_t column_family_id, const Slice &key, const Slice &value);
     };
 
     WriteBatch();
@@ -32,9 +41,16 @@ namespace yedis {
 
     // Store the mapping "key->value" in the database.
     void Put(const Slice &key, const Slice &value);
+    void Put(ColumnFamilyHandle* column_family, const Slice &key, const Slice &value);
 
     // If the database contains a mapping for "key", erase it.  Else do nothing.
     void Delete(const Slice &key);
+    void Delete(ColumnFamilyHandle* column_family, const Slice &key);
+
+    // Apply the merge operator of the column family to the current value
+    // of "key" and "value", see merge_operator.h.
+    void Merge(const Slice &key, const Slice &value);
+    void Merge(ColumnFamilyHandle* column_family, const Slice &key, const Slice &value);
 
     // Clear all updates buffered in this batch.
     void Clear();
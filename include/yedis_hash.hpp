@@ -0,0 +1,36 @@
+//
+// Hashes stored as one key per field, see yedis_keyspace.hpp.
+//
+
+#ifndef YEDIS_INCLUDE_YEDIS_HASH_HPP_
+#define YEDIS_INCLUDE_YEDIS_HASH_HPP_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "yedis_keyspace.hpp"
+
+namespace yedis {
+  class Hash {
+  public:
+    typedef std::vector<std::pair<std::string, std::string>> FieldValues;
+
+    explicit Hash(KeySpace *keyspace): keyspace_(keyspace) {}
+
+    // Sets the fields, "*added", if non-null, is set to the number of
+    // new fields.
+    Status hset(const Slice &key, const FieldValues &field_values, int *added = nullptr);
+
+    // NotFound if "key" has no "field".
+    Status hget(const Slice &key, const Slice &field, std::string *value);
+
+    // all fields and values of "key" ordered by field, none if there is
+    // no such hash
+    Status hgetall(const Slice &key, FieldValues *result);
+
+  private:
+    KeySpace *keyspace_;
+  };
+}
+#endif //YEDIS_INCLUDE_YEDIS_HASH_HPP_
@@ -0,0 +1,147 @@
+//
+// Key encoding and meta versioning shared by hashes, sets and lists.
+//
+
+#ifndef YEDIS_INCLUDE_YEDIS_KEYSPACE_HPP_
+#define YEDIS_INCLUDE_YEDIS_KEYSPACE_HPP_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "common/status.h"
+#include "compaction_filter.h"
+#include "options.h"
+#include "slice.h"
+
+namespace yedis {
+  class DB;
+  class ColumnFamilyHandle;
+
+  // The type of a collection, also the first byte of its member keys.
+  enum class KeyType : char {
+    kHash = 'h',
+    kSet = 's',
+    kList = 'l'
+  };
+
+  struct KeyMeta {
+    KeyType type = KeyType::kHash;
+    // embedded in every member key of the collection
+    uint64_t version = 0;
+    // number of members
+    int64_t size = 0;
+    // lists only: the elements are at indices [head, tail)
+    uint64_t head = 0;
+    uint64_t tail = 0;
+  };
+
+  // Storage layout, "key" is the length prefixed user key:
+  //   'M'  key                    -> type, version, size, list head and tail
+  //   type key version sub-key    -> member value
+  // The sub-key is the hash field, the set member or the list index.
+  // Versions and list indices are big-endian, so the elements of a list
+  // are sorted by index.
+  //
+  // Deleting a collection only removes its meta key.  A collection
+  // created under the same key later gets a newer version, the members
+  // written under older versions are never read again.
+  std::string MetaKey(const Slice &key);
+  std::string MemberPrefix(KeyType type, const Slice &key, uint64_t version);
+  std::string MemberKey(KeyType type, const Slice &key, uint64_t version, const Slice &sub_key);
+
+  void EncodeMeta(const KeyMeta &meta, std::string *value);
+  Status DecodeMeta(const Slice &value, KeyMeta *meta);
+
+  void PutBigEndian64(std::string *dst, uint64_t value);
+  uint64_t DecodeBigEndian64(const char *p);
+
+  // The error of a command against a key of another type.
+  Status WrongType();
+  // True if "s" reports a command against a key of another type.
+  bool IsWrongType(const Status &s);
+
+  // A version newer than all versions handed out before: microseconds
+  // since the epoch, bumped past the last one, so versions grow across
+  // restarts too.
+  uint64_t NewKeyVersion();
+
+  // Garbage collects the members of deleted collections: flushes and
+  // compactions drop member keys whose version is not the one of their
+  // meta key, so DEL only has to remove the meta key.
+  //
+  // Set it as compaction_filter of the member column families before the
+  // db is opened, Attach() it once the db is open and Detach() it before
+  // the db is deleted.  It keeps every entry while detached.  Readers
+  // never reach the entries it drops, so reads do not run it.
+  class VersionGCFilter : public CompactionFilter {
+  public:
+    VersionGCFilter(): db_(nullptr), meta_cf_(nullptr) {}
+
+    // Meta keys are read from "meta_cf" of "db".
+    void Attach(DB *db, ColumnFamilyHandle *meta_cf);
+    void Detach();
+
+    bool Filter(const Slice &key, const Slice &value) const override;
+    bool FilterReads() const override { return false; }
+
+  protected:
+    // Sets the meta key of the collection "key" belongs to and the version
+    // embedded in "key".  Returns false for keys that are no members.
+    virtual bool ParseMemberKey(const Slice &key, std::string *meta_key, uint64_t *version) const = 0;
+
+    // The version stored in a meta value, false if it is malformed.
+    virtual bool ParseMetaVersion(const Slice &meta_value, uint64_t *version) const = 0;
+
+  private:
+    std::atomic<DB *> db_;
+    std::atomic<ColumnFamilyHandle *> meta_cf_;
+  };
+
+  // GC filter for the column family of a KeySpace.  The caller owns the
+  // result.
+  VersionGCFilter *NewKeySpaceGCFilter();
+
+  // The collections of one column family.  Hash, Set and List share it,
+  // so a key holds one type at a time and writers of a key serialize on
+  // the same lock whatever the type.
+  class KeySpace {
+  public:
+    // collections live in "column_family", the default one if nullptr
+    explicit KeySpace(DB *db, ColumnFamilyHandle *column_family = nullptr);
+
+    KeySpace(const KeySpace &) = delete;
+    KeySpace &operator=(const KeySpace &) = delete;
+
+    // Removes the collection "key", whatever its size, with one delete of
+    // its meta key.  "*existed" is set to whether there was one.
+    Status del(const Slice &key, bool *existed);
+
+    // "hash", "set", "list" or "none"
+    Status type(const Slice &key, std::string *type);
+
+    DB *db() const { return db_; }
+    ColumnFamilyHandle *column_family() const { return column_family_; }
+    const ReadOptions &read_options() const { return read_options_; }
+    const WriteOptions &write_options() const { return write_options_; }
+
+    // Held by writers of "key" from reading its meta to writing it back.
+    std::mutex &KeyLock(const Slice &key);
+
+    // NotFound if "key" does not exist, WRONGTYPE if it is not a "type".
+    Status GetMeta(const Slice &key, KeyType type, KeyMeta *meta);
+
+    // Meta of an empty collection with a new version.
+    KeyMeta NewMeta(KeyType type);
+
+  private:
+    static constexpr int kNumKeyLocks = 64;
+
+    DB *db_;
+    ColumnFamilyHandle *column_family_;
+    std::mutex key_locks_[kNumKeyLocks];
+    ReadOptions read_options_;
+    WriteOptions write_options_;
+  };
+}
+#endif //YEDIS_INCLUDE_YEDIS_KEYSPACE_HPP_
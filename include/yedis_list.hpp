@@ -0,0 +1,38 @@
+//
+// Lists stored as one key per element, see yedis_keyspace.hpp.
+//
+
+#ifndef YEDIS_INCLUDE_YEDIS_LIST_HPP_
+#define YEDIS_INCLUDE_YEDIS_LIST_HPP_
+
+#include <string>
+#include <vector>
+
+#include "yedis_keyspace.hpp"
+
+namespace yedis {
+  // Elements are keyed by their index.  The meta value keeps the indices
+  // of the first and past the last element, pushes and pops at either end
+  // write one element and the meta value.
+  class List {
+  public:
+    typedef std::vector<std::string> StrList;
+
+    explicit List(KeySpace *keyspace): keyspace_(keyspace) {}
+
+    // Inserts "values" at the head one after another, so the last one ends
+    // up first.  "*length", if non-null, is set to the new length.
+    Status lpush(const Slice &key, const StrList &values, int64_t *length = nullptr);
+
+    // Removes and returns the last element, NotFound if the list is empty.
+    Status rpop(const Slice &key, std::string *value);
+
+    // Elements start to stop (inclusive), negative positions count from
+    // the last element.
+    Status lrange(const Slice &key, int64_t start, int64_t stop, StrList *result);
+
+  private:
+    KeySpace *keyspace_;
+  };
+}
+#endif //YEDIS_INCLUDE_YEDIS_LIST_HPP_
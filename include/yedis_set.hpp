@@ -0,0 +1,32 @@
+//
+// Sets stored as one key per member, see yedis_keyspace.hpp.
+//
+
+#ifndef YEDIS_INCLUDE_YEDIS_SET_HPP_
+#define YEDIS_INCLUDE_YEDIS_SET_HPP_
+
+#include <string>
+#include <vector>
+
+#include "yedis_keyspace.hpp"
+
+namespace yedis {
+  class Set {
+  public:
+    typedef std::vector<std::string> StrList;
+
+    explicit Set(KeySpace *keyspace): keyspace_(keyspace) {}
+
+    // "*added", if non-null, is set to the number of new members.
+    Status sadd(const Slice &key, const StrList &members, int *added = nullptr);
+
+    Status sismember(const Slice &key, const Slice &member, bool *is_member);
+
+    // all members of "key" in byte order, none if there is no such set
+    Status smembers(const Slice &key, StrList *result);
+
+  private:
+    KeySpace *keyspace_;
+  };
+}
+#endif //YEDIS_INCLUDE_YEDIS_SET_HPP_
@@ -5,35 +5,177 @@
 #ifndef YEDIS_INCLUDE_YEDIS_ZSET_HPP_
 #define YEDIS_INCLUDE_YEDIS_ZSET_HPP_
 
+#include <map>
 #include <mutex>
+#include <string>
 #include <vector>
 #include "yedis.hpp"
+#include "yedis_keyspace.hpp"
 #include "util.hpp"
 #include "common/status.h"
 #include <options.h>
 
 namespace yedis {
   class DB;
+  class ColumnFamilyHandle;
+  class Iterator;
+  class WriteBatch;
 
+  // Storage layout, "vkey" is the length prefixed zset key followed by
+  // the big-endian version of the zset:
+  //   meta_  key                -> version
+  //   data_  vkey member        -> score
+  //   index_ vkey score member  -> empty
+  //   rank_  vkey level bucket  -> member count, int64 merge operands
+  // Scores are encoded so that their byte order is their numeric order,
+  // which keeps the index keys of a zset sorted by (score, member).  The
+  // level 0 rank key counts all members.
+  //
+  // Deleting a zset only removes its meta key, a zset created under the
+  // same key later gets a newer version.  The GC filter drops the keys
+  // of old versions in the background.
+  //
+  // Rank keys count the members per bucket of their "rank path", the
+  // encoded score followed by the first bytes of the member: a level l
+  // bucket holds the members whose path starts with its l bytes.  A path
+  // of l - 1 bytes ends in a level l bucket of its own, which sorts before
+  // its siblings like the member does, and has no deeper ones.  A rank is found by summing the counts of the lower
+  // buckets among at most 256 siblings per level and scanning the members
+  // of one deepest bucket, instead of scanning every member ranked below.
+  // Members with equal scores split up by their bytes too, only those
+  // sharing the score and kRankLevels - 8 leading bytes share a bucket.
+  // Buckets all members left count 0, the GC filter drops them.
   class ZSet {
-    const char *kMetaKey = "meta_";
-    const char *kIndexKeyPrefix = "index_";
+    static constexpr const char *kMetaKey = "meta_";
+    static constexpr const char *kDataKeyPrefix = "data_";
+    static constexpr const char *kIndexKeyPrefix = "index_";
+    static constexpr const char *kRankKeyPrefix = "rank_";
 
   public:
     typedef std::vector<std::string> StrList;
 
-    ZSet(DB *db) : db_(db) {}
+    // meta, index and data keys all live in the default column family.
+    // Rank counts are merge operands, so it needs the merge operator of
+    // MetaColumnFamilyOptions: without it every write fails with
+    // NotSupported.
+    explicit ZSet(DB *db);
 
-    Status zadd(const Slice &key, const std::vector<ScoreMember> &member);
+    // Keeps meta, index and data keys in their own column families, so
+    // that each gets table options matching its access pattern.  "meta"
+    // needs MetaColumnFamilyOptions, as above.
+    ZSet(DB *db, ColumnFamilyHandle *meta, ColumnFamilyHandle *index, ColumnFamilyHandle *data)
+        : db_(db), meta_cf_(meta), index_cf_(index), data_cf_(data) {}
 
+    // Options for the column families above.  Meta keys are point looked
+    // up by every command: small blocks and a bloom filter.  Index and
+    // data keys are scanned by range: large blocks, no filter.
+    static Options MetaColumnFamilyOptions(const Options &base);
+    static Options IndexColumnFamilyOptions(const Options &base);
+    static Options DataColumnFamilyOptions(const Options &base);
+
+    // Garbage collects the keys of deleted zsets and empty rank buckets.
+    // Set it as the compaction_filter of the meta, index and data column
+    // families and attach it to the meta column family.  The caller owns
+    // the result.
+    static VersionGCFilter *NewGCFilter();
+
+    // Adds the members or updates their scores.  "*added", if non-null,
+    // is set to the number of new members.  NaN scores are rejected.
+    Status zadd(const Slice &key, const std::vector<ScoreMember> &member, int *added = nullptr);
+
+    // Sets "*count" to the number of members of "key", 0 if there is none.
+    Status zcard(const Slice &key, int64_t *count);
+
+    // Adds "increment" to the score of "member", which starts at 0 if
+    // the member is new, and stores the new score in "*score".  Unlike
+    // the counts this is not a blind write: moving the index entry of the
+    // member needs its old score, which is read under the key lock.
+    Status zincrby(const Slice &key, double increment, const std::string &member, double *score);
+
+    // NotFound if "member" is not in the set.
+    Status zscore(const Slice &key, const std::string &member, double *score);
+
+    // 0 based position of "member" ordered by score, NotFound if it is
+    // not in the set.
+    Status zrank(const Slice &key, const std::string &member, int64_t *rank);
+
+    // members ranked start to stop (inclusive) by score, negative
+    // positions count from the last member.  One descent through the
+    // rank buckets to start, then a scan up to stop.
     StrList zrange(const std::string &key, int start, int stop);
 
+    // members with min <= score <= max, ordered by score: one seek to min
+    // and a scan up to max
+    Status zrangebyscore(const Slice &key, double min, double max, std::vector<ScoreMember> *result);
+
     // return counts of members removed
     Status zrem(const std::string &key, const StrList &members, int *ret);
 
+    // Removes the zset "key" whatever its size with one delete of its meta
+    // key.  "*existed" is set to whether there was one.
+    Status del(const Slice &key, bool *existed);
+
   private:
+    static constexpr int kNumKeyLocks = 64;
+    // Buckets of 1 to kRankLevels bytes of the rank path: the 8 bytes of
+    // the encoded score, then up to 32 bytes of the member, enough to
+    // tell apart keys like "user:000001" or uuids.
+    static constexpr int kRankLevels = 40;
+
+    // Deepest level with a bucket of "path": the first level it is
+    // shorter than, or kRankLevels.  A member is counted at the levels up
+    // to it only, so a write merges into about as many buckets as the
+    // member has bytes.
+    static int RankDepth(const std::string &path);
+
+    // A score change moves the index entry of a member, which needs the
+    // old score.  Writers of the same zset serialize on one of these.
+    std::mutex &KeyLock(const Slice &key);
+
+    std::string MetaKey(const Slice &key) const;
+    static std::string VersionedKey(const Slice &key, uint64_t version);
+    std::string DataKey(const Slice &vkey, const Slice &member) const;
+    std::string IndexPrefix(const Slice &vkey) const;
+    std::string RankKey(const Slice &vkey, int level, const Slice &bucket) const;
+
+    // NotFound if there is no zset "key".
+    Status GetVersion(const Slice &key, uint64_t *version);
+    // The version of "key", a new zset is created in "*batch" if there is
+    // none.  REQUIRES: KeyLock(key) held
+    Status GetOrCreateVersion(WriteBatch *batch, const Slice &key, uint64_t *version);
+
+    // Look up the score of a member by its data key, sets *found.
+    Status GetScore(const std::string &data_key, bool *found, double *score);
+
+    // Pending count changes by rank key, so that a write merges one
+    // operand per bucket it touches however many members share it.
+    typedef std::map<std::string, int64_t> RankDeltas;
+
+    // Add "delta" to the pending counts of the buckets of "member" at
+    // "score".
+    void UpdateRankCounts(RankDeltas *deltas, const Slice &vkey, double score, const Slice &member,
+                          int64_t delta);
+
+    // Merge the non-zero pending counts into "*batch".
+    void WriteRankCounts(WriteBatch *batch, const RankDeltas &deltas);
+
+    // Sum of the counts of the level "level" buckets below "bucket" that
+    // share its parent.
+    Status CountLowerBuckets(Iterator *rank_iter, const Slice &vkey, int level,
+                             const std::string &bucket, int64_t *count);
+
+    // Position "index_iter" at the member ranked "rank", or make it
+    // leave the index of "vkey" if there is none.
+    Status SeekToRank(Iterator *rank_iter, Iterator *index_iter, const Slice &vkey, int64_t rank);
+
+    // Member count of the zset version "vkey".
+    Status CountMembers(const Slice &vkey, int64_t *count);
+
     DB *db_;
-    std::mutex mutex_;
+    ColumnFamilyHandle *meta_cf_;
+    ColumnFamilyHandle *index_cf_;
+    ColumnFamilyHandle *data_cf_;
+    std::mutex key_locks_[kNumKeyLocks];
     ReadOptions default_read_options_;
     WriteOptions default_write_options_;
   };
@@ -0,0 +1,351 @@
+//
+// yedis_micro_bench: google benchmark suite of the hot primitives.
+//
+//   yedis_micro_bench [--benchmark_filter=REGEX] [--benchmark_repetitions=N] ...
+//
+// Each kernel runs at a few sizes, compare runs with google benchmark's
+// tools/compare.py.
+//
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
+
+#include "btree_node_page.h"
+#include "cache.h"
+#include "common/checksum.h"
+#include "comparator.h"
+#include "filter_policy.h"
+#include "options.h"
+#include "util.hpp"
+#include "ydb/block.h"
+#include "ydb/block_builder.h"
+#include "ydb/db_format.h"
+#include "ydb/memtable.h"
+#include "ydb/table_format.h"
+
+using namespace yedis;
+
+namespace {
+
+constexpr uint64_t kSeed = 301;
+
+std::string Key(uint64_t i) {
+  static constexpr const char* kKeyFormat = "key{:012d}";
+  return fmt::format(kKeyFormat, i);
+}
+
+std::string RandomString(std::mt19937_64* rnd, size_t len) {
+  std::string s(len, 0);
+  for (auto& c: s) {
+    c = static_cast<char>(' ' + (*rnd)() % 95);
+  }
+  return s;
+}
+
+// Arg: bits of the encoded values, so 7 encodes to one byte, 32 to five.
+void BM_EncodeVarint32(benchmark::State& state) {
+  const int bits = state.range(0);
+  std::mt19937_64 rnd(kSeed);
+  std::vector<uint32_t> values(1024);
+  for (auto& v: values) {
+    v = static_cast<uint32_t>(rnd() & ((uint64_t{1} << bits) - 1));
+  }
+  char buf[5 * 1024];
+  for (auto _: state) {
+    char* p = buf;
+    for (uint32_t v: values) {
+      p = EncodeVarint32(p, v);
+    }
+    benchmark::DoNotOptimize(p);
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_EncodeVarint32)->Arg(7)->Arg(14)->Arg(28)->Arg(32);
+
+void BM_GetVarint32Ptr(benchmark::State& state) {
+  const int bits = state.range(0);
+  std::mt19937_64 rnd(kSeed);
+  std::string encoded;
+  const int kValues = 1024;
+  for (int i = 0; i < kValues; i++) {
+    PutVarint32(&encoded, static_cast<uint32_t>(rnd() & ((uint64_t{1} << bits) - 1)));
+  }
+  for (auto _: state) {
+    const char* p = encoded.data();
+    const char* limit = p + encoded.size();
+    uint32_t sum = 0;
+    while (p < limit) {
+      uint32_t v;
+      p = GetVarint32Ptr(p, limit, &v);
+      sum += v;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * kValues);
+}
+BENCHMARK(BM_GetVarint32Ptr)->Arg(7)->Arg(14)->Arg(28)->Arg(32);
+
+// Arg: bytes hashed.
+void BM_Hash(benchmark::State& state) {
+  std::mt19937_64 rnd(kSeed);
+  const std::string data = RandomString(&rnd, state.range(0));
+  for (auto _: state) {
+    benchmark::DoNotOptimize(Hash(data.data(), data.size(), 0xbc9f1d34));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Hash)->Arg(8)->Arg(16)->Arg(64)->Arg(256)->Arg(4096);
+
+// Arg: bytes hashed.
+void BM_Hash64(benchmark::State& state) {
+  std::mt19937_64 rnd(kSeed);
+  const std::string data = RandomString(&rnd, state.range(0));
+  for (auto _: state) {
+    benchmark::DoNotOptimize(Hash64(data.data(), data.size(), 0xbc9f1d34));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Hash64)->Arg(8)->Arg(16)->Arg(64)->Arg(256)->Arg(4096);
+
+// Arg: bytes checksummed.
+void BM_Crc32Extend(benchmark::State& state) {
+  std::mt19937_64 rnd(kSeed);
+  std::string data = RandomString(&rnd, state.range(0));
+  for (auto _: state) {
+    benchmark::DoNotOptimize(crc32::Extend(0, reinterpret_cast<uint8_t*>(data.data()), data.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Crc32Extend)->Arg(64)->Arg(4096)->Arg(32 << 10)->Arg(1 << 20);
+
+// Args: keys per filter, filter format version.
+void BM_BloomCreateFilter(benchmark::State& state) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10, state.range(1)));
+  std::vector<std::string> key_strings;
+  for (int i = 0; i < state.range(0); i++) {
+    key_strings.push_back(Key(i));
+  }
+  std::vector<Slice> keys(key_strings.begin(), key_strings.end());
+  std::string filter;
+  for (auto _: state) {
+    filter.clear();
+    policy->CreateFilter(keys.data(), keys.size(), &filter);
+    benchmark::DoNotOptimize(filter.data());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_BloomCreateFilter)->ArgsProduct({{100, 10000, 100000}, {1, 2}});
+
+// Args: keys per filter, whether the probed keys are in it.
+void BM_BloomKeyMayMatch(benchmark::State& state) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  const int n = state.range(0);
+  std::vector<std::string> key_strings;
+  for (int i = 0; i < n; i++) {
+    key_strings.push_back(Key(i));
+  }
+  std::vector<Slice> keys(key_strings.begin(), key_strings.end());
+  std::string filter;
+  policy->CreateFilter(keys.data(), keys.size(), &filter);
+  std::vector<std::string> probes;
+  for (int i = 0; i < 1024; i++) {
+    probes.push_back(Key(state.range(1) ? i * 7919 % n : n + i));
+  }
+  size_t i = 0;
+  for (auto _: state) {
+    benchmark::DoNotOptimize(policy->KeyMayMatch(probes[i++ & 1023], filter));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BloomKeyMayMatch)->ArgsProduct({{1000, 100000}, {0, 1}});
+
+// Args: entries in the block, restart interval.
+void BM_BlockIterSeek(benchmark::State& state) {
+  const int n = state.range(0);
+  Options options;
+  options.block_restart_interval = state.range(1);
+  BlockBuilder builder(&options);
+  std::mt19937_64 rnd(kSeed);
+  for (int i = 0; i < n; i++) {
+    builder.Add(Key(i), RandomString(&rnd, 32));
+  }
+  const std::string data = builder.Finish().ToString();
+  BlockContents contents;
+  contents.data = Slice(data);
+  contents.cachable = false;
+  contents.heap_allocated = false;
+  Block block(contents);
+  std::unique_ptr<Iterator> iter(block.NewIterator(BytewiseComparator()));
+  std::vector<std::string> targets;
+  for (int i = 0; i < 1024; i++) {
+    targets.push_back(Key(rnd() % n));
+  }
+  size_t i = 0;
+  for (auto _: state) {
+    iter->Seek(targets[i++ & 1023]);
+    benchmark::DoNotOptimize(iter->Valid());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BlockIterSeek)->ArgsProduct({{16, 128, 1024}, {1, 16}});
+
+// Arg: value size.  A fresh memtable every kMaxEntries keeps the skiplist
+// height comparable between runs.
+void BM_MemTableAdd(benchmark::State& state) {
+  const int kMaxEntries = 100000;
+  std::mt19937_64 rnd(kSeed);
+  const std::string value = RandomString(&rnd, state.range(0));
+  std::vector<std::string> keys;
+  for (int i = 0; i < kMaxEntries; i++) {
+    keys.push_back(Key(rnd()));
+  }
+  auto mem = new MemTable();
+  mem->Ref();
+  SequenceNumber seq = 0;
+  int i = 0;
+  for (auto _: state) {
+    if (i == kMaxEntries) {
+      state.PauseTiming();
+      mem->Unref();
+      mem = new MemTable();
+      mem->Ref();
+      i = 0;
+      state.ResumeTiming();
+    }
+    mem->Add(++seq, ValueType::kTypeValue, keys[i++], value);
+  }
+  mem->Unref();
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * (keys[0].size() + value.size()));
+}
+BENCHMARK(BM_MemTableAdd)->Arg(16)->Arg(100)->Arg(1024);
+
+// Arg: entries in the memtable.
+void BM_MemTableGet(benchmark::State& state) {
+  const int n = state.range(0);
+  std::mt19937_64 rnd(kSeed);
+  auto mem = new MemTable();
+  mem->Ref();
+  const std::string value = RandomString(&rnd, 100);
+  for (int i = 0; i < n; i++) {
+    mem->Add(i + 1, ValueType::kTypeValue, Key(i), value);
+  }
+  std::vector<std::string> targets;
+  for (int i = 0; i < 1024; i++) {
+    targets.push_back(Key(rnd() % n));
+  }
+  std::string result;
+  Status s;
+  size_t i = 0;
+  for (auto _: state) {
+    LookupKey lkey(targets[i++ & 1023], kMaxSequenceNumber);
+    benchmark::DoNotOptimize(mem->Get(lkey, &result, &s));
+  }
+  mem->Unref();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MemTableGet)->Arg(1000)->Arg(100000);
+
+// Arg: keys in the cache.  Threads share one cache, one op in 16 inserts.
+std::unique_ptr<Cache> lru_cache;
+std::vector<std::string> lru_keys;
+
+void NoopDeleter(const Slice&, void*) {}
+
+void LRUCacheSetup(const benchmark::State& state) {
+  const int n = state.range(0);
+  lru_cache.reset(NewLRUCache(n * 2));
+  lru_keys.clear();
+  for (int i = 0; i < n; i++) {
+    lru_keys.push_back(Key(i));
+    lru_cache->Release(lru_cache->Insert(lru_keys.back(), nullptr, 1, NoopDeleter));
+  }
+}
+
+void LRUCacheTeardown(const benchmark::State&) {
+  lru_cache.reset();
+}
+
+void BM_LRUCacheInsertLookup(benchmark::State& state) {
+  const int n = state.range(0);
+  std::mt19937_64 rnd(kSeed + state.thread_index());
+  uint64_t hits = 0;
+  for (auto _: state) {
+    const std::string& key = lru_keys[rnd() % n];
+    Cache::Handle* handle = (rnd() & 15) == 0
+        ? lru_cache->Insert(key, nullptr, 1, NoopDeleter)
+        : lru_cache->Lookup(key);
+    if (handle != nullptr) {
+      hits++;
+      lru_cache->Release(handle);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["hit_rate"] = benchmark::Counter(hits, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_LRUCacheInsertLookup)
+    ->Arg(1024)->Arg(65536)
+    ->ThreadRange(1, 8)->UseRealTime()
+    ->Setup(LRUCacheSetup)->Teardown(LRUCacheTeardown);
+
+// Arg: value size.  Fills a leaf page with random keys, one iteration is
+// one full page.
+void BM_BTreeLeafInsert(benchmark::State& state) {
+  std::mt19937_64 rnd(kSeed);
+  const std::string value = RandomString(&rnd, state.range(0));
+  const uint32_t entry_size = sizeof(int64_t) + sizeof(int32_t) + value.size();
+  BTreeNodePage page;
+  int64_t entries = 0;
+  for (auto _: state) {
+    state.PauseTiming();
+    page.ResetMemory();
+    page.init(0, 1);
+    state.ResumeTiming();
+    while (page.GetAvailable() >= entry_size) {
+      page.leaf_insert(static_cast<int64_t>(rnd() >> 1), reinterpret_cast<const byte*>(value.data()),
+                       value.size());
+      entries++;
+    }
+  }
+  state.SetItemsProcessed(entries);
+}
+BENCHMARK(BM_BTreeLeafInsert)->Arg(8)->Arg(64)->Arg(256);
+
+// Arg: value size, so a smaller one packs more entries to scan.
+void BM_BTreeLeafSearch(benchmark::State& state) {
+  std::mt19937_64 rnd(kSeed);
+  const std::string value = RandomString(&rnd, state.range(0));
+  const uint32_t entry_size = sizeof(int64_t) + sizeof(int32_t) + value.size();
+  BTreeNodePage page;
+  page.init(0, 1);
+  int64_t n = 0;
+  while (page.GetAvailable() >= entry_size) {
+    page.leaf_insert(n++, reinterpret_cast<const byte*>(value.data()), value.size());
+  }
+  std::string result;
+  for (auto _: state) {
+    benchmark::DoNotOptimize(page.leaf_search(static_cast<int64_t>(rnd() % n), &result));
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["entries"] = n;
+}
+BENCHMARK(BM_BTreeLeafSearch)->Arg(8)->Arg(64)->Arg(256);
+
+}
+
+int main(int argc, char** argv) {
+  spdlog::set_level(spdlog::level::warn);
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,718 @@
+//
+// yedis_bench: db_bench style benchmarks of the LSM db and the btree.
+//
+//   yedis_bench [--engine lsm|btree] [--benchmarks LIST] [--num N] [--reads N]
+//               [--duration SECONDS] [--threads N] [--key_size N] [--value_size N]
+//               [--batch_size N] [--seek_nexts N] [--zset_keys N] [--range_len N]
+//               [--seed N] [--db PATH] [--use_existing_db 0|1] [--sync 0|1]
+//               [--compression none|snappy] [--cache_size BYTES] [--bloom_bits N]
+//               [--write_buffer_size BYTES] [--page_size N] [--statistics 0|1]
+//
+// LIST is a comma separated list of
+//
+//   fillseq     write num keys in order
+//   fillrandom  write num keys in random order
+//   overwrite   overwrite num random keys of an existing db
+//   readrandom  read reads random keys
+//   readseq     read reads keys in order
+//   seekrandom  seek to reads random keys and read seek_nexts more   (lsm)
+//   multiget    read reads batches of batch_size random keys
+//   zadd        add num random members to zset_keys zsets             (lsm)
+//   zrange      read the first range_len members of reads random zsets (lsm)
+//
+// Every thread runs num (or reads) / threads operations, or as many as fit in
+// duration seconds if it is set.  Keys and values derive from seed only, so
+// two runs with the same flags do the same work.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <latch>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
+
+#include "btree.hpp"
+#include "buffer_pool_manager.hpp"
+#include "cache.h"
+#include "db.h"
+#include "disk_manager.hpp"
+#include "filter_policy.h"
+#include "options.h"
+#include "statistics.h"
+#include "yedis_zset.hpp"
+
+using namespace yedis;
+
+namespace {
+
+struct BenchOptions {
+  std::string engine = "lsm";
+  std::string benchmarks = "fillseq,fillrandom,overwrite,readrandom,readseq,seekrandom,multiget,zadd,zrange";
+  int64_t num = 100000;
+  // number of read operations, num if negative
+  int64_t reads = -1;
+  // seconds per benchmark, 0 to run a fixed number of operations
+  int duration = 0;
+  int threads = 1;
+  int key_size = 16;
+  int value_size = 100;
+  int batch_size = 16;
+  int seek_nexts = 0;
+  int zset_keys = 100;
+  int range_len = 10;
+  uint64_t seed = 301;
+  std::string db = "yedis_bench";
+  bool use_existing_db = false;
+  bool sync = false;
+  CompressionType compression = kNoCompression;
+  size_t cache_size = 8 << 20;
+  int bloom_bits = 10;
+  size_t write_buffer_size = 4 << 20;
+  uint32_t page_size = 4096;
+  bool statistics = false;
+};
+
+// Values are slices of a buffer filled once from the seed.
+class ValueGenerator {
+public:
+  explicit ValueGenerator(uint64_t seed) {
+    std::mt19937_64 rnd(seed);
+    data_.resize(1 << 20);
+    for (auto& c: data_) {
+      c = static_cast<char>(' ' + rnd() % 95);
+    }
+  }
+
+  Slice Generate(size_t len) {
+    if (pos_ + len > data_.size()) {
+      pos_ = 0;
+    }
+    pos_ += len;
+    return Slice(data_.data() + pos_ - len, len);
+  }
+
+private:
+  std::string data_;
+  size_t pos_ = 0;
+};
+
+// Latencies and counts of one thread, merged into the first one at the end.
+class Stats {
+public:
+  void Start() {
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  void Finish() {
+    finish_ = std::chrono::steady_clock::now();
+  }
+
+  void FinishedOp(std::chrono::steady_clock::time_point op_start) {
+    auto elapsed = std::chrono::steady_clock::now() - op_start;
+    latencies_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+
+  void AddBytes(int64_t n) { bytes_ += n; }
+  void AddFound(int64_t n) { found_ += n; }
+  void AddMessage(const std::string& msg) { message_ = msg; }
+
+  void Merge(const Stats& other) {
+    latencies_.insert(latencies_.end(), other.latencies_.begin(), other.latencies_.end());
+    bytes_ += other.bytes_;
+    found_ += other.found_;
+    start_ = std::min(start_, other.start_);
+    finish_ = std::max(finish_, other.finish_);
+    if (message_.empty()) {
+      message_ = other.message_;
+    }
+  }
+
+  // fillseq      :      2.345 micros/op    426439 ops/sec    47.2 MB/s
+  //                P50 1.90 P95 3.10 P99 9.80 P99.9 41.00 MAX 1200.00 micros
+  void Report(const std::string& name, bool count_found, int64_t lookups) {
+    static constexpr const char* kOpsFormat =
+        "{:<12} : {:>10.3f} micros/op {:>9.0f} ops/sec {:>8.1f} MB/s";
+    static constexpr const char* kLatencyFormat =
+        "{:>14}P50 {:.2f} P95 {:.2f} P99 {:.2f} P99.9 {:.2f} MAX {:.2f} micros\n";
+    const int64_t ops = latencies_.size();
+    const double seconds = std::chrono::duration<double>(finish_ - start_).count();
+    std::string line = fmt::format(kOpsFormat, name, ops == 0 ? 0 : seconds * 1e6 / ops,
+                                   seconds == 0 ? 0 : ops / seconds,
+                                   seconds == 0 ? 0 : bytes_ / 1048576.0 / seconds);
+    if (count_found) {
+      line.append(fmt::format(" ({} of {} found)", found_, lookups));
+    }
+    if (!message_.empty()) {
+      line.append(" ").append(message_);
+    }
+    std::sort(latencies_.begin(), latencies_.end());
+    fmt::print("{}\n", line);
+    fmt::print(kLatencyFormat, "", Percentile(50), Percentile(95), Percentile(99), Percentile(99.9),
+               Percentile(100));
+    fflush(stdout);
+  }
+
+private:
+  // in micros, latencies_ must be sorted
+  double Percentile(double p) const {
+    if (latencies_.empty()) {
+      return 0;
+    }
+    size_t index = static_cast<size_t>(p / 100 * (latencies_.size() - 1) + 0.5);
+    return latencies_[index] / 1000.0;
+  }
+
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point finish_;
+  std::vector<uint64_t> latencies_;
+  int64_t bytes_ = 0;
+  int64_t found_ = 0;
+  std::string message_;
+};
+
+// What the benchmarks need from an engine.  Keys are numbers, every engine
+// encodes them its own way.
+class Engine {
+public:
+  virtual ~Engine() = default;
+
+  virtual Status Put(const WriteOptions& options, uint64_t key, const Slice& value) = 0;
+  virtual Status Get(uint64_t key, std::string* value) = 0;
+
+  // Ordered access, nullptr if the engine has none.
+  virtual Iterator* NewIterator() { return nullptr; }
+  virtual bool HasIterator() const { return false; }
+  virtual ZSet* zset() { return nullptr; }
+
+  // Encoded size of a key, for MB/s.
+  virtual size_t KeySize() const = 0;
+  virtual std::string Key(uint64_t key) const = 0;
+  // Whether threads can share the engine.
+  virtual bool ThreadSafe() const = 0;
+  virtual void PrintStats() {}
+};
+
+class LSMEngine: public Engine {
+public:
+  explicit LSMEngine(const BenchOptions& bench): bench_(bench) {}
+
+  ~LSMEngine() override {
+    delete db_;
+    delete cache_;
+    delete filter_policy_;
+    delete statistics_;
+  }
+
+  Status Open() {
+    options_.create_if_missing = true;
+    options_.compression = bench_.compression;
+    options_.write_buffer_size = bench_.write_buffer_size;
+    if (bench_.cache_size > 0) {
+      cache_ = NewLRUCache(bench_.cache_size);
+      options_.block_cache = cache_;
+    }
+    if (bench_.bloom_bits > 0) {
+      filter_policy_ = NewBloomFilterPolicy(bench_.bloom_bits);
+      options_.filter_policy = filter_policy_;
+    }
+    if (bench_.statistics) {
+      statistics_ = CreateDBStatistics();
+      options_.statistics = statistics_;
+    }
+    meta_options_ = ZSet::MetaColumnFamilyOptions(options_);
+    index_options_ = ZSet::IndexColumnFamilyOptions(options_);
+    data_options_ = ZSet::DataColumnFamilyOptions(options_);
+    std::vector<ColumnFamilyDescriptor> column_families = {
+        {kDefaultColumnFamilyName, &options_},
+        {"zset_meta", &meta_options_},
+        {"zset_index", &index_options_},
+        {"zset_data", &data_options_},
+    };
+    std::vector<ColumnFamilyHandle*> handles;
+    Status s = DB::Open(options_, bench_.db, column_families, &handles, &db_);
+    if (s.ok()) {
+      zset_ = std::make_unique<ZSet>(db_, handles[1], handles[2], handles[3]);
+    }
+    return s;
+  }
+
+  Status Put(const WriteOptions& options, uint64_t key, const Slice& value) override {
+    return db_->Put(options, Key(key), value);
+  }
+
+  Status Get(uint64_t key, std::string* value) override {
+    return db_->Get(ReadOptions(), Key(key), value);
+  }
+
+  Iterator* NewIterator() override {
+    return db_->NewIterator(ReadOptions());
+  }
+  bool HasIterator() const override { return true; }
+
+  ZSet* zset() override { return zset_.get(); }
+
+  size_t KeySize() const override { return bench_.key_size; }
+
+  // zero padded, so the order of keys is the order of numbers
+  std::string Key(uint64_t key) const override {
+    static constexpr const char* kKeyFormat = "{:0{}}";
+    return fmt::format(kKeyFormat, key, bench_.key_size);
+  }
+
+  bool ThreadSafe() const override { return true; }
+
+  void PrintStats() override {
+    std::string stats;
+    if (db_->GetProperty("ydb.stats", &stats)) {
+      fmt::print("{}", stats);
+    }
+  }
+
+private:
+  const BenchOptions& bench_;
+  Options options_;
+  Options meta_options_;
+  Options index_options_;
+  Options data_options_;
+  Cache* cache_ = nullptr;
+  const FilterPolicy* filter_policy_ = nullptr;
+  Statistics* statistics_ = nullptr;
+  DB* db_ = nullptr;
+  std::unique_ptr<ZSet> zset_;
+};
+
+// The btree has int64 keys, no iterator and a buffer pool for one thread.
+// A key that exists is overwritten by removing it first.
+class BTreeEngine: public Engine {
+public:
+  explicit BTreeEngine(const BenchOptions& bench) {
+    BTreeOptions options;
+    options.page_size = bench.page_size;
+    std::filesystem::create_directories(bench.db);
+    disk_manager_ = new DiskManager(bench.db + "/btree.idx", options);
+    instance_.disk_manager = disk_manager_;
+    buffer_pool_manager_ = new BufferPoolManager(kPoolSize, &instance_, options);
+    instance_.buffer_pool_manager = buffer_pool_manager_;
+    tree_ = new BTree(&instance_, options);
+  }
+
+  ~BTreeEngine() override {
+    buffer_pool_manager_->Flush();
+    disk_manager_->ShutDown();
+    delete tree_;
+    delete buffer_pool_manager_;
+    delete disk_manager_;
+  }
+
+  Status Put(const WriteOptions&, uint64_t key, const Slice& value) override {
+    std::string existing;
+    if (tree_->read(key, &existing).ok()) {
+      Status s = tree_->remove(key);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    return tree_->add(key, value);
+  }
+
+  Status Get(uint64_t key, std::string* value) override {
+    return tree_->read(key, value);
+  }
+
+  size_t KeySize() const override { return sizeof(int64_t); }
+  std::string Key(uint64_t key) const override { return std::to_string(key); }
+  bool ThreadSafe() const override { return false; }
+
+private:
+  static constexpr size_t kPoolSize = 1024;
+
+  YedisInstance instance_;
+  DiskManager* disk_manager_;
+  BufferPoolManager* buffer_pool_manager_;
+  BTree* tree_;
+};
+
+// Every benchmark of a run draws different keys, but the same ones in every
+// run with the same seed.
+struct ThreadState {
+  ThreadState(int tid, uint64_t seed, int benchmark): tid(tid), values(seed + tid) {
+    std::seed_seq seq{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32),
+                      static_cast<uint32_t>(tid), static_cast<uint32_t>(benchmark)};
+    rnd.seed(seq);
+  }
+
+  int tid;
+  std::mt19937_64 rnd;
+  ValueGenerator values;
+  Stats stats;
+};
+
+class Benchmark {
+public:
+  explicit Benchmark(const BenchOptions& bench): bench_(bench) {}
+
+  int Run() {
+    if (!bench_.use_existing_db) {
+      std::filesystem::remove_all(bench_.db);
+    }
+    if (bench_.engine == "lsm") {
+      auto engine = std::make_unique<LSMEngine>(bench_);
+      Status s = engine->Open();
+      if (!s.ok()) {
+        fmt::print(stderr, "open db {} error: {}\n", bench_.db, s.ToString());
+        return 1;
+      }
+      engine_ = std::move(engine);
+    } else if (bench_.engine == "btree") {
+      engine_ = std::make_unique<BTreeEngine>(bench_);
+    } else {
+      fmt::print(stderr, "unknown engine {}\n", bench_.engine);
+      return 1;
+    }
+    if (!engine_->ThreadSafe() && bench_.threads > 1) {
+      fmt::print(stderr, "the {} engine is single threaded\n", bench_.engine);
+      return 1;
+    }
+    PrintHeader();
+
+    size_t pos = 0;
+    while (pos <= bench_.benchmarks.size()) {
+      size_t end = bench_.benchmarks.find(',', pos);
+      if (end == std::string::npos) {
+        end = bench_.benchmarks.size();
+      }
+      std::string name = bench_.benchmarks.substr(pos, end - pos);
+      pos = end + 1;
+      if (!name.empty() && !RunBenchmark(name)) {
+        return 1;
+      }
+    }
+    if (bench_.statistics) {
+      engine_->PrintStats();
+    }
+    return 0;
+  }
+
+private:
+  using Method = void (Benchmark::*)(ThreadState*);
+
+  void PrintHeader() {
+    const int64_t entry_size = engine_->KeySize() + bench_.value_size;
+    fmt::print("Engine:     {}\n", bench_.engine);
+    fmt::print("Keys:       {} bytes each\n", engine_->KeySize());
+    fmt::print("Values:     {} bytes each\n", bench_.value_size);
+    fmt::print("Entries:    {}\n", bench_.num);
+    fmt::print("RawSize:    {:.1f} MB (estimated)\n", bench_.num * entry_size / 1048576.0);
+    fmt::print("Threads:    {}\n", bench_.threads);
+    if (bench_.duration > 0) {
+      fmt::print("Duration:   {} seconds per benchmark\n", bench_.duration);
+    }
+    fmt::print("------------------------------------------------\n");
+    fflush(stdout);
+  }
+
+  bool RunBenchmark(const std::string& name) {
+    Method method = nullptr;
+    bool is_read = false;
+    bool count_found = false;
+    bool needs_iterator = false;
+    bool needs_zset = false;
+    if (name == "fillseq") {
+      method = &Benchmark::WriteSeq;
+    } else if (name == "fillrandom" || name == "overwrite") {
+      method = &Benchmark::WriteRandom;
+    } else if (name == "readrandom") {
+      method = &Benchmark::ReadRandom;
+      is_read = count_found = true;
+    } else if (name == "readseq") {
+      method = &Benchmark::ReadSeq;
+      is_read = true;
+    } else if (name == "seekrandom") {
+      method = &Benchmark::SeekRandom;
+      is_read = count_found = needs_iterator = true;
+    } else if (name == "multiget") {
+      method = &Benchmark::MultiGet;
+      is_read = count_found = true;
+    } else if (name == "zadd") {
+      method = &Benchmark::ZAdd;
+      needs_zset = true;
+    } else if (name == "zrange") {
+      method = &Benchmark::ZRange;
+      is_read = needs_zset = true;
+    } else {
+      fmt::print(stderr, "unknown benchmark {}\n", name);
+      return false;
+    }
+    if ((needs_zset && engine_->zset() == nullptr) || (needs_iterator && !engine_->HasIterator())) {
+      fmt::print("{:<12} : skipped, not supported by the {} engine\n", name, bench_.engine);
+      fflush(stdout);
+      return true;
+    }
+
+    benchmarks_run_++;
+    const int64_t total = is_read && bench_.reads >= 0 ? bench_.reads : bench_.num;
+    ops_per_thread_ = std::max<int64_t>(1, total / bench_.threads);
+
+    std::vector<std::unique_ptr<ThreadState>> states;
+    for (int i = 0; i < bench_.threads; i++) {
+      states.push_back(std::make_unique<ThreadState>(i, bench_.seed, benchmarks_run_));
+    }
+    std::latch start(bench_.threads + 1);
+    std::vector<std::thread> threads;
+    for (auto& state: states) {
+      threads.emplace_back([this, method, &start, s = state.get()] {
+        start.arrive_and_wait();
+        s->stats.Start();
+        (this->*method)(s);
+        s->stats.Finish();
+      });
+    }
+    deadline_ = std::chrono::steady_clock::now() + std::chrono::seconds(bench_.duration);
+    start.arrive_and_wait();
+    for (auto& thread: threads) {
+      thread.join();
+    }
+    for (size_t i = 1; i < states.size(); i++) {
+      states[0]->stats.Merge(states[i]->stats);
+    }
+    int64_t lookups = ops_per_thread_ * bench_.threads;
+    if (name == "multiget") {
+      lookups *= bench_.batch_size;
+    }
+    states[0]->stats.Report(name, count_found && bench_.duration == 0, lookups);
+    return true;
+  }
+
+  // Runs "op" ops_per_thread_ times or until the deadline.
+  template <typename Op>
+  void Loop(ThreadState* thread, Op&& op) {
+    for (int64_t i = 0; bench_.duration > 0 || i < ops_per_thread_; i++) {
+      auto op_start = std::chrono::steady_clock::now();
+      if (bench_.duration > 0 && op_start >= deadline_) {
+        break;
+      }
+      op(i);
+      thread->stats.FinishedOp(op_start);
+    }
+  }
+
+  static void Check(const Status& s, const char* what) {
+    if (!s.ok()) {
+      fmt::print(stderr, "{} error: {}\n", what, s.ToString());
+      exit(1);
+    }
+  }
+
+  uint64_t RandomKey(ThreadState* thread) {
+    return thread->rnd() % bench_.num;
+  }
+
+  void Write(ThreadState* thread, uint64_t key) {
+    WriteOptions options;
+    options.sync = bench_.sync;
+    Check(engine_->Put(options, key, thread->values.Generate(bench_.value_size)), "put");
+    thread->stats.AddBytes(engine_->KeySize() + bench_.value_size);
+  }
+
+  // Threads write disjoint ranges of keys, in order.
+  void WriteSeq(ThreadState* thread) {
+    const uint64_t first = thread->tid * ops_per_thread_;
+    Loop(thread, [&](int64_t i) { Write(thread, (first + i) % bench_.num); });
+  }
+
+  void WriteRandom(ThreadState* thread) {
+    Loop(thread, [&](int64_t) { Write(thread, RandomKey(thread)); });
+  }
+
+  void Read(ThreadState* thread, uint64_t key, std::string* value) {
+    Status s = engine_->Get(key, value);
+    if (s.ok()) {
+      thread->stats.AddFound(1);
+      thread->stats.AddBytes(engine_->KeySize() + value->size());
+    } else if (!s.IsNotFound()) {
+      Check(s, "get");
+    }
+  }
+
+  void ReadRandom(ThreadState* thread) {
+    std::string value;
+    Loop(thread, [&](int64_t) { Read(thread, RandomKey(thread), &value); });
+  }
+
+  // With an iterator one op is one Next(), starting over at the end.
+  // Without, keys are read by number in order.
+  void ReadSeq(ThreadState* thread) {
+    std::unique_ptr<Iterator> iter(engine_->NewIterator());
+    if (iter == nullptr) {
+      std::string value;
+      Loop(thread, [&](int64_t i) { Read(thread, i % bench_.num, &value); });
+      thread->stats.AddMessage("(point reads in key order)");
+      return;
+    }
+    iter->SeekToFirst();
+    Loop(thread, [&](int64_t) {
+      if (!iter->Valid()) {
+        iter->SeekToFirst();
+        if (!iter->Valid()) {
+          return;
+        }
+      }
+      thread->stats.AddBytes(iter->key().size() + iter->value().size());
+      iter->Next();
+    });
+  }
+
+  void SeekRandom(ThreadState* thread) {
+    std::unique_ptr<Iterator> iter(engine_->NewIterator());
+    Loop(thread, [&](int64_t) {
+      const std::string key = engine_->Key(RandomKey(thread));
+      iter->Seek(key);
+      if (iter->Valid() && iter->key() == key) {
+        thread->stats.AddFound(1);
+      }
+      for (int j = 0; iter->Valid() && j <= bench_.seek_nexts; j++) {
+        thread->stats.AddBytes(iter->key().size() + iter->value().size());
+        iter->Next();
+      }
+    });
+  }
+
+  // The db has no batched Get, one op is batch_size Gets of keys in order.
+  void MultiGet(ThreadState* thread) {
+    std::vector<uint64_t> keys(bench_.batch_size);
+    std::string value;
+    Loop(thread, [&](int64_t) {
+      for (auto& key: keys) {
+        key = RandomKey(thread);
+      }
+      std::sort(keys.begin(), keys.end());
+      for (auto key: keys) {
+        Read(thread, key, &value);
+      }
+    });
+  }
+
+  std::string ZSetKey(ThreadState* thread) {
+    static constexpr const char* kZSetKeyFormat = "zset{:06d}";
+    return fmt::format(kZSetKeyFormat, thread->rnd() % bench_.zset_keys);
+  }
+
+  void ZAdd(ThreadState* thread) {
+    static constexpr const char* kMemberFormat = "member{:010d}";
+    std::vector<ScoreMember> members(1);
+    Loop(thread, [&](int64_t) {
+      const std::string key = ZSetKey(thread);
+      members[0].score = static_cast<double>(thread->rnd() % 1000000);
+      members[0].member = fmt::format(kMemberFormat, RandomKey(thread));
+      Check(engine_->zset()->zadd(key, members), "zadd");
+      thread->stats.AddBytes(key.size() + members[0].member.size() + sizeof(double));
+    });
+  }
+
+  void ZRange(ThreadState* thread) {
+    Loop(thread, [&](int64_t) {
+      for (const auto& member: engine_->zset()->zrange(ZSetKey(thread), 0, bench_.range_len - 1)) {
+        thread->stats.AddBytes(member.size());
+      }
+    });
+  }
+
+  const BenchOptions& bench_;
+  std::unique_ptr<Engine> engine_;
+  int benchmarks_run_ = 0;
+  int64_t ops_per_thread_ = 0;
+  std::chrono::steady_clock::time_point deadline_;
+};
+
+void Usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s [--engine lsm|btree] [--benchmarks LIST] [--num N] [--reads N]\n"
+          "          [--duration SECONDS] [--threads N] [--key_size N] [--value_size N]\n"
+          "          [--batch_size N] [--seek_nexts N] [--zset_keys N] [--range_len N]\n"
+          "          [--seed N] [--db PATH] [--use_existing_db 0|1] [--sync 0|1]\n"
+          "          [--compression none|snappy] [--cache_size BYTES] [--bloom_bits N]\n"
+          "          [--write_buffer_size BYTES] [--page_size N] [--statistics 0|1]\n",
+          prog);
+  exit(1);
+}
+
+}
+
+int main(int argc, char** argv) {
+  BenchOptions bench;
+  for (int i = 1; i < argc; i++) {
+    const char* flag = argv[i];
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+    }
+    const char* value = argv[++i];
+    if (strcmp(flag, "--engine") == 0) {
+      bench.engine = value;
+    } else if (strcmp(flag, "--benchmarks") == 0) {
+      bench.benchmarks = value;
+    } else if (strcmp(flag, "--num") == 0) {
+      bench.num = atoll(value);
+    } else if (strcmp(flag, "--reads") == 0) {
+      bench.reads = atoll(value);
+    } else if (strcmp(flag, "--duration") == 0) {
+      bench.duration = atoi(value);
+    } else if (strcmp(flag, "--threads") == 0) {
+      bench.threads = atoi(value);
+    } else if (strcmp(flag, "--key_size") == 0) {
+      bench.key_size = atoi(value);
+    } else if (strcmp(flag, "--value_size") == 0) {
+      bench.value_size = atoi(value);
+    } else if (strcmp(flag, "--batch_size") == 0) {
+      bench.batch_size = atoi(value);
+    } else if (strcmp(flag, "--seek_nexts") == 0) {
+      bench.seek_nexts = atoi(value);
+    } else if (strcmp(flag, "--zset_keys") == 0) {
+      bench.zset_keys = atoi(value);
+    } else if (strcmp(flag, "--range_len") == 0) {
+      bench.range_len = atoi(value);
+    } else if (strcmp(flag, "--seed") == 0) {
+      bench.seed = strtoull(value, nullptr, 10);
+    } else if (strcmp(flag, "--db") == 0) {
+      bench.db = value;
+    } else if (strcmp(flag, "--use_existing_db") == 0) {
+      bench.use_existing_db = atoi(value) != 0;
+    } else if (strcmp(flag, "--sync") == 0) {
+      bench.sync = atoi(value) != 0;
+    } else if (strcmp(flag, "--compression") == 0) {
+      if (strcmp(value, "none") == 0) {
+        bench.compression = kNoCompression;
+      } else if (strcmp(value, "snappy") == 0) {
+        bench.compression = kSnappyCompression;
+      } else {
+        Usage(argv[0]);
+      }
+    } else if (strcmp(flag, "--cache_size") == 0) {
+      bench.cache_size = strtoull(value, nullptr, 10);
+    } else if (strcmp(flag, "--bloom_bits") == 0) {
+      bench.bloom_bits = atoi(value);
+    } else if (strcmp(flag, "--write_buffer_size") == 0) {
+      bench.write_buffer_size = strtoull(value, nullptr, 10);
+    } else if (strcmp(flag, "--page_size") == 0) {
+      bench.page_size = atoi(value);
+    } else if (strcmp(flag, "--statistics") == 0) {
+      bench.statistics = atoi(value) != 0;
+    } else {
+      Usage(argv[0]);
+    }
+  }
+  if (bench.num <= 0 || bench.threads <= 0 || bench.key_size <= 0 || bench.value_size < 0 ||
+      bench.batch_size <= 0 || bench.zset_keys <= 0 || bench.range_len <= 0) {
+    Usage(argv[0]);
+  }
+  spdlog::set_level(spdlog::level::warn);
+  return Benchmark(bench).Run();
+}
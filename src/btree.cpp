@@ -7,34 +7,41 @@
 #include <buffer_pool_manager.hpp>
 #include <btree_leaf_node_page.hpp>
 #include <btree_meta_page.hpp>
+#include <mutex>
 #include <stack>
 #include <sstream>
 #include <db.h>
+#include <event_trace.h>
 
 namespace yedis {
+  // latch_ guards root_ and the buffer pool.  Reads hold it exclusive
+  // too: they pin pages and touch the LRU lists, which are not thread
+  // safe.
   Status BTree::add(int64_t key, const Slice &value) {
+    std::lock_guard<std::mutex> guard(latch_);
     Status s;
     auto origin_root = root_;
     s = root_->add(yedis_instance_->buffer_pool_manager, key, reinterpret_cast<const byte *>(value.data()),
                    value.size(), &root_);
-    if (!s.ok()) {
-      return s;
-    }
-    if (origin_root != root_) {
+    if (s.ok() && origin_root != root_) {
       // root有更新, 代表level + 1
       meta_->SetLevels(meta_->GetLevels() + 1);
       // 更新root page
       meta_->SetRootPageId(root_->GetPageID());
-      SPDLOG_INFO("update meta info successfully, new root_page_id: {}", root_->GetPageID());
+      SPDLOG_DEBUG("update meta info successfully, new root_page_id: {}", root_->GetPageID());
+      YEDIS_TRACE_EVENT(TraceEventType::kBTreeRootSplit, {"root_page_id", root_->GetPageID()},
+                        {"levels", meta_->GetLevels()});
     }
     return s;
   }
 
   Status BTree::read(int64_t key, std::string *value) {
+    std::lock_guard<std::mutex> guard(latch_);
     return root_->read(yedis_instance_->buffer_pool_manager, key, value);
   }
 
   Status BTree::remove(int64_t key) {
+    std::lock_guard<std::mutex> guard(latch_);
     auto origin_root = root_;
     auto s = root_->remove(yedis_instance_->buffer_pool_manager, key, &root_);
     if (!s.ok()) {
@@ -46,15 +53,19 @@ namespace yedis {
       meta_->SetLevels(meta_->GetLevels() - 1);
       meta_->SetRootPageId(root_->GetPageID());
       yedis_instance_->buffer_pool_manager->Pin(root_);
-      SPDLOG_INFO("update meta info successfully, new root_page_id: {}", root_->GetPageID());
+      SPDLOG_DEBUG("update meta info successfully, new root_page_id: {}", root_->GetPageID());
     }
     return s;
   }
 
   Status BTree::init() {
-    // read meta
-    page_id_t meta_page_id;
-    meta_ = reinterpret_cast<BTreeMetaPage *>(yedis_instance_->buffer_pool_manager->NewPage(&meta_page_id));
+    // read meta, it is the first page of the file
+    page_id_t meta_page_id = 0;
+    if (yedis_instance_->disk_manager->NumPages() == 0) {
+      meta_ = reinterpret_cast<BTreeMetaPage *>(yedis_instance_->buffer_pool_manager->NewPage(&meta_page_id));
+    } else {
+      meta_ = reinterpret_cast<BTreeMetaPage *>(yedis_instance_->buffer_pool_manager->FetchPage(meta_page_id));
+    }
 
     meta_->SetPageID(meta_page_id);
     SPDLOG_INFO("meta_page page_id {}", meta_->GetPageID());
@@ -85,8 +96,8 @@ namespace yedis {
     if (root_page_id != root_->GetPageID()) {
       spdlog::error("open btree failed due to non zero root page id {}", root_->GetPageID());
     }
-    root_->init(root_->GetDegree(), root_page_id);
-
+    // NOTE: no init, an index root has no available and init would take it
+    // for an empty leaf, writing prev and next over its first key
     yedis_instance_->buffer_pool_manager->Pin(root_);
 
     spdlog::info("open btree successfully with page_id {}", root_page_id);
@@ -161,6 +172,7 @@ namespace yedis {
   }
 
   page_id_t BTree::GetRoot() {
+    std::lock_guard<std::mutex> guard(latch_);
     return root_->GetPageID();
   }
 
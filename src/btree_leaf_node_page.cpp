@@ -97,19 +97,19 @@ int BTreeLeafNodePage::upper_bound(const byte *key) {
   for(i = cur_entries_ - 1; i >= 0; i--) {
     auto offset = *(start + i);
     assert(offset < entries_.size());
-    spdlog::info("offset = {}, entries length: {}", offset, entries_.size());
+    SPDLOG_TRACE("offset = {}, entries length: {}", offset, entries_.size());
     auto target_key = entries_[offset].key;
     if (memcmp(key, target_key, entries_[offset].key_len) >= 0) {
       break;
     }
-    spdlog::debug("start[{}] = {}", i, start[i]);
+    SPDLOG_TRACE("start[{}] = {}", i, start[i]);
     start[i + 1] = start[i];
   }
   if (i == -1) {
     i = 0;
   }
   start[i] = cur_entries_;
-  spdlog::debug("start[{}] = {}", i, start[i]);
+  SPDLOG_TRACE("start[{}] = {}", i, start[i]);
   return i;
 }
 
@@ -32,7 +32,7 @@ Status BTreeNodePage::add(const byte *key, size_t k_len, const byte *value, size
 
 // NOTE: only root node can add key
 Status BTreeNodePage::add(BufferPoolManager* buffer_pool_manager, int64_t key, const byte *value, size_t v_len, BTreeNodePage** root) {
-  SPDLOG_INFO("[{}], root page_id {}, available={}", key, GetPageID(), GetAvailable());
+  SPDLOG_TRACE("[{}], root page_id {}, available={}", key, GetPageID(), GetAvailable());
 
   if (buffer_pool_manager->PinnedSize() != 2) {
     // 不考虑并发的话，之后meta和root会被pin住
@@ -51,7 +51,7 @@ Status BTreeNodePage::add(BufferPoolManager* buffer_pool_manager, int64_t key, c
   assert(target_leaf_page->Pinned());
   assert(sizeof(int64_t) + sizeof(int32_t) + v_len <= MaxAvailable());
 
-  SPDLOG_INFO("key={}, search leaf page: {}, successfully, available={}", key, target_leaf_page->GetPageID(), target_leaf_page->GetAvailable());
+  SPDLOG_TRACE("key={}, search leaf page: {}, successfully, available={}", key, target_leaf_page->GetPageID(), target_leaf_page->GetAvailable());
   auto s = target_leaf_page->leaf_insert(key, value, v_len);
   if (target_leaf_page != *root) {
     // 非root 节点可以UnPin
@@ -77,9 +77,8 @@ Status BTreeNodePage::read(int64_t key, std::string *result) {
 // TODO: Pin Or UnPin
 Status BTreeNodePage::read(BufferPoolManager* buffer_pool_manager, int64_t key, std::string *result) {
   auto it = this;
-  std::vector<page_id_t> path;
   while (!it->IsLeafNode()) {
-    path.push_back(it->GetPageID());
+    SPDLOG_TRACE("[{}] read search path: page_id {}", key, it->GetPageID());
     int64_t* key_start = it->KeyPosStart();
     int n_keys = it->GetCurrentEntries();
     auto child_start = it->ChildPosStart();
@@ -90,12 +89,7 @@ Status BTreeNodePage::read(BufferPoolManager* buffer_pool_manager, int64_t key,
     it = reinterpret_cast<BTreeNodePage*>(buffer_pool_manager->FetchPage(child_start[pos]));
   }
   assert(it->IsLeafNode());
-  path.push_back(it->GetPageID());
-  printf("[%lld] read search path: ---------------------\n", key);
-  for(auto p: path) {
-    printf(" %d", p);
-  }
-  printf("\n");
+  SPDLOG_TRACE("[{}] read search path: leaf page_id {}", key, it->GetPageID());
   return it->leaf_search(key, result);
 }
 
@@ -109,10 +103,10 @@ BTreeNodePage * BTreeNodePage::search(BufferPoolManager* buffer_pool_manager, in
   auto it = this;
   BTreeNodePage* parent = nullptr;
   int pos = 0;
-  SPDLOG_INFO("search to index node: key={}, page_id={}", key, it->GetPageID());
+  SPDLOG_TRACE("search to index node: key={}, page_id={}", key, it->GetPageID());
   while(!it->IsLeafNode()) {
     if (it->IsFull()) {
-      SPDLOG_INFO("[{}] found index node={} full", key, it->GetPageID());
+      SPDLOG_TRACE("[{}] found index node={} full", key, it->GetPageID());
       if (*root == it) {
         // 当前index node就是根节点
         auto new_root = it->index_split(buffer_pool_manager, nullptr, 0);
@@ -138,17 +132,12 @@ BTreeNodePage * BTreeNodePage::search(BufferPoolManager* buffer_pool_manager, in
     auto child_start = it->ChildPosStart();
     // 这里算的真有问题吗
     int64_t* key_end = key_start + n_keys;
-    SPDLOG_INFO("[{}] page_id: {}, key: {}, n_keys: {}, degree: {}", key, it->GetPageID(), key, n_keys, it->GetDegree());
-    printf("---------------------------------\n");
-    for (int i = 0; i < n_keys; i++) {
-      printf("%lld ", key_start[i]);
-    }
-    printf("\n---------------------------------\n");
+    SPDLOG_TRACE("[{}] page_id: {}, key: {}, n_keys: {}, degree: {}", key, it->GetPageID(), key, n_keys, it->GetDegree());
     int64_t* result = std::lower_bound(key_start, key_end, key);
     if (parent != nullptr && parent != *root && parent != it) {
       buffer_pool_manager->UnPin(parent);
     }
-    printf("result = %p, key_start = %p\n", result, key_start);
+    SPDLOG_TRACE("[{}] lower_bound pos {}", key, result - key_start);
     // NOTE: 实时更新parent_id
     if (parent != nullptr && parent != it) {
       it->SetParentPageID(parent->GetPageID());
@@ -157,12 +146,12 @@ BTreeNodePage * BTreeNodePage::search(BufferPoolManager* buffer_pool_manager, in
     if (result != key_end) {
       // found
       pos = result - key_start;
-      SPDLOG_INFO("key={} found child pos: {}, child page_id: {}", key, pos, child_start[pos]);
+      SPDLOG_TRACE("key={} found child pos: {}, child page_id: {}", key, pos, child_start[pos]);
       it = reinterpret_cast<BTreeNodePage*>(buffer_pool_manager->FetchPage(child_start[pos]));
     } else {
       // key 最大
       pos = n_keys;
-      SPDLOG_INFO("biggest key: key={} found child pos: {}, child page_id: {}", key, pos, child_start[pos]);
+      SPDLOG_TRACE("biggest key: key={} found child pos: {}, child page_id: {}", key, pos, child_start[pos]);
       assert(child_start[pos] != 0);
       it = reinterpret_cast<BTreeNodePage*>(buffer_pool_manager->FetchPage(child_start[pos]));
     }
@@ -184,23 +173,23 @@ BTreeNodePage * BTreeNodePage::search(BufferPoolManager* buffer_pool_manager, in
     return nullptr;
   }
   if (it->IsFull(total_len)) {
-    SPDLOG_INFO("page {} leaf node is full", it->GetPageID());
+    SPDLOG_TRACE("page {} leaf node is full", it->GetPageID());
     // debug_available(buffer_pool_manager);
     // TODO: child_pos has some problem
     // NOTE: why default is pos + 1
     int child_pos = pos + 1;
-    SPDLOG_INFO("before leaf_split child_pos = {}, parent page_id = {}", child_pos, it->GetParentPageID());
+    SPDLOG_TRACE("before leaf_split child_pos = {}, parent page_id = {}", child_pos, it->GetParentPageID());
     // NOTE: leaf_split will change parent relation
     // NOTE: here we can already know which leaf_node the key will insert
     BTreeNodePage *target_leaf_page;
     auto new_root = it->leaf_split(buffer_pool_manager, key, total_len, parent, pos, &child_pos, &target_leaf_page);
-    SPDLOG_INFO("after leaf_split child_pos = {}, parent page_id = {}", child_pos, it->GetParentPageID());
+    SPDLOG_TRACE("after leaf_split child_pos = {}, parent page_id = {}", child_pos, it->GetParentPageID());
     // debug_available(buffer_pool_manager);
     // *root will never be nullptr
     // TODO: the following line is unnecessary
     if (*root != nullptr) {
       //　update root
-      SPDLOG_INFO("root not null root page_id: {}", (*root)->GetPageID());
+      SPDLOG_TRACE("root not null root page_id: {}", (*root)->GetPageID());
       if (new_root != nullptr) {
         buffer_pool_manager->Pin(new_root);
         // NOTE: only one leaf node meet with split will cause it unpinned
@@ -209,14 +198,14 @@ BTreeNodePage * BTreeNodePage::search(BufferPoolManager* buffer_pool_manager, in
           // NOTE: prevent unpin parent
           buffer_pool_manager->UnPin(*root);
         }
-        SPDLOG_INFO("search found new root: {}", new_root->GetPageID());
+        SPDLOG_TRACE("search found new root: {}", new_root->GetPageID());
         *root = new_root;
       } else {
-        SPDLOG_INFO("root not changed");
+        SPDLOG_TRACE("root not changed");
       }
     }
     if (target_leaf_page != nullptr) {
-      SPDLOG_INFO("split target_leaf_page page_id = {}", target_leaf_page->GetPageID());
+      SPDLOG_TRACE("split target_leaf_page page_id = {}", target_leaf_page->GetPageID());
     }
     assert(target_leaf_page != nullptr && target_leaf_page->Pinned());
     if (target_leaf_page != it) {
@@ -244,14 +233,14 @@ BTreeNodePage * BTreeNodePage::search(BufferPoolManager* buffer_pool_manager, in
 BTreeNodePage* BTreeNodePage::index_split(BufferPoolManager* buffer_pool_manager, BTreeNodePage* parent, int child_idx) {
   auto key_start = KeyPosStart();
   int n_entries = GetCurrentEntries();
-  SPDLOG_INFO("page_id {}, n_entries = {}", GetPageID(), n_entries);
+  SPDLOG_TRACE("page_id {}, n_entries = {}", GetPageID(), n_entries);
   assert(n_entries >= 4);
   assert(!IsLeafNode());
   // NOTE: make mid_key to parent level
   auto mid_key  = key_start[n_entries / 2];
   // 需要将right部分的数据迁移到新的index node上
   auto new_index_page = NewIndexPageFrom(buffer_pool_manager, this, n_entries / 2 + 1);
-  SPDLOG_INFO("split mid_key = {}", mid_key);
+  SPDLOG_TRACE("split mid_key = {}", mid_key);
   // no need to rewrite key_start[n_entries / 2]
   SetCurrentEntries(n_entries / 2);
   if (parent == nullptr) {
@@ -260,7 +249,7 @@ BTreeNodePage* BTreeNodePage::index_split(BufferPoolManager* buffer_pool_manager
     new_index_page->SetParentPageID(new_root->GetPageID());
     return new_root;
   }
-  SPDLOG_INFO("with parent {}", parent->GetPageID());
+  SPDLOG_TRACE("with parent {}", parent->GetPageID());
   new_index_page->SetParentPageID(parent->GetPageID());
   // parent never overflow
   parent->index_node_add_child(child_idx, mid_key, child_idx + 1, new_index_page->GetPageID());
@@ -285,8 +274,8 @@ BTreeNodePage* BTreeNodePage::leaf_split(
     assert(parent->Pinned());
   }
   assert(IsLeafNode());
-  int n_entries = GetCurrentEntries();
-  SPDLOG_INFO("current page_id: {}, current_entries: {}, available={}", GetPageID(), n_entries, GetAvailable());
+  [[maybe_unused]] int n_entries = GetCurrentEntries();
+  SPDLOG_TRACE("current page_id: {}, current_entries: {}, available={}", GetPageID(), n_entries, GetAvailable());
   auto entry_pos_start = reinterpret_cast<char *>(EntryPosStart());
   BTreeNodeIter start(entry_pos_start);
   BTreeNodeIter end(entry_pos_start + GetEntryTail());
@@ -314,7 +303,7 @@ BTreeNodePage* BTreeNodePage::leaf_split(
   }
   if (sz == 0) {
     // new_key is smallest
-    SPDLOG_INFO("[page_id {}] to insert smallest key", GetPageID());
+    SPDLOG_TRACE("[page_id {}] to insert smallest key", GetPageID());
     mid_key = new_key;
     new_leaf_page = NewLeafPage(buffer_pool_manager, 0, it, it);
     // 手动pin?
@@ -352,7 +341,7 @@ BTreeNodePage* BTreeNodePage::leaf_split(
     }
   } else if (sz == used) {
     // new_key is biggest
-    SPDLOG_INFO("leaf_split with max key: {}, prev_key: {}", new_key, prev_key);
+    SPDLOG_TRACE("leaf_split with max key: {}, prev_key: {}", new_key, prev_key);
     mid_key = prev_key;
     new_leaf_page = NewLeafPage(buffer_pool_manager, 0, it, it);
     buffer_pool_manager->Pin(new_leaf_page);
@@ -389,7 +378,7 @@ BTreeNodePage* BTreeNodePage::leaf_split(
     }
   } else {
     if (sz + total_size <= MaxAvailable())  {
-      SPDLOG_INFO("leaf_split insert node with left child, key: {}", new_key);
+      SPDLOG_TRACE("leaf_split insert node with left child, key: {}", new_key);
       // 放入前一个node上
       mid_key = new_key;
       // right page
@@ -433,7 +422,7 @@ BTreeNodePage* BTreeNodePage::leaf_split(
 
     } else if (used - sz + total_size <= MaxAvailable()) {
       // 放入后一个node中
-      SPDLOG_INFO("leaf_split insert node with right child, key: {}, prev_key: {}", new_key, prev_key);
+      SPDLOG_TRACE("leaf_split insert node with right child, key: {}, prev_key: {}", new_key, prev_key);
       mid_key = prev_key;
 
       // right page
@@ -476,7 +465,7 @@ BTreeNodePage* BTreeNodePage::leaf_split(
     } else {
       // 只能新建一个page来存储new_key
       // 要插入两个page
-      SPDLOG_INFO("need 2 page to storage new_key");
+      SPDLOG_TRACE("need 2 page to storage new_key");
       auto single_page = NewLeafPage(buffer_pool_manager, 0, it, it);
       buffer_pool_manager->Pin(single_page);
       assert(single_page->IsLeafNode());
@@ -522,9 +511,9 @@ BTreeNodePage* BTreeNodePage::leaf_split(
           buffer_pool_manager->UnPin(new_leaf_page);
           return nullptr;
         }
-        SPDLOG_INFO("parent {} is full", parent->GetPageID());
+        SPDLOG_TRACE("parent {} is full", parent->GetPageID());
         if (parent->GetParentPageID() == INVALID_PAGE_ID) {
-          SPDLOG_INFO("parent {} was root page", parent->GetPageID());
+          SPDLOG_TRACE("parent {} was root page", parent->GetPageID());
           // NOTE: parent is root page
           auto new_root = parent->index_split(buffer_pool_manager, nullptr, INVALID_PAGE_ID);
           // NOTE: judge current page is in new_root's left or right
@@ -538,7 +527,7 @@ BTreeNodePage* BTreeNodePage::leaf_split(
             target_index_page_id = new_root->GetChild(0);
           }
           if (child_key_idx > MAX_DEGREE / 2) {
-            SPDLOG_INFO("new_page will add the right half, child_idx {}", child_key_idx);
+            SPDLOG_TRACE("new_page will add the right half, child_idx {}", child_key_idx);
             // current page split into right half
             SetParentPageID(new_root->GetChild(1));
             single_page->SetParentPageID(new_root->GetChild(1));
@@ -548,10 +537,10 @@ BTreeNodePage* BTreeNodePage::leaf_split(
           // buffer_pool_manager->UnPin(single_page);
           buffer_pool_manager->UnPin(new_leaf_page);
           assert(target_index_page_id != INVALID_PAGE_ID);
-          SPDLOG_INFO("new_target_index_page_id {}", target_index_page_id);
+          SPDLOG_TRACE("new_target_index_page_id {}", target_index_page_id);
           // NOTE: target_index_page_id maybe same as parent
           if (target_index_page_id == parent->GetPageID()) {
-            SPDLOG_INFO("found target index page id equals parent {}", target_index_page_id);
+            SPDLOG_TRACE("found target index page id equals parent {}", target_index_page_id);
             parent->index_node_add_child(new_key, new_leaf_page_id);
             return new_root;
           }
@@ -569,7 +558,7 @@ BTreeNodePage* BTreeNodePage::leaf_split(
         auto first = parent->GetKey(0);
         auto idx_pos = std::lower_bound(grandparent->KeyPosStart(), grandparent->KeyPosStart() + grandparent->GetCurrentEntries(), first);
         auto idx = idx_pos - grandparent->KeyPosStart();
-        SPDLOG_INFO("parent {} is grandparent {} 's {} child", parent->GetPageID(), grandparent->GetPageID(), idx);
+        SPDLOG_TRACE("parent {} is grandparent {} 's {} child", parent->GetPageID(), grandparent->GetPageID(), idx);
         parent->index_split(buffer_pool_manager, grandparent, idx);
         auto target_index_page_id = INVALID_PAGE_ID;
         if (new_key > grandparent->GetKey(idx)) {
@@ -581,7 +570,7 @@ BTreeNodePage* BTreeNodePage::leaf_split(
 
         // TODO: need test
         if (child_key_idx > MAX_DEGREE / 2) {
-          SPDLOG_INFO("child idx {} will split into right page", child_key_idx);
+          SPDLOG_TRACE("child idx {} will split into right page", child_key_idx);
           // current page split into right half
           SetParentPageID(grandparent->GetChild(idx + 1));
           single_page->SetParentPageID(grandparent->GetChild(idx + 1));
@@ -592,7 +581,7 @@ BTreeNodePage* BTreeNodePage::leaf_split(
         buffer_pool_manager->UnPin(new_leaf_page);
         // NOTE: grandparent also need unpin
         if (grandparent->GetParentPageID() != INVALID_PAGE_ID) {
-          SPDLOG_INFO("unpin grandparent page: {}, current parent_page id: {}", grandparent->GetPageID(), grandparent->GetParentPageID());
+          SPDLOG_TRACE("unpin grandparent page: {}, current parent_page id: {}", grandparent->GetPageID(), grandparent->GetParentPageID());
           buffer_pool_manager->UnPin(grandparent);
         }
 
@@ -622,7 +611,7 @@ Status BTreeNodePage::leaf_insert(int64_t key, const byte *value, int32_t v_len)
   BTreeNodeIter start(entry_pos_start);
   BTreeNodeIter end(entry_pos_start + GetEntryTail());
   size_t offset = 0;
-//  SPDLOG_INFO("current entry tail {}, page_id {}", GetEntryTail(), GetPageID());
+//  SPDLOG_TRACE("current entry tail {}, page_id {}", GetEntryTail(), GetPageID());
   for(auto it = start; it != end; it++) {
     if (key < it.key()) {
       break;
@@ -634,7 +623,7 @@ Status BTreeNodePage::leaf_insert(int64_t key, const byte *value, int32_t v_len)
     offset += it.size();
   }
   auto total_len = sizeof(key) + sizeof(int32_t) + v_len;
-  memcpy(entry_pos_start + offset + total_len, entry_pos_start + offset, GetEntryTail() - offset);
+  memmove(entry_pos_start + offset + total_len, entry_pos_start + offset, GetEntryTail() - offset);
 
   // write value
   auto pos_start = entry_pos_start + offset;
@@ -651,20 +640,20 @@ Status BTreeNodePage::leaf_insert(int64_t key, const byte *value, int32_t v_len)
   // update available size
   SetAvailable(GetAvailable() - total_len);
   SetIsDirty(true);
-  SPDLOG_INFO("[page_id {}] key={}, offset={}, available={}, entry_tail= {}, move size= {}", GetPageID(), key, offset, GetAvailable(), GetEntryTail(), GetEntryTail() - offset);
+  SPDLOG_TRACE("[page_id {}] key={}, offset={}, available={}, entry_tail= {}, move size= {}", GetPageID(), key, offset, GetAvailable(), GetEntryTail(), GetEntryTail() - offset);
   return Status::OK();
 }
 
 Status BTreeNodePage::leaf_search(int64_t target, std::string *dst) {
   assert(IsLeafNode());
-  int n_entries = GetCurrentEntries();
-  SPDLOG_INFO("current page_id: {}, current_entries: {}, available={}", GetPageID(), n_entries, GetAvailable());
+  [[maybe_unused]] int n_entries = GetCurrentEntries();
+  SPDLOG_TRACE("current page_id: {}, current_entries: {}, available={}", GetPageID(), n_entries, GetAvailable());
   auto entry_pos_start = reinterpret_cast<char *>(EntryPosStart());
   BTreeNodeIter start(entry_pos_start);
   BTreeNodeIter end(entry_pos_start + GetEntryTail());
   for (auto it = start; it != end; it++) {
     if (it.key() == target) {
-      SPDLOG_INFO("key: {}, value_size: {}", target, it.value_size());
+      SPDLOG_TRACE("key: {}, value_size: {}", target, it.value_size());
       dst->assign(it.value().data(), it.value_size());
       return Status::OK();
     }
@@ -674,14 +663,14 @@ Status BTreeNodePage::leaf_search(int64_t target, std::string *dst) {
 
 bool BTreeNodePage::leaf_exists(int64_t target) {
   assert(IsLeafNode());
-  int n_entries = GetCurrentEntries();
-  SPDLOG_INFO("current page_id: {}, current_entries: {}, available={}", GetPageID(), n_entries, GetAvailable());
+  [[maybe_unused]] int n_entries = GetCurrentEntries();
+  SPDLOG_TRACE("current page_id: {}, current_entries: {}, available={}", GetPageID(), n_entries, GetAvailable());
   auto entry_pos_start = reinterpret_cast<char *>(EntryPosStart());
   BTreeNodeIter start(entry_pos_start);
   BTreeNodeIter end(entry_pos_start + GetEntryTail());
   for (auto it = start; it != end; it++) {
     if (it.key() == target) {
-      SPDLOG_INFO("key: {}, value_size: {}", target, it.value_size());
+      SPDLOG_TRACE("key: {}, value_size: {}", target, it.value_size());
       return true;
     }
   }
@@ -702,19 +691,19 @@ BTreeNodePage* BTreeNodePage::NewIndexPage(BufferPoolManager* buffer_pool_manage
   auto child_start = next_page->ChildPosStart();
   child_start[0] = left;
   child_start[1] = right;
-  SPDLOG_INFO("index page child: {} {}, child offset: {}", left, right, reinterpret_cast<char *>(child_start) - next_page->GetData());
+  SPDLOG_TRACE("index page child: {} {}, child offset: {}", left, right, reinterpret_cast<char *>(child_start) - next_page->GetData());
   next_page->SetIsDirty(true);
   // 设置entries
   next_page->SetCurrentEntries(cnt);
-  auto right_child = reinterpret_cast<BTreeNodePage*>(buffer_pool_manager->FetchPage(right));
-  SPDLOG_INFO("after new index node right page_id = {}, available = {}", right_child->GetPageID(), right_child->GetAvailable());
+  [[maybe_unused]] auto right_child = reinterpret_cast<BTreeNodePage*>(buffer_pool_manager->FetchPage(right));
+  SPDLOG_TRACE("after new index node right page_id = {}, available = {}", right_child->GetPageID(), right_child->GetAvailable());
   return next_page;
 }
 
 // TODO: should be static method
 BTreeNodePage* BTreeNodePage::NewLeafPage(BufferPoolManager* buffer_pool_manager, int cnt, const EntryIterator &start, const EntryIterator &end) {
   assert(cnt >= 0);
-  SPDLOG_INFO("[page_id {}] leaf page with count {}", GetPageID(), cnt);
+  SPDLOG_TRACE("[page_id {}] leaf page with count {}", GetPageID(), cnt);
   page_id_t new_page_id;
   auto next_page = static_cast<BTreeNodePage*>(buffer_pool_manager->NewPage(&new_page_id));
   assert(new_page_id != INVALID_PAGE_ID);
@@ -762,23 +751,13 @@ BTreeNodePage* BTreeNodePage::NewIndexPageFrom(BufferPoolManager* buffer_pool_ma
   page_id_t page_id;
   auto new_page = reinterpret_cast<BTreeNodePage*>(buffer_pool_manager->NewPage(&page_id));
   auto cnt = src->GetCurrentEntries() - start;
-  SPDLOG_INFO("new index page_id {}, with {} keys, start: {}", page_id, cnt, start);
+  SPDLOG_TRACE("new index page_id {}, with {} keys, start: {}", page_id, cnt, start);
   new_page->SetCurrentEntries(cnt);
   new_page->SetPageID(page_id);
   // index_node需要设置degree
   new_page->SetDegree(src->GetDegree());
   // 复制key [start, n_entries)
   memmove(new_page->KeyPosStart(), src->KeyPosStart() + start, cnt * sizeof(int64_t));
-  printf("origin children-------------------------------\n");
-  for (int i = start; i < src->GetCurrentEntries(); i++) {
-    printf("%lld ", src->GetKey(i));
-  }
-  printf("\n----------------------\n");
-  printf("new children--------------------------\n");
-  for (int i = 0; i < cnt; i++) {
-    printf("%lld ", new_page->GetKey(i));
-  }
-  printf("\n----------------------\n");
   // 复制child, [start, n_entries]
   memmove(new_page->ChildPosStart(), src->ChildPosStart() + start, (cnt + 1) * sizeof(int64_t));
   new_page->SetIsDirty(true);
@@ -791,7 +770,7 @@ void BTreeNodePage::index_node_add_child(int pos, int64_t key, int child_pos, pa
   assert(pos >= 0);
   auto key_start = KeyPosStart();
   auto n_entry = GetCurrentEntries();
-  SPDLOG_INFO("[page_id {}] key_pos={}, key={}, n_entries = {}, child_pos = {}, child_page_id={}", GetPageID(), pos, key, n_entry, child_pos, child);
+  SPDLOG_TRACE("[page_id {}] key_pos={}, key={}, n_entries = {}, child_pos = {}, child_page_id={}", GetPageID(), pos, key, n_entry, child_pos, child);
   // NOTE: 这个问题居然看了好久, 居然是size的问题...
   memmove(key_start + pos + 1, key_start + pos, (n_entry - pos) * sizeof(int64_t));
   key_start[pos]= key;
@@ -808,7 +787,7 @@ void BTreeNodePage::index_node_add_child(int pos, int64_t key, int child_pos, pa
   // POST ASSERT
   SetCurrentEntries(n_entry + 1);
   assert(GetCurrentEntries() <= GetDegree());
-  SPDLOG_INFO("[page_id {}] after add child entries {}", GetPageID(), GetCurrentEntries());
+  SPDLOG_TRACE("[page_id {}] after add child entries {}", GetPageID(), GetCurrentEntries());
 }
 
 // NOTE: just for one page key
@@ -820,7 +799,7 @@ void BTreeNodePage::index_node_add_child(int64_t key, page_id_t child) {
   auto it = std::lower_bound(key_start, key_end, key);
 
   auto idx = it - key_start;
-  SPDLOG_INFO("new_key in the index {}", idx);
+  SPDLOG_TRACE("new_key in the index {}", idx);
   // TODO: need test child = key_idx + 1
   index_node_add_child(idx, key, idx + 1, child, nullptr);
 }
@@ -865,7 +844,7 @@ Status BTreeNodePage::leaf_remove(BufferPoolManager* buffer_pool_manager, int64_
     offset += it.size();
   }
   if (!found) {
-    SPDLOG_INFO("leaf {} not found key {}", GetPageID(), key);
+    SPDLOG_TRACE("leaf {} not found key {}", GetPageID(), key);
     return Status::NotFound("no key");
   }
   auto left = total - offset - total_size;
@@ -874,20 +853,20 @@ Status BTreeNodePage::leaf_remove(BufferPoolManager* buffer_pool_manager, int64_
   }
   SetAvailable(GetAvailable() + total_size);
   if (total > total_size) {
-    SPDLOG_INFO("page_id={} success delete key {}", GetPageID(), key);
+    SPDLOG_TRACE("page_id={} success delete key {}", GetPageID(), key);
     return Status::OK();
   }
-  SPDLOG_INFO("page_id={} will be empty page", GetPageID());
+  SPDLOG_TRACE("page_id={} will be empty page", GetPageID());
   if (*root == this) {
     // root page is empty
-    SPDLOG_INFO("root_page {} is empty", GetPageID());
+    SPDLOG_TRACE("root_page {} is empty", GetPageID());
     return Status::OK();
   }
   // empty leaf_page, will cause parent to remove child
   auto parent_id = GetParentPageID();
   assert(parent_id != INVALID_PAGE_ID);
 
-  SPDLOG_INFO("remove_page found parent id {}", parent_id);
+  SPDLOG_TRACE("remove_page found parent id {}", parent_id);
   auto parent = reinterpret_cast<BTreeNodePage*>(buffer_pool_manager->FetchPage(parent_id));
   auto key_pos = std::lower_bound(parent->KeyPosStart(), parent->KeyPosStart() + parent->GetCurrentEntries(), key);
   auto child_index = key_pos - parent->KeyPosStart();
@@ -919,7 +898,7 @@ Status BTreeNodePage::index_remove(BufferPoolManager* buffer_pool_manager, int k
   assert(entries >= 1);
   assert(child_idx <= entries);
   assert(key_idx < entries);
-  SPDLOG_INFO("page_id {} to remove key_idx = {}, child_idx = {}", GetPageID(), key_idx, child_idx);
+  SPDLOG_TRACE("page_id {} to remove key_idx = {}, child_idx = {}", GetPageID(), key_idx, child_idx);
   // index_node entries >= ceil(degree / 2)
   if (entries - 1 >= (degree / 2) || *root == this) {
     if (*root == this && entries == 1) {
@@ -928,7 +907,7 @@ Status BTreeNodePage::index_remove(BufferPoolManager* buffer_pool_manager, int k
       if (child_idx == 0) {
         new_root_page_id = GetChild(1);
       }
-      SPDLOG_INFO("root will down to child, new_root_page_id {}", new_root_page_id);
+      SPDLOG_TRACE("root will down to child, new_root_page_id {}", new_root_page_id);
       auto new_root_page = reinterpret_cast<BTreeNodePage*>(buffer_pool_manager->FetchPage(new_root_page_id));
       auto old_root = *root;
       assert(old_root != nullptr);
@@ -941,7 +920,7 @@ Status BTreeNodePage::index_remove(BufferPoolManager* buffer_pool_manager, int k
     // NOTE: only root can have less than degree / 2
     // if last child, just update entries count
     auto key_move_cnt = entries - key_idx - 1;
-    SPDLOG_INFO("index_page {} has {} child, no_redistribute, move key cnt: {}", GetPageID(), entries + 1, key_move_cnt);
+    SPDLOG_TRACE("index_page {} has {} child, no_redistribute, move key cnt: {}", GetPageID(), entries + 1, key_move_cnt);
     memmove(key_start + key_idx, key_start + (key_idx + 1), key_move_cnt * sizeof(int64_t));
     auto child_move_cnt = entries - child_idx;
     memmove(child_start + child_idx, child_start + (child_idx + 1), child_move_cnt * sizeof(page_id_t));
@@ -953,19 +932,19 @@ Status BTreeNodePage::index_remove(BufferPoolManager* buffer_pool_manager, int k
     // recursive remove
     auto parent_id = GetParentPageID();
     assert(parent_id != INVALID_PAGE_ID);
-    SPDLOG_INFO("index_remove will cause redistribute, parent_page_id {}, current page_id {}", parent_id, GetPageID());
+    SPDLOG_TRACE("index_remove will cause redistribute, parent_page_id {}, current page_id {}", parent_id, GetPageID());
     auto parent_page = reinterpret_cast<BTreeNodePage*>(buffer_pool_manager->FetchPage(parent_id));
     int parent_child_idx;
     // found current page's index in parent page
     auto s = parent_page->find_child_index(GetPageID(), &parent_child_idx);
-    SPDLOG_INFO("parent_child_idx = {}, child_idx = {}", parent_child_idx, child_idx);
+    SPDLOG_TRACE("parent_child_idx = {}, child_idx = {}", parent_child_idx, child_idx);
     assert(s.ok());
     // remove current index
     if (child_idx == entries) {
       // right most child no need to delete
-      SPDLOG_INFO("delete to right most child {}", child_idx);
+      SPDLOG_TRACE("delete to right most child {}", child_idx);
     }
-    SPDLOG_INFO("delete key_idx {} need to borrow from parent", key_idx);
+    SPDLOG_TRACE("delete key_idx {} need to borrow from parent", key_idx);
     // NOTE: assume key_idx always right
     memmove(key_start + key_idx, key_start + key_idx + 1, (entries - key_idx - 1) * sizeof(int64_t));
     memmove(child_start + child_idx, child_start + child_idx + 1, (entries - child_idx) * sizeof(page_id_t));
@@ -977,9 +956,9 @@ Status BTreeNodePage::index_remove(BufferPoolManager* buffer_pool_manager, int k
       auto sibling_entries = next_sibling_page->GetCurrentEntries();
       if (need_merge(entries - 1, sibling_entries)) {
         // NOTE: just remove a child
-        SPDLOG_INFO("merge two page left {}, right {}", GetPageID(), next_sibling_page_id);
+        SPDLOG_TRACE("merge two page left {}, right {}", GetPageID(), next_sibling_page_id);
         // NOTE: borrow from parent's first key
-        SPDLOG_INFO("page_id {} borrow first key from parent {}, key: {}", GetPageID(), parent_page->GetPageID(), parent_page->GetKey(0));
+        SPDLOG_TRACE("page_id {} borrow first key from parent {}, key: {}", GetPageID(), parent_page->GetPageID(), parent_page->GetKey(0));
         // NOTE: update entries count before merge
         SetCurrentEntries(entries - 1);
         s = merge(this, next_sibling_page, parent_page, 0);
@@ -991,7 +970,7 @@ Status BTreeNodePage::index_remove(BufferPoolManager* buffer_pool_manager, int k
         // redistribute is ok, no recursive
         auto max_redistribute_cnt = sibling_entries - (MAX_DEGREE / 2);
         assert(max_redistribute_cnt > 0);
-        SPDLOG_INFO("redistribute children between {} and {} is ok", GetPageID(), next_sibling_page_id);
+        SPDLOG_TRACE("redistribute children between {} and {} is ok", GetPageID(), next_sibling_page_id);
         SetCurrentEntries(entries - 1);
         s = redistribute(this, next_sibling_page, parent_page, 0);
         assert(s.ok());
@@ -1000,13 +979,13 @@ Status BTreeNodePage::index_remove(BufferPoolManager* buffer_pool_manager, int k
 
     } else if (parent_child_idx == parent_page->GetCurrentEntries()) {
       // right most child
-      SPDLOG_INFO("delete right most child page {} in parent {} idx {}", GetPageID(), parent_page->GetPageID(), parent_child_idx);
+      SPDLOG_TRACE("delete right most child page {} in parent {} idx {}", GetPageID(), parent_page->GetPageID(), parent_child_idx);
       auto prev_sibling_page_id = parent_page->GetChild(parent_child_idx - 1);
       assert(prev_sibling_page_id != 0 && prev_sibling_page_id != INVALID_PAGE_ID);
       auto prev_sibling_page = reinterpret_cast<BTreeNodePage*>(buffer_pool_manager->FetchPage(prev_sibling_page_id));
       auto sibling_entries = prev_sibling_page->GetCurrentEntries();
       if (need_merge(sibling_entries, entries - 1)) {
-        SPDLOG_INFO("merge two page left {}, right {}", prev_sibling_page_id, GetPageID());
+        SPDLOG_TRACE("merge two page left {}, right {}", prev_sibling_page_id, GetPageID());
         SetCurrentEntries(entries - 1);
         s = merge(prev_sibling_page, this, parent_page, parent_child_idx - 1);
         assert(s.ok());
@@ -1014,7 +993,7 @@ Status BTreeNodePage::index_remove(BufferPoolManager* buffer_pool_manager, int k
         ResetMemory();
         return parent_page->index_remove(buffer_pool_manager, parent_child_idx - 1, parent_child_idx, root);
       } else {
-        SPDLOG_INFO("redistribute children between {} and {} is ok", prev_sibling_page_id, GetPageID());
+        SPDLOG_TRACE("redistribute children between {} and {} is ok", prev_sibling_page_id, GetPageID());
         SetCurrentEntries(entries - 1);
         return redistribute(prev_sibling_page, this, parent_page, parent_child_idx - 1);
       }
@@ -1027,7 +1006,7 @@ Status BTreeNodePage::index_remove(BufferPoolManager* buffer_pool_manager, int k
       auto next_page = reinterpret_cast<BTreeNodePage*>(buffer_pool_manager->FetchPage(next_page_id));
       auto prev_entries = prev_page->GetCurrentEntries();
       auto next_entries = next_page->GetCurrentEntries();
-      SPDLOG_INFO("page_id {} meet with middle node prev_page {}, next_page {}", GetPageID(), prev_page_id, next_page_id);
+      SPDLOG_TRACE("page_id {} meet with middle node prev_page {}, next_page {}", GetPageID(), prev_page_id, next_page_id);
 
       SetCurrentEntries(entries - 1);
       // update to latest entries
@@ -1036,18 +1015,18 @@ Status BTreeNodePage::index_remove(BufferPoolManager* buffer_pool_manager, int k
         if (prev_entries > next_entries) {
           // case redis-3
           // redistribute between left and current
-          SPDLOG_INFO("case redis-3");
+          SPDLOG_TRACE("case redis-3");
           return redistribute(prev_page, this, parent_page, parent_child_idx - 1);
         } else {
           // case redis-4
           // redistribute between current and right
-          SPDLOG_INFO("case redis-4");
+          SPDLOG_TRACE("case redis-4");
           return redistribute(this, next_page, parent_page, parent_child_idx);
         }
       } else if (can_redistribute(next_entries, entries)) {
         // case redis-5
         // redistribute between current and right
-        SPDLOG_INFO("index_remove:branch:3 case redis-5");
+        SPDLOG_TRACE("index_remove:branch:3 case redis-5");
         return redistribute(this, next_page, parent_page, parent_child_idx);
       } else if (prev_entries < next_entries) {
         // case merge-1
@@ -1055,19 +1034,19 @@ Status BTreeNodePage::index_remove(BufferPoolManager* buffer_pool_manager, int k
         // NOTE: 都不可以redistribute的情况下，prev和next应该是一样多的key, 理论上讲这个case应该不存在
         s = merge(prev_page, this, parent_page, parent_child_idx - 1);
         assert(s.ok());
-        SPDLOG_INFO("case merge-1");
+        SPDLOG_TRACE("case merge-1");
         return parent_page->index_remove(buffer_pool_manager, parent_child_idx - 1, parent_child_idx, root);
       } else {
         // case merge-2
         // merge current and right
         s = merge(this, next_page, parent_page, parent_child_idx);
         assert(s.ok());
-        SPDLOG_INFO("case merge-2");
+        SPDLOG_TRACE("case merge-2");
         return parent_page->index_remove(buffer_pool_manager, parent_child_idx, parent_child_idx + 1, root);
       }
     }
   }
-  SPDLOG_INFO("meet with unsupported situation");
+  SPDLOG_TRACE("meet with unsupported situation");
 }
 
 Status BTreeNodePage::merge(BTreeNodePage *left, BTreeNodePage *right, BTreeNodePage *parent, int borrowed_key_idx) {
@@ -1092,7 +1071,7 @@ Status BTreeNodePage::redistribute(BTreeNodePage *left, BTreeNodePage *right, BT
   if (entries_left < entries_right) {
     // case redistribute-2
     auto redistribute_cnt = get_redistribute_cnt(entries_left, entries_right);
-    SPDLOG_INFO("entry_left = {}, entry_right = {}, redistribute_cnt = {}", entries_left, entries_right, redistribute_cnt);
+    SPDLOG_TRACE("entry_left = {}, entry_right = {}, redistribute_cnt = {}", entries_left, entries_right, redistribute_cnt);
     // append keys to left
     auto left_key_start = left->KeyPosStart();
     auto right_key_start = right->KeyPosStart();
@@ -1119,8 +1098,8 @@ Status BTreeNodePage::redistribute(BTreeNodePage *left, BTreeNodePage *right, BT
   } else if (entries_right < entries_left) {
     // case redistribute-2
     auto redistribute_cnt = get_redistribute_cnt(entries_right, entries_left);
-    SPDLOG_INFO("move left to right, parent key_idx {}", key_idx);
-    SPDLOG_INFO("entry_left = {}, entry_right = {}, redistribute_cnt = {}", entries_left, entries_right, redistribute_cnt);
+    SPDLOG_TRACE("move left to right, parent key_idx {}", key_idx);
+    SPDLOG_TRACE("entry_left = {}, entry_right = {}, redistribute_cnt = {}", entries_left, entries_right, redistribute_cnt);
     // left 满了，需要向right redistribute
     auto left_key_start = left->KeyPosStart();
     auto right_key_start = right->KeyPosStart();
@@ -1218,7 +1197,7 @@ void BTreeNodePage::init(BTreeNodePage* dst, int degree, int n, page_id_t page_i
     dst->SetPrevPageID(INVALID_PAGE_ID);
   }
   dst->SetParentPageID(INVALID_PAGE_ID);
-  SPDLOG_INFO("init page: page_id={}, is_leaf={}, available={}", page_id, is_leaf, dst->GetAvailable());
+  SPDLOG_TRACE("init page: page_id={}, is_leaf={}, available={}", page_id, is_leaf, dst->GetAvailable());
 }
 
 // iterator
@@ -1273,9 +1252,9 @@ void BTreeNodePage::debug_available(BufferPoolManager* buffer_pool) {
     auto btree_page = reinterpret_cast<BTreeNodePage*>(buffer_pool->FetchPage(page_id));
     assert(btree_page->GetPageID() == page_id);
     if (!btree_page->IsLeafNode()) {
-      SPDLOG_INFO("root page_id={}, childs = {}", page_id, btree_page->GetCurrentEntries());
+      SPDLOG_TRACE("root page_id={}, childs = {}", page_id, btree_page->GetCurrentEntries());
     } else {
-      SPDLOG_INFO("leaf page_id={}, keys = {}, available = {}", page_id, btree_page->GetCurrentEntries(), btree_page->GetAvailable());
+      SPDLOG_TRACE("leaf page_id={}, keys = {}, available = {}", page_id, btree_page->GetCurrentEntries(), btree_page->GetAvailable());
     }
   }
 }
@@ -2,6 +2,7 @@
 // Created by skyitachi on 2020/8/22.
 //
 #include <buffer_pool_manager.hpp>
+#include <event_trace.h>
 #include <spdlog/spdlog.h>
 #include <utility>
 
@@ -45,7 +46,7 @@ Page* BufferPoolManager::FetchPage(page_id_t page_id) {
   // fetch from pinned records first
   auto pinned_it = pinned_records_.find(page_id);
   if (pinned_it != pinned_records_.end()) {
-    SPDLOG_INFO("found page_id {} in pinned records", page_id);
+    SPDLOG_TRACE("found page_id {} in pinned records", page_id);
     return pinned_it->second;
   }
   // fetch from lru records second
@@ -54,7 +55,7 @@ Page* BufferPoolManager::FetchPage(page_id_t page_id) {
     // 放到队首
     next_page = *it->second;
     if (using_list_.front() == next_page) {
-      SPDLOG_INFO("no need to reinsert");
+      SPDLOG_TRACE("no need to reinsert");
       return next_page;
     }
     using_list_.erase(it->second);
@@ -73,7 +74,7 @@ Page* BufferPoolManager::FetchPage(page_id_t page_id) {
     lru_records_.insert(std::make_pair(page_id, first));
     yedis_instance_->disk_manager->ReadPage(page_id, next_page->GetData());
     next_page->SetPageID(page_id);
-    SPDLOG_INFO("current using_list_ first: page_id {}", next_page->GetPageId());
+    SPDLOG_TRACE("current using_list_ first: page_id {}", next_page->GetPageId());
   } else if (!using_list_.empty()) {
     auto iterator = lru_records_.find(page_id);
     if (iterator == lru_records_.end()) {
@@ -81,7 +82,9 @@ Page* BufferPoolManager::FetchPage(page_id_t page_id) {
       auto least_used_page = using_list_.back();
       using_list_.pop_back();
       lru_records_.erase(least_used_page->GetPageId());
-      SPDLOG_INFO("least used page {}, out memory", least_used_page->GetPageId());
+      SPDLOG_TRACE("least used page {}, out memory", least_used_page->GetPageId());
+      YEDIS_TRACE_EVENT(TraceEventType::kPageEvict, {"page_id", least_used_page->GetPageId()},
+                        {"dirty", least_used_page->IsDirty()}, {"for_page_id", page_id});
       FlushPage(least_used_page);
       next_page = least_used_page;
       using_list_.push_front(next_page);
@@ -105,22 +108,22 @@ void BufferPoolManager::Pin(Page *page) {
 // TODO: make sure pin and unpin logic
 void BufferPoolManager::Pin(page_id_t page_id) {
   if (pinned_records_.find(page_id) != pinned_records_.end()) {
-    SPDLOG_INFO("found {} in pinned records", page_id);
+    SPDLOG_TRACE("found {} in pinned records", page_id);
     return;
   }
   auto it = lru_records_.find(page_id);
   assert(it != lru_records_.end());
-  SPDLOG_INFO("found page {} in lru_records", page_id);
+  SPDLOG_TRACE("found page {} in lru_records", page_id);
   (*(it->second))->Pin();
   pinned_records_.insert(std::make_pair(it->first, *(it->second)));
   // TODO: 这里会影响到相关内存的有效问题
-  SPDLOG_INFO("before using list delete iterator: page_id {}, it.key {}", (*it->second)->GetPageId(), it->first);
+  SPDLOG_TRACE("before using list delete iterator: page_id {}, it.key {}", (*it->second)->GetPageId(), it->first);
   // TODO: 这里要确保只会被删除一次
   using_list_.erase(it->second);
-  SPDLOG_INFO("using_list_ erase done, before lru_records delete iterator, page_id {}", page_id);
+  SPDLOG_TRACE("using_list_ erase done, before lru_records delete iterator, page_id {}", page_id);
   lru_records_.erase(page_id);
   // NOTE: after erase iterator was not defined
-  SPDLOG_INFO("lru_records erase done: {}", page_id);
+  SPDLOG_TRACE("lru_records erase done: {}", page_id);
 }
 
 void BufferPoolManager::UnPin(Page *page) {
@@ -133,17 +136,18 @@ void BufferPoolManager::UnPin(page_id_t page_id) {
   if (it == pinned_records_.end()) {
     return;
   }
-  it->second->UnPin();
-  pinned_records_.erase(page_id);
+  Page* page = it->second;
+  page->UnPin();
+  pinned_records_.erase(it);
   // NOTE: 放到了队首 值得商榷
-  using_list_.push_front(it->second);
+  using_list_.push_front(page);
   lru_records_.insert(std::make_pair(page_id, using_list_.begin()));
 }
 
 // lru
 Page* BufferPoolManager::NewPage(page_id_t *page_id) {
   *page_id = yedis_instance_->disk_manager->AllocatePage();
-  SPDLOG_INFO("NewPage page_id: {}", *page_id);
+  SPDLOG_TRACE("NewPage page_id: {}", *page_id);
   auto new_page = FetchPage(*page_id);
   new_page->SetPageID(*page_id);
   return new_page;
@@ -161,10 +165,10 @@ Status BufferPoolManager::Flush() {
 
 void BufferPoolManager::FlushPage(Page *page) {
   if (page->IsDirty()) {
-    SPDLOG_INFO("flush_page page_id {}", page->GetPageId());
+    SPDLOG_TRACE("flush_page page_id {}", page->GetPageId());
     yedis_instance_->disk_manager->WritePage(page->GetPageId(), page->GetData());
   } else {
-    SPDLOG_INFO("no need to flush: {}", page->GetPageId());
+    SPDLOG_TRACE("no need to flush: {}", page->GetPageId());
   }
   page->ResetMemory();
 }
@@ -7,6 +7,7 @@
 
 #include <disk_manager.hpp>
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -19,6 +20,8 @@ namespace yedis {
       spdlog::error("{} open failed {}", db_file, strerror(errno));
       throw "open failed";
     }
+    // NOTE: reopened file, new pages go after the existing ones
+    next_page_id_ = GetFileSize(db_file) / options_.page_size;
   }
 
   void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
@@ -28,12 +31,12 @@ namespace yedis {
 
   void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
     lseek(fd_, page_id * options_.page_size, SEEK_SET);
-    spdlog::info("write to disk data: page_id {}, page_size {}, db file: {}", page_id, options_.page_size, file_name_);
+    SPDLOG_TRACE("write to disk data: page_id {}, page_size {}, db file: {}", page_id, options_.page_size, file_name_);
     int written = write(fd_, page_data, options_.page_size);
     if (written != options_.page_size) {
       spdlog::error("write to disk error, written {} data", written);
     } else {
-      spdlog::info("write success");
+      SPDLOG_TRACE("write success");
     }
   }
 
@@ -45,8 +48,12 @@ namespace yedis {
     close(fd_);
   }
 
-  int DiskManager::GetFileSize(const std::string &file_name) {
-    return -1;
+  int64_t DiskManager::GetFileSize(const std::string &file_name) {
+    struct stat st{};
+    if (stat(file_name.c_str(), &st) != 0) {
+      return -1;
+    }
+    return st.st_size;
   }
 
   void DiskManager::Destroy() {
@@ -0,0 +1,95 @@
+//
+// Sampled event trace.
+//
+
+#include <cassert>
+#include <chrono>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
+
+#include "event_trace.h"
+
+namespace yedis {
+
+namespace {
+
+const char* const kTraceEventTypeNames[static_cast<int>(TraceEventType::kTraceEventTypeMax)] = {
+  "page_evict",
+  "btree_root_split",
+  "memtable_switch",
+  "flush",
+  "compaction",
+  "write_stall",
+};
+
+std::atomic<uint32_t> sample_every{1};
+std::atomic<uint64_t> seen[static_cast<int>(TraceEventType::kTraceEventTypeMax)];
+
+class LogEventTraceSink: public EventTraceSink {
+public:
+  void Write(const TraceEvent& event) override {
+    spdlog::info("{}", event.ToString());
+  }
+};
+
+}
+
+const char* TraceEventTypeName(TraceEventType type) {
+  assert(type < TraceEventType::kTraceEventTypeMax);
+  return kTraceEventTypeNames[static_cast<int>(type)];
+}
+
+std::string TraceEvent::ToString() const {
+  static constexpr const char* kEventFormat = "event={} ts={}";
+  static constexpr const char* kFieldFormat = " {}={}";
+  std::string result = fmt::format(kEventFormat, TraceEventTypeName(type), timestamp_micros);
+  for (int i = 0; i < num_fields; i++) {
+    result.append(fmt::format(kFieldFormat, fields[i].name, fields[i].value));
+  }
+  return result;
+}
+
+EventTraceSink* NewLogEventTraceSink() {
+  return new LogEventTraceSink();
+}
+
+void SetEventTraceSink(EventTraceSink* sink, uint32_t every) {
+  sample_every.store(every == 0 ? 1 : every, std::memory_order_relaxed);
+  for (auto& count: seen) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  event_trace::sink.store(sink, std::memory_order_release);
+}
+
+namespace event_trace {
+
+std::atomic<EventTraceSink*> sink{nullptr};
+
+bool Sample(TraceEventType type) {
+  const uint64_t n = seen[static_cast<int>(type)].fetch_add(1, std::memory_order_relaxed);
+  return n % sample_every.load(std::memory_order_relaxed) == 0;
+}
+
+void Record(TraceEventType type, std::initializer_list<TraceEventField> fields) {
+  EventTraceSink* current = sink.load(std::memory_order_acquire);
+  if (current == nullptr) {
+    return;
+  }
+  TraceEvent event;
+  event.type = type;
+  event.timestamp_micros = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  event.num_fields = 0;
+  for (const auto& field: fields) {
+    if (event.num_fields == TraceEvent::kMaxFields) {
+      break;
+    }
+    event.fields[event.num_fields++] = field;
+  }
+  current->Write(event);
+}
+
+}
+
+}
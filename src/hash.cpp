@@ -0,0 +1,339 @@
+//
+// 64-bit hash after XXH3: short keys go through a few multiply-folds,
+// long keys are consumed in 64-byte stripes by eight independent lanes,
+// which maps onto SSE2/AVX2 registers.
+//
+// Filters persist these values, every implementation below has to return
+// the same result for the same input.
+//
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "util.hpp"
+
+namespace yedis {
+
+namespace {
+
+constexpr uint64_t kPrime32_1 = 0x9E3779B1u;
+constexpr uint64_t kPrime32_2 = 0x85EBCA77u;
+constexpr uint64_t kPrime32_3 = 0xC2B2AE3Du;
+constexpr uint64_t kPrime64_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t kPrime64_3 = 0x165667B19E3779F9ull;
+constexpr uint64_t kPrime64_4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t kPrime64_5 = 0x27D4EB2F165667C5ull;
+
+constexpr size_t kSecretSize = 192;
+constexpr size_t kStripeLen = 64;
+constexpr size_t kSecretConsumeRate = 8;
+constexpr size_t kAccNb = kStripeLen / sizeof(uint64_t);
+constexpr size_t kStripesPerBlock = (kSecretSize - kStripeLen) / kSecretConsumeRate;
+constexpr size_t kBlockLen = kStripeLen * kStripesPerBlock;
+
+constexpr size_t kMidSizeMax = 240;
+
+// The key material mixed into the input.  Generated with splitmix64 rather
+// than copied from XXH3, so the values differ from XXH3_64bits.
+constexpr std::array<char, kSecretSize> MakeSecret() {
+  std::array<char, kSecretSize> secret{};
+  uint64_t x = kPrime64_1;
+  for (size_t i = 0; i < kSecretSize; i += sizeof(uint64_t)) {
+    x += 0x9E3779B97F4A7C15ull;
+    uint64_t z = x;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    for (size_t j = 0; j < sizeof(uint64_t); j++) {
+      secret[i + j] = static_cast<char>(z >> (8 * j));
+    }
+  }
+  return secret;
+}
+
+constexpr std::array<char, kSecretSize> kSecret = MakeSecret();
+
+inline uint64_t Read64(const char* p) {
+  // little endian only, like DecodeFixed64
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t Read32(const char* p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline void Write64(char* p, uint64_t v) {
+  std::memcpy(p, &v, sizeof(v));
+}
+
+inline uint64_t Rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t Mul128Fold64(uint64_t a, uint64_t b) {
+  const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+  return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+
+inline uint64_t Avalanche(uint64_t h) {
+  h ^= h >> 37;
+  h *= 0x165667919E3779F9ull;
+  h ^= h >> 32;
+  return h;
+}
+
+inline uint64_t Avalanche64(uint64_t h) {
+  h ^= h >> 33;
+  h *= kPrime64_2;
+  h ^= h >> 29;
+  h *= kPrime64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+inline uint64_t Rrmxmx(uint64_t h, uint64_t len) {
+  h ^= Rotl64(h, 49) ^ Rotl64(h, 24);
+  h *= 0x9FB21C651E98DF25ull;
+  h ^= (h >> 35) + len;
+  h *= 0x9FB21C651E98DF25ull;
+  return h ^ (h >> 28);
+}
+
+inline uint64_t Mix16B(const char* p, const char* secret, uint64_t seed) {
+  return Mul128Fold64(Read64(p) ^ (Read64(secret) + seed),
+                      Read64(p + 8) ^ (Read64(secret + 8) - seed));
+}
+
+uint64_t Hash0To16(const char* p, size_t len, const char* secret, uint64_t seed) {
+  if (len > 8) {
+    const uint64_t bitflip1 = (Read64(secret + 24) ^ Read64(secret + 32)) + seed;
+    const uint64_t bitflip2 = (Read64(secret + 40) ^ Read64(secret + 48)) - seed;
+    const uint64_t lo = Read64(p) ^ bitflip1;
+    const uint64_t hi = Read64(p + len - 8) ^ bitflip2;
+    const uint64_t acc = len + __builtin_bswap64(lo) + hi + Mul128Fold64(lo, hi);
+    return Avalanche(acc);
+  }
+  if (len >= 4) {
+    seed ^= static_cast<uint64_t>(__builtin_bswap32(static_cast<uint32_t>(seed))) << 32;
+    const uint64_t bitflip = (Read64(secret + 8) ^ Read64(secret + 16)) - seed;
+    const uint64_t input = Read32(p + len - 4) + (static_cast<uint64_t>(Read32(p)) << 32);
+    return Rrmxmx(input ^ bitflip, len);
+  }
+  if (len > 0) {
+    const uint32_t c1 = static_cast<uint8_t>(p[0]);
+    const uint32_t c2 = static_cast<uint8_t>(p[len >> 1]);
+    const uint32_t c3 = static_cast<uint8_t>(p[len - 1]);
+    const uint32_t combined = (c1 << 16) | (c2 << 24) | c3 | (static_cast<uint32_t>(len) << 8);
+    const uint64_t bitflip = (Read32(secret) ^ Read32(secret + 4)) + seed;
+    return Avalanche64(combined ^ bitflip);
+  }
+  return Avalanche64(seed ^ Read64(secret + 56) ^ Read64(secret + 64));
+}
+
+uint64_t Hash17To128(const char* p, size_t len, const char* secret, uint64_t seed) {
+  uint64_t acc = len * kPrime64_1;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        acc += Mix16B(p + 48, secret + 96, seed);
+        acc += Mix16B(p + len - 64, secret + 112, seed);
+      }
+      acc += Mix16B(p + 32, secret + 64, seed);
+      acc += Mix16B(p + len - 48, secret + 80, seed);
+    }
+    acc += Mix16B(p + 16, secret + 32, seed);
+    acc += Mix16B(p + len - 32, secret + 48, seed);
+  }
+  acc += Mix16B(p, secret, seed);
+  acc += Mix16B(p + len - 16, secret + 16, seed);
+  return Avalanche(acc);
+}
+
+uint64_t Hash129To240(const char* p, size_t len, const char* secret, uint64_t seed) {
+  uint64_t acc = len * kPrime64_1;
+  for (size_t i = 0; i < 8; i++) {
+    acc += Mix16B(p + 16 * i, secret + 16 * i, seed);
+  }
+  acc = Avalanche(acc);
+  const size_t rounds = len / 16;
+  for (size_t i = 8; i < rounds; i++) {
+    acc += Mix16B(p + 16 * i, secret + 16 * (i - 8) + 3, seed);
+  }
+  acc += Mix16B(p + len - 16, secret + kSecretSize - 17 - 7, seed);
+  return Avalanche(acc);
+}
+
+// One stripe into the eight lanes: every lane adds the multiplied halves
+// of its keyed input and the raw input of its neighbour.
+void AccumulateScalar(uint64_t* acc, const char* p, const char* secret) {
+  for (size_t i = 0; i < kAccNb; i++) {
+    const uint64_t data = Read64(p + 8 * i);
+    const uint64_t keyed = data ^ Read64(secret + 8 * i);
+    acc[i ^ 1] += data;
+    acc[i] += (keyed & 0xFFFFFFFFull) * (keyed >> 32);
+  }
+}
+
+void ScrambleScalar(uint64_t* acc, const char* secret) {
+  for (size_t i = 0; i < kAccNb; i++) {
+    uint64_t a = acc[i];
+    a ^= a >> 47;
+    a ^= Read64(secret + 8 * i);
+    a *= kPrime32_1;
+    acc[i] = a;
+  }
+}
+
+#if defined(__x86_64__)
+// SSE2 is part of x86-64, no dispatch needed
+void AccumulateSSE2(uint64_t* acc, const char* p, const char* secret) {
+  auto* xacc = reinterpret_cast<__m128i*>(acc);
+  for (size_t i = 0; i < kStripeLen / sizeof(__m128i); i++) {
+    const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p) + i);
+    const __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i);
+    const __m128i keyed = _mm_xor_si128(data, key);
+    const __m128i keyed_hi = _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1));
+    const __m128i product = _mm_mul_epu32(keyed, keyed_hi);
+    const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    const __m128i a = _mm_loadu_si128(xacc + i);
+    _mm_storeu_si128(xacc + i, _mm_add_epi64(product, _mm_add_epi64(a, swapped)));
+  }
+}
+
+void ScrambleSSE2(uint64_t* acc, const char* secret) {
+  auto* xacc = reinterpret_cast<__m128i*>(acc);
+  const __m128i prime = _mm_set1_epi32(static_cast<int>(kPrime32_1));
+  for (size_t i = 0; i < kStripeLen / sizeof(__m128i); i++) {
+    __m128i a = _mm_loadu_si128(xacc + i);
+    a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+    a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+    const __m128i a_hi = _mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1));
+    const __m128i lo = _mm_mul_epu32(a, prime);
+    const __m128i hi = _mm_mul_epu32(a_hi, prime);
+    _mm_storeu_si128(xacc + i, _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+  }
+}
+
+__attribute__((target("avx2")))
+void AccumulateAVX2(uint64_t* acc, const char* p, const char* secret) {
+  auto* xacc = reinterpret_cast<__m256i*>(acc);
+  for (size_t i = 0; i < kStripeLen / sizeof(__m256i); i++) {
+    const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p) + i);
+    const __m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i);
+    const __m256i keyed = _mm256_xor_si256(data, key);
+    const __m256i keyed_hi = _mm256_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1));
+    const __m256i product = _mm256_mul_epu32(keyed, keyed_hi);
+    const __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    const __m256i a = _mm256_loadu_si256(xacc + i);
+    _mm256_storeu_si256(xacc + i, _mm256_add_epi64(product, _mm256_add_epi64(a, swapped)));
+  }
+}
+
+__attribute__((target("avx2")))
+void ScrambleAVX2(uint64_t* acc, const char* secret) {
+  auto* xacc = reinterpret_cast<__m256i*>(acc);
+  const __m256i prime = _mm256_set1_epi32(static_cast<int>(kPrime32_1));
+  for (size_t i = 0; i < kStripeLen / sizeof(__m256i); i++) {
+    __m256i a = _mm256_loadu_si256(xacc + i);
+    a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+    a = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+    const __m256i a_hi = _mm256_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1));
+    const __m256i lo = _mm256_mul_epu32(a, prime);
+    const __m256i hi = _mm256_mul_epu32(a_hi, prime);
+    _mm256_storeu_si256(xacc + i, _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+  }
+}
+#endif
+
+using AccumulateFunc = void (*)(uint64_t* acc, const char* p, const char* secret);
+using ScrambleFunc = void (*)(uint64_t* acc, const char* secret);
+
+template<AccumulateFunc accumulate, ScrambleFunc scramble>
+uint64_t HashLong(const char* p, size_t len, const char* secret) {
+  uint64_t acc[kAccNb] = {kPrime32_3, kPrime64_1, kPrime64_2, kPrime64_3,
+                          kPrime64_4, kPrime32_2, kPrime64_5, kPrime32_1};
+  const size_t blocks = (len - 1) / kBlockLen;
+  for (size_t n = 0; n < blocks; n++) {
+    const char* block = p + n * kBlockLen;
+    for (size_t s = 0; s < kStripesPerBlock; s++) {
+      accumulate(acc, block + s * kStripeLen, secret + s * kSecretConsumeRate);
+    }
+    scramble(acc, secret + kSecretSize - kStripeLen);
+  }
+
+  // the partial last block, and the very last stripe, which may overlap it
+  const size_t stripes = ((len - 1) - blocks * kBlockLen) / kStripeLen;
+  const char* block = p + blocks * kBlockLen;
+  for (size_t s = 0; s < stripes; s++) {
+    accumulate(acc, block + s * kStripeLen, secret + s * kSecretConsumeRate);
+  }
+  accumulate(acc, p + len - kStripeLen, secret + kSecretSize - kStripeLen - 7);
+
+  uint64_t result = len * kPrime64_1;
+  for (size_t i = 0; i < kAccNb / 2; i++) {
+    const char* key = secret + 11 + 16 * i;
+    result += Mul128Fold64(acc[2 * i] ^ Read64(key), acc[2 * i + 1] ^ Read64(key + 8));
+  }
+  return Avalanche(result);
+}
+
+using HashLongFunc = uint64_t (*)(const char* p, size_t len, const char* secret);
+
+HashLongFunc PickHashLong() {
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("avx2")) {
+    return HashLong<AccumulateAVX2, ScrambleAVX2>;
+  }
+  return HashLong<AccumulateSSE2, ScrambleSSE2>;
+#else
+  return HashLong<AccumulateScalar, ScrambleScalar>;
+#endif
+}
+
+uint64_t HashLongWithSeed(HashLongFunc hash_long, const char* data, size_t n, uint64_t seed) {
+  if (seed == 0) {
+    return hash_long(data, n, kSecret.data());
+  }
+  // long keys take the seed through a secret of their own
+  char secret[kSecretSize];
+  for (size_t i = 0; i < kSecretSize; i += 16) {
+    Write64(secret + i, Read64(kSecret.data() + i) + seed);
+    Write64(secret + i + 8, Read64(kSecret.data() + i + 8) - seed);
+  }
+  return hash_long(data, n, secret);
+}
+
+}
+
+uint64_t Hash64(const char* data, size_t n, uint64_t seed) {
+  if (n <= 16) {
+    return Hash0To16(data, n, kSecret.data(), seed);
+  }
+  if (n <= 128) {
+    return Hash17To128(data, n, kSecret.data(), seed);
+  }
+  if (n <= kMidSizeMax) {
+    return Hash129To240(data, n, kSecret.data(), seed);
+  }
+  // picked on first use, static initializers of other files may hash too
+  static const HashLongFunc hash_long = PickHashLong();
+  return HashLongWithSeed(hash_long, data, n, seed);
+}
+
+uint64_t Hash64Portable(const char* data, size_t n, uint64_t seed) {
+  if (n <= kMidSizeMax) {
+    return Hash64(data, n, seed);
+  }
+  return HashLongWithSeed(HashLong<AccumulateScalar, ScrambleScalar>, data, n, seed);
+}
+
+}
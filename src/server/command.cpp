@@ -0,0 +1,722 @@
+//
+// Executes the commands of a connection against the db.
+//
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <unordered_map>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "command.h"
+#include "resp.h"
+#include "db.h"
+#include "util.hpp"
+#include "write_batch.h"
+#include "yedis_keyspace.hpp"
+#include "yedis_zset.hpp"
+
+namespace yedis {
+namespace server {
+
+static std::string Lower(const std::string& s) {
+  std::string result = s;
+  std::transform(result.begin(), result.end(), result.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return result;
+}
+
+static bool ParseInteger(const std::string& s, int64_t* value) {
+  if (s.empty()) {
+    return false;
+  }
+  char* end;
+  errno = 0;
+  long long result = strtoll(s.c_str(), &end, 10);
+  if (errno != 0 || *end != '\0') {
+    return false;
+  }
+  *value = result;
+  return true;
+}
+
+static bool ParseScore(const std::string& s, double* score) {
+  const std::string lower = Lower(s);
+  if (lower == "inf" || lower == "+inf") {
+    *score = HUGE_VAL;
+    return true;
+  }
+  if (lower == "-inf") {
+    *score = -HUGE_VAL;
+    return true;
+  }
+  if (s.empty()) {
+    return false;
+  }
+  char* end;
+  errno = 0;
+  double result = strtod(s.c_str(), &end);
+  if (errno != 0 || *end != '\0' || std::isnan(result)) {
+    return false;
+  }
+  *score = result;
+  return true;
+}
+
+// min and max of ZRANGEBYSCORE, "(" makes them exclusive
+static bool ParseScoreBound(const std::string& s, double* score, bool* exclusive) {
+  *exclusive = !s.empty() && s[0] == '(';
+  return ParseScore(*exclusive ? s.substr(1) : s, score);
+}
+
+static constexpr const char* kWrongArgs = "ERR wrong number of arguments for '{}' command";
+static constexpr const char* kNotInteger = "ERR value is not an integer or out of range";
+static constexpr const char* kNotFloat = "ERR value is not a valid float";
+static constexpr const char* kSyntaxError = "ERR syntax error";
+
+static void ReplyStatus(const Status& s, RespWriter* w) {
+  const std::string message = s.ToString();
+  if (IsWrongType(s)) {
+    w->Error(message.substr(message.find("WRONGTYPE")));
+  } else {
+    w->Error("ERR " + message);
+  }
+}
+
+CommandExecutor::CommandExecutor(DB* db, ColumnFamilyHandle* strings, ZSet* zset, KeySpace* keyspace)
+    : db_(db), strings_(strings), zset_(zset), keyspace_(keyspace), hash_(keyspace), set_(keyspace),
+      list_(keyspace) {
+  commands_ = {
+      {"ping", {&CommandExecutor::Ping, -1, false}},
+      {"echo", {&CommandExecutor::Echo, 2, false}},
+      {"hello", {&CommandExecutor::Hello, -1, false}},
+      {"quit", {&CommandExecutor::Quit, 1, false}},
+      {"command", {&CommandExecutor::CommandInfo, -1, false}},
+      {"config", {&CommandExecutor::Config, -2, false}},
+      {"select", {&CommandExecutor::Select, 2, false}},
+      {"get", {&CommandExecutor::Get, 2, false}},
+      {"mget", {&CommandExecutor::MGet, -2, false}},
+      {"exists", {&CommandExecutor::Exists, -2, false}},
+      {"set", {nullptr, 3, true}},
+      {"mset", {nullptr, -3, true}},
+      {"del", {nullptr, -2, true}},
+      {"type", {&CommandExecutor::Type, 2, false}},
+      {"hset", {&CommandExecutor::HSet, -4, false}},
+      {"hget", {&CommandExecutor::HGet, 3, false}},
+      {"hgetall", {&CommandExecutor::HGetAll, 2, false}},
+      {"sadd", {&CommandExecutor::SAdd, -3, false}},
+      {"sismember", {&CommandExecutor::SIsMember, 3, false}},
+      {"smembers", {&CommandExecutor::SMembers, 2, false}},
+      {"lpush", {&CommandExecutor::LPush, -3, false}},
+      {"rpop", {&CommandExecutor::RPop, 2, false}},
+      {"lrange", {&CommandExecutor::LRange, 4, false}},
+      {"zadd", {&CommandExecutor::ZAdd, -4, false}},
+      {"zcard", {&CommandExecutor::ZCard, 2, false}},
+      {"zscore", {&CommandExecutor::ZScore, 3, false}},
+      {"zincrby", {&CommandExecutor::ZIncrBy, 4, false}},
+      {"zrank", {&CommandExecutor::ZRank, 3, false}},
+      {"zrange", {&CommandExecutor::ZRange, -4, false}},
+      {"zrangebyscore", {&CommandExecutor::ZRangeByScore, -4, false}},
+      {"zrem", {&CommandExecutor::ZRem, -3, false}},
+  };
+}
+
+const CommandExecutor::Command* CommandExecutor::Lookup(const std::string& name) const {
+  auto it = commands_.find(Lower(name));
+  return it == commands_.end() ? nullptr : &it->second;
+}
+
+bool CommandExecutor::CheckArity(const Command& command, const Argv& argv) {
+  const int argc = static_cast<int>(argv.size());
+  return command.arity >= 0 ? argc == command.arity : argc >= -command.arity;
+}
+
+void CommandExecutor::Execute(ClientState* client, const std::vector<Argv>& requests, std::string* out) {
+  size_t i = 0;
+  while (i < requests.size() && !client->close_after_reply) {
+    const Argv& argv = requests[i];
+    RespWriter w(out, client->protocol);
+    if (argv.empty()) {
+      i++;
+      continue;
+    }
+    const Command* command = Lookup(argv[0]);
+    if (command == nullptr) {
+      w.Error(fmt::format("ERR unknown command '{}'", argv[0]));
+      i++;
+      continue;
+    }
+    if (command->batched_write) {
+      size_t end = i + 1;
+      while (end < requests.size() && !requests[end].empty()) {
+        const Command* next = Lookup(requests[end][0]);
+        if (next == nullptr || !next->batched_write) {
+          break;
+        }
+        end++;
+      }
+      ExecuteWriteGroup(client, requests, i, end, out);
+      i = end;
+      continue;
+    }
+    if (!CheckArity(*command, argv)) {
+      w.Error(fmt::format(kWrongArgs, Lower(argv[0])));
+    } else {
+      (this->*command->handler)(client, argv, &w);
+    }
+    i++;
+  }
+}
+
+void CommandExecutor::ExecuteWriteGroup(ClientState* client, const std::vector<Argv>& requests,
+                                        size_t begin, size_t end, std::string* out) {
+  std::vector<std::string> keys;
+  for (size_t i = begin; i < end; i++) {
+    const Argv& argv = requests[i];
+    const size_t step = Lower(argv[0]) == "del" ? 1 : 2;
+    for (size_t j = 1; j < argv.size(); j += step) {
+      keys.push_back(argv[j]);
+    }
+  }
+  auto type_locks = LockTypes(keys);
+
+  WriteBatch batch;
+  // what the batch did to a key so far, DEL reports keys written before it
+  std::unordered_map<std::string, bool> pending;
+  auto exists = [&](const std::string& key) {
+    auto it = pending.find(key);
+    if (it != pending.end()) {
+      return it->second;
+    }
+    std::string value;
+    return db_->Get(read_options_, strings_, key, &value).ok();
+  };
+
+  // replies are held back until the batch is written
+  std::vector<std::string> replies(end - begin);
+  std::vector<bool> applied(end - begin, false);
+  // whether each key of a DEL held a string, empty for the other commands
+  std::vector<std::vector<bool>> deleted(end - begin);
+  for (size_t i = begin; i < end; i++) {
+    const Argv& argv = requests[i];
+    const Command* command = Lookup(argv[0]);
+    const std::string name = Lower(argv[0]);
+    RespWriter w(&replies[i - begin], client->protocol);
+    if (!CheckArity(*command, argv) || (name == "mset" && argv.size() % 2 == 0)) {
+      w.Error(fmt::format(kWrongArgs, name));
+      continue;
+    }
+    applied[i - begin] = true;
+    if (name == "set" || name == "mset") {
+      for (size_t j = 1; j + 1 < argv.size(); j += 2) {
+        batch.Put(strings_, argv[j], argv[j + 1]);
+        pending[argv[j]] = true;
+      }
+      w.SimpleString("OK");
+    } else {
+      for (size_t j = 1; j < argv.size(); j++) {
+        deleted[i - begin].push_back(exists(argv[j]));
+        batch.Delete(strings_, argv[j]);
+        pending[argv[j]] = false;
+      }
+    }
+  }
+
+  Status s = db_->Write(write_options_, &batch);
+  for (size_t i = 0; i < replies.size(); i++) {
+    RespWriter w(out, client->protocol);
+    if (applied[i] && !s.ok()) {
+      ReplyStatus(s, &w);
+      continue;
+    }
+    if (!applied[i]) {
+      out->append(replies[i]);
+      continue;
+    }
+    // collections and zsets are deleted under their key lock, after the
+    // strings: SET replaces them, DEL counts a key once whatever it held
+    const Argv& argv = requests[begin + i];
+    const bool del = !deleted[i].empty();
+    int64_t count = 0;
+    Status del_status;
+    for (size_t j = 1; j < argv.size() && del_status.ok(); j += del ? 1 : 2) {
+      bool existed;
+      del_status = DeleteCollection(argv[j], &existed);
+      if (del && (existed || deleted[i][j - 1])) {
+        count++;
+      }
+    }
+    if (!del_status.ok()) {
+      ReplyStatus(del_status, &w);
+    } else if (del) {
+      w.Integer(count);
+    } else {
+      out->append(replies[i]);
+    }
+  }
+}
+
+void CommandExecutor::Ping(ClientState* client, const Argv& argv, RespWriter* w) {
+  if (argv.size() > 2) {
+    w->Error(fmt::format(kWrongArgs, "ping"));
+  } else if (argv.size() == 2) {
+    w->Bulk(argv[1]);
+  } else {
+    w->SimpleString("PONG");
+  }
+}
+
+void CommandExecutor::Echo(ClientState* client, const Argv& argv, RespWriter* w) {
+  w->Bulk(argv[1]);
+}
+
+void CommandExecutor::Hello(ClientState* client, const Argv& argv, RespWriter* w) {
+  int protocol = client->protocol;
+  if (argv.size() >= 2) {
+    int64_t version;
+    if (!ParseInteger(argv[1], &version)) {
+      w->Error("ERR Protocol version is not an integer or out of range");
+      return;
+    }
+    if (version != 2 && version != 3) {
+      w->Error("NOPROTO unsupported protocol version");
+      return;
+    }
+    protocol = static_cast<int>(version);
+  }
+  client->protocol = protocol;
+  // the reply already uses the negotiated protocol
+  RespWriter reply(w->out(), protocol);
+  reply.MapHeader(3);
+  reply.Bulk("server");
+  reply.Bulk("yedis");
+  reply.Bulk("proto");
+  reply.Integer(protocol);
+  reply.Bulk("mode");
+  reply.Bulk("standalone");
+}
+
+void CommandExecutor::Quit(ClientState* client, const Argv& argv, RespWriter* w) {
+  client->close_after_reply = true;
+  w->SimpleString("OK");
+}
+
+void CommandExecutor::CommandInfo(ClientState* client, const Argv& argv, RespWriter* w) {
+  // enough for clients that probe the command table on connect
+  w->ArrayHeader(0);
+}
+
+void CommandExecutor::Config(ClientState* client, const Argv& argv, RespWriter* w) {
+  // redis-benchmark reads "save" and "appendonly", nothing is configurable
+  if (Lower(argv[1]) == "get") {
+    w->MapHeader(0);
+  } else {
+    w->Error("ERR CONFIG subcommand not supported");
+  }
+}
+
+void CommandExecutor::Select(ClientState* client, const Argv& argv, RespWriter* w) {
+  if (argv[1] == "0") {
+    w->SimpleString("OK");
+  } else {
+    w->Error("ERR DB index is out of range");
+  }
+}
+
+void CommandExecutor::Get(ClientState* client, const Argv& argv, RespWriter* w) {
+  std::string value;
+  Status s = db_->Get(read_options_, strings_, argv[1], &value);
+  if (s.ok()) {
+    w->Bulk(value);
+  } else if (s.IsNotFound()) {
+    w->Null();
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::MGet(ClientState* client, const Argv& argv, RespWriter* w) {
+  w->ArrayHeader(argv.size() - 1);
+  std::string value;
+  for (size_t i = 1; i < argv.size(); i++) {
+    if (db_->Get(read_options_, strings_, argv[i], &value).ok()) {
+      w->Bulk(value);
+    } else {
+      w->Null();
+    }
+  }
+}
+
+void CommandExecutor::Exists(ClientState* client, const Argv& argv, RespWriter* w) {
+  int64_t count = 0;
+  for (size_t i = 1; i < argv.size(); i++) {
+    std::string type;
+    Status s = TypeOf(argv[i], &type);
+    if (!s.ok()) {
+      ReplyStatus(s, w);
+      return;
+    }
+    if (type != "none") {
+      count++;
+    }
+  }
+  w->Integer(count);
+}
+
+Status CommandExecutor::TypeOf(const std::string& key, std::string* type) {
+  std::string value;
+  if (db_->Get(read_options_, strings_, key, &value).ok()) {
+    *type = "string";
+    return Status::OK();
+  }
+  Status s = keyspace_->type(key, type);
+  if (!s.ok() || *type != "none") {
+    return s;
+  }
+  int64_t count;
+  s = zset_->zcard(key, &count);
+  if (s.ok() && count > 0) {
+    *type = "zset";
+  }
+  return s;
+}
+
+std::mutex& CommandExecutor::TypeLock(const std::string& key) {
+  return type_locks_[Hash64(key.data(), key.size(), 0) % kNumTypeLocks];
+}
+
+std::vector<std::unique_lock<std::mutex>> CommandExecutor::LockTypes(const std::vector<std::string>& keys) {
+  std::vector<std::mutex*> locks;
+  for (auto& key: keys) {
+    locks.push_back(&TypeLock(key));
+  }
+  // in address order, so that two writers of the same keys never wait
+  // for each other's next lock
+  std::sort(locks.begin(), locks.end());
+  locks.erase(std::unique(locks.begin(), locks.end()), locks.end());
+  std::vector<std::unique_lock<std::mutex>> held;
+  for (auto* lock: locks) {
+    held.emplace_back(*lock);
+  }
+  return held;
+}
+
+Status CommandExecutor::CheckType(const std::string& key, const std::string& type) {
+  std::string held;
+  Status s = TypeOf(key, &held);
+  if (s.ok() && held != "none" && held != type) {
+    return WrongType();
+  }
+  return s;
+}
+
+Status CommandExecutor::DeleteCollection(const std::string& key, bool* existed) {
+  // a key holds one type, but removing both is as cheap as looking
+  Status s = keyspace_->del(key, existed);
+  bool zset_existed = false;
+  if (s.ok()) {
+    s = zset_->del(key, &zset_existed);
+  }
+  *existed = *existed || zset_existed;
+  return s;
+}
+
+void CommandExecutor::Type(ClientState* client, const Argv& argv, RespWriter* w) {
+  std::string type;
+  Status s = TypeOf(argv[1], &type);
+  if (s.ok()) {
+    w->SimpleString(type);
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::HSet(ClientState* client, const Argv& argv, RespWriter* w) {
+  if (argv.size() % 2 != 0) {
+    w->Error(fmt::format(kWrongArgs, "hset"));
+    return;
+  }
+  Hash::FieldValues field_values;
+  for (size_t i = 2; i + 1 < argv.size(); i += 2) {
+    field_values.emplace_back(argv[i], argv[i + 1]);
+  }
+  int added;
+  std::lock_guard<std::mutex> type_lock(TypeLock(argv[1]));
+  Status s = CheckType(argv[1], "hash");
+  if (s.ok()) {
+    s = hash_.hset(argv[1], field_values, &added);
+  }
+  if (s.ok()) {
+    w->Integer(added);
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::HGet(ClientState* client, const Argv& argv, RespWriter* w) {
+  std::string value;
+  Status s = hash_.hget(argv[1], argv[2], &value);
+  if (s.ok()) {
+    w->Bulk(value);
+  } else if (s.IsNotFound()) {
+    w->Null();
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::HGetAll(ClientState* client, const Argv& argv, RespWriter* w) {
+  Hash::FieldValues field_values;
+  Status s = hash_.hgetall(argv[1], &field_values);
+  if (!s.ok()) {
+    ReplyStatus(s, w);
+    return;
+  }
+  w->MapHeader(field_values.size());
+  for (auto& [field, value]: field_values) {
+    w->Bulk(field);
+    w->Bulk(value);
+  }
+}
+
+void CommandExecutor::SAdd(ClientState* client, const Argv& argv, RespWriter* w) {
+  int added;
+  std::lock_guard<std::mutex> type_lock(TypeLock(argv[1]));
+  Status s = CheckType(argv[1], "set");
+  if (s.ok()) {
+    s = set_.sadd(argv[1], Argv(argv.begin() + 2, argv.end()), &added);
+  }
+  if (s.ok()) {
+    w->Integer(added);
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::SIsMember(ClientState* client, const Argv& argv, RespWriter* w) {
+  bool is_member;
+  Status s = set_.sismember(argv[1], argv[2], &is_member);
+  if (s.ok()) {
+    w->Integer(is_member ? 1 : 0);
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::SMembers(ClientState* client, const Argv& argv, RespWriter* w) {
+  Set::StrList members;
+  Status s = set_.smembers(argv[1], &members);
+  if (!s.ok()) {
+    ReplyStatus(s, w);
+    return;
+  }
+  w->SetHeader(members.size());
+  for (auto& member: members) {
+    w->Bulk(member);
+  }
+}
+
+void CommandExecutor::LPush(ClientState* client, const Argv& argv, RespWriter* w) {
+  int64_t length;
+  std::lock_guard<std::mutex> type_lock(TypeLock(argv[1]));
+  Status s = CheckType(argv[1], "list");
+  if (s.ok()) {
+    s = list_.lpush(argv[1], Argv(argv.begin() + 2, argv.end()), &length);
+  }
+  if (s.ok()) {
+    w->Integer(length);
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::RPop(ClientState* client, const Argv& argv, RespWriter* w) {
+  std::string value;
+  Status s = list_.rpop(argv[1], &value);
+  if (s.ok()) {
+    w->Bulk(value);
+  } else if (s.IsNotFound()) {
+    w->Null();
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::LRange(ClientState* client, const Argv& argv, RespWriter* w) {
+  int64_t start, stop;
+  if (!ParseInteger(argv[2], &start) || !ParseInteger(argv[3], &stop)) {
+    w->Error(kNotInteger);
+    return;
+  }
+  List::StrList elements;
+  Status s = list_.lrange(argv[1], start, stop, &elements);
+  if (!s.ok()) {
+    ReplyStatus(s, w);
+    return;
+  }
+  w->ArrayHeader(elements.size());
+  for (auto& element: elements) {
+    w->Bulk(element);
+  }
+}
+
+void CommandExecutor::ZAdd(ClientState* client, const Argv& argv, RespWriter* w) {
+  if (argv.size() % 2 != 0) {
+    w->Error(kSyntaxError);
+    return;
+  }
+  std::vector<ScoreMember> members;
+  for (size_t i = 2; i + 1 < argv.size(); i += 2) {
+    double score;
+    if (!ParseScore(argv[i], &score)) {
+      w->Error(kNotFloat);
+      return;
+    }
+    members.push_back({score, argv[i + 1]});
+  }
+  int added;
+  std::lock_guard<std::mutex> type_lock(TypeLock(argv[1]));
+  Status s = CheckType(argv[1], "zset");
+  if (s.ok()) {
+    s = zset_->zadd(argv[1], members, &added);
+  }
+  if (s.ok()) {
+    w->Integer(added);
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::ZCard(ClientState* client, const Argv& argv, RespWriter* w) {
+  int64_t count;
+  Status s = zset_->zcard(argv[1], &count);
+  if (s.ok()) {
+    w->Integer(count);
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::ZScore(ClientState* client, const Argv& argv, RespWriter* w) {
+  double score;
+  Status s = zset_->zscore(argv[1], argv[2], &score);
+  if (s.ok()) {
+    w->Double(score);
+  } else if (s.IsNotFound()) {
+    w->Null();
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::ZIncrBy(ClientState* client, const Argv& argv, RespWriter* w) {
+  double increment;
+  if (!ParseScore(argv[2], &increment)) {
+    w->Error(kNotFloat);
+    return;
+  }
+  double score;
+  std::lock_guard<std::mutex> type_lock(TypeLock(argv[1]));
+  Status s = CheckType(argv[1], "zset");
+  if (s.ok()) {
+    s = zset_->zincrby(argv[1], increment, argv[3], &score);
+  }
+  if (s.ok()) {
+    w->Double(score);
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::ZRank(ClientState* client, const Argv& argv, RespWriter* w) {
+  int64_t rank;
+  Status s = zset_->zrank(argv[1], argv[2], &rank);
+  if (s.ok()) {
+    w->Integer(rank);
+  } else if (s.IsNotFound()) {
+    w->Null();
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+void CommandExecutor::ZRange(ClientState* client, const Argv& argv, RespWriter* w) {
+  int64_t start, stop;
+  if (!ParseInteger(argv[2], &start) || !ParseInteger(argv[3], &stop)) {
+    w->Error(kNotInteger);
+    return;
+  }
+  bool with_scores = false;
+  if (argv.size() == 5 && Lower(argv[4]) == "withscores") {
+    with_scores = true;
+  } else if (argv.size() != 4) {
+    w->Error(kSyntaxError);
+    return;
+  }
+  auto members = zset_->zrange(argv[1], static_cast<int>(start), static_cast<int>(stop));
+  w->ArrayHeader(with_scores && w->protocol() < 3 ? 2 * members.size() : members.size());
+  for (auto& member: members) {
+    if (!with_scores) {
+      w->Bulk(member);
+      continue;
+    }
+    double score = 0;
+    zset_->zscore(argv[1], member, &score);
+    if (w->protocol() >= 3) {
+      w->ArrayHeader(2);
+    }
+    w->Bulk(member);
+    w->Double(score);
+  }
+}
+
+void CommandExecutor::ZRangeByScore(ClientState* client, const Argv& argv, RespWriter* w) {
+  double min, max;
+  bool min_exclusive, max_exclusive;
+  if (!ParseScoreBound(argv[2], &min, &min_exclusive) || !ParseScoreBound(argv[3], &max, &max_exclusive)) {
+    w->Error("ERR min or max is not a float");
+    return;
+  }
+  bool with_scores = false;
+  if (argv.size() == 5 && Lower(argv[4]) == "withscores") {
+    with_scores = true;
+  } else if (argv.size() != 4) {
+    w->Error(kSyntaxError);
+    return;
+  }
+  std::vector<ScoreMember> members;
+  Status s = zset_->zrangebyscore(argv[1], min, max, &members);
+  if (!s.ok()) {
+    ReplyStatus(s, w);
+    return;
+  }
+  members.erase(std::remove_if(members.begin(), members.end(), [&](const ScoreMember& m) {
+    return (min_exclusive && m.score == min) || (max_exclusive && m.score == max);
+  }), members.end());
+  w->ArrayHeader(with_scores && w->protocol() < 3 ? 2 * members.size() : members.size());
+  for (auto& member: members) {
+    if (with_scores && w->protocol() >= 3) {
+      w->ArrayHeader(2);
+    }
+    w->Bulk(member.member);
+    if (with_scores) {
+      w->Double(member.score);
+    }
+  }
+}
+
+void CommandExecutor::ZRem(ClientState* client, const Argv& argv, RespWriter* w) {
+  int removed;
+  Status s = zset_->zrem(argv[1], Argv(argv.begin() + 2, argv.end()), &removed);
+  if (s.ok()) {
+    w->Integer(removed);
+  } else {
+    ReplyStatus(s, w);
+  }
+}
+
+}  // namespace server
+}  // namespace yedis
@@ -0,0 +1,136 @@
+//
+// Executes the commands of a connection against the db.
+//
+
+#ifndef YEDIS_SERVER_COMMAND_H
+#define YEDIS_SERVER_COMMAND_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "options.h"
+#include "yedis_hash.hpp"
+#include "yedis_list.hpp"
+#include "yedis_set.hpp"
+
+namespace yedis {
+
+class DB;
+class ColumnFamilyHandle;
+class ZSet;
+
+namespace server {
+
+class RespWriter;
+
+using Argv = std::vector<std::string>;
+
+// Per connection protocol state.
+struct ClientState {
+  // RESP version chosen with HELLO
+  int protocol = 2;
+  // set by QUIT, the connection closes once its replies are sent
+  bool close_after_reply = false;
+};
+
+// Thread safe, the event loops share one executor.
+class CommandExecutor {
+public:
+  // String keys live in "strings", zset commands go to "zset", hashes,
+  // sets and lists to "keyspace".  Strings, zsets and the other
+  // collections are separate namespaces, but a key holds one type at a
+  // time: collection writers fail with WRONGTYPE on a key of another
+  // type, SET replaces whatever the key held and DEL removes it from all
+  // of them.
+  CommandExecutor(DB* db, ColumnFamilyHandle* strings, ZSet* zset, KeySpace* keyspace);
+
+  CommandExecutor(const CommandExecutor&) = delete;
+  CommandExecutor& operator=(const CommandExecutor&) = delete;
+
+  // Execute the pipelined "requests" of one connection in order and
+  // append their replies to "*out".  Runs of SET, MSET and DEL are
+  // applied with one WriteBatch, so a pipeline of writes costs one db
+  // write instead of one per command.
+  void Execute(ClientState* client, const std::vector<Argv>& requests, std::string* out);
+
+private:
+  using Handler = void (CommandExecutor::*)(ClientState* client, const Argv& argv, RespWriter* w);
+  struct Command {
+    Handler handler;
+    // exact number of arguments, the command included, or the minimum if
+    // negative
+    int arity;
+    // applied with the neighbouring writes of the pipeline
+    bool batched_write;
+  };
+
+  const Command* Lookup(const std::string& name) const;
+  static bool CheckArity(const Command& command, const Argv& argv);
+
+  // "string", "hash", "set", "list", "zset" or "none"
+  Status TypeOf(const std::string& key, std::string* type);
+
+  // Held by writers of "key" from checking its type until their write
+  // is done, whatever namespace they write.
+  std::mutex& TypeLock(const std::string& key);
+  // The type locks of all "keys", taken in one order.
+  std::vector<std::unique_lock<std::mutex>> LockTypes(const std::vector<std::string>& keys);
+  // WRONGTYPE if "key" holds a type other than "type".
+  // REQUIRES: TypeLock(key) held
+  Status CheckType(const std::string& key, const std::string& type);
+  // Removes the collection or zset "key", sets "*existed" if there was one.
+  Status DeleteCollection(const std::string& key, bool* existed);
+
+  // Applies requests [begin, end), which are all batched writes.
+  void ExecuteWriteGroup(ClientState* client, const std::vector<Argv>& requests,
+                         size_t begin, size_t end, std::string* out);
+
+  void Ping(ClientState* client, const Argv& argv, RespWriter* w);
+  void Echo(ClientState* client, const Argv& argv, RespWriter* w);
+  void Hello(ClientState* client, const Argv& argv, RespWriter* w);
+  void Quit(ClientState* client, const Argv& argv, RespWriter* w);
+  void CommandInfo(ClientState* client, const Argv& argv, RespWriter* w);
+  void Config(ClientState* client, const Argv& argv, RespWriter* w);
+  void Select(ClientState* client, const Argv& argv, RespWriter* w);
+  void Get(ClientState* client, const Argv& argv, RespWriter* w);
+  void MGet(ClientState* client, const Argv& argv, RespWriter* w);
+  void Exists(ClientState* client, const Argv& argv, RespWriter* w);
+  void Type(ClientState* client, const Argv& argv, RespWriter* w);
+  void HSet(ClientState* client, const Argv& argv, RespWriter* w);
+  void HGet(ClientState* client, const Argv& argv, RespWriter* w);
+  void HGetAll(ClientState* client, const Argv& argv, RespWriter* w);
+  void SAdd(ClientState* client, const Argv& argv, RespWriter* w);
+  void SIsMember(ClientState* client, const Argv& argv, RespWriter* w);
+  void SMembers(ClientState* client, const Argv& argv, RespWriter* w);
+  void LPush(ClientState* client, const Argv& argv, RespWriter* w);
+  void RPop(ClientState* client, const Argv& argv, RespWriter* w);
+  void LRange(ClientState* client, const Argv& argv, RespWriter* w);
+  void ZAdd(ClientState* client, const Argv& argv, RespWriter* w);
+  void ZCard(ClientState* client, const Argv& argv, RespWriter* w);
+  void ZScore(ClientState* client, const Argv& argv, RespWriter* w);
+  void ZIncrBy(ClientState* client, const Argv& argv, RespWriter* w);
+  void ZRank(ClientState* client, const Argv& argv, RespWriter* w);
+  void ZRange(ClientState* client, const Argv& argv, RespWriter* w);
+  void ZRangeByScore(ClientState* client, const Argv& argv, RespWriter* w);
+  void ZRem(ClientState* client, const Argv& argv, RespWriter* w);
+
+  DB* const db_;
+  ColumnFamilyHandle* const strings_;
+  ZSet* const zset_;
+  KeySpace* const keyspace_;
+  Hash hash_;
+  Set set_;
+  List list_;
+  std::unordered_map<std::string, Command> commands_;
+  static constexpr int kNumTypeLocks = 64;
+  std::mutex type_locks_[kNumTypeLocks];
+  ReadOptions read_options_;
+  WriteOptions write_options_;
+};
+
+}  // namespace server
+}  // namespace yedis
+
+#endif //YEDIS_SERVER_COMMAND_H
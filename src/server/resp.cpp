@@ -0,0 +1,198 @@
+//
+// RESP2/RESP3 request parsing and reply encoding.
+//
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "resp.h"
+
+namespace yedis {
+namespace server {
+
+// the limits of redis
+static const int64_t kMaxMultiBulkLength = 1024 * 1024;
+static const int64_t kMaxBulkLength = 512 * 1024 * 1024;
+static const size_t kMaxInlineLength = 64 * 1024;
+
+// Parse the decimal integer in [p, limit), false if it is not one.
+static bool ParseInt64(const char* p, const char* limit, int64_t* value) {
+  bool negative = false;
+  if (p < limit && *p == '-') {
+    negative = true;
+    p++;
+  }
+  if (p == limit) {
+    return false;
+  }
+  int64_t result = 0;
+  for (; p < limit; p++) {
+    if (*p < '0' || *p > '9' || result > (std::numeric_limits<int64_t>::max() - 9) / 10) {
+      return false;
+    }
+    result = result * 10 + (*p - '0');
+  }
+  *value = negative ? -result : result;
+  return true;
+}
+
+// Returns the position of the "\r\n" ending the line at "p", nullptr if
+// the line is incomplete.
+static const char* FindLineEnd(const char* p, const char* limit) {
+  const char* cr = static_cast<const char*>(memchr(p, '\r', limit - p));
+  if (cr == nullptr || cr + 1 >= limit) {
+    return nullptr;
+  }
+  return cr;
+}
+
+RespParser::Result RespParser::Parse(const char* data, size_t n, size_t* consumed,
+                                     std::vector<std::string>* argv, std::string* error) {
+  argv->clear();
+  if (n == 0) {
+    return kIncomplete;
+  }
+  if (data[0] == '*') {
+    return ParseMultiBulk(data, n, consumed, argv, error);
+  }
+  return ParseInline(data, n, consumed, argv, error);
+}
+
+RespParser::Result RespParser::ParseMultiBulk(const char* data, size_t n, size_t* consumed,
+                                              std::vector<std::string>* argv, std::string* error) {
+  const char* limit = data + n;
+  const char* line_end = FindLineEnd(data, limit);
+  if (line_end == nullptr) {
+    return kIncomplete;
+  }
+  int64_t count;
+  if (!ParseInt64(data + 1, line_end, &count) || count > kMaxMultiBulkLength) {
+    *error = "Protocol error: invalid multibulk length";
+    return kError;
+  }
+  const char* p = line_end + 2;
+  for (int64_t i = 0; i < count; i++) {
+    if (p >= limit) {
+      return kIncomplete;
+    }
+    if (*p != '$') {
+      *error = fmt::format("Protocol error: expected '$', got '{}'", *p);
+      return kError;
+    }
+    line_end = FindLineEnd(p, limit);
+    if (line_end == nullptr) {
+      return kIncomplete;
+    }
+    int64_t length;
+    if (!ParseInt64(p + 1, line_end, &length) || length < 0 || length > kMaxBulkLength) {
+      *error = "Protocol error: invalid bulk length";
+      return kError;
+    }
+    p = line_end + 2;
+    if (limit - p < length + 2) {
+      return kIncomplete;
+    }
+    argv->emplace_back(p, length);
+    p += length + 2;
+  }
+  *consumed = p - data;
+  return kOk;
+}
+
+RespParser::Result RespParser::ParseInline(const char* data, size_t n, size_t* consumed,
+                                           std::vector<std::string>* argv, std::string* error) {
+  const char* newline = static_cast<const char*>(memchr(data, '\n', n));
+  if (newline == nullptr) {
+    if (n > kMaxInlineLength) {
+      *error = "Protocol error: too big inline request";
+      return kError;
+    }
+    return kIncomplete;
+  }
+  const char* line_end = newline;
+  if (line_end > data && line_end[-1] == '\r') {
+    line_end--;
+  }
+  for (const char* p = data; p < line_end;) {
+    if (*p == ' ' || *p == '\t') {
+      p++;
+      continue;
+    }
+    const char* word = p;
+    while (p < line_end && *p != ' ' && *p != '\t') {
+      p++;
+    }
+    argv->emplace_back(word, p - word);
+  }
+  *consumed = newline + 1 - data;
+  return kOk;
+}
+
+void RespWriter::SimpleString(const std::string& s) {
+  out_->push_back('+');
+  out_->append(s);
+  out_->append("\r\n");
+}
+
+void RespWriter::Error(const std::string& message) {
+  out_->push_back('-');
+  out_->append(message);
+  out_->append("\r\n");
+}
+
+void RespWriter::Integer(int64_t n) {
+  fmt::format_to(std::back_inserter(*out_), ":{}\r\n", n);
+}
+
+void RespWriter::Bulk(const std::string& s) {
+  fmt::format_to(std::back_inserter(*out_), "${}\r\n", s.size());
+  out_->append(s);
+  out_->append("\r\n");
+}
+
+void RespWriter::Null() {
+  out_->append(protocol_ >= 3 ? "_\r\n" : "$-1\r\n");
+}
+
+void RespWriter::ArrayHeader(size_t n) {
+  fmt::format_to(std::back_inserter(*out_), "*{}\r\n", n);
+}
+
+void RespWriter::MapHeader(size_t n) {
+  if (protocol_ >= 3) {
+    fmt::format_to(std::back_inserter(*out_), "%{}\r\n", n);
+  } else {
+    ArrayHeader(2 * n);
+  }
+}
+
+void RespWriter::SetHeader(size_t n) {
+  if (protocol_ >= 3) {
+    fmt::format_to(std::back_inserter(*out_), "~{}\r\n", n);
+  } else {
+    ArrayHeader(n);
+  }
+}
+
+void RespWriter::Double(double d) {
+  if (protocol_ >= 3) {
+    out_->push_back(',');
+    out_->append(FormatDouble(d));
+    out_->append("\r\n");
+  } else {
+    Bulk(FormatDouble(d));
+  }
+}
+
+std::string FormatDouble(double d) {
+  if (std::isinf(d)) {
+    return d > 0 ? "inf" : "-inf";
+  }
+  return fmt::format("{}", d);
+}
+
+}  // namespace server
+}  // namespace yedis
@@ -0,0 +1,72 @@
+//
+// RESP2/RESP3 request parsing and reply encoding.
+//
+
+#ifndef YEDIS_SERVER_RESP_H
+#define YEDIS_SERVER_RESP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace yedis {
+namespace server {
+
+// Parses requests out of a connection's input buffer.  Clients send
+// multibulk arrays of bulk strings, telnet style inline commands are
+// accepted too.  Pipelined requests are parsed one at a time.
+class RespParser {
+public:
+  enum Result {
+    kOk,          // *argv holds one request
+    kIncomplete,  // wait for more input
+    kError        // protocol error, the connection should be closed
+  };
+
+  // Parse the first request of [data, data + n).  On kOk "*consumed" is
+  // set to its length in bytes.  An empty multibulk yields an empty argv.
+  Result Parse(const char* data, size_t n, size_t* consumed, std::vector<std::string>* argv,
+               std::string* error);
+
+private:
+  Result ParseMultiBulk(const char* data, size_t n, size_t* consumed,
+                        std::vector<std::string>* argv, std::string* error);
+  Result ParseInline(const char* data, size_t n, size_t* consumed,
+                     std::vector<std::string>* argv, std::string* error);
+};
+
+// Appends replies to an output buffer.  Types RESP2 lacks are sent in
+// their RESP2 form: maps as flat arrays, doubles as bulk strings and the
+// null as a null bulk string.
+class RespWriter {
+public:
+  RespWriter(std::string* out, int protocol): out_(out), protocol_(protocol) {}
+
+  int protocol() const { return protocol_; }
+  std::string* out() const { return out_; }
+
+  void SimpleString(const std::string& s);
+  void Error(const std::string& message);
+  void Integer(int64_t n);
+  void Bulk(const std::string& s);
+  void Null();
+  void ArrayHeader(size_t n);
+  // followed by 2 * n entries, keys and values alternating
+  void MapHeader(size_t n);
+  // followed by n entries
+  void SetHeader(size_t n);
+  void Double(double d);
+
+private:
+  std::string* const out_;
+  const int protocol_;
+};
+
+// Shortest text that reads back as "d", "inf" and "-inf" for infinities.
+std::string FormatDouble(double d);
+
+}  // namespace server
+}  // namespace yedis
+
+#endif //YEDIS_SERVER_RESP_H
@@ -0,0 +1,475 @@
+//
+// RESP server on epoll event loops.
+//
+
+#include "server.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <unordered_map>
+
+#include <spdlog/spdlog.h>
+
+#include "command.h"
+#include "mpmc_queue.h"
+#include "resp.h"
+
+namespace yedis {
+namespace server {
+
+namespace {
+
+constexpr int kMaxEvents = 256;
+constexpr size_t kReadSize = 16 * 1024;
+// bytes read before they are processed, the rest stays in the socket
+constexpr size_t kInputBatch = 1024 * 1024;
+// an unfinished request this long closes the connection, Redis's
+// client-query-buffer-limit
+constexpr size_t kMaxQueryBuffer = 1024 * 1024 * 1024;
+constexpr int kBacklog = 511;
+constexpr size_t kPendingCapacity = 1024;
+
+Status ErrnoStatus(const std::string& context) {
+  return Status::IOError(context, strerror(errno));
+}
+
+void WakeUp(int event_fd) {
+  uint64_t one = 1;
+  // a full counter still wakes the reader up
+  ssize_t n = write(event_fd, &one, sizeof(one));
+  (void) n;
+}
+
+void Drain(int event_fd) {
+  uint64_t count;
+  ssize_t n = read(event_fd, &count, sizeof(count));
+  (void) n;
+}
+
+struct Connection {
+  explicit Connection(int fd): fd(fd) {}
+
+  int fd;
+  std::string input;
+  std::string output;
+  // bytes of output already sent
+  size_t sent = 0;
+  // EPOLLOUT is registered, input is left alone until output drains
+  bool writing = false;
+  // close once output is sent: QUIT, protocol errors and closed input
+  bool closing = false;
+  ClientState client;
+};
+
+}  // namespace
+
+// Serves the connections handed to it on its own thread.
+class EventLoop {
+public:
+  explicit EventLoop(CommandExecutor* executor)
+      : executor_(executor), epoll_fd_(-1), wake_fd_(-1), stopping_(false), pending_(kPendingCapacity) {}
+
+  ~EventLoop() {
+    for (auto& [fd, conn]: connections_) {
+      close(fd);
+      delete conn;
+    }
+    int fd;
+    while (pending_.try_pop(&fd)) {
+      close(fd);
+    }
+    if (epoll_fd_ >= 0) close(epoll_fd_);
+    if (wake_fd_ >= 0) close(wake_fd_);
+  }
+
+  Status Start() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+      return ErrnoStatus("epoll_create1");
+    }
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+      return ErrnoStatus("eventfd");
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wake_fd_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev) < 0) {
+      return ErrnoStatus("epoll_ctl");
+    }
+    thread_ = std::thread(&EventLoop::Loop, this);
+    return Status::OK();
+  }
+
+  void Stop() {
+    stopping_.store(true, std::memory_order_release);
+    WakeUp(wake_fd_);
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  // Called by the acceptor, "fd" is non blocking.
+  void Add(int fd) {
+    // the loop empties the queue whenever it wakes up, it is only full
+    // while the loop is busy
+    while (!pending_.try_push(fd)) {
+      WakeUp(wake_fd_);
+      std::this_thread::yield();
+    }
+    WakeUp(wake_fd_);
+  }
+
+private:
+  void Loop() {
+    epoll_event events[kMaxEvents];
+    while (!stopping_.load(std::memory_order_acquire)) {
+      int n = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+      if (n < 0) {
+        if (errno != EINTR) {
+          spdlog::error("epoll_wait error: {}", strerror(errno));
+          return;
+        }
+        continue;
+      }
+      for (int i = 0; i < n; i++) {
+        const int fd = events[i].data.fd;
+        if (fd == wake_fd_) {
+          Drain(wake_fd_);
+          AddPending();
+          continue;
+        }
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) {
+          continue;
+        }
+        Connection* conn = it->second;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+          // deliver what the peer sent before hanging up
+          conn->closing = true;
+        }
+        if (events[i].events & EPOLLOUT) {
+          Flush(conn);
+        } else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+          Read(conn);
+        }
+      }
+    }
+  }
+
+  void AddPending() {
+    int fds[kMaxEvents];
+    size_t n;
+    while ((n = pending_.try_pop_n(fds, kMaxEvents)) > 0) {
+      Register(fds, n);
+    }
+  }
+
+  void Register(const int* fds, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      const int fd = fds[i];
+      epoll_event ev{};
+      ev.events = EPOLLIN;
+      ev.data.fd = fd;
+      if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        spdlog::error("epoll_ctl add connection error: {}", strerror(errno));
+        close(fd);
+        continue;
+      }
+      connections_[fd] = new Connection(fd);
+    }
+  }
+
+  // Reads until EAGAIN or kInputBatch bytes, epoll is level triggered and
+  // reports the socket again after Process.  A closing connection reads
+  // what is left, the peer cannot send more.
+  void Read(Connection* conn) {
+    char buf[kReadSize];
+    size_t batch = 0;
+    while (conn->closing || batch < kInputBatch) {
+      ssize_t n = read(conn->fd, buf, sizeof(buf));
+      if (n > 0) {
+        conn->input.append(buf, n);
+        batch += n;
+        continue;
+      }
+      if (n == 0) {
+        conn->closing = true;
+      } else if (errno == EINTR) {
+        continue;
+      } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        Close(conn);
+        return;
+      }
+      break;
+    }
+    Process(conn);
+  }
+
+  // Execute every complete request of the input, the pipeline is answered
+  // with one write.
+  void Process(Connection* conn) {
+    std::vector<Argv> requests;
+    size_t offset = 0;
+    bool protocol_error = false;
+    std::string error;
+    while (offset < conn->input.size()) {
+      size_t consumed = 0;
+      Argv argv;
+      RespParser::Result result = parser_.Parse(conn->input.data() + offset, conn->input.size() - offset,
+                                                &consumed, &argv, &error);
+      if (result == RespParser::kIncomplete) {
+        break;
+      }
+      if (result == RespParser::kError) {
+        protocol_error = true;
+        break;
+      }
+      offset += consumed;
+      requests.push_back(std::move(argv));
+    }
+    conn->input.erase(0, offset);
+    if (!protocol_error && conn->input.size() > kMaxQueryBuffer) {
+      protocol_error = true;
+      error = "query buffer limit exceeded";
+    }
+    if (protocol_error) {
+      conn->input.clear();
+    }
+
+    if (!requests.empty()) {
+      executor_->Execute(&conn->client, requests, &conn->output);
+    }
+    if (protocol_error) {
+      RespWriter w(&conn->output, conn->client.protocol);
+      w.Error("ERR Protocol error: " + error);
+      conn->closing = true;
+    }
+    if (conn->client.close_after_reply) {
+      conn->closing = true;
+    }
+    Flush(conn);
+  }
+
+  void Flush(Connection* conn) {
+    while (conn->sent < conn->output.size()) {
+      ssize_t n = write(conn->fd, conn->output.data() + conn->sent, conn->output.size() - conn->sent);
+      if (n >= 0) {
+        conn->sent += n;
+        continue;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // a client that does not read its replies stops being read
+        // itself, its output grows by the replies to one input batch
+        SetWriting(conn, true);
+        return;
+      }
+      Close(conn);
+      return;
+    }
+    conn->output.clear();
+    conn->sent = 0;
+    if (conn->closing) {
+      Close(conn);
+      return;
+    }
+    if (conn->writing) {
+      SetWriting(conn, false);
+      // requests that arrived while the output was blocked
+      if (!conn->input.empty()) {
+        Read(conn);
+      }
+    }
+  }
+
+  void SetWriting(Connection* conn, bool writing) {
+    if (conn->writing == writing) {
+      return;
+    }
+    epoll_event ev{};
+    ev.events = writing ? EPOLLOUT : EPOLLIN;
+    ev.data.fd = conn->fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn->fd, &ev);
+    conn->writing = writing;
+  }
+
+  void Close(Connection* conn) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn->fd, nullptr);
+    close(conn->fd);
+    connections_.erase(conn->fd);
+    delete conn;
+  }
+
+  CommandExecutor* const executor_;
+  int epoll_fd_;
+  int wake_fd_;
+  std::atomic<bool> stopping_;
+  std::thread thread_;
+  RespParser parser_;
+  // owned by the loop thread
+  std::unordered_map<int, Connection*> connections_;
+
+  // accepted connections not yet registered
+  MPMCQueue<int> pending_;
+};
+
+Server::Server(const ServerOptions& options, CommandExecutor* executor)
+    : options_(options),
+      executor_(executor),
+      tcp_fd_(-1),
+      unix_fd_(-1),
+      epoll_fd_(-1),
+      stop_fd_(-1),
+      next_loop_(0) {}
+
+Server::~Server() {
+  for (auto& loop: loops_) {
+    loop->Stop();
+  }
+  loops_.clear();
+  if (tcp_fd_ >= 0) close(tcp_fd_);
+  if (unix_fd_ >= 0) {
+    close(unix_fd_);
+    unlink(options_.unix_socket.c_str());
+  }
+  if (epoll_fd_ >= 0) close(epoll_fd_);
+  if (stop_fd_ >= 0) close(stop_fd_);
+}
+
+Status Server::Listen() {
+  if (options_.port > 0) {
+    tcp_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (tcp_fd_ < 0) {
+      return ErrnoStatus("socket");
+    }
+    int on = 1;
+    setsockopt(tcp_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(options_.port);
+    if (inet_pton(AF_INET, options_.bind_address.c_str(), &addr.sin_addr) != 1) {
+      return Status::InvalidArgument("bad bind address", options_.bind_address);
+    }
+    if (bind(tcp_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+      return ErrnoStatus("bind " + options_.bind_address + ":" + std::to_string(options_.port));
+    }
+    if (listen(tcp_fd_, kBacklog) < 0) {
+      return ErrnoStatus("listen");
+    }
+  }
+  if (!options_.unix_socket.empty()) {
+    sockaddr_un addr{};
+    if (options_.unix_socket.size() >= sizeof(addr.sun_path)) {
+      return Status::InvalidArgument("unix socket path too long", options_.unix_socket);
+    }
+    unix_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (unix_fd_ < 0) {
+      return ErrnoStatus("socket");
+    }
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, options_.unix_socket.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(options_.unix_socket.c_str());
+    if (bind(unix_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+      return ErrnoStatus("bind " + options_.unix_socket);
+    }
+    if (listen(unix_fd_, kBacklog) < 0) {
+      return ErrnoStatus("listen");
+    }
+  }
+  if (tcp_fd_ < 0 && unix_fd_ < 0) {
+    return Status::InvalidArgument("neither a port nor a unix socket to listen on");
+  }
+  return Status::OK();
+}
+
+Status Server::Start() {
+  Status s = Listen();
+  if (!s.ok()) {
+    return s;
+  }
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd_ < 0 || stop_fd_ < 0) {
+    return ErrnoStatus("epoll setup");
+  }
+  for (int fd: {tcp_fd_, unix_fd_, stop_fd_}) {
+    if (fd < 0) {
+      continue;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      return ErrnoStatus("epoll_ctl");
+    }
+  }
+  const int threads = std::max(options_.io_threads, 1);
+  for (int i = 0; i < threads; i++) {
+    loops_.emplace_back(new EventLoop(executor_));
+    s = loops_.back()->Start();
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
+void Server::Run() {
+  epoll_event events[8];
+  while (true) {
+    int n = epoll_wait(epoll_fd_, events, 8, -1);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      spdlog::error("epoll_wait error: {}", strerror(errno));
+      return;
+    }
+    for (int i = 0; i < n; i++) {
+      const int listen_fd = events[i].data.fd;
+      if (listen_fd == stop_fd_) {
+        Drain(stop_fd_);
+        return;
+      }
+      while (true) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+          if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+          }
+          if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            spdlog::error("accept error: {}", strerror(errno));
+          }
+          break;
+        }
+        if (listen_fd == tcp_fd_) {
+          int on = 1;
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        loops_[next_loop_++ % loops_.size()]->Add(fd);
+      }
+    }
+  }
+}
+
+void Server::Stop() {
+  if (stop_fd_ >= 0) {
+    WakeUp(stop_fd_);
+  }
+}
+
+}  // namespace server
+}  // namespace yedis
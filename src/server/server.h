@@ -0,0 +1,71 @@
+//
+// RESP server on epoll event loops.
+//
+
+#ifndef YEDIS_SERVER_SERVER_H
+#define YEDIS_SERVER_SERVER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/status.h"
+
+namespace yedis {
+namespace server {
+
+class CommandExecutor;
+
+struct ServerOptions {
+  std::string bind_address = "127.0.0.1";
+  // 0 disables the TCP listener
+  int port = 6379;
+  // if not empty, also listen on this unix domain socket
+  std::string unix_socket;
+  // event loops serving the accepted connections
+  int io_threads = 4;
+};
+
+class EventLoop;
+
+// One acceptor thread hands new connections round robin to io_threads
+// event loops.  A connection stays on its loop for its lifetime, every
+// loop reads, executes and replies to its connections without locking
+// each other out.
+class Server {
+public:
+  Server(const ServerOptions& options, CommandExecutor* executor);
+  ~Server();
+
+  Server(const Server&) = delete;
+  Server& operator=(const Server&) = delete;
+
+  // Bind the listeners and start the event loops.
+  Status Start();
+
+  // Accept connections until Stop() is called.
+  void Run();
+
+  // Safe to call from a signal handler.
+  void Stop();
+
+private:
+  Status Listen();
+
+  const ServerOptions options_;
+  CommandExecutor* const executor_;
+  int tcp_fd_;
+  int unix_fd_;
+  int epoll_fd_;
+  int stop_fd_;
+  std::vector<std::unique_ptr<EventLoop>> loops_;
+  size_t next_loop_;
+};
+
+}  // namespace server
+}  // namespace yedis
+
+#endif //YEDIS_SERVER_SERVER_H
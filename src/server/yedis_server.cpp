@@ -0,0 +1,120 @@
+//
+// yedis-server: serves the db over RESP.
+//
+//   yedis-server [--port N] [--bind ADDR] [--unixsocket PATH]
+//                [--threads N] [--dir PATH]
+//
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include <spdlog/spdlog.h>
+
+#include "command.h"
+#include "db.h"
+#include "server.h"
+#include "yedis_keyspace.hpp"
+#include "yedis_zset.hpp"
+
+using namespace yedis;
+
+static server::Server* g_server = nullptr;
+
+static void HandleSignal(int) {
+  if (g_server != nullptr) {
+    g_server->Stop();
+  }
+}
+
+static void Usage(const char* prog) {
+  fprintf(stderr, "usage: %s [--port N] [--bind ADDR] [--unixsocket PATH] [--threads N] [--dir PATH]\n", prog);
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  server::ServerOptions server_options;
+  std::string dir = "yedis_data";
+  for (int i = 1; i < argc; i++) {
+    const char* flag = argv[i];
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+    }
+    const char* value = argv[++i];
+    if (strcmp(flag, "--port") == 0) {
+      server_options.port = atoi(value);
+    } else if (strcmp(flag, "--bind") == 0) {
+      server_options.bind_address = value;
+    } else if (strcmp(flag, "--unixsocket") == 0) {
+      server_options.unix_socket = value;
+    } else if (strcmp(flag, "--threads") == 0) {
+      server_options.io_threads = atoi(value);
+    } else if (strcmp(flag, "--dir") == 0) {
+      dir = value;
+    } else {
+      Usage(argv[0]);
+    }
+  }
+
+  Options options;
+  options.create_if_missing = true;
+  options.compression = kNoCompression;
+  // the members of deleted zsets and collections are dropped by
+  // compactions
+  std::unique_ptr<VersionGCFilter> zset_gc(ZSet::NewGCFilter());
+  std::unique_ptr<VersionGCFilter> collections_gc(NewKeySpaceGCFilter());
+  Options zset_options = options;
+  zset_options.compaction_filter = zset_gc.get();
+  Options meta_options = ZSet::MetaColumnFamilyOptions(zset_options);
+  Options index_options = ZSet::IndexColumnFamilyOptions(zset_options);
+  Options data_options = ZSet::DataColumnFamilyOptions(zset_options);
+  Options collections_options = options;
+  collections_options.compaction_filter = collections_gc.get();
+  std::vector<ColumnFamilyDescriptor> column_families = {
+      {kDefaultColumnFamilyName, &options},
+      {"zset_meta", &meta_options},
+      {"zset_index", &index_options},
+      {"zset_data", &data_options},
+      {"collections", &collections_options},
+  };
+  std::vector<ColumnFamilyHandle*> handles;
+  DB* db;
+  Status s = DB::Open(options, dir, column_families, &handles, &db);
+  if (!s.ok()) {
+    spdlog::error("open db {} error: {}", dir, s.ToString());
+    return 1;
+  }
+
+  zset_gc->Attach(db, handles[1]);
+  collections_gc->Attach(db, handles[4]);
+
+  {
+    ZSet zset(db, handles[1], handles[2], handles[3]);
+    KeySpace keyspace(db, handles[4]);
+    server::CommandExecutor executor(db, handles[0], &zset, &keyspace);
+    server::Server server(server_options, &executor);
+    s = server.Start();
+    if (!s.ok()) {
+      spdlog::error("start server error: {}", s.ToString());
+      zset_gc->Detach();
+      collections_gc->Detach();
+      delete db;
+      return 1;
+    }
+    g_server = &server;
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, HandleSignal);
+    signal(SIGTERM, HandleSignal);
+    spdlog::info("yedis-server ready, port {} unix socket '{}' io threads {}", server_options.port,
+                 server_options.unix_socket, server_options.io_threads);
+    server.Run();
+    g_server = nullptr;
+    spdlog::info("yedis-server shutting down");
+  }
+
+  zset_gc->Detach();
+  collections_gc->Detach();
+  delete db;
+  return 0;
+}
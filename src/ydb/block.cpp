@@ -42,7 +42,7 @@ Block::Block(const yedis::BlockContents &contents) {
 
 Block::~Block() {
   if (owned_) {
-    delete data_;
+    delete[] data_;
   }
 }
 
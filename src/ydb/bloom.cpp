@@ -11,11 +11,25 @@ static uint32_t BloomHash(const Slice& key) {
   return Hash(key.data(), key.size(), 0xbc9f1d34);
 }
 
+static uint64_t BloomHash64(const Slice& key) {
+  return Hash64(key.data(), key.size(), 0xbc9f1d34);
+}
+
+// map h onto [0, n) without a division
+static uint64_t FastRange64(uint64_t h, uint64_t n) {
+  return static_cast<uint64_t>((static_cast<unsigned __int128>(h) * n) >> 64);
+}
+
+// Set in the trailing k byte of format 2 filters.  Readers that predate it
+// see k > 30 and treat the filter as matching everything.
+static constexpr uint8_t kHash64Flag = 0x80;
+
 
 class BloomFilterPolicy: public FilterPolicy {
 
 public:
-  explicit BloomFilterPolicy(int bits_per_key): bits_per_key_(bits_per_key) {
+  BloomFilterPolicy(int bits_per_key, int format_version)
+      : bits_per_key_(bits_per_key), hash64_(format_version >= 2) {
     k_ = static_cast<size_t>(bits_per_key * 0.69);
     if (k_ < 1) k_ = 1;
     if (k_ > 30) k_ = 30;
@@ -34,9 +48,20 @@ public:
 
     const size_t init_size = dst->size();
     dst->resize(init_size + bytes, 0);
-    dst->push_back(static_cast<char>(k_));
+    dst->push_back(static_cast<char>(hash64_ ? (k_ | kHash64Flag) : k_));
     char* array = &(*dst)[init_size];
     for (int i = 0; i < n; i++) {
+      if (hash64_) {
+        // 64-bit probes, 32-bit ones repeat on filters of more than 2^32 bits
+        uint64_t h = BloomHash64(keys[i]);
+        const uint64_t delta = (h >> 33) | (h << 31);
+        for (size_t j = 0; j < k_; j++) {
+          const uint64_t bitpos = FastRange64(h, bits);
+          array[bitpos / 8] |= (1 << (bitpos % 8));
+          h += delta;
+        }
+        continue;
+      }
       uint32_t h = BloomHash(keys[i]);
       const uint32_t delta = (h >> 17) | (h << 15);
       for (size_t j = 0; j < k_; j++) {
@@ -54,12 +79,28 @@ public:
 
     const char* array = bloom_filter.data();
     const size_t bits = (len - 1) * 8;
-    const size_t k = array[len - 1];
+    const uint8_t k_byte = static_cast<uint8_t>(array[len - 1]);
+    if (k_byte & kHash64Flag) {
+      const size_t k = k_byte & ~kHash64Flag;
+      if (k > 30) {
+        return true;
+      }
+      uint64_t h = BloomHash64(key);
+      const uint64_t delta = (h >> 33) | (h << 31);
+      for (size_t j = 0; j < k; j++) {
+        const uint64_t bitpos = FastRange64(h, bits);
+        if ((array[bitpos / 8] & (1 << (bitpos % 8))) == 0) return false;
+        h += delta;
+      }
+      return true;
+    }
+
+    const size_t k = k_byte;
     if (k > 30) {
       return true;
     }
     uint32_t h = BloomHash(key);
-    const uint32_t delta = (h >> 17) || (h << 15);
+    const uint32_t delta = (h >> 17) | (h << 15);
     for (size_t j = 0; j < k; j++) {
       const uint32_t bitpos = h % bits;
       if ((array[bitpos / 8] & (1 << (bitpos % 8))) == 0) return false;
@@ -71,10 +112,107 @@ public:
 private:
   size_t bits_per_key_;
   size_t k_;
+  bool hash64_;
+};
+
+const FilterPolicy* NewBloomFilterPolicy(int bits_per_key, int format_version) {
+  return new BloomFilterPolicy(bits_per_key, format_version);
+}
+
+// All probes of a key land in one 64-byte line, so a lookup costs a single
+// cache miss instead of k.  The line is picked from the high bits of the
+// hash, the probes are generated by re-multiplying it.
+class BlockedBloomFilterPolicy: public FilterPolicy {
+public:
+  static constexpr size_t kLineBytes = 64;
+  static constexpr size_t kLineBits = kLineBytes * 8;
+
+  BlockedBloomFilterPolicy(int bits_per_key, int format_version)
+      : bits_per_key_(bits_per_key), hash64_(format_version >= 2) {
+    // a blocked filter needs a few more probes than a plain one to reach the
+    // same fp rate, round instead of truncating
+    k_ = static_cast<size_t>(bits_per_key * 0.69 + 0.5);
+    if (k_ < 1) k_ = 1;
+    if (k_ > 30) k_ = 30;
+  }
+
+  const char* Name() const override { return "yedis.BlockedBloomFilter"; }
+
+  void CreateFilter(const Slice* keys, int n, std::string* dst) const override {
+    size_t lines = (n * bits_per_key_ + kLineBits - 1) / kLineBits;
+    if (lines < 1) lines = 1;
+
+    const size_t init_size = dst->size();
+    dst->resize(init_size + lines * kLineBytes, 0);
+    dst->push_back(static_cast<char>(hash64_ ? (k_ | kHash64Flag) : k_));
+    char* array = &(*dst)[init_size];
+    for (int i = 0; i < n; i++) {
+      char* line;
+      uint32_t h2;
+      if (hash64_) {
+        // the line from the high half, the probes from the low one
+        const uint64_t h = BloomHash64(keys[i]);
+        line = array + FastRange64(h, lines) * kLineBytes;
+        h2 = static_cast<uint32_t>(h) * kMultiplier;
+      } else {
+        const uint32_t h = BloomHash(keys[i]);
+        line = array + LineIndex(h, lines) * kLineBytes;
+        h2 = h * kMultiplier;
+      }
+      for (size_t j = 0; j < k_; j++) {
+        // top 9 bits address a bit inside the 512-bit line
+        const uint32_t bitpos = h2 >> 23;
+        line[bitpos / 8] |= (1 << (bitpos % 8));
+        h2 *= kMultiplier;
+      }
+    }
+  }
+
+  bool KeyMayMatch(const Slice& key, const Slice& bloom_filter) const override {
+    const size_t len = bloom_filter.size();
+    if (len < kLineBytes + 1 || (len - 1) % kLineBytes != 0) return true;
+
+    const char* array = bloom_filter.data();
+    const size_t lines = (len - 1) / kLineBytes;
+    const uint8_t k_byte = static_cast<uint8_t>(array[len - 1]);
+    const size_t k = k_byte & ~kHash64Flag;
+    if (k > 30) {
+      return true;
+    }
+    const char* line;
+    uint32_t h2;
+    if (k_byte & kHash64Flag) {
+      const uint64_t h = BloomHash64(key);
+      line = array + FastRange64(h, lines) * kLineBytes;
+      h2 = static_cast<uint32_t>(h) * kMultiplier;
+    } else {
+      const uint32_t h = BloomHash(key);
+      line = array + LineIndex(h, lines) * kLineBytes;
+      h2 = h * kMultiplier;
+    }
+    for (size_t j = 0; j < k; j++) {
+      const uint32_t bitpos = h2 >> 23;
+      if ((line[bitpos / 8] & (1 << (bitpos % 8))) == 0) return false;
+      h2 *= kMultiplier;
+    }
+    return true;
+  }
+
+private:
+  static constexpr uint32_t kMultiplier = 0x9e3779b9;
+
+  // map h onto [0, lines) without a division
+  static size_t LineIndex(uint32_t h, size_t lines) {
+    return static_cast<size_t>((static_cast<uint64_t>(h) * lines) >> 32);
+  }
+
+  size_t bits_per_key_;
+  size_t k_;
+  bool hash64_;
 };
 
-const FilterPolicy* NewBloomFilterPolicy(int bits_per_key) {
-  return new BloomFilterPolicy(bits_per_key);
+const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key, int format_version) {
+  return new BlockedBloomFilterPolicy(bits_per_key, format_version);
 }
 
 }
@@ -16,7 +16,7 @@ namespace {
 
 struct HashSlice {
   size_t operator() (const Slice& key) const {
-    return Hash(key.data(), key.size(), 0);
+    return Hash64(key.data(), key.size(), 0);
   }
 };
 
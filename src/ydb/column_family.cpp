@@ -0,0 +1,181 @@
+//
+// Per column family state: memtables, versions and options.
+//
+#include <unordered_map>
+
+#include "column_family.h"
+#include "memtable.h"
+#include "perf_context.h"
+
+namespace yedis {
+
+const char* kDefaultColumnFamilyName = "default";
+
+namespace {
+char sv_in_use;
+// marks a slot whose super version a reader has checked out
+SuperVersion* const kSVInUse = reinterpret_cast<SuperVersion*>(&sv_in_use);
+
+std::atomic<uint64_t> next_instance_id{0};
+}
+
+void SuperVersion::Cleanup() {
+  mem->Unref();
+  for (auto* m: imm) {
+    m->Unref();
+  }
+  current->Unref();
+}
+
+ColumnFamilyHandle::~ColumnFamilyHandle() = default;
+
+const std::string& ColumnFamilyHandleImpl::GetName() const {
+  return cfd_->GetName();
+}
+
+uint32_t ColumnFamilyHandleImpl::GetID() const {
+  return cfd_->GetID();
+}
+
+Options SanitizeColumnFamilyOptions(const Options& db_options, const Options& cf_options) {
+  Options result = db_options;
+  result.write_buffer_size = cf_options.write_buffer_size;
+  result.max_write_buffer_number = cf_options.max_write_buffer_number;
+  result.block_cache = cf_options.block_cache;
+  result.block_size = cf_options.block_size;
+  result.block_restart_interval = cf_options.block_restart_interval;
+  result.max_file_size = cf_options.max_file_size;
+  result.compression = cf_options.compression;
+  result.filter_policy = cf_options.filter_policy;
+  result.full_filter = cf_options.full_filter;
+  result.index_type = cf_options.index_type;
+  result.partition_filters = cf_options.partition_filters;
+  result.metadata_block_size = cf_options.metadata_block_size;
+  result.compaction_filter = cf_options.compaction_filter;
+  result.merge_operator = cf_options.merge_operator;
+  return result;
+}
+
+// "options" with the user filter policy swapped for "internal_filter_policy"
+static Options WithFilterPolicy(const Options& options, const FilterPolicy* internal_filter_policy) {
+  Options result = options;
+  result.filter_policy = internal_filter_policy;
+  return result;
+}
+
+ColumnFamilyData::ColumnFamilyData(uint32_t id, std::string name, VersionSet* vset, const Options& options)
+  : id_(id),
+    name_(std::move(name)),
+    internal_filter_policy_(options.filter_policy == nullptr ?
+                            nullptr : new InternalFilterPolicy(options.filter_policy)),
+    options_(WithFilterPolicy(options, internal_filter_policy_.get())),
+    handle_(this),
+    mem_(new MemTable()),
+    log_number_(0),
+    dummy_versions_(vset, this),
+    current_(nullptr),
+    pending_compaction_bytes_(0),
+    super_version_(nullptr),
+    instance_id_(next_instance_id.fetch_add(1, std::memory_order_relaxed)) {
+  mem_->Ref();
+}
+
+ColumnFamilyData::~ColumnFamilyData() {
+  ResetThreadLocalSuperVersions();
+  if (super_version_ != nullptr && super_version_->Unref()) {
+    super_version_->Cleanup();
+    delete super_version_;
+  }
+  mem_->Unref();
+  for (auto& imm: imm_) {
+    imm.mem->Unref();
+  }
+  if (current_ != nullptr) {
+    current_->Unref();
+  }
+  // every older version is released by now
+  assert(dummy_versions_.next_ == &dummy_versions_);
+}
+
+ColumnFamilyData::SuperVersionSlot* ColumnFamilyData::ThreadSlot() {
+  thread_local std::unordered_map<uint64_t, std::shared_ptr<SuperVersionSlot>> slots;
+  auto it = slots.find(instance_id_);
+  if (it != slots.end()) {
+    return it->second.get();
+  }
+  // slots only this map still holds belong to dropped column families
+  std::erase_if(slots, [](const auto& entry) { return entry.second.use_count() == 1; });
+  auto slot = std::make_shared<SuperVersionSlot>();
+  {
+    std::lock_guard<std::mutex> lock_guard(sv_slots_mutex_);
+    sv_slots_.push_back(slot);
+  }
+  return slots.emplace(instance_id_, std::move(slot)).first->second.get();
+}
+
+SuperVersion* ColumnFamilyData::GetThreadLocalSuperVersion(std::mutex* mu) {
+  SuperVersion* sv = ThreadSlot()->sv.exchange(kSVInUse, std::memory_order_acquire);
+  assert(sv != kSVInUse);
+  if (sv != nullptr) {
+    // the slot reference moves to the caller
+    return sv;
+  }
+  // first read of this thread, or reset since its last one
+  perf::Timer timer(&PerfContext::db_mutex_lock_time);
+  std::lock_guard<std::mutex> lock_guard(*mu);
+  timer.Stop();
+  sv = super_version_;
+  sv->Ref();
+  return sv;
+}
+
+void ColumnFamilyData::ReturnThreadLocalSuperVersion(SuperVersion* sv, std::mutex* mu) {
+  SuperVersion* expected = kSVInUse;
+  if (ThreadSlot()->sv.compare_exchange_strong(expected, sv, std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+    return;
+  }
+  // a new super version was installed while "sv" was checked out
+  if (sv->Unref()) {
+    std::lock_guard<std::mutex> lock_guard(*mu);
+    sv->Cleanup();
+    delete sv;
+  }
+}
+
+void ColumnFamilyData::InstallSuperVersion() {
+  auto* sv = new SuperVersion;
+  sv->mem = mem_;
+  sv->mem->Ref();
+  sv->imm.reserve(imm_.size());
+  for (auto it = imm_.rbegin(); it != imm_.rend(); ++it) {
+    it->mem->Ref();
+    sv->imm.push_back(it->mem);
+  }
+  sv->current = current_;
+  sv->current->Ref();
+  sv->refs.store(1, std::memory_order_relaxed);
+
+  SuperVersion* old = super_version_;
+  super_version_ = sv;
+  ResetThreadLocalSuperVersions();
+  if (old != nullptr && old->Unref()) {
+    old->Cleanup();
+    delete old;
+  }
+}
+
+void ColumnFamilyData::ResetThreadLocalSuperVersions() {
+  std::lock_guard<std::mutex> lock_guard(sv_slots_mutex_);
+  for (auto& slot: sv_slots_) {
+    SuperVersion* sv = slot->sv.exchange(nullptr, std::memory_order_acq_rel);
+    if (sv != nullptr && sv != kSVInUse && sv->Unref()) {
+      sv->Cleanup();
+      delete sv;
+    }
+  }
+  // the thread of a slot nobody else holds has exited
+  std::erase_if(sv_slots_, [](const auto& slot) { return slot.use_count() == 1; });
+}
+
+}
@@ -0,0 +1,155 @@
+//
+// Per column family state: memtables, versions and options.
+//
+
+#ifndef YEDIS_COLUMN_FAMILY_H
+#define YEDIS_COLUMN_FAMILY_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "db.h"
+#include "options.h"
+#include "option.hpp"
+#include "version_set.h"
+
+namespace yedis {
+
+class ColumnFamilyData;
+class MemTable;
+
+class ColumnFamilyHandleImpl: public ColumnFamilyHandle {
+public:
+  explicit ColumnFamilyHandleImpl(ColumnFamilyData* cfd): cfd_(cfd) {}
+
+  const std::string& GetName() const override;
+  uint32_t GetID() const override;
+
+  ColumnFamilyData* cfd() const { return cfd_; }
+
+private:
+  ColumnFamilyData* const cfd_;
+};
+
+// What a read of a column family needs: its memtables and its current
+// version, each referenced once.  A new one replaces it whenever any of
+// them changes, so readers holding it see a consistent state.
+struct SuperVersion {
+  MemTable* mem;
+  // newest first
+  std::vector<MemTable*> imm;
+  Version* current;
+  std::atomic<int> refs;
+
+  void Ref() { refs.fetch_add(1, std::memory_order_relaxed); }
+  // Returns true if this was the last reference, the caller must then
+  // Cleanup() and delete it.
+  bool Unref() { return refs.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+  // Release mem, imm and current.
+  // REQUIRES: db mutex held
+  void Cleanup();
+};
+
+// Options of a column family: the db wide fields of "db_options" and the
+// memtable and table fields of "cf_options".
+Options SanitizeColumnFamilyOptions(const Options& db_options, const Options& cf_options);
+
+// Owned by VersionSet.  Everything but id, name and options is protected
+// by the db mutex.
+class ColumnFamilyData {
+public:
+  ColumnFamilyData(uint32_t id, std::string name, VersionSet* vset, const Options& options);
+  ~ColumnFamilyData();
+
+  ColumnFamilyData(const ColumnFamilyData&) = delete;
+  ColumnFamilyData& operator=(const ColumnFamilyData&) = delete;
+
+  uint32_t GetID() const { return id_; }
+  const std::string& GetName() const { return name_; }
+  // filter_policy is wrapped to work on the internal keys of tables
+  const Options& options() const { return options_; }
+  ColumnFamilyHandle* handle() { return &handle_; }
+
+  Version* current() const { return current_; }
+
+  MemTable* mem() const { return mem_; }
+
+  uint64_t pending_compaction_bytes() const { return pending_compaction_bytes_; }
+
+  // Returns a referenced super version without taking "mu", the db mutex,
+  // unless the one cached for this thread was replaced.  Hand it back with
+  // ReturnThreadLocalSuperVersion() from the same thread.
+  SuperVersion* GetThreadLocalSuperVersion(std::mutex* mu);
+  void ReturnThreadLocalSuperVersion(SuperVersion* sv, std::mutex* mu);
+
+  // Replace the super version after mem_, imm_ or current_ changed.
+  // REQUIRES: db mutex held
+  void InstallSuperVersion();
+
+private:
+  friend class Version;
+  friend class VersionSet;
+  friend class DBImpl;
+
+  // A super version cached by one thread: a referenced one, nullptr once
+  // it was reset, or kSVInUse while that thread has it checked out.  Only
+  // the owning thread checks it out and returns it, so an install that
+  // resets it in between makes the return fail instead of caching a stale
+  // super version.
+  struct alignas(64) SuperVersionSlot {
+    std::atomic<SuperVersion*> sv{nullptr};
+  };
+
+  // The slot of the calling thread, registered on its first read.
+  SuperVersionSlot* ThreadSlot();
+  // Empty every slot, readers with one checked out drop it on return.
+  // Slots of exited threads are dropped too.
+  // REQUIRES: db mutex held
+  void ResetThreadLocalSuperVersions();
+
+  struct ImmutableMemTable {
+    MemTable* mem;
+    // logs older than this one hold none of the data of the column
+    // family once "mem" is flushed
+    uint64_t next_log_number;
+    bool flush_scheduled;
+  };
+
+  const uint32_t id_;
+  const std::string name_;
+  // the filter policy of options_, filters of the column family's tables
+  // cover user keys
+  const std::unique_ptr<const FilterPolicy> internal_filter_policy_;
+  const Options options_;
+  ColumnFamilyHandleImpl handle_;
+
+  MemTable* mem_;
+  // full memtables waiting for flush, oldest first
+  std::deque<ImmutableMemTable> imm_;
+  // oldest log that may hold unflushed data of this column family
+  uint64_t log_number_;
+
+  Version dummy_versions_;  // Head of circular doubly-linked list of versions.
+  Version* current_;        // == dummy_versions_.prev_
+
+  // Per-level key at which the next compaction at that level should start.
+  std::string compact_pointer_[config::kNumLevels];
+  uint64_t pending_compaction_bytes_;
+
+  SuperVersion* super_version_;
+  // tells this column family apart from any later one at the same address
+  // in the thread local slot maps
+  const uint64_t instance_id_;
+  // slots of every thread that read this column family, each one shared
+  // with the thread local map of its thread
+  std::mutex sv_slots_mutex_;
+  std::vector<std::shared_ptr<SuperVersionSlot>> sv_slots_;
+};
+
+}
+
+#endif //YEDIS_COLUMN_FAMILY_H
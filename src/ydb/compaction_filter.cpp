@@ -0,0 +1,52 @@
+//
+// Hook to drop entries while flushes and compactions rewrite them.
+//
+#include <chrono>
+
+#include "compaction_filter.h"
+#include "slice.h"
+#include "util.hpp"
+
+namespace yedis {
+
+static const size_t kExpirationSize = sizeof(uint64_t);
+
+CompactionFilter::~CompactionFilter() = default;
+
+void AppendExpiration(std::string* value, uint64_t expire_at_ms) {
+  char buf[kExpirationSize];
+  EncodeFixed64(buf, expire_at_ms);
+  value->append(buf, kExpirationSize);
+}
+
+bool ParseExpiration(const Slice& stored, Slice* value, uint64_t* expire_at_ms) {
+  if (stored.size() < kExpirationSize) {
+    return false;
+  }
+  const size_t value_size = stored.size() - kExpirationSize;
+  *value = Slice(stored.data(), value_size);
+  *expire_at_ms = DecodeFixed64(stored.data() + value_size);
+  return true;
+}
+
+class TTLCompactionFilter: public CompactionFilter {
+public:
+  const char* Name() const override { return "yedis.TTLCompactionFilter"; }
+
+  bool Filter(const Slice& key, const Slice& value) const override {
+    Slice user_value;
+    uint64_t expire_at_ms;
+    if (!ParseExpiration(value, &user_value, &expire_at_ms) || expire_at_ms == 0) {
+      return false;
+    }
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    return expire_at_ms <= static_cast<uint64_t>(now);
+  }
+};
+
+const CompactionFilter* NewTTLCompactionFilter() {
+  return new TTLCompactionFilter();
+}
+
+}
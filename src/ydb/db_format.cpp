@@ -42,10 +42,35 @@ int InternalKeyComparator::Compare(const Slice &a, const Slice &b) const {
 }
 
 int InternalKeyComparator::Compare(const yedis::InternalKey &a, const yedis::InternalKey &b) const {
-  std::cout << "encoded length: " << a.Encode().size() << ", b: " << b.Encode().size() << std::endl;
   return Compare(a.Encode(), b.Encode());
 }
 
+InternalFilterPolicy::InternalFilterPolicy(const FilterPolicy* p)
+  : user_policy_(p),
+    name_(std::string("yedis.InternalKey.") + p->Name()) {}
+
+const char* InternalFilterPolicy::Name() const {
+  return name_.c_str();
+}
+
+void InternalFilterPolicy::CreateFilter(const Slice* keys, int n, std::string* dst) const {
+  // the filter builders drop keys[] after this call, so the user keys are
+  // written over it, consecutive versions of a key collapse into one
+  auto* user_keys = const_cast<Slice*>(keys);
+  int num_user_keys = 0;
+  for (int i = 0; i < n; i++) {
+    Slice user_key = ExtractUserKey(keys[i]);
+    if (num_user_keys == 0 || user_keys[num_user_keys - 1] != user_key) {
+      user_keys[num_user_keys++] = user_key;
+    }
+  }
+  user_policy_->CreateFilter(user_keys, num_user_keys, dst);
+}
+
+bool InternalFilterPolicy::KeyMayMatch(const Slice& key, const Slice& filter) const {
+  return user_policy_->KeyMayMatch(ExtractUserKey(key), filter);
+}
+
 void InternalKeyComparator::FindShortSuccessor(std::string *key) const {
   Slice user_key = ExtractUserKey(*key);
   std::string tmp(user_key.data(), user_key.size());
@@ -7,9 +7,11 @@
 
 #include <inttypes.h>
 #include <limits>
+#include <cstring>
 
 #include "slice.h"
 #include "comparator.h"
+#include "filter_policy.h"
 
 namespace yedis {
 
@@ -23,9 +25,17 @@ namespace yedis {
     kInfoLogFile  // Either the current one, or an old one
   };
 
-  enum class ValueType: uint8_t { kTypeDeletion = 0x0, kTypeValue = 0x1 };
+  // kTypeMerge entries are operands of the merge operator, applied on
+  // top of the older versions of the key.
+  enum class ValueType: uint8_t { kTypeDeletion = 0x0, kTypeValue = 0x1, kTypeMerge = 0x2 };
 
-  static const ValueType kValueTypeForSeek = ValueType::kTypeValue;
+  // kValueTypeForSeek defines the ValueType that should be passed when
+  // constructing a ParsedInternalKey object for seeking to a particular
+  // sequence number (since we sort sequence numbers in decreasing order
+  // and the value type is embedded as the low 8 bits in the sequence
+  // number in internal keys, we need to use the highest-numbered
+  // ValueType, not the lowest).
+  static const ValueType kValueTypeForSeek = ValueType::kTypeMerge;
 
   typedef uint64_t SequenceNumber;
 
@@ -53,6 +63,22 @@ namespace yedis {
     return static_cast<ValueType>(internal_key.data()[internal_key.size() - 8]);
   }
 
+  // Attempt to parse an internal key from "internal_key".  On success,
+  // stores the parsed data in "*result", and returns true.
+  //
+  // On error, returns false, leaves "*result" in an undefined state.
+  inline bool ParseInternalKey(const Slice& internal_key, ParsedInternalKey* result) {
+    const size_t n = internal_key.size();
+    if (n < 8) return false;
+    uint64_t num;
+    memcpy(&num, internal_key.data() + n - 8, sizeof(num));
+    uint8_t c = num & 0xff;
+    result->sequence = num >> 8;
+    result->type = static_cast<ValueType>(c);
+    result->user_key = Slice(internal_key.data(), n - 8);
+    return (c <= static_cast<uint8_t>(ValueType::kTypeMerge));
+  }
+
   class InternalKey {
   public:
     InternalKey() {}
@@ -100,6 +126,21 @@ namespace yedis {
 
   };
 
+  // Filter policy wrapper that converts from internal keys to user keys,
+  // so a filter answers for every version of a user key.
+  class InternalFilterPolicy: public FilterPolicy {
+  private:
+    const FilterPolicy* const user_policy_;
+    // differs from the user policy name: filters built over whole
+    // internal keys by older tables must not be probed with user keys
+    const std::string name_;
+  public:
+    explicit InternalFilterPolicy(const FilterPolicy* p);
+    const char* Name() const override;
+    void CreateFilter(const Slice* keys, int n, std::string* dst) const override;
+    bool KeyMayMatch(const Slice& key, const Slice& filter) const override;
+  };
+
   class LookupKey {
   public:
     // Initialize *this for looking up user_key at a snapshot with
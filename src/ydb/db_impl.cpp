@@ -1,16 +1,23 @@
 //
 // Created by Shiping Yao on 2023/3/12.
 //
-#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <latch>
+#include <memory>
+#include <thread>
 
 #include <folly/executors/CPUThreadPoolExecutor.h>
+#include <spdlog/spdlog.h>
 
 #include "db_impl.h"
 #include "version_set.h"
+#include "column_family.h"
 #include "memtable.h"
 #include "iterator.h"
 #include "options.h"
 #include "table.h"
+#include "table_cache.h"
 #include "util.hpp"
 #include "fs.hpp"
 #include "table_builder.h"
@@ -19,166 +26,840 @@
 #include "db.h"
 #include "db_format.h"
 #include "exception.h"
+#include "rate_limiter.h"
+#include "statistics.h"
+#include "perf_context.h"
+#include "event_trace.h"
+#include "merger.h"
+#include "compaction_filter.h"
+#include "merge_helper.h"
+#include "db_iter.h"
 
 namespace yedis {
 
+struct DBImpl::SubcompactionState {
+  struct Output {
+    uint64_t number;
+    uint64_t file_size;
+    InternalKey smallest, largest;
+  };
+
+  // user key range [begin, end) of this shard, empty means unbounded
+  std::string begin;
+  std::string end;
+
+  std::vector<Output> outputs;
+  std::unique_ptr<FileHandle> outfile;
+  std::unique_ptr<TableBuilder> builder;
+  Status status;
+
+  Output* current_output() { return &outputs[outputs.size() - 1]; }
+};
+
+static Status NewTableFile(const Options& options, const std::string& fname, std::unique_ptr<FileHandle>& result) {
+  if (options.use_direct_io_for_flush_and_compaction) {
+    return options.file_system->NewDirectWritableFile(fname, options.writable_file_max_buffer_size, result);
+  }
+  result = options.file_system->OpenFile(fname, O_CREAT | O_RDWR | O_TRUNC);
+  return Status::OK();
+}
+
+// files held open by other parts of the db than the table cache
+static const int kNumNonTableCacheFiles = 10;
+
+static int TableCacheSize(const Options& sanitized_options) {
+  return std::max(sanitized_options.max_open_files - kNumNonTableCacheFiles, 64);
+}
+
+// raw_options.comparator 定义的是user_comparator
+static Options SanitizeOptions(const Options& src, const InternalKeyComparator* icmp) {
+  Options result = src;
+  result.comparator = icmp;
+  result.file_system = new LocalFileSystem;
+  return result;
+}
+
+// Resolves the column family of a batch record to its current memtable.
+// REQUIRES: mutex_ held while the batch is inserted
+class ColumnFamilyMemTablesImpl: public ColumnFamilyMemTables {
+public:
+  explicit ColumnFamilyMemTablesImpl(VersionSet* versions): versions_(versions) {}
+
+  MemTable* GetMemTable(uint32_t column_family_id) override {
+    ColumnFamilyData* cfd = versions_->GetColumnFamily(column_family_id);
+    return cfd == nullptr ? nullptr : cfd->mem();
+  }
+
+private:
+  VersionSet* const versions_;
+};
 
 DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
   : db_name_(dbname),
-    options_(raw_options),
+    options_(SanitizeOptions(raw_options, &internal_comparator_)),
     internal_comparator_(raw_options.comparator),
-    mem_(new MemTable()),
-    imm_(nullptr),
+    table_cache_(new TableCache(db_name_, TableCacheSize(options_))),
     logfile_number_(0),
-    versions_(new VersionSet(db_name_, &options_, &internal_comparator_)) {
-  thread_pool_ = std::make_unique<folly::CPUThreadPoolExecutor>(8);
-  // raw_options.comparator 定义的是user_comparator
-  options_ = raw_options;
-  options_.comparator = &internal_comparator_;
-  options_.file_system = new LocalFileSystem;
+    versions_(new VersionSet(db_name_, &options_, table_cache_, &internal_comparator_)),
+    background_flushes_scheduled_(0),
+    background_compactions_scheduled_(0),
+    shutting_down_(false) {
+  flush_pool_ = std::make_unique<folly::CPUThreadPoolExecutor>(std::max(1, raw_options.max_background_flushes));
+  // room for the shards of every running compaction besides its own thread
+  compaction_pool_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+      std::max(1, raw_options.max_background_compactions) * std::max<uint32_t>(1, raw_options.max_subcompactions));
+}
+
+Status DBImpl::CreateColumnFamily(const Options& options, const std::string& name,
+                                  ColumnFamilyHandle** handle) {
+  *handle = nullptr;
+  std::lock_guard<std::mutex> lock_guard(mutex_);
+  if (versions_->GetColumnFamily(name) != nullptr) {
+    return Status::InvalidArgument("column family already exists");
+  }
+  ColumnFamilyData* cfd;
+  Status s = versions_->CreateColumnFamily(SanitizeColumnFamilyOptions(options_, options), name, &mutex_, &cfd);
+  if (s.ok()) {
+    // the new column family has no data in any existing log
+    cfd->log_number_ = logfile_number_;
+    *handle = cfd->handle();
+  }
+  return s;
+}
+
+ColumnFamilyHandle* DBImpl::DefaultColumnFamily() const {
+  return versions_->GetDefault()->handle();
 }
 
 Status DBImpl::Put(const WriteOptions& options, const Slice& key,
            const Slice& value) {
-  // lock by my self
+  return Put(options, DefaultColumnFamily(), key, value);
+}
+
+Status DBImpl::Put(const WriteOptions& options, ColumnFamilyHandle* column_family,
+                   const Slice& key, const Slice& value) {
+  StopWatch sw(options_.statistics, kPutMicros);
   WriteBatch batch;
-  batch.Put(key, value);
-  std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
-  lock.lock();
-  Status s = MakeRoomForWrite(false);
+  batch.Put(column_family, key, value);
+  return Write(options, &batch);
+}
+
+Status DBImpl::Delete(const WriteOptions& options, const Slice& key) {
+  return Delete(options, DefaultColumnFamily(), key);
+}
+
+Status DBImpl::Delete(const WriteOptions& options, ColumnFamilyHandle* column_family, const Slice& key) {
+  WriteBatch batch;
+  batch.Delete(column_family, key);
+  return Write(options, &batch);
+}
+
+Status DBImpl::Merge(const WriteOptions& options, const Slice& key, const Slice& value) {
+  return Merge(options, DefaultColumnFamily(), key, value);
+}
+
+Status DBImpl::Merge(const WriteOptions& options, ColumnFamilyHandle* column_family,
+                     const Slice& key, const Slice& value) {
+  ColumnFamilyData* cfd = static_cast<ColumnFamilyHandleImpl*>(column_family)->cfd();
+  if (cfd->options().merge_operator == nullptr) {
+    return Status::NotSupported("no merge_operator for column family", cfd->GetName());
+  }
+  WriteBatch batch;
+  batch.Merge(column_family, key, value);
+  return Write(options, &batch);
+}
+
+Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
+  if (WriteBatchInternal::Count(updates) == 0) {
+    return Status::OK();
+  }
+  StopWatch sw(options_.statistics, kWriteMicros);
+  std::set<uint32_t> column_families;
+  std::set<uint32_t> merged_column_families;
+  Status s = WriteBatchInternal::ColumnFamilies(updates, &column_families, &merged_column_families);
   if (!s.ok()) {
     return s;
   }
+  // lock by my self
+  std::unique_lock<std::mutex> write_lock(write_mutex_, std::defer_lock);
+  std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+  perf::Timer write_timer(&PerfContext::write_thread_wait_time);
+  write_lock.lock();
+  write_timer.Stop();
+  perf::Timer lock_timer(&PerfContext::db_mutex_lock_time);
+  lock.lock();
+  lock_timer.Stop();
+  for (uint32_t id: column_families) {
+    ColumnFamilyData* cfd = versions_->GetColumnFamily(id);
+    if (cfd == nullptr) {
+      return Status::InvalidArgument("unknown column family");
+    }
+    // operands nothing can fold would fail every read of their key
+    if (cfd->options().merge_operator == nullptr && merged_column_families.count(id) != 0) {
+      return Status::NotSupported("no merge_operator for column family", cfd->GetName());
+    }
+  }
+  for (uint32_t id: column_families) {
+    ColumnFamilyData* cfd = versions_->GetColumnFamily(id);
+    s = MakeRoomForWrite(cfd, false);
+    if (!s.ok()) {
+      return s;
+    }
+  }
   uint64_t last_sequence = versions_->LastSequence();
-  last_sequence += 1;
+  WriteBatchInternal::SetSequence(updates, last_sequence + 1);
+  last_sequence += WriteBatchInternal::Count(updates);
   lock.unlock();
 
-  // encode like write batch
-  Slice write_batch_content = WriteBatchInternal::Contents(&batch);
+  // one WAL record for all column families, the batch is atomic
+  Slice write_batch_content = WriteBatchInternal::Contents(updates);
   s = wal_writer_->AddRecord(write_batch_content);
+  if (s.ok() && options.sync) {
+    s = wal_handle_->Sync();
+    RecordTick(options_.statistics, kWALSyncs);
+  }
   if (s.ok()) {
+    RecordTick(options_.statistics, kBytesWritten, write_batch_content.size());
+    RecordTick(options_.statistics, kKeysWritten, WriteBatchInternal::Count(updates));
+    lock_timer.Start();
     lock.lock();
-    mem_->Add(last_sequence, ValueType::kTypeValue, key, value);
+    lock_timer.Stop();
+    ColumnFamilyMemTablesImpl memtables(versions_);
+    s = WriteBatchInternal::InsertInto(updates, &memtables);
     versions_->SetLastSequence(last_sequence);
     lock.unlock();
   }
   return s;
 }
 
-// Ignore force
+// Returns the delay for the next write to "cfd", 0 if writes may go at
+// full speed.  Sets *stop if writes have to wait for a compaction.
 // mutex_ acquired
-Status DBImpl::MakeRoomForWrite(bool force) {
+uint64_t DBImpl::WriteStallDelay(ColumnFamilyData* cfd, bool* stop) {
   assert(!mutex_.try_lock());
+  const Options& options = cfd->options();
+  const int l0_files = cfd->current()->NumFiles(0);
+  const uint64_t pending_bytes = cfd->pending_compaction_bytes();
+  *stop = l0_files >= options.level0_stop_writes_trigger
+      || (options.hard_pending_compaction_bytes_limit > 0
+          && pending_bytes >= options.hard_pending_compaction_bytes_limit);
+  if (*stop) {
+    return 0;
+  }
+  uint64_t delay = 0;
+  if (l0_files >= options.level0_slowdown_writes_trigger) {
+    delay = options.write_stall_delay_micros * (l0_files - options.level0_slowdown_writes_trigger + 1);
+  }
+  if (delay == 0 && options.soft_pending_compaction_bytes_limit > 0
+      && pending_bytes >= options.soft_pending_compaction_bytes_limit) {
+    delay = options.write_stall_delay_micros;
+  }
+  return delay;
+}
+
+// REQUIRES: mutex_ acquired
+Status DBImpl::MakeRoomForWrite(ColumnFamilyData* cfd, bool force) {
+  assert(!mutex_.try_lock());
+  bool allow_delay = !force;
+  bool stop = false;
   Status s;
   while (true) {
+    uint64_t delay = WriteStallDelay(cfd, &stop);
     if (!bg_error_.ok()) {
       s = bg_error_;
       break;
-    } else if (imm_ != nullptr) {
-      // NOTE: should wait here
+    } else if (allow_delay && delay > 0) {
+      // We are getting close to hitting a hard limit on the number of
+      // L0 files.  Rather than delaying a single write by several
+      // seconds when we hit the hard limit, start delaying each
+      // individual write a little bit to reduce latency variance.  Also,
+      // this delay hands over some CPU to the compaction thread in
+      // case it is sharing the same core as the writer.
+      mutex_.unlock();
+      std::this_thread::sleep_for(std::chrono::microseconds(delay));
+      mutex_.lock();
+      stall_stats_.slowdown_count++;
+      stall_stats_.slowdown_micros += delay;
+      RecordTick(options_.statistics, kStallMicros, delay);
+      YEDIS_TRACE_EVENT(TraceEventType::kWriteStall, {"cf", cfd->GetID()},
+                        {"micros", static_cast<int64_t>(delay)}, {"stop", 0});
+      allow_delay = false;  // Do not delay a single write more than once
+    } else if (!force && cfd->mem_->ApproximateMemoryUsage() <= cfd->options().write_buffer_size) {
+      // There is room in current memtable
+      break;
+    } else if (cfd->imm_.size() + 1 >= static_cast<size_t>(std::max(2, cfd->options().max_write_buffer_number))
+               || stop) {
+      // We have filled up the current memtable, but every other write
+      // buffer is still waiting for its flush, or there are too many
+      // level-0 files or too much compaction debt, so we wait.
+      auto start = std::chrono::steady_clock::now();
       std::unique_lock<std::mutex> lock(mutex_, std::adopt_lock);
-      std::cout << "wait here" << std::endl;
       background_work_finished_signal_.wait(lock);
-      std::cout << "after wait" << std::endl;
       lock.release();
-    } else if (mem_->ApproximateMemoryUsage() <= options_.write_buffer_size) {
-      std::cout << "have enough space" << std::endl;
-      // enough space
-      break;
+      const uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start).count();
+      stall_stats_.stop_count++;
+      stall_stats_.stop_micros += micros;
+      RecordTick(options_.statistics, kStallMicros, micros);
+      YEDIS_TRACE_EVENT(TraceEventType::kWriteStall, {"cf", cfd->GetID()},
+                        {"micros", static_cast<int64_t>(micros)}, {"stop", 1});
     } else {
-      assert(versions_->PrevLogNumber() == 0);
-      uint64_t new_log_number = versions_->NewFileNumber();
-      delete wal_writer_;
-      wal_handle_.reset(nullptr);
-      // TODO: 这里如何使用unique_ptr管理file_handle, 应该是可以直接赋值的
-      wal_handle_ =
-          options_.file_system->OpenFile(LogFileName(db_name_, new_log_number), O_RDWR | O_CREAT);
-      wal_writer_ = new wal::Writer(*wal_handle_);
-      // NOTE: important
-      logfile_number_ = new_log_number;
-      imm_ = mem_;
-      mem_ = new MemTable();
-      mem_->Ref();
-      MaybeScheduleCompaction();
+      // Attempt to switch to a new memtable and trigger flush of old
+      SwitchMemTable(cfd);
+      force = false;  // Do not force another compaction if have room
+      MaybeScheduleFlush();
     }
   }
   return s;
 }
 
-// just compact level0
+// REQUIRES: mutex_ acquired
+void DBImpl::SwitchMemTable(ColumnFamilyData* cfd) {
+  assert(!mutex_.try_lock());
+  assert(versions_->PrevLogNumber() == 0);
+  uint64_t new_log_number = versions_->NewFileNumber();
+  delete wal_writer_;
+  wal_handle_.reset(nullptr);
+  // TODO: 这里如何使用unique_ptr管理file_handle, 应该是可以直接赋值的
+  wal_handle_ =
+      options_.file_system->OpenFile(LogFileName(db_name_, new_log_number), O_RDWR | O_CREAT);
+  wal_writer_ = new wal::Writer(*wal_handle_);
+  // NOTE: important
+  logfile_number_ = new_log_number;
+  YEDIS_TRACE_EVENT(TraceEventType::kMemTableSwitch, {"cf", cfd->GetID()},
+                    {"log", static_cast<int64_t>(new_log_number)},
+                    {"memtable_bytes", static_cast<int64_t>(cfd->mem_->ApproximateMemoryUsage())},
+                    {"immutables", static_cast<int64_t>(cfd->imm_.size() + 1)});
+  cfd->imm_.push_back({cfd->mem_, new_log_number, false});
+  cfd->mem_ = new MemTable();
+  cfd->mem_->Ref();
+  cfd->InstallSuperVersion();
+  // column families with nothing in memory need none of the older logs,
+  // the others keep them alive until their own flush
+  for (auto& [id, other]: versions_->column_families()) {
+    if (other->mem_->ApproximateMemoryUsage() == 0 && other->imm_.empty()) {
+      other->log_number_ = new_log_number;
+    }
+  }
+}
+
+bool DBImpl::GetProperty(const Slice &property, std::string *value) {
+  value->clear();
+
+  std::lock_guard<std::mutex> lock_guard(mutex_);
+  Slice in = property;
+  Slice prefix("ydb.");
+  if (!in.starts_with(prefix)) return false;
+  in.remove_prefix(prefix.size());
+
+  if (in.starts_with("num-files-at-level")) {
+    in.remove_prefix(strlen("num-files-at-level"));
+    int level = 0;
+    for (size_t i = 0; i < in.size(); i++) {
+      if (in[i] < '0' || in[i] > '9') return false;
+      level = level * 10 + (in[i] - '0');
+    }
+    if (in.empty() || level >= config::kNumLevels) {
+      return false;
+    }
+    *value = std::to_string(versions_->GetDefault()->current()->NumFiles(level));
+    return true;
+  } else if (in == "pending-compaction-bytes") {
+    *value = std::to_string(versions_->GetDefault()->pending_compaction_bytes());
+    return true;
+  } else if (in == "write-stall") {
+    char buf[200];
+    std::snprintf(buf, sizeof(buf),
+                  "slowdown count: %llu\n"
+                  "slowdown micros: %llu\n"
+                  "stop count: %llu\n"
+                  "stop micros: %llu\n",
+                  static_cast<unsigned long long>(stall_stats_.slowdown_count),
+                  static_cast<unsigned long long>(stall_stats_.slowdown_micros),
+                  static_cast<unsigned long long>(stall_stats_.stop_count),
+                  static_cast<unsigned long long>(stall_stats_.stop_micros));
+    value->append(buf);
+    return true;
+  } else if (in == "stats") {
+    if (options_.statistics == nullptr) {
+      return false;
+    }
+    *value = options_.statistics->ToString();
+    return true;
+  }
+  return false;
+}
+
+// Every idle flush thread takes all memtables of a column family that
+// queued up since its last flush was scheduled, they are merged into a
+// single level-0 file.
 // mutex_ acquired
-void DBImpl::MaybeScheduleCompaction() {
+void DBImpl::MaybeScheduleFlush() {
   assert(!mutex_.try_lock());
-  if (imm_ != nullptr) {
-    background_compaction_scheduled_ = true;
-    std::cout << "start background call" << std::endl;
-    thread_pool_->add([&]{
-      BackgroundCall();
+  for (auto& [id, cfd]: versions_->column_families()) {
+    if (background_flushes_scheduled_ >= std::max(1, options_.max_background_flushes)
+        || shutting_down_.load(std::memory_order_acquire)
+        || !bg_error_.ok()) {
+      return;
+    }
+    FlushJob job;
+    job.cfd = cfd;
+    for (auto& imm: cfd->imm_) {
+      if (!imm.flush_scheduled) {
+        imm.flush_scheduled = true;
+        job.mems.push_back(imm.mem);
+      }
+    }
+    if (job.mems.empty()) {
+      continue;
+    }
+    // numbered in memtable order, level-0 lookups rely on newer files
+    // having larger numbers
+    job.file_number = versions_->NewFileNumber();
+    background_flushes_scheduled_++;
+    flush_pool_->add([this, job] {
+      BackgroundFlushCall(job);
     });
   }
 }
 
-//void DBImpl::BGWork(void *db) {
-//
-//}
+void DBImpl::BackgroundFlushCall(const FlushJob& job) {
+  std::lock_guard<std::mutex> lock_guard(mutex_);
+  assert(background_flushes_scheduled_ > 0);
+  if (!shutting_down_.load(std::memory_order_acquire)) {
+    CompactMemTable(job);
+  }
+  background_flushes_scheduled_--;
+  MaybeScheduleFlush();
+  // a new level-0 file may push level 0 over its trigger
+  MaybeScheduleCompaction();
+  background_work_finished_signal_.notify_all();
+}
 
-void DBImpl::BackgroundCall() {
-  std::cout << "in the background call" << std::endl;
+// mutex_ acquired
+void DBImpl::MaybeScheduleCompaction() {
+  assert(!mutex_.try_lock());
+  while (background_compactions_scheduled_ < options_.max_background_compactions
+         && !shutting_down_.load(std::memory_order_acquire)
+         && bg_error_.ok()
+         && versions_->NeedsCompaction()) {
+    background_compactions_scheduled_++;
+    compaction_pool_->add([this] {
+      BackgroundCompactionCall();
+    });
+  }
+}
+
+void DBImpl::BackgroundCompactionCall() {
   std::lock_guard<std::mutex> lock_guard(mutex_);
-  assert(background_compaction_scheduled_);
-  if (imm_ != nullptr) {
-    CompactMemTable();
-    background_compaction_scheduled_ = false;
-    background_work_finished_signal_.notify_all();
-    std::cout << "notify all" << std::endl;
-    return;
+  assert(background_compactions_scheduled_ > 0);
+  bool made_progress = false;
+  if (!shutting_down_.load(std::memory_order_acquire) && bg_error_.ok()) {
+    made_progress = BackgroundCompaction();
   }
+  background_compactions_scheduled_--;
+  // a call that found every candidate busy does not reschedule, the
+  // running compactions do when they finish
+  if (made_progress) {
+    MaybeScheduleCompaction();
+  }
+  background_work_finished_signal_.notify_all();
 }
 
+bool DBImpl::BackgroundCompaction() {
+  assert(!mutex_.try_lock());
+  Compaction* c = versions_->PickCompaction();
+  if (c == nullptr) {
+    return false;
+  }
+
+  Status s;
+  if (c->IsTrivialMove()) {
+    // Move file to next level
+    FileMetaData* f = c->input(0, 0);
+    c->edit()->RemoveFile(c->level(), f->number);
+    c->edit()->AddFile(c->level() + 1, f->number, f->file_size, f->smallest, f->largest);
+    s = versions_->LogAndApply(c->edit(), &mutex_);
+  } else {
+    s = DoCompactionWork(c);
+  }
+  versions_->ReleaseCompaction(c);
+
+  if (s.ok()) {
+    RemoveObsoleteFiles();
+  } else if (!shutting_down_.load(std::memory_order_acquire)) {
+    bg_error_ = s;
+  }
+  return true;
+}
 
-void DBImpl::CompactMemTable() {
-  std::cout << "in compact memtable" << std::endl;
+Status DBImpl::DoCompactionWork(Compaction *c) {
   assert(!mutex_.try_lock());
-  assert(imm_ != nullptr);
+  StopWatch sw(options_.statistics, kCompactionMicros);
+  // no snapshots yet, nothing older than the last sequence is visible
+  const SequenceNumber smallest_snapshot = versions_->LastSequence();
+  const Comparator* ucmp = internal_comparator_.user_comparator();
+
+  // shard boundaries are picked among the input file edges, which is cheap
+  // and roughly splits the input by size
+  std::vector<std::string> boundaries;
+  if (options_.max_subcompactions > 1) {
+    std::vector<std::string> keys;
+    for (int which = 0; which < 2; which++) {
+      for (int i = 0; i < c->num_input_files(which); i++) {
+        keys.push_back(c->input(which, i)->smallest.user_key().ToString());
+        keys.push_back(c->input(which, i)->largest.user_key().ToString());
+      }
+    }
+    std::sort(keys.begin(), keys.end(), [ucmp](const std::string& a, const std::string& b) {
+      return ucmp->Compare(a, b) < 0;
+    });
+    keys.erase(std::unique(keys.begin(), keys.end(), [ucmp](const std::string& a, const std::string& b) {
+      return ucmp->Compare(a, b) == 0;
+    }), keys.end());
+    if (keys.size() > 1) {
+      const size_t shards = std::min<size_t>(options_.max_subcompactions, keys.size() - 1);
+      for (size_t i = 1; i < shards; i++) {
+        boundaries.push_back(keys[i * (keys.size() - 1) / shards]);
+      }
+    }
+  }
+
+  std::vector<SubcompactionState> subs(boundaries.size() + 1);
+  for (size_t i = 0; i < boundaries.size(); i++) {
+    subs[i].end = boundaries[i];
+    subs[i + 1].begin = boundaries[i];
+  }
+
+  mutex_.unlock();
+  // Shards 1.. go to the compaction pool.  Whoever claims a shard first
+  // runs it: this thread takes the ones no pool thread has started, so it
+  // only waits for running shards, never for queued tasks.  A task that
+  // runs after its shard was taken must not touch "subs" any more, the
+  // claims outlive this call.
+  auto claimed = std::make_shared<std::vector<std::atomic<bool>>>(subs.size());
+  std::latch done(static_cast<std::ptrdiff_t>(subs.size()));
+  auto run = [this, c, smallest_snapshot, &subs, &done](std::vector<std::atomic<bool>>& claims, size_t i) {
+    if (!claims[i].exchange(true, std::memory_order_acq_rel)) {
+      RunSubcompaction(c, smallest_snapshot, &subs[i]);
+      done.count_down();
+    }
+  };
+  for (size_t i = 1; i < subs.size(); i++) {
+    compaction_pool_->add([run, claimed, i] {
+      run(*claimed, i);
+    });
+  }
+  for (size_t i = 0; i < subs.size(); i++) {
+    run(*claimed, i);
+  }
+  done.wait();
+  mutex_.lock();
+
+  Status s;
+  for (auto& sub: subs) {
+    if (!sub.status.ok()) {
+      s = sub.status;
+      break;
+    }
+  }
+  if (s.ok() && shutting_down_.load(std::memory_order_acquire)) {
+    s = Status::IOError("Deleting DB during compaction");
+  }
+  if (s.ok()) {
+    // shards cover disjoint user key ranges, so are their outputs
+    c->AddInputDeletions(c->edit());
+    for (auto& sub: subs) {
+      for (auto& out: sub.outputs) {
+        c->edit()->AddFile(c->level() + 1, out.number, out.file_size, out.smallest, out.largest);
+      }
+    }
+    s = versions_->LogAndApply(c->edit(), &mutex_);
+  }
+  int64_t outputs = 0;
+  int64_t output_bytes = 0;
+  for (auto& sub: subs) {
+    for (auto& out: sub.outputs) {
+      pending_outputs_.erase(out.number);
+      outputs++;
+      output_bytes += out.file_size;
+    }
+  }
+  YEDIS_TRACE_EVENT(TraceEventType::kCompaction, {"cf", c->column_family()->GetID()},
+                    {"level", c->level()},
+                    {"inputs", c->num_input_files(0) + c->num_input_files(1)},
+                    {"outputs", outputs}, {"output_bytes", output_bytes}, {"ok", s.ok()});
+  return s;
+}
+
+void DBImpl::RunSubcompaction(Compaction *c, SequenceNumber smallest_snapshot, SubcompactionState *sub) {
+  const Comparator* ucmp = internal_comparator_.user_comparator();
+  Iterator* input = versions_->MakeInputIterator(c);
+  Status s;
+  try {
+    if (sub->begin.empty()) {
+      input->SeekToFirst();
+    } else {
+      InternalKey start(sub->begin, kMaxSequenceNumber, kValueTypeForSeek);
+      input->Seek(start.Encode());
+    }
+
+    const Options& cf_options = c->column_family()->options();
+    const CompactionFilter* filter = cf_options.compaction_filter;
+    MergeHelper merge(ucmp, cf_options.merge_operator, filter);
+    ParsedInternalKey ikey;
+    std::string current_user_key;
+    bool has_current_user_key = false;
+    SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
+    std::string filtered_key;
+    while (input->Valid() && !shutting_down_.load(std::memory_order_acquire)) {
+      Slice key = input->key();
+      Slice value = input->value();
+      if (!ParseInternalKey(key, &ikey)) {
+        // Do not hide error keys
+        current_user_key.clear();
+        has_current_user_key = false;
+        last_sequence_for_key = kMaxSequenceNumber;
+      } else {
+        if (!sub->end.empty() && ucmp->Compare(ikey.user_key, sub->end) >= 0) {
+          break;
+        }
+        if (!has_current_user_key || ucmp->Compare(ikey.user_key, current_user_key) != 0) {
+          // outputs are only cut between user keys, all versions of a key
+          // stay in one file
+          if (sub->builder != nullptr && sub->builder->FileSize() >= c->MaxOutputFileSize()) {
+            s = FinishCompactionOutputFile(sub);
+            if (!s.ok()) {
+              break;
+            }
+          }
+          // First occurrence of this user key
+          current_user_key.assign(ikey.user_key.data(), ikey.user_key.size());
+          has_current_user_key = true;
+          last_sequence_for_key = kMaxSequenceNumber;
+        }
+
+        bool drop = false;
+        if (last_sequence_for_key <= smallest_snapshot) {
+          // Hidden by an newer entry for same user key
+          drop = true;
+        } else if (ikey.type == ValueType::kTypeDeletion && ikey.sequence <= smallest_snapshot
+                   && c->IsBaseLevelForKey(ikey.user_key)) {
+          // For this user key:
+          // (1) there is no data in higher levels
+          // (2) data in lower levels will have larger sequence numbers
+          // (3) data in layers that are being compacted here and have
+          //     smaller sequence numbers will be dropped in the next
+          //     few iterations of this loop (by rule (A) above).
+          // Therefore this deletion marker is obsolete and can be dropped.
+          drop = true;
+        }
+        last_sequence_for_key = ikey.sequence;
+        if (!drop && ikey.type == ValueType::kTypeMerge && ikey.sequence <= smallest_snapshot
+            && cf_options.merge_operator != nullptr) {
+          // Older entries of the key would be hidden by rule (A), fold them
+          // into the operand instead.
+          // The helper leaves the input past the folded entries.
+          s = merge.MergeUntil(input, c->IsBaseLevelForKey(ikey.user_key));
+          for (size_t i = 0; s.ok() && i < merge.output().size(); i++) {
+            s = AddCompactionOutput(c, sub, merge.output()[i].first, merge.output()[i].second);
+          }
+          if (!s.ok()) {
+            break;
+          }
+          continue;
+        }
+        if (!drop && filter != nullptr && ikey.type == ValueType::kTypeValue
+            && filter->Filter(ikey.user_key, value)) {
+          if (c->IsBaseLevelForKey(ikey.user_key)) {
+            // older versions of the key in this compaction are hidden by
+            // rule (A) above, there are none further down
+            drop = true;
+          } else {
+            // the entry has to keep hiding older versions of the key
+            filtered_key.clear();
+            AppendInternalKey(&filtered_key, ParsedInternalKey(ikey.user_key, ikey.sequence,
+                                                               ValueType::kTypeDeletion));
+            key = filtered_key;
+            value = Slice();
+          }
+        }
+        if (drop) {
+          input->Next();
+          continue;
+        }
+      }
+
+      s = AddCompactionOutput(c, sub, key, value);
+      if (!s.ok()) {
+        break;
+      }
+      input->Next();
+    }
+
+    if (s.ok()) {
+      s = input->status();
+    }
+    if (s.ok() && sub->builder != nullptr) {
+      s = FinishCompactionOutputFile(sub);
+    }
+  } catch (Exception& e) {
+    s = Status::IOError(e.what());
+  }
+  if (sub->builder != nullptr) {
+    sub->builder->Abandon();
+    sub->builder.reset();
+  }
+  delete input;
+  sub->status = s;
+}
+
+Status DBImpl::AddCompactionOutput(Compaction* c, SubcompactionState* sub, const Slice& key,
+                                   const Slice& value) {
+  if (sub->builder == nullptr) {
+    Status s = OpenCompactionOutputFile(c, sub);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  if (sub->builder->NumEntries() == 0) {
+    sub->current_output()->smallest.DecodeFrom(key);
+  }
+  sub->current_output()->largest.DecodeFrom(key);
+  sub->builder->Add(key, value);
+  return Status::OK();
+}
+
+Status DBImpl::OpenCompactionOutputFile(Compaction* c, SubcompactionState *sub) {
+  assert(sub->builder == nullptr);
+  uint64_t file_number;
+  {
+    std::lock_guard<std::mutex> lock_guard(mutex_);
+    file_number = versions_->NewFileNumber();
+    pending_outputs_.insert(file_number);
+  }
+  SubcompactionState::Output out;
+  out.number = file_number;
+  out.file_size = 0;
+  sub->outputs.push_back(out);
+
+  const Options& options = c->column_family()->options();
+  Status s = NewTableFile(options, TableFileName(db_name_, file_number), sub->outfile);
+  if (s.ok()) {
+    sub->builder = std::make_unique<TableBuilder>(options, sub->outfile.get());
+  }
+  return s;
+}
+
+Status DBImpl::FinishCompactionOutputFile(SubcompactionState *sub) {
+  assert(sub->builder != nullptr);
+  Status s = sub->builder->Finish();
+  sub->current_output()->file_size = sub->builder->FileSize();
+  sub->builder.reset();
+  try {
+    sub->outfile->Close();
+  } catch (IOException& e) {
+    if (s.ok()) {
+      s = Status::IOError(e.what());
+    }
+  }
+  sub->outfile.reset();
+  return s;
+}
+
+void DBImpl::CompactMemTable(const FlushJob& job) {
+  assert(!mutex_.try_lock());
+  ColumnFamilyData* cfd = job.cfd;
+  assert(!cfd->imm_.empty());
+  StopWatch sw(options_.statistics, kFlushMicros);
   VersionEdit edit;
-  Version* base = versions_->current();
+  edit.SetColumnFamily(cfd->GetID());
+  Version* base = cfd->current();
   base->Ref();
-  Status s = WriteLevel0Table(imm_, &edit, base);
-  std::cout << "unref in compact memtable" << std::endl;
+  Status s = WriteLevel0Table(job, &edit, base);
   base->Unref();
 
+  // Flushes are installed in memtable order, otherwise a compaction could
+  // move newer data below a level-0 file that is still to come.
+  {
+    std::unique_lock<std::mutex> lock(mutex_, std::adopt_lock);
+    background_work_finished_signal_.wait(lock, [&] {
+      return !bg_error_.ok() || shutting_down_.load(std::memory_order_acquire)
+          || cfd->imm_.front().mem == job.mems.front();
+    });
+    lock.release();
+  }
+  if (s.ok() && !bg_error_.ok()) {
+    s = bg_error_;
+  } else if (s.ok() && cfd->imm_.front().mem != job.mems.front()) {
+    s = Status::IOError("Deleting DB during memtable flush");
+  }
+
   if (s.ok()) {
+    // a log is obsolete once no column family has unflushed data in it
+    cfd->log_number_ = cfd->imm_[job.mems.size() - 1].next_log_number;
+    uint64_t min_log_number = cfd->log_number_;
+    for (auto& [id, other]: versions_->column_families()) {
+      min_log_number = std::min(min_log_number, other->log_number_);
+    }
     edit.SetPrevLogNumber(0);
-    edit.SetLogNumber(logfile_number_);
+    edit.SetLogNumber(min_log_number);
     s = versions_->LogAndApply(&edit, &mutex_);
   }
+  // only now the new level-0 file is protected by the version list, a
+  // concurrent compaction may be collecting obsolete files meanwhile
+  int64_t flushed_bytes = 0;
+  for (auto& [level, f]: edit.new_files_) {
+    pending_outputs_.erase(f.number);
+    flushed_bytes += f.file_size;
+  }
+  YEDIS_TRACE_EVENT(TraceEventType::kFlush, {"cf", cfd->GetID()},
+                    {"file", static_cast<int64_t>(job.file_number)},
+                    {"memtables", static_cast<int64_t>(job.mems.size())},
+                    {"bytes", flushed_bytes}, {"ok", s.ok()});
 
   if (s.ok()) {
     // TODO: clear, 如何清理Memtable， unique_ptr是否可行
-    imm_->Unref();
-    imm_ = nullptr;
+    for (size_t i = 0; i < job.mems.size(); i++) {
+      assert(cfd->imm_.front().mem == job.mems[i]);
+      cfd->imm_.front().mem->Unref();
+      cfd->imm_.pop_front();
+    }
+    cfd->InstallSuperVersion();
     RemoveObsoleteFiles();
+  } else {
+    // writers waiting for imm_ to drain have to see the failure
+    bg_error_ = s;
   }
 }
 
-Status DBImpl::WriteLevel0Table(MemTable *mem, VersionEdit *edit, Version *base) {
+Status DBImpl::WriteLevel0Table(const FlushJob& job, VersionEdit *edit, Version *base) {
   assert(!mutex_.try_lock());
   FileMetaData meta;
 
-  meta.number = versions_->NewFileNumber();
+  meta.number = job.file_number;
   pending_outputs_.insert(meta.number);
   Status s;
-  Iterator* iter = mem->NewIterator();
+  Iterator* iter;
+  if (job.mems.size() == 1) {
+    iter = job.mems[0]->NewIterator();
+  } else {
+    std::vector<Iterator*> list;
+    list.reserve(job.mems.size());
+    for (auto* mem: job.mems) {
+      list.push_back(mem->NewIterator());
+    }
+    iter = NewMergingIterator(&internal_comparator_, list.data(), static_cast<int>(list.size()));
+  }
   {
     mutex_.unlock();
-    s = BuildTable(db_name_, options_, iter, &meta);
+    s = BuildTable(db_name_, job.cfd->options(), iter, &meta);
     mutex_.lock();
   }
+  delete iter;
   if (!s.ok()) {
     return s;
   }
-  delete iter;
-  pending_outputs_.erase(meta.number);
 
   // NOTE: 本次实现只写到level 0
   int level = 0;
@@ -194,15 +875,34 @@ Status DBImpl::BuildTable(const std::string &dbname, const Options &options, Ite
   iter->SeekToFirst();
 
   std::string fname = TableFileName(dbname, meta->number);
-  auto file_ptr = options.file_system->OpenFile(fname, O_CREAT | O_RDWR | O_TRUNC);
+  std::unique_ptr<FileHandle> file_ptr;
+  s = NewTableFile(options, fname, file_ptr);
+  if (!s.ok()) {
+    return s;
+  }
   // TableBuilder的Comparator必须是InternalKeyOperator
   auto builder = std::make_unique<TableBuilder>(options, file_ptr.get());
-  std::cout << "decode smallest: " << iter->key().size() << std::endl;
-  meta->smallest.DecodeFrom(iter->key());
+  // a slow flush stalls writers, so it goes ahead of compactions
+  builder->SetIOPriority(RateLimiter::kHigh);
+  const CompactionFilter* filter = options.compaction_filter;
+  std::string filtered_key;
+  ParsedInternalKey ikey;
   Slice key;
   while(iter->Valid()) {
     key = iter->key();
-    builder->Add(key, iter->value());
+    Slice value = iter->value();
+    if (filter != nullptr && ParseInternalKey(key, &ikey) && ikey.type == ValueType::kTypeValue
+        && filter->Filter(ikey.user_key, value)) {
+      // level-0 output, older versions of the key may be anywhere below
+      filtered_key.clear();
+      AppendInternalKey(&filtered_key, ParsedInternalKey(ikey.user_key, ikey.sequence, ValueType::kTypeDeletion));
+      key = filtered_key;
+      value = Slice();
+    }
+    if (builder->NumEntries() == 0) {
+      meta->smallest.DecodeFrom(key);
+    }
+    builder->Add(key, value);
     iter->Next();
   }
   if (!key.empty()) {
@@ -212,18 +912,24 @@ Status DBImpl::BuildTable(const std::string &dbname, const Options &options, Ite
   if (!s.ok()) {
     return s;
   }
+  // a direct io file is only complete once its last sector is written
+  try {
+    file_ptr->Close();
+  } catch (IOException& e) {
+    return Status::IOError(e.what());
+  }
   meta->file_size = builder->FileSize();
   return s;
 }
 
-void DBImpl::prepare() {
+void DBImpl::prepare(const std::vector<ColumnFamilyDescriptor>& column_families) {
   std::unique_lock<std::mutex> lk(mutex_);
   if (!options_.file_system->Exists(db_name_)) {
     auto s = options_.file_system->CreateDir(db_name_);
     assert(s.ok());
   }
   bool save_manifest;
-  Status s = versions_->Recover(&save_manifest);
+  Status s = versions_->Recover(&save_manifest, column_families);
   if (!s.ok()) {
     return;
   }
@@ -256,13 +962,13 @@ void DBImpl::prepare() {
   }
 
   // recover from logs
-  VersionEdit edit;
+  std::map<uint32_t, VersionEdit> edits;
   std::sort(logs.begin(), logs.end());
   for (int i = 0; i < logs.size(); i++) {
     //
     auto log_number = logs[i];
     bool last_log = i == logs.size() - 1;
-    s = RecoverLogFile(log_number, last_log, &save_manifest, &edit, &max_seq);
+    s = RecoverLogFile(log_number, last_log, &save_manifest, &edits, &max_seq);
     if (!s.ok()) {
       break;
     }
@@ -274,10 +980,27 @@ void DBImpl::prepare() {
   wal_writer_ = new wal::Writer(*wal_handle_);
 
   logfile_number_ = new_log_number;
-  if (mem_ != nullptr) {
-    // NOTE: important
-    mem_->Ref();
+  for (auto& [id, cfd]: versions_->column_families()) {
+    cfd->log_number_ = new_log_number;
   }
+
+  // the recovered tables hold everything the old logs did, merge operands
+  // included, so the logs must not be replayed a second time
+  if (s.ok()) {
+    if (max_seq > versions_->LastSequence()) {
+      versions_->SetLastSequence(max_seq);
+    }
+    for (auto& [id, cfd]: versions_->column_families()) {
+      VersionEdit& edit = edits[id];
+      edit.SetColumnFamily(id);
+      edit.SetLogNumber(new_log_number);
+      s = versions_->LogAndApply(&edit, &mutex_);
+      if (!s.ok()) {
+        break;
+      }
+    }
+  }
+  MaybeScheduleCompaction();
 }
 
 void DBImpl::RemoveObsoleteFiles() {
@@ -327,6 +1050,9 @@ void DBImpl::RemoveObsoleteFiles() {
 
       if (!keep) {
         files_to_delete.push_back(std::move(filename));
+        if (ft == FileType::kTableFile) {
+          table_cache_->Evict(number);
+        }
       }
     }
   }
@@ -338,48 +1064,177 @@ void DBImpl::RemoveObsoleteFiles() {
 }
 
 DBImpl::~DBImpl() noexcept {
-  mutex_.lock();
-  if (mem_ != nullptr) mem_->Unref();
-  if (imm_ != nullptr) imm_->Unref();
-  mutex_.unlock();
-  thread_pool_->join();
+  // running compactions stop at their next key, queued calls return early
+  shutting_down_.store(true, std::memory_order_release);
+  {
+    // wake up flushes waiting for an older one that will never run
+    std::lock_guard<std::mutex> lock_guard(mutex_);
+    background_work_finished_signal_.notify_all();
+  }
+  flush_pool_->join();
+  compaction_pool_->join();
+  // column families release their memtables and versions
+  delete versions_;
+  delete table_cache_;
+}
+
+// the compaction filter, if reads have to apply it
+static const CompactionFilter* ReadFilter(const Options& cf_options) {
+  const CompactionFilter* filter = cf_options.compaction_filter;
+  return filter != nullptr && filter->FilterReads() ? filter : nullptr;
 }
 
 Status DBImpl::Get(const ReadOptions &options, const Slice &key, std::string *value) {
+  return Get(options, DefaultColumnFamily(), key, value);
+}
+
+Status DBImpl::Get(const ReadOptions &options, ColumnFamilyHandle* column_family, const Slice &key,
+                   std::string *value) {
+  StopWatch sw(options_.statistics, kGetMicros);
   Status s;
-  SequenceNumber snapshot;
-  std::unique_lock<std::mutex> lk(mutex_, std::defer_lock);
-  lk.lock();
-  snapshot = versions_->LastSequence();
-  MemTable* mem = mem_;
-  mem->Ref();
-  MemTable* imm = imm_;
-  if (imm != nullptr) {
-    imm->Ref();
-  }
-  Version* current = versions_->current();
-  current->Ref();
-  {
-    lk.unlock();
-    LookupKey lkey(key, snapshot);
-    if (mem->Get(lkey, value, &s)) {
-    } else if (imm != nullptr && imm->Get(lkey, value, &s)) {
-    } else {
-      s = current->Get(options, lkey, value);
+  ColumnFamilyData* cfd = static_cast<ColumnFamilyHandleImpl*>(column_family)->cfd();
+  // no db mutex unless the super version changed since this thread's last read
+  SuperVersion* sv = cfd->GetThreadLocalSuperVersion(&mutex_);
+  // writers publish the sequence after their memtable inserts
+  SequenceNumber snapshot = versions_->LastSequence();
+  LookupKey lkey(key, snapshot);
+  // newest first
+  std::vector<std::string> merge_operands;
+  bool found = sv->mem->Get(lkey, value, &s, &merge_operands);
+  for (size_t i = 0; !found && i < sv->imm.size(); i++) {
+    found = sv->imm[i]->Get(lkey, value, &s, &merge_operands);
+  }
+  RecordTick(options_.statistics, found ? kMemtableHit : kMemtableMiss);
+  if (!found) {
+    auto start = std::chrono::steady_clock::now();
+    s = sv->current->Get(options, lkey, value, &merge_operands);
+    if (options_.rate_limiter != nullptr) {
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      options_.rate_limiter->RecordReadLatency(
+          std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
     }
-    lk.lock();
   }
-  mem->Unref();
-  if (imm != nullptr) {
-    imm->Unref();
+  // the newest version may be filtered, but not compacted away yet
+  const CompactionFilter* filter = ReadFilter(cfd->options());
+  if (s.ok() && filter != nullptr && filter->Filter(key, *value)) {
+    value->clear();
+    s = Status::NotFound("");
+  }
+  if (!merge_operands.empty() && (s.ok() || s.IsNotFound())) {
+    std::string merged;
+    Slice existing(*value);
+    s = MergeHelper::FullMerge(cfd->options().merge_operator, key, s.ok() ? &existing : nullptr,
+                               merge_operands, &merged);
+    if (s.ok() && filter != nullptr && filter->Filter(key, merged)) {
+      s = Status::NotFound("");
+    }
+    if (s.ok()) {
+      value->swap(merged);
+    }
+  }
+  cfd->ReturnThreadLocalSuperVersion(sv, &mutex_);
+  if (s.ok()) {
+    RecordTick(options_.statistics, kKeysRead);
+    RecordTick(options_.statistics, kBytesRead, value->size());
+    perf::Count(&PerfContext::get_read_bytes, value->size());
   }
-  current->Unref();
   return s;
 }
 
+namespace {
+
+// What a DB iterator pins until it is deleted.
+struct IterState {
+  std::mutex* const mu;
+  MemTable* const mem;
+  std::vector<MemTable*> imms;
+  Version* const version;
+
+  IterState(std::mutex* mutex, MemTable* mem, Version* version)
+      : mu(mutex), mem(mem), version(version) {}
+};
+
+void CleanupIteratorState(void* arg1, void* arg2) {
+  auto* state = reinterpret_cast<IterState*>(arg1);
+  std::lock_guard<std::mutex> lock_guard(*state->mu);
+  state->mem->Unref();
+  for (auto* imm: state->imms) {
+    imm->Unref();
+  }
+  state->version->Unref();
+  delete state;
+}
+
+}  // anonymous namespace
+
+Iterator* DBImpl::NewIterator(const ReadOptions &options) {
+  return NewIterator(options, DefaultColumnFamily());
+}
+
+Iterator* DBImpl::NewIterator(const ReadOptions &options, ColumnFamilyHandle* column_family) {
+  ColumnFamilyData* cfd = static_cast<ColumnFamilyHandleImpl*>(column_family)->cfd();
+  std::vector<Iterator*> list;
+  SequenceNumber sequence;
+  IterState* state;
+  {
+    std::lock_guard<std::mutex> lock_guard(mutex_);
+    sequence = versions_->LastSequence();
+    // newest first, like Get looks them up
+    cfd->mem_->Ref();
+    state = new IterState(&mutex_, cfd->mem_, cfd->current());
+    list.push_back(cfd->mem_->NewIterator());
+    for (auto it = cfd->imm_.rbegin(); it != cfd->imm_.rend(); ++it) {
+      it->mem->Ref();
+      state->imms.push_back(it->mem);
+      list.push_back(it->mem->NewIterator());
+    }
+    state->version->Ref();
+  }
+  // table iterators are opened without the mutex
+  state->version->AddIterators(options, &list);
+  Iterator* internal_iter = NewMergingIterator(&internal_comparator_, list.data(),
+                                               static_cast<int>(list.size()));
+  internal_iter->RegisterCleanup(&CleanupIteratorState, state, nullptr);
+  return NewDBIterator(internal_comparator_.user_comparator(), internal_iter, sequence,
+                       cfd->options().merge_operator, ReadFilter(cfd->options()));
+}
+
 // no reuse log
-Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log, bool *save_manifest, VersionEdit *edit,
-                              SequenceNumber *max_sequence) {
+// Collects the records of a log into one memtable per column family.
+class RecoveryMemTables: public ColumnFamilyMemTables {
+public:
+  explicit RecoveryMemTables(VersionSet* versions): versions_(versions) {}
+  ~RecoveryMemTables() override {
+    for (auto& [id, mem]: mems_) {
+      if (mem != nullptr) {
+        mem->Unref();
+      }
+    }
+  }
+
+  MemTable* GetMemTable(uint32_t column_family_id) override {
+    // records of unknown column families are skipped
+    if (versions_->GetColumnFamily(column_family_id) == nullptr) {
+      return nullptr;
+    }
+    MemTable*& mem = mems_[column_family_id];
+    if (mem == nullptr) {
+      mem = new MemTable();
+      mem->Ref();
+    }
+    return mem;
+  }
+
+  // a flushed memtable is unreferenced and reset to nullptr by the caller
+  std::map<uint32_t, MemTable*>& mems() { return mems_; }
+
+private:
+  VersionSet* const versions_;
+  std::map<uint32_t, MemTable*> mems_;
+};
+
+Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log, bool *save_manifest,
+                              std::map<uint32_t, VersionEdit>* edits, SequenceNumber *max_sequence) {
   assert(!mutex_.try_lock());
   Status s;
   auto log_file_name = LogFileName(db_name_, log_number);
@@ -395,38 +1250,47 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log, bool *save_man
   SequenceNumber last_seq;
   SequenceNumber max_seq(0);
   int compactions = 0;
-  MemTable* mem = nullptr;
-  while (log_reader->ReadRecord(&record, &scratch)) {
+  RecoveryMemTables memtables(versions_);
+  for (bool more = true; more; ) {
+    // the last record comes with more == false
+    more = log_reader->ReadRecord(&record, &scratch);
+    if (record.empty()) {
+      break;
+    }
     // split k, v
     WriteBatchInternal::SetContents(&batch, record);
     last_seq = WriteBatchInternal::Sequence(&batch) + WriteBatchInternal::Count(&batch) - 1;
     if (last_seq > max_seq) {
       max_seq = last_seq;
     }
-    if (mem == nullptr) {
-      mem = new MemTable();
-      mem->Ref();
-    }
-    s = WriteBatchInternal::InsertInto(&batch, mem);
+    s = WriteBatchInternal::InsertInto(&batch, &memtables);
     if (!s.ok()) {
       break;
     }
 
-    if (mem->ApproximateMemoryUsage() >= options_.write_buffer_size) {
-      compactions++;
-      s = WriteLevel0Table(mem, edit, nullptr);
-      mem->Unref();
-      mem = nullptr;
-      if (!s.ok()) {
-        break;
+    for (auto& [id, mem]: memtables.mems()) {
+      ColumnFamilyData* cfd = versions_->GetColumnFamily(id);
+      if (mem != nullptr && mem->ApproximateMemoryUsage() >= cfd->options().write_buffer_size) {
+        compactions++;
+        s = WriteLevel0Table({cfd, {mem}, versions_->NewFileNumber()}, &(*edits)[id], nullptr);
+        mem->Unref();
+        mem = nullptr;
+        if (!s.ok()) {
+          break;
+        }
       }
     }
+    if (!s.ok()) {
+      break;
+    }
   }
   *max_sequence = max_seq;
 
-  if (mem != nullptr && s.ok()) {
-    s = WriteLevel0Table(mem, edit, nullptr);
-    mem->Unref();
+  for (auto& [id, mem]: memtables.mems()) {
+    if (mem != nullptr && s.ok()) {
+      s = WriteLevel0Table({versions_->GetColumnFamily(id), {mem}, versions_->NewFileNumber()},
+                           &(*edits)[id], nullptr);
+    }
   }
 
   return s;
@@ -438,8 +1302,42 @@ Status DB::Open(const Options &options, const std::string &name, DB **dbptr) {
   *dbptr = nullptr;
   auto* impl = new DBImpl(options, name);
   *dbptr = impl;
-  impl->prepare();
+  impl->prepare({});
   return Status::OK();
 }
 
+Status DB::Open(const Options &options, const std::string &name,
+                const std::vector<ColumnFamilyDescriptor> &column_families,
+                std::vector<ColumnFamilyHandle*>* handles, DB **dbptr) {
+  *dbptr = nullptr;
+  handles->clear();
+  auto* impl = new DBImpl(options, name);
+  impl->prepare(column_families);
+  Status s;
+  for (const auto& descriptor: column_families) {
+    ColumnFamilyHandle* handle = nullptr;
+    {
+      std::lock_guard<std::mutex> lock_guard(impl->mutex_);
+      ColumnFamilyData* cfd = impl->versions_->GetColumnFamily(descriptor.name);
+      if (cfd != nullptr) {
+        handle = cfd->handle();
+      }
+    }
+    if (handle == nullptr) {
+      s = impl->CreateColumnFamily(*descriptor.options, descriptor.name, &handle);
+      if (!s.ok()) {
+        break;
+      }
+    }
+    handles->push_back(handle);
+  }
+  if (!s.ok()) {
+    handles->clear();
+    delete impl;
+    return s;
+  }
+  *dbptr = impl;
+  return s;
+}
+
 }
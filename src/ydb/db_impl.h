@@ -5,7 +5,10 @@
 #ifndef YEDIS_DB_IMPL_H
 #define YEDIS_DB_IMPL_H
 
+#include <atomic>
 #include <condition_variable>
+#include <deque>
+#include <map>
 #include <thread>
 #include <set>
 
@@ -22,6 +25,9 @@ class Version;
 class VersionSet;
 class MemTable;
 class Table;
+class TableCache;
+class Compaction;
+class ColumnFamilyData;
 struct FileMetaData;
 
 class DBImpl: public DB {
@@ -32,64 +38,112 @@ public:
   DBImpl(const DBImpl&) = delete;
   DBImpl& operator=(const DBImpl&) = delete;
 
+  Status CreateColumnFamily(const Options& options, const std::string& name,
+                            ColumnFamilyHandle** handle) override;
+  ColumnFamilyHandle* DefaultColumnFamily() const override;
+
   Status Put(const WriteOptions& options, const Slice& key,
              const Slice& value) override;
-  Status Delete(const WriteOptions& options, const Slice& key) override {
-    return Status::NotSupported("no delete method");
-  };
+  Status Put(const WriteOptions& options, ColumnFamilyHandle* column_family,
+             const Slice& key, const Slice& value) override;
+  Status Delete(const WriteOptions& options, const Slice& key) override;
+  Status Delete(const WriteOptions& options, ColumnFamilyHandle* column_family,
+                const Slice& key) override;
+  Status Merge(const WriteOptions& options, const Slice& key, const Slice& value) override;
+  Status Merge(const WriteOptions& options, ColumnFamilyHandle* column_family,
+               const Slice& key, const Slice& value) override;
 
-  Status Write(const WriteOptions& options, WriteBatch* updates) override {
-    return Status::NotSupported("no write method");
-  };
+  Status Write(const WriteOptions& options, WriteBatch* updates) override;
 
   Status Get(const ReadOptions& options, const Slice& key, std::string* value) override;
+  Status Get(const ReadOptions& options, ColumnFamilyHandle* column_family,
+             const Slice& key, std::string* value) override;
+
+  Iterator* NewIterator(const ReadOptions& options) override;
+  Iterator* NewIterator(const ReadOptions& options, ColumnFamilyHandle* column_family) override;
 
-  Iterator* NewIterator(const ReadOptions& options) override {
-    return nullptr;
-  }
+  bool GetProperty(const Slice& property, std::string* value) override;
 
 private:
   friend class DB;
   friend class VersionSet;
 
-  void prepare();
-  void CompactMemTable();
+  void prepare(const std::vector<ColumnFamilyDescriptor>& column_families);
+  // memtables of one column family flushed together into one level-0 file
+  struct FlushJob {
+    ColumnFamilyData* cfd;
+    std::vector<MemTable*> mems;  // oldest first
+    uint64_t file_number;
+  };
+
+  void CompactMemTable(const FlushJob& job);
+  // "edits" collects the level-0 files written per column family
   Status RecoverLogFile(uint64_t log_number, bool last_log, bool* save_manifest,
-                        VersionEdit* edit, SequenceNumber* max_sequence);
-  Status MakeRoomForWrite(bool force);
-  Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base);
+                        std::map<uint32_t, VersionEdit>* edits, SequenceNumber* max_sequence);
+  Status MakeRoomForWrite(ColumnFamilyData* cfd, bool force);
+  uint64_t WriteStallDelay(ColumnFamilyData* cfd, bool* stop);
+  // Start a new WAL and queue the memtable of "cfd" for flush.
+  void SwitchMemTable(ColumnFamilyData* cfd);
+  Status WriteLevel0Table(const FlushJob& job, VersionEdit* edit, Version* base);
 
   Status BuildTable(const std::string& dbname, const Options& options, Iterator* iter, FileMetaData* meta);
 
   std::mutex mutex_;
+  // Held by Write from start to end, so one writer at a time picks a
+  // sequence, appends to the WAL and inserts.  The WAL is appended
+  // without mutex_, and switched only by writers.
+  std::mutex write_mutex_;
 
   std::unique_ptr<FileHandle> wal_handle_;
   wal::Writer* wal_writer_;
-  MemTable* mem_;
-  MemTable* imm_;
   std::string db_name_;
 
   Options options_;
   const InternalKeyComparator internal_comparator_;
 
+  // open tables of every column family, keyed by file number
+  TableCache* const table_cache_;
+
   VersionSet* const versions_;
   // wal file_number
   uint64_t logfile_number_;
   Status bg_error_;
 
   std::condition_variable background_work_finished_signal_;
-  bool background_compaction_scheduled_;
+  int background_flushes_scheduled_;
+  int background_compactions_scheduled_;
+  std::atomic<bool> shutting_down_;
+
+  // writes delayed or stopped by MakeRoomForWrite, protected by mutex_
+  struct WriteStallStats {
+    uint64_t slowdown_count = 0;
+    uint64_t slowdown_micros = 0;
+    uint64_t stop_count = 0;
+    uint64_t stop_micros = 0;
+  };
+  WriteStallStats stall_stats_;
+
+  struct SubcompactionState;
 
+  void MaybeScheduleFlush();
+  void BackgroundFlushCall(const FlushJob& job);
   void MaybeScheduleCompaction();
-  void BackgroundCall();
+  void BackgroundCompactionCall();
+  // Returns false if there was nothing to compact.
+  bool BackgroundCompaction();
+  Status DoCompactionWork(Compaction* c);
+  // runs without mutex_, one call per key-range shard
+  void RunSubcompaction(Compaction* c, SequenceNumber smallest_snapshot, SubcompactionState* sub);
+  Status OpenCompactionOutputFile(Compaction* c, SubcompactionState* sub);
+  // Append "key" to the current output of "sub", opening one if needed.
+  Status AddCompactionOutput(Compaction* c, SubcompactionState* sub, const Slice& key,
+                             const Slice& value);
+  Status FinishCompactionOutputFile(SubcompactionState* sub);
   void RemoveObsoleteFiles();
   std::set<uint64_t> pending_outputs_;
-  std::unique_ptr<folly::CPUThreadPoolExecutor> thread_pool_;
-
-  std::thread bg_thread_;
-
-
-
+  // flushes never queue behind long compactions
+  std::unique_ptr<folly::CPUThreadPoolExecutor> flush_pool_;
+  std::unique_ptr<folly::CPUThreadPoolExecutor> compaction_pool_;
 };
 
 }
@@ -0,0 +1,174 @@
+//
+// Iterator over the user keys of a column family.
+//
+
+#include <string>
+#include <vector>
+
+#include "db_iter.h"
+#include "comparator.h"
+#include "compaction_filter.h"
+#include "iterator.h"
+#include "merge_helper.h"
+
+namespace yedis {
+
+namespace {
+
+// The internal iterator is always left at the first entry of the user key
+// after the current one, every entry of the current key is consumed when
+// it is resolved.
+class DBIter: public Iterator {
+public:
+  DBIter(const Comparator* ucmp, Iterator* iter, SequenceNumber s,
+         const MergeOperator* merge_operator, const CompactionFilter* filter)
+    : user_comparator_(ucmp),
+      iter_(iter),
+      sequence_(s),
+      merge_operator_(merge_operator),
+      filter_(filter),
+      valid_(false) {}
+
+  DBIter(const DBIter&) = delete;
+  DBIter& operator=(const DBIter&) = delete;
+
+  ~DBIter() override { delete iter_; }
+
+  bool Valid() const override { return valid_; }
+  Slice key() const override {
+    assert(valid_);
+    return saved_key_;
+  }
+  Slice value() const override {
+    assert(valid_);
+    return saved_value_;
+  }
+  Status status() const override {
+    if (status_.ok()) {
+      return iter_->status();
+    }
+    return status_;
+  }
+
+  void Next() override {
+    assert(valid_);
+    FindNextUserEntry();
+  }
+  void Prev() override {
+    valid_ = false;
+    status_ = Status::NotSupported("DBIter only moves forward");
+  }
+  void Seek(const Slice& target) override {
+    std::string seek_key;
+    AppendInternalKey(&seek_key, ParsedInternalKey(target, sequence_, kValueTypeForSeek));
+    iter_->Seek(seek_key);
+    FindNextUserEntry();
+  }
+  void SeekToFirst() override {
+    iter_->SeekToFirst();
+    FindNextUserEntry();
+  }
+  void SeekToLast() override {
+    valid_ = false;
+    status_ = Status::NotSupported("DBIter only moves forward");
+  }
+
+private:
+  void FindNextUserEntry();
+  // Advance past the remaining entries of saved_key_.
+  void SkipCurrentUserKey();
+  bool SameUserKey(const ParsedInternalKey& ikey) const {
+    return user_comparator_->Compare(ikey.user_key, saved_key_) == 0;
+  }
+
+  const Comparator* const user_comparator_;
+  Iterator* const iter_;
+  SequenceNumber const sequence_;
+  const MergeOperator* const merge_operator_;
+  const CompactionFilter* const filter_;
+
+  Status status_;
+  std::string saved_key_;
+  std::string saved_value_;
+  bool valid_;
+};
+
+void DBIter::SkipCurrentUserKey() {
+  ParsedInternalKey ikey;
+  while (iter_->Valid() && ParseInternalKey(iter_->key(), &ikey) && SameUserKey(ikey)) {
+    iter_->Next();
+  }
+}
+
+void DBIter::FindNextUserEntry() {
+  valid_ = false;
+  ParsedInternalKey ikey;
+  while (iter_->Valid()) {
+    if (!ParseInternalKey(iter_->key(), &ikey)) {
+      status_ = Status::Corruption("corrupted internal key in DBIter");
+      return;
+    }
+    if (ikey.sequence > sequence_) {
+      // written after the iterator was created
+      iter_->Next();
+      continue;
+    }
+    saved_key_.assign(ikey.user_key.data(), ikey.user_key.size());
+    switch (ikey.type) {
+      case ValueType::kTypeDeletion:
+        SkipCurrentUserKey();
+        continue;
+      case ValueType::kTypeValue:
+        saved_value_.assign(iter_->value().data(), iter_->value().size());
+        SkipCurrentUserKey();
+        valid_ = true;
+        break;
+      case ValueType::kTypeMerge: {
+        // newest first, up to the value or deletion below them
+        std::vector<std::string> operands;
+        std::string base;
+        bool has_base = false;
+        for (; iter_->Valid(); iter_->Next()) {
+          if (!ParseInternalKey(iter_->key(), &ikey) || !SameUserKey(ikey)) {
+            break;
+          }
+          if (ikey.type == ValueType::kTypeMerge) {
+            operands.emplace_back(iter_->value().data(), iter_->value().size());
+            continue;
+          }
+          if (ikey.type == ValueType::kTypeValue
+              && (filter_ == nullptr || !filter_->Filter(ikey.user_key, iter_->value()))) {
+            has_base = true;
+            base.assign(iter_->value().data(), iter_->value().size());
+          }
+          break;
+        }
+        SkipCurrentUserKey();
+        Slice existing(base);
+        status_ = MergeHelper::FullMerge(merge_operator_, saved_key_, has_base ? &existing : nullptr,
+                                         operands, &saved_value_);
+        if (!status_.ok()) {
+          return;
+        }
+        valid_ = true;
+        break;
+      }
+    }
+    // the newest version may be filtered, but not compacted away yet
+    if (filter_ != nullptr && filter_->Filter(saved_key_, saved_value_)) {
+      valid_ = false;
+      continue;
+    }
+    return;
+  }
+}
+
+}  // namespace
+
+Iterator* NewDBIterator(const Comparator* user_comparator, Iterator* internal_iter,
+                        SequenceNumber sequence, const MergeOperator* merge_operator,
+                        const CompactionFilter* filter) {
+  return new DBIter(user_comparator, internal_iter, sequence, merge_operator, filter);
+}
+
+}
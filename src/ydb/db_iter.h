@@ -0,0 +1,31 @@
+//
+// Iterator over the user keys of a column family.
+//
+
+#ifndef YEDIS_DB_ITER_H
+#define YEDIS_DB_ITER_H
+
+#include "db_format.h"
+
+namespace yedis {
+
+class Comparator;
+class CompactionFilter;
+class Iterator;
+class MergeOperator;
+
+// Return a new iterator that converts internal keys (yielded by
+// "internal_iter") that were live at the specified "sequence" number
+// into appropriate user keys.  Deleted and filtered keys are skipped,
+// merge operands are folded into the value they apply to.  Takes
+// ownership of "internal_iter".
+//
+// Memtables cannot be walked backwards, so the result only moves forward:
+// SeekToLast() and Prev() leave it invalid with a NotSupported status.
+Iterator* NewDBIterator(const Comparator* user_comparator, Iterator* internal_iter,
+                        SequenceNumber sequence, const MergeOperator* merge_operator,
+                        const CompactionFilter* filter);
+
+}
+
+#endif //YEDIS_DB_ITER_H
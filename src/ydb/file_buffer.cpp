@@ -11,14 +11,20 @@
 
 
 namespace yedis {
-  FileBuffer::FileBuffer(Allocator &allocator, FileBufferType type, uint64_t user_size):
-    allocator(allocator), type(type) {
+  FileBuffer::FileBuffer(Allocator &allocator, FileBufferType type, uint64_t user_size, uint64_t alignment):
+    allocator(allocator), type(type), alignment(alignment) {
     Init();
     if (user_size) {
       Resize(user_size);
     }
   }
 
+  FileBuffer::~FileBuffer() {
+    if (malloced_buffer) {
+      allocator.FreeData(malloced_buffer, malloced_size);
+    }
+  }
+
   void FileBuffer::Init() {
     buffer = nullptr;
     size = 0;
@@ -32,6 +38,21 @@ namespace yedis {
   }
 
   void FileBuffer::ReallocBuffer(uint64_t new_size) {
+    if (alignment) {
+      // realloc does not keep the alignment, the contents are dropped anyway
+      if (malloced_buffer) {
+        allocator.FreeData(malloced_buffer, malloced_size);
+      }
+      malloced_size = new_size + alignment;
+      malloced_buffer = allocator.AllocateData(malloced_size);
+      if (!malloced_buffer) {
+        throw std::bad_alloc();
+      }
+      auto addr = reinterpret_cast<uintptr_t>(malloced_buffer);
+      buffer = reinterpret_cast<data_ptr_t>((addr + alignment - 1) / alignment * alignment);
+      size = 0;
+      return;
+    }
     if (malloced_buffer) {
       malloced_buffer = allocator.ReallocateData(malloced_buffer, malloced_size, new_size);
     } else {
@@ -16,9 +16,12 @@ enum class FileBufferType: uint8_t { BLOCK = 1, MANAGED_BUFFER = 2, TINY_BUFFER
 class FileBuffer {
 
 public:
-  FileBuffer(Allocator& allocator, FileBufferType type, uint64_t user_size);
+  // alignment != 0 aligns buffer to that many bytes, as O_DIRECT requires
+  FileBuffer(Allocator& allocator, FileBufferType type, uint64_t user_size, uint64_t alignment = 0);
+  ~FileBuffer();
   Allocator& allocator;
   FileBufferType type;
+  uint64_t alignment;
   data_ptr_t buffer;
   uint64_t size;
 
@@ -87,9 +87,46 @@ bool FilterBlockReader::KeyMayMatch(uint64_t block_offset, const yedis::Slice &k
       Slice filter = Slice(data_ + start, limit - start);
       return policy_->KeyMayMatch(key, filter);
     } else if (start == limit) {
+      // Empty filters do not match any keys
       return false;
     }
   }
-  return false;
+  return true;  // Errors are treated as potential matches
+}
+
+FullFilterBlockBuilder::FullFilterBlockBuilder(const yedis::FilterPolicy *policy)
+  : policy_(policy) {}
+
+void FullFilterBlockBuilder::AddKey(const yedis::Slice &key) {
+  start_.push_back(keys_.size());
+  keys_.append(key.data(), key.size());
+}
+
+Slice FullFilterBlockBuilder::Finish() {
+  result_.clear();
+  const size_t num_keys = start_.size();
+  if (num_keys == 0) {
+    return Slice(result_);
+  }
+
+  start_.push_back(keys_.size());
+  tmp_keys_.resize(num_keys);
+  for (size_t i = 0; i < num_keys; i++) {
+    tmp_keys_[i] = Slice(keys_.data() + start_[i], start_[i + 1] - start_[i]);
+  }
+  policy_->CreateFilter(tmp_keys_.data(), num_keys, &result_);
+
+  tmp_keys_.clear();
+  keys_.clear();
+  start_.clear();
+  return Slice(result_);
+}
+
+bool FullFilterBlockReader::KeyMayMatch(const yedis::Slice &key) const {
+  if (contents_.empty()) {
+    // an empty partition holds no keys
+    return false;
+  }
+  return policy_->KeyMayMatch(key, contents_);
+}
 }
-}
\ No newline at end of file
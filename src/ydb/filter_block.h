@@ -52,5 +52,41 @@ private:
   size_t num_;
   size_t base_lg_;
 };
+
+// A full filter covers every key added since the last Finish() with a
+// single filter, independent of block offsets.  Used for filter partitions.
+class FullFilterBlockBuilder {
+public:
+  explicit FullFilterBlockBuilder(const FilterPolicy*);
+
+  FullFilterBlockBuilder(const FullFilterBlockBuilder&) = delete;
+  FullFilterBlockBuilder& operator=(const FullFilterBlockBuilder&) = delete;
+
+  void AddKey(const Slice& key);
+
+  bool empty() const { return start_.empty(); }
+
+  // Build the filter over the pending keys and reset the key buffer.
+  // The returned slice stays valid until the next call to Finish().
+  Slice Finish();
+
+private:
+  const FilterPolicy* policy_;
+  std::string keys_;
+  std::vector<size_t> start_;
+  std::string result_;
+  std::vector<Slice> tmp_keys_;
+};
+
+class FullFilterBlockReader {
+public:
+  FullFilterBlockReader(const FilterPolicy* policy, const Slice& contents)
+    : policy_(policy), contents_(contents) {}
+  bool KeyMayMatch(const Slice& key) const;
+
+private:
+  const FilterPolicy* policy_;
+  Slice contents_;
+};
 }
 #endif //YEDIS_FILTER_BLOCK_H
@@ -5,11 +5,15 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <filesystem>
 #include <absl/strings/substitute.h>
+#include <spdlog/spdlog.h>
 
 #include "exception.h"
 #include "fs.hpp"
+#include "allocator.h"
+#include "file_buffer.h"
 
 namespace yedis {
 
@@ -45,6 +49,126 @@ int64_t UnixFileHandle::FileSize() {
   return st.st_size;
 }
 
+Status UnixFileHandle::Sync() {
+  if (::fdatasync(fd) != 0) {
+    return Status::IOError(path, strerror(errno));
+  }
+  return Status::OK();
+}
+
+MmapFileHandle::~MmapFileHandle() {
+  if (base != nullptr) {
+    ::munmap(const_cast<char*>(base), length);
+  }
+}
+
+static uint64_t AlignUp(uint64_t n) {
+  return (n + kDirectIOAlignment - 1) / kDirectIOAlignment * kDirectIOAlignment;
+}
+
+DirectIOFileHandle::DirectIOFileHandle(FileSystem &file_system, std::string_view path, int fd,
+                                       uint64_t file_size, size_t buffer_size):
+  UnixFileHandle(file_system, path, fd), file_size(file_size),
+  buffer_size(AlignUp(std::max<size_t>(buffer_size, 1))), buffer_offset(0), buffer_len(0), writable(false) {
+  buffer = std::make_unique<FileBuffer>(Allocator::DefaultAllocator(), FileBufferType::MANAGED_BUFFER,
+                                        this->buffer_size, kDirectIOAlignment);
+}
+
+DirectIOFileHandle::~DirectIOFileHandle() {
+  try {
+    Close();
+  } catch (IOException& e) {
+    spdlog::error("close direct io file {} error: {}", path, e.what());
+  }
+}
+
+void DirectIOFileHandle::FlushBuffer(uint64_t length) {
+  // O_DIRECT writes whole sectors, zero the padding after the real data
+  memset(buffer->buffer + buffer_len, 0, length - buffer_len);
+  int64_t bytes_written = pwrite(fd, buffer->buffer, length, buffer_offset);
+  if (bytes_written < 0) {
+    throw IOException(absl::Substitute("Could not write to file $0: $1", path, strerror(errno)));
+  }
+  if (bytes_written != static_cast<int64_t>(length)) {
+    throw IOException(absl::Substitute("Could not write all bytes to file $0: wanted=$1 written=$2",
+                                       path, length, bytes_written));
+  }
+}
+
+void DirectIOFileHandle::Close() {
+  if (fd == -1) {
+    return;
+  }
+  std::string error;
+  if (writable) {
+    try {
+      if (buffer_len > 0) {
+        FlushBuffer(AlignUp(buffer_len));
+      }
+      // drop the padding of the last sector
+      if (::ftruncate(fd, static_cast<off_t>(file_size)) != 0) {
+        error = absl::Substitute("Could not truncate file $0: $1", path, strerror(errno));
+      }
+    } catch (IOException& e) {
+      error = e.what();
+    }
+    buffer_len = 0;
+  }
+  UnixFileHandle::Close();
+  if (!error.empty()) {
+    throw IOException(error);
+  }
+}
+
+int64_t DirectIOFileHandle::Append(const void *data, int64_t nr_bytes) {
+  auto src = reinterpret_cast<const_data_ptr_t>(data);
+  uint64_t left = nr_bytes;
+  while (left > 0) {
+    uint64_t n = std::min<uint64_t>(left, buffer_size - buffer_len);
+    memcpy(buffer->buffer + buffer_len, src, n);
+    buffer_len += n;
+    src += n;
+    left -= n;
+    if (buffer_len == buffer_size) {
+      FlushBuffer(buffer_size);
+      buffer_offset += buffer_size;
+      buffer_len = 0;
+    }
+  }
+  file_size += nr_bytes;
+  return nr_bytes;
+}
+
+int64_t DirectIOFileHandle::ReadAt(void *data, int64_t nr_bytes, int64_t location) {
+  auto dst = reinterpret_cast<data_ptr_t>(data);
+  uint64_t pos = location;
+  uint64_t left = nr_bytes;
+  while (left > 0) {
+    if (pos < buffer_offset || pos >= buffer_offset + buffer_len) {
+      if (pos >= file_size) {
+        break;
+      }
+      // refill the read-ahead buffer from the sector containing pos
+      buffer_offset = pos / kDirectIOAlignment * kDirectIOAlignment;
+      int64_t bytes_read = pread(fd, buffer->buffer, buffer_size, buffer_offset);
+      if (bytes_read == -1) {
+        buffer_len = 0;
+        throw IOException(absl::Substitute("Could not read from file $0: $1", path, strerror(errno)));
+      }
+      buffer_len = bytes_read;
+      if (pos >= buffer_offset + buffer_len) {
+        break;
+      }
+    }
+    uint64_t n = std::min<uint64_t>(left, buffer_offset + buffer_len - pos);
+    memcpy(dst, buffer->buffer + (pos - buffer_offset), n);
+    dst += n;
+    pos += n;
+    left -= n;
+  }
+  return nr_bytes - left;
+}
+
 std::unique_ptr<FileHandle> LocalFileSystem::OpenFile(std::string_view path, int flags) {
   int fd = ::open(path.data(), flags, 0644);
   if (fd == -1) {
@@ -55,6 +179,17 @@ std::unique_ptr<FileHandle> LocalFileSystem::OpenFile(std::string_view path, int
 }
 
 int64_t LocalFileSystem::Read(FileHandle &handle, void *buffer, int64_t nr_bytes, int64_t location) {
+  if (auto direct = dynamic_cast<DirectIOFileHandle*>(&handle)) {
+    if (direct->writable) {
+      throw IOException(absl::Substitute("Could not read from file $0: opened for direct writes", handle.path));
+    }
+    int64_t bytes_read = direct->ReadAt(buffer, nr_bytes, location);
+    if (bytes_read != nr_bytes) {
+      throw IOException(absl::Substitute("Could not read all bytes from file $0: wanted=$1 read=$2",
+                                         handle.path, nr_bytes, bytes_read));
+    }
+    return bytes_read;
+  }
   int fd =((UnixFileHandle&) handle).fd;
   int64_t bytes_read = pread(fd, buffer, nr_bytes, location);
   if (bytes_read == -1) {
@@ -68,6 +203,9 @@ int64_t LocalFileSystem::Read(FileHandle &handle, void *buffer, int64_t nr_bytes
 }
 
 int64_t LocalFileSystem::Read(FileHandle& handle, void *buffer, int64_t nr_bytes) {
+  if (dynamic_cast<DirectIOFileHandle*>(&handle)) {
+    throw IOException(absl::Substitute("Could not read from file $0: direct io needs positional reads", handle.path));
+  }
   int fd =((UnixFileHandle&) handle).fd;
   int64_t bytes_read = read(fd, buffer, nr_bytes);
   if (bytes_read == -1) {
@@ -78,6 +216,9 @@ int64_t LocalFileSystem::Read(FileHandle& handle, void *buffer, int64_t nr_bytes
 }
 
 int64_t LocalFileSystem::Write(FileHandle &handle, void *buffer, int64_t nr_bytes, int64_t location) {
+  if (dynamic_cast<DirectIOFileHandle*>(&handle)) {
+    throw IOException(absl::Substitute("Could not write to file $0: direct io only supports appends", handle.path));
+  }
   int fd =((UnixFileHandle&) handle).fd;
   int64_t bytes_written = pwrite(fd, buffer, nr_bytes, location);
   if (bytes_written == -1) {
@@ -91,6 +232,12 @@ int64_t LocalFileSystem::Write(FileHandle &handle, void *buffer, int64_t nr_byte
 }
 
 int64_t LocalFileSystem::Write(FileHandle &handle, void *buffer, int64_t nr_bytes) {
+  if (auto direct = dynamic_cast<DirectIOFileHandle*>(&handle)) {
+    if (!direct->writable) {
+      throw IOException(absl::Substitute("Could not write to file $0: opened for direct reads", handle.path));
+    }
+    return direct->Append(buffer, nr_bytes);
+  }
   int fd =((UnixFileHandle&) handle).fd;
   int64_t bytes_written = write(fd, buffer, nr_bytes);
   if (bytes_written == -1) {
@@ -156,6 +303,76 @@ Status LocalFileSystem::NewReadableFile(std::string_view path, std::unique_ptr<F
   return Status::OK();
 }
 
+Status LocalFileSystem::NewMmapReadableFile(std::string_view path, std::unique_ptr<FileHandle> &result) {
+  int fd = ::open(path.data(), O_RDONLY);
+  if (fd == -1) {
+    return Status::IOError(absl::Substitute("Cannot open file $0: $1", path.data(), strerror(errno)));
+  }
+  struct stat st{};
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return Status::IOError(absl::Substitute("Cannot stat file $0: $1", path.data(), strerror(errno)));
+  }
+  auto length = static_cast<size_t>(st.st_size);
+  void* base = nullptr;
+  // mmap of an empty file fails, keep such files unmapped
+  if (length > 0) {
+    base = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      ::close(fd);
+      return Status::IOError(absl::Substitute("Cannot mmap file $0: $1", path.data(), strerror(errno)));
+    }
+  }
+  result = std::make_unique<MmapFileHandle>(*this, path, fd, reinterpret_cast<const char*>(base), length);
+  return Status::OK();
+}
+
+static int OpenDirect(std::string_view path, int flags) {
+#ifdef O_DIRECT
+  int fd = ::open(path.data(), flags | O_DIRECT, 0644);
+  if (fd == -1 && errno == EINVAL) {
+    // the file system does not support O_DIRECT (e.g. tmpfs), the aligned
+    // buffering still works on a plain descriptor
+    fd = ::open(path.data(), flags, 0644);
+  }
+#else
+  int fd = ::open(path.data(), flags, 0644);
+#ifdef F_NOCACHE
+  if (fd != -1) {
+    ::fcntl(fd, F_NOCACHE, 1);
+  }
+#endif
+#endif
+  return fd;
+}
+
+Status LocalFileSystem::NewDirectReadableFile(std::string_view path, size_t readahead_size,
+                                              std::unique_ptr<FileHandle> &result) {
+  int fd = OpenDirect(path, O_RDONLY);
+  if (fd == -1) {
+    return Status::IOError(absl::Substitute("Cannot open file $0: $1", path.data(), strerror(errno)));
+  }
+  struct stat st{};
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return Status::IOError(absl::Substitute("Cannot stat file $0: $1", path.data(), strerror(errno)));
+  }
+  result = std::make_unique<DirectIOFileHandle>(*this, path, fd, st.st_size, readahead_size);
+  return Status::OK();
+}
+
+Status LocalFileSystem::NewDirectWritableFile(std::string_view path, size_t buffer_size,
+                                              std::unique_ptr<FileHandle> &result) {
+  int fd = OpenDirect(path, O_CREAT | O_RDWR | O_TRUNC);
+  if (fd == -1) {
+    return Status::IOError(absl::Substitute("Cannot open file $0: $1", path.data(), strerror(errno)));
+  }
+  auto handle = std::make_unique<DirectIOFileHandle>(*this, path, fd, 0, buffer_size);
+  handle->writable = true;
+  result = std::move(handle);
+  return Status::OK();
+}
+
 Status LocalFileSystem::NewWritableFile(std::string_view path, std::unique_ptr<FileHandle>& result) {
   result = OpenFile(path, O_RDWR);
   if (!result) {
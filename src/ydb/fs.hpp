@@ -15,8 +15,13 @@
 
 namespace yedis {
 class FileSystem;
+class FileBuffer;
 class DB;
 
+// O_DIRECT requires buffers, offsets and lengths aligned to the logical
+// sector size of the device, 4KB covers all common devices
+static constexpr uint64_t kDirectIOAlignment = 4096;
+
 struct FileHandle {
 public:
   FileHandle(FileSystem& file_system, std::string_view path);
@@ -30,6 +35,13 @@ public:
 
   int64_t Read(void *buffer, int64_t nr_bytes, int64_t location);
   int64_t Write(void *buffer, int64_t nr_bytes, int64_t location);
+
+  // Start of the file contents if the whole file is memory mapped,
+  // nullptr otherwise.
+  virtual const char* MappedData() const { return nullptr; }
+
+  // Flush written data to stable storage.
+  virtual Status Sync() { return Status::OK(); }
  public:
   FileSystem& file_system;
   std::string path;
@@ -54,6 +66,16 @@ class FileSystem {
   virtual Status GetChildren(const std::string& dir, std::vector<std::string>& result) = 0;
 
   virtual Status NewReadableFile(std::string_view path, std::unique_ptr<FileHandle>&) = 0;
+  // Like NewReadableFile, but the returned handle exposes the file through
+  // MappedData().  The file must not change while it is mapped.
+  virtual Status NewMmapReadableFile(std::string_view path, std::unique_ptr<FileHandle>&) = 0;
+  // O_DIRECT variants of NewReadableFile and NewWritableFile, their I/O
+  // bypasses the OS page cache.  The writable file is created or truncated,
+  // supports appends only and is complete once Close() returns.
+  virtual Status NewDirectReadableFile(std::string_view path, size_t readahead_size,
+                                       std::unique_ptr<FileHandle>&) = 0;
+  virtual Status NewDirectWritableFile(std::string_view path, size_t buffer_size,
+                                       std::unique_ptr<FileHandle>&) = 0;
   virtual Status NewWritableFile(std::string_view path, std::unique_ptr<FileHandle>& result) = 0;
 
 };
@@ -66,6 +88,7 @@ public:
   }
   int fd;
   int64_t FileSize() override;
+  Status Sync() override;
 public:
   void Close() override {
     if (fd != -1) {
@@ -75,6 +98,48 @@ public:
   }
 };
 
+// read-only handle over a file mapped with mmap(2)
+struct MmapFileHandle: public UnixFileHandle {
+public:
+  MmapFileHandle(FileSystem& file_system, std::string_view path, int fd, const char* base, size_t length)
+    : UnixFileHandle(file_system, path, fd), base(base), length(length) {}
+  ~MmapFileHandle() override;
+  int64_t FileSize() override { return static_cast<int64_t>(length); }
+  const char* MappedData() const override { return base; }
+
+  const char* base;
+  size_t length;
+};
+
+// Handle over a file opened with O_DIRECT.  Appends are staged in a
+// sector-aligned FileBuffer and written out in whole buffers; Close() pads
+// the tail to a sector and truncates the file back to its real size.
+// Reads are served from an aligned read-ahead buffer.
+struct DirectIOFileHandle: public UnixFileHandle {
+public:
+  DirectIOFileHandle(FileSystem& file_system, std::string_view path, int fd, uint64_t file_size,
+                     size_t buffer_size);
+  ~DirectIOFileHandle() override;
+  int64_t FileSize() override { return static_cast<int64_t>(file_size); }
+  void Close() override;
+
+  int64_t Append(const void* data, int64_t nr_bytes);
+  int64_t ReadAt(void* data, int64_t nr_bytes, int64_t location);
+
+  // logical size, including bytes still sitting in the write buffer
+  uint64_t file_size;
+  size_t buffer_size;
+  std::unique_ptr<FileBuffer> buffer;
+  // file offset of buffer, always aligned
+  uint64_t buffer_offset;
+  // valid bytes in buffer
+  uint64_t buffer_len;
+  bool writable;
+
+private:
+  void FlushBuffer(uint64_t length);
+};
+
 class LocalFileSystem: public FileSystem {
 public:
   std::unique_ptr<FileHandle> OpenFile(std::string_view path, int flags) override;
@@ -101,6 +166,14 @@ public:
 
   Status NewReadableFile(std::string_view path, std::unique_ptr<FileHandle>& result) override;
 
+  Status NewMmapReadableFile(std::string_view path, std::unique_ptr<FileHandle>& result) override;
+
+  Status NewDirectReadableFile(std::string_view path, size_t readahead_size,
+                               std::unique_ptr<FileHandle>& result) override;
+
+  Status NewDirectWritableFile(std::string_view path, size_t buffer_size,
+                               std::unique_ptr<FileHandle>& result) override;
+
   Status NewWritableFile(std::string_view path, std::unique_ptr<FileHandle>& result) override;
 
   ~LocalFileSystem() override = default;
@@ -1,7 +1,6 @@
 //
 // Created by Shiping Yao on 2023/4/6.
 //
-#include <iostream>
 #include <cassert>
 
 #include <spdlog/spdlog.h>
@@ -10,6 +9,7 @@
 #include "memtable.h"
 #include "util.hpp"
 #include "db_format.h"
+#include "perf_context.h"
 
 namespace yedis {
 
@@ -54,7 +54,6 @@ void MemTable::Add(SequenceNumber seq, ValueType type, const Slice &key, const S
   //  tag          : uint64((sequence << 8) | type)
   //  value_size   : varint32 of value.size()
   //  value bytes  : char[value.size()]
-  auto before_allocated = ApproximateMemoryUsage();
   uint64_t key_size = key.size();
   uint64_t value_size = value.size();
   uint64_t internal_key_size = key_size + 8;
@@ -71,33 +70,43 @@ void MemTable::Add(SequenceNumber seq, ValueType type, const Slice &key, const S
   SkipList accessor(table_.get());
 
   accessor.add(Slice(start, encoded_len));
-  auto after_allocated = ApproximateMemoryUsage();
-  spdlog::info("[stats] before: {} after: {}", before_allocated, after_allocated);
 }
 
-bool MemTable::Get(const LookupKey &key, std::string *value, Status *s) {
+bool MemTable::Get(const LookupKey &key, std::string *value, Status *s,
+                   std::vector<std::string>* merge_operands) {
+  perf::Count(&PerfContext::get_from_memtable_count);
+  perf::Timer timer(&PerfContext::get_from_memtable_time);
   // 这里保证了seq number >= key里的seq
   SkipList accessor(table_.get());
-  auto iter = accessor.lower_bound(key.memtable_key());
-  if (iter != accessor.end()) {
+  for (auto iter = accessor.lower_bound(key.memtable_key()); iter != accessor.end(); ++iter) {
     uint32_t internal_key_len;
     const char* start = GetVarint32Ptr(iter->data(), iter->data() + 5, &internal_key_len);
     auto user_key = Slice(start, internal_key_len - 8);
-    if (user_key.compare(key.user_key()) == 0) {
-      auto tag = DecodeFixed<uint64_t>((void *) (start + internal_key_len - 8));
-      auto vt = static_cast<ValueType>(tag & 0xff);
-      switch (vt) {
-        case ValueType::kTypeDeletion: {
-          *s = Status::NotFound(Slice());
-          return true;
-        }
-        case ValueType::kTypeValue: {
-          uint32_t value_len;
-          const char* value_start = GetVarint32Ptr(start + internal_key_len, start + internal_key_len + 5, &value_len);
-          value->assign(value_start, value_len);
-          *s = Status::OK();
+    if (user_key.compare(key.user_key()) != 0) {
+      break;
+    }
+    auto tag = DecodeFixed<uint64_t>((void *) (start + internal_key_len - 8));
+    auto vt = static_cast<ValueType>(tag & 0xff);
+    uint32_t value_len;
+    const char* value_start = GetVarint32Ptr(start + internal_key_len, start + internal_key_len + 5, &value_len);
+    switch (vt) {
+      case ValueType::kTypeDeletion: {
+        *s = Status::NotFound(Slice());
+        return true;
+      }
+      case ValueType::kTypeValue: {
+        value->assign(value_start, value_len);
+        *s = Status::OK();
+        return true;
+      }
+      case ValueType::kTypeMerge: {
+        if (merge_operands == nullptr) {
+          *s = Status::NotSupported("merge operand without merge_operands");
           return true;
         }
+        // older entries of the same key follow, keep walking
+        merge_operands->emplace_back(value_start, value_len);
+        break;
       }
     }
   }
@@ -135,14 +144,23 @@ public:
   using SkipListType = MemTable::SkipListType;
   using SkipListAccessor = MemTable::SkipList;
 
-  explicit MemTableIterator(SkipListType* table) : iter_(SkipListAccessor::Skipper(SkipListAccessor(table))) {}
+  explicit MemTableIterator(SkipListType* table)
+    : table_(table), iter_(SkipListAccessor::Skipper(SkipListAccessor(table))) {}
 
   MemTableIterator(const MemTableIterator&) = delete;
   MemTableIterator& operator=(const MemTableIterator&) = delete;
   ~MemTableIterator() override = default;
 
   bool Valid() const override { return iter_.good(); }
-  void Seek(const Slice& k) override { iter_.to(k); }
+  // "k" is an internal key, the skiplist holds length prefixed ones.  A
+  // Skipper only moves forward, seeks start over from the head.
+  void Seek(const Slice& k) override {
+    tmp_.clear();
+    PutVarint32(&tmp_, k.size());
+    tmp_.append(k.data(), k.size());
+    iter_ = SkipListAccessor::Skipper(SkipListAccessor(table_));
+    iter_.to(Slice(tmp_));
+  }
   void SeekToFirst() override {
     auto first = iter_.accessor().first();
     if (first != nullptr) {
@@ -160,7 +178,7 @@ public:
     iter_.operator++();
   }
   void Prev() override {
-    std::cout << "not support" << std::endl;
+    SPDLOG_WARN("memtable iterator does not support Prev");
   }
 
   // memtable key
@@ -176,6 +194,7 @@ public:
   Status status() const override { return Status::OK(); }
 
 private:
+  SkipListType* table_;
   MemTable::SkipList::Skipper iter_;
   std::string tmp_;
 };
@@ -6,8 +6,10 @@
 #define YEDIS_MEMTABLE_H
 
 #include <atomic>
+#include <vector>
 #include <folly/ConcurrentSkipList.h>
 #include <folly/memory/Malloc.h>
+#include <spdlog/spdlog.h>
 
 #include "common/status.h"
 #include "db_format.h"
@@ -27,7 +29,13 @@ class MemTable {
 
     void Add(SequenceNumber seq, ValueType type, const Slice& key,
              const Slice& value);
-    bool Get(const LookupKey& key, std::string* value, Status* s);
+    // Returns true if the memtable holds a value or a deletion for key,
+    // newer merge operands are appended to *merge_operands (newest first).
+    // Returns false with the operands collected so far if the memtable
+    // holds only merge operands for key, or nothing.  A merge operand
+    // with merge_operands == nullptr is a NotSupported error.
+    bool Get(const LookupKey& key, std::string* value, Status* s,
+             std::vector<std::string>* merge_operands = nullptr);
 
     Slice EncodeEntry(SequenceNumber seq, ValueType type, const Slice& key, const Slice& value);
 
@@ -35,15 +43,15 @@ class MemTable {
     size_t ApproximateMemoryUsage() { return alloc_.size(); }
 
     void Ref() {
-      refs_++;
-      std::cout << "Ref memtable " << id_ << std::endl;
+      refs_.fetch_add(1, std::memory_order_relaxed);
+      SPDLOG_TRACE("Ref memtable {}", id_);
     }
 
     void Unref() {
-      refs_--;
-      std::cout << "Unref: release memtable: " << id_ << ", refs: " << refs_ << std::endl;
-      if (refs_ == 0) {
-        std::cout << "Unref: release memtable: " << id_ << std::endl;
+      const int refs = refs_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+      SPDLOG_TRACE("Unref memtable {}, refs: {}", id_, refs);
+      if (refs == 0) {
+        SPDLOG_DEBUG("release memtable {}", id_);
         delete this;
       }
     }
@@ -64,7 +72,7 @@ class MemTable {
     std::unique_ptr<SkipListType> table_;
 
     Allocator alloc_;
-    int refs_;
+    std::atomic<int> refs_;
 
 
   };
@@ -0,0 +1,101 @@
+//
+// Folds merge operands for reads and compactions.
+//
+
+#include "merge_helper.h"
+#include "comparator.h"
+#include "compaction_filter.h"
+#include "iterator.h"
+#include "merge_operator.h"
+
+namespace yedis {
+
+Status MergeHelper::FullMerge(const MergeOperator* merge_operator, const Slice& key,
+                              const Slice* existing_value, const std::vector<std::string>& operands,
+                              std::string* result) {
+  if (merge_operator == nullptr) {
+    return Status::NotSupported("merge operand without a merge_operator");
+  }
+  std::vector<Slice> oldest_first(operands.rbegin(), operands.rend());
+  if (!merge_operator->FullMerge(key, existing_value, oldest_first, result)) {
+    return Status::Corruption("merge failed", merge_operator->Name());
+  }
+  return Status::OK();
+}
+
+Status MergeHelper::MergeUntil(Iterator* iter, bool at_base_level) {
+  output_.clear();
+  ParsedInternalKey ikey;
+  if (!ParseInternalKey(iter->key(), &ikey) || ikey.type != ValueType::kTypeMerge) {
+    return Status::Corruption("merge helper not positioned at a merge operand");
+  }
+  const std::string user_key = ikey.user_key.ToString();
+  const SequenceNumber sequence = ikey.sequence;
+
+  // newest first, like the iterator returns them
+  std::vector<std::string> keys;
+  std::vector<std::string> operands;
+  std::string base_value;
+  bool has_base = false;
+  bool has_base_value = false;
+  for (; iter->Valid(); iter->Next()) {
+    if (!ParseInternalKey(iter->key(), &ikey)
+        || user_comparator_->Compare(ikey.user_key, user_key) != 0) {
+      // corrupted keys are left to the caller
+      break;
+    }
+    if (ikey.type == ValueType::kTypeMerge) {
+      keys.push_back(iter->key().ToString());
+      operands.push_back(iter->value().ToString());
+      continue;
+    }
+    has_base = true;
+    if (ikey.type == ValueType::kTypeValue
+        && (filter_ == nullptr || !filter_->Filter(ikey.user_key, iter->value()))) {
+      has_base_value = true;
+      base_value = iter->value().ToString();
+    }
+    iter->Next();
+    break;
+  }
+  Status s = iter->status();
+  if (!s.ok()) {
+    return s;
+  }
+
+  if (has_base || at_base_level) {
+    std::string merged;
+    Slice existing(base_value);
+    s = FullMerge(merge_operator_, user_key, has_base_value ? &existing : nullptr, operands, &merged);
+    if (!s.ok()) {
+      return s;
+    }
+    std::string key;
+    if (filter_ != nullptr && filter_->Filter(user_key, merged)) {
+      if (!at_base_level) {
+        AppendInternalKey(&key, ParsedInternalKey(user_key, sequence, ValueType::kTypeDeletion));
+        output_.emplace_back(std::move(key), std::string());
+      }
+    } else {
+      AppendInternalKey(&key, ParsedInternalKey(user_key, sequence, ValueType::kTypeValue));
+      output_.emplace_back(std::move(key), std::move(merged));
+    }
+    return s;
+  }
+
+  // the value below the operands lives further down, they stay operands
+  if (operands.size() > 1 && merge_operator_ != nullptr) {
+    std::vector<Slice> oldest_first(operands.rbegin(), operands.rend());
+    std::string combined;
+    if (merge_operator_->PartialMerge(user_key, oldest_first, &combined)) {
+      output_.emplace_back(keys.front(), std::move(combined));
+      return s;
+    }
+  }
+  for (size_t i = 0; i < keys.size(); i++) {
+    output_.emplace_back(std::move(keys[i]), std::move(operands[i]));
+  }
+  return s;
+}
+
+}
@@ -0,0 +1,60 @@
+//
+// Folds merge operands for reads and compactions.
+//
+
+#ifndef YEDIS_MERGE_HELPER_H
+#define YEDIS_MERGE_HELPER_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/status.h"
+#include "db_format.h"
+
+namespace yedis {
+
+class Comparator;
+class CompactionFilter;
+class Iterator;
+class MergeOperator;
+
+class MergeHelper {
+public:
+  MergeHelper(const Comparator* user_comparator, const MergeOperator* merge_operator,
+              const CompactionFilter* filter)
+    : user_comparator_(user_comparator),
+      merge_operator_(merge_operator),
+      filter_(filter) {}
+
+  // Store in "*result" the value of "key" after applying "operands"
+  // (newest first) to "existing_value", nullptr if the key has no value.
+  static Status FullMerge(const MergeOperator* merge_operator, const Slice& key,
+                          const Slice* existing_value, const std::vector<std::string>& operands,
+                          std::string* result);
+
+  // Fold the merge operand "iter" is positioned at with the older entries
+  // of the same user key, up to and including the first value or deletion.
+  // "iter" is left at the first entry not folded.  Without a value below
+  // the operands, they are only combined into a full value if nothing of
+  // the key exists below the output, "at_base_level".
+  //
+  // REQUIRES: iter is positioned at a merge operand and every entry of
+  // the key at or after it is older than any snapshot.
+  Status MergeUntil(Iterator* iter, bool at_base_level);
+
+  // Entries to write in place of the folded ones, newest first, as
+  // internal key / value pairs.  Empty if the result was filtered at the
+  // base level.
+  const std::vector<std::pair<std::string, std::string>>& output() const { return output_; }
+
+private:
+  const Comparator* user_comparator_;
+  const MergeOperator* merge_operator_;
+  const CompactionFilter* filter_;
+  std::vector<std::pair<std::string, std::string>> output_;
+};
+
+}
+
+#endif //YEDIS_MERGE_HELPER_H
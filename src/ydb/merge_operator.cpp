@@ -0,0 +1,63 @@
+//
+// Read-modify-write operators applied by reads and compactions.
+//
+
+#include "merge_operator.h"
+#include "slice.h"
+#include "util.hpp"
+
+namespace yedis {
+
+MergeOperator::~MergeOperator() = default;
+
+bool MergeOperator::PartialMerge(const Slice& key, const std::vector<Slice>& operands,
+                                 std::string* new_value) const {
+  return false;
+}
+
+class Int64AddOperator: public MergeOperator {
+public:
+  const char* Name() const override { return "yedis.Int64AddOperator"; }
+
+  bool FullMerge(const Slice& key, const Slice* existing_value,
+                 const std::vector<Slice>& operands,
+                 std::string* new_value) const override {
+    int64_t sum = 0;
+    if (existing_value != nullptr && !Add(*existing_value, &sum)) {
+      return false;
+    }
+    for (const auto& operand: operands) {
+      if (!Add(operand, &sum)) {
+        return false;
+      }
+    }
+    Encode(sum, new_value);
+    return true;
+  }
+
+  bool PartialMerge(const Slice& key, const std::vector<Slice>& operands,
+                    std::string* new_value) const override {
+    return FullMerge(key, nullptr, operands, new_value);
+  }
+
+private:
+  static bool Add(const Slice& operand, int64_t* sum) {
+    if (operand.size() != sizeof(uint64_t)) {
+      return false;
+    }
+    *sum += static_cast<int64_t>(DecodeFixed64(operand.data()));
+    return true;
+  }
+
+  static void Encode(int64_t sum, std::string* value) {
+    char buf[sizeof(uint64_t)];
+    EncodeFixed64(buf, static_cast<uint64_t>(sum));
+    value->assign(buf, sizeof(buf));
+  }
+};
+
+const MergeOperator* NewInt64AddOperator() {
+  return new Int64AddOperator();
+}
+
+}
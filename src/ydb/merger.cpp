@@ -0,0 +1,168 @@
+//
+// Merging iterator over several sorted children.
+//
+
+#include <vector>
+
+#include "merger.h"
+#include "comparator.h"
+#include "iterator.h"
+
+namespace yedis {
+
+namespace {
+
+class MergingIterator: public Iterator {
+public:
+  MergingIterator(const Comparator* comparator, Iterator** children, int n)
+    : comparator_(comparator),
+      children_(children, children + n),
+      current_(nullptr),
+      direction_(kForward) {}
+
+  ~MergingIterator() override {
+    for (auto child: children_) {
+      delete child;
+    }
+  }
+
+  bool Valid() const override { return current_ != nullptr; }
+
+  void SeekToFirst() override {
+    for (auto child: children_) {
+      child->SeekToFirst();
+    }
+    FindSmallest();
+    direction_ = kForward;
+  }
+
+  void SeekToLast() override {
+    for (auto child: children_) {
+      child->SeekToLast();
+    }
+    FindLargest();
+    direction_ = kReverse;
+  }
+
+  void Seek(const Slice& target) override {
+    for (auto child: children_) {
+      child->Seek(target);
+    }
+    FindSmallest();
+    direction_ = kForward;
+  }
+
+  void Next() override {
+    assert(Valid());
+
+    // Ensure that all children are positioned after key().
+    // If we are moving in the forward direction, it is already
+    // true for all of the non-current_ children since current_ is
+    // the smallest child and key() == current_->key().  Otherwise,
+    // we explicitly position the non-current_ children.
+    if (direction_ != kForward) {
+      for (auto child: children_) {
+        if (child != current_) {
+          child->Seek(key());
+          if (child->Valid() && comparator_->Compare(key(), child->key()) == 0) {
+            child->Next();
+          }
+        }
+      }
+      direction_ = kForward;
+    }
+
+    current_->Next();
+    FindSmallest();
+  }
+
+  void Prev() override {
+    assert(Valid());
+
+    // Ensure that all children are positioned before key().
+    if (direction_ != kReverse) {
+      for (auto child: children_) {
+        if (child != current_) {
+          child->Seek(key());
+          if (child->Valid()) {
+            // Child is at first entry >= key().  Step back one to be < key()
+            child->Prev();
+          } else {
+            // Child has no entries >= key().  Position at last entry.
+            child->SeekToLast();
+          }
+        }
+      }
+      direction_ = kReverse;
+    }
+
+    current_->Prev();
+    FindLargest();
+  }
+
+  Slice key() const override {
+    assert(Valid());
+    return current_->key();
+  }
+
+  Slice value() const override {
+    assert(Valid());
+    return current_->value();
+  }
+
+  Status status() const override {
+    for (auto child: children_) {
+      Status s = child->status();
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    return Status::OK();
+  }
+
+private:
+  enum Direction { kForward, kReverse };
+
+  void FindSmallest() {
+    Iterator* smallest = nullptr;
+    for (auto child: children_) {
+      if (child->Valid()) {
+        if (smallest == nullptr || comparator_->Compare(child->key(), smallest->key()) < 0) {
+          smallest = child;
+        }
+      }
+    }
+    current_ = smallest;
+  }
+
+  void FindLargest() {
+    Iterator* largest = nullptr;
+    for (auto it = children_.rbegin(); it != children_.rend(); ++it) {
+      Iterator* child = *it;
+      if (child->Valid()) {
+        if (largest == nullptr || comparator_->Compare(child->key(), largest->key()) > 0) {
+          largest = child;
+        }
+      }
+    }
+    current_ = largest;
+  }
+
+  const Comparator* comparator_;
+  std::vector<Iterator*> children_;
+  Iterator* current_;
+  Direction direction_;
+};
+}
+
+Iterator* NewMergingIterator(const Comparator* comparator, Iterator** children, int n) {
+  assert(n >= 0);
+  if (n == 0) {
+    return NewEmptyIterator();
+  } else if (n == 1) {
+    return children[0];
+  }
+  return new MergingIterator(comparator, children, n);
+}
+
+}
@@ -0,0 +1,66 @@
+//
+// Per-thread request profiling.
+//
+
+#include <cstring>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "perf_context.h"
+
+namespace yedis {
+
+namespace perf {
+
+thread_local PerfLevel perf_level = PerfLevel::kDisable;
+thread_local PerfContext perf_context = {};
+
+}
+
+void SetPerfLevel(PerfLevel level) {
+  perf::perf_level = level;
+}
+
+PerfLevel GetPerfLevel() {
+  return perf::perf_level;
+}
+
+PerfContext* get_perf_context() {
+  return &perf::perf_context;
+}
+
+void PerfContext::Reset() {
+  std::memset(this, 0, sizeof(*this));
+}
+
+std::string PerfContext::ToString(bool exclude_zero_counters) const {
+  static constexpr const char* kFormat = "{} = {}, ";
+  const std::pair<const char*, uint64_t> counters[] = {
+    {"get_from_memtable_count", get_from_memtable_count},
+    {"get_from_memtable_time", get_from_memtable_time},
+    {"get_from_table_count", get_from_table_count},
+    {"get_from_table_time", get_from_table_time},
+    {"block_read_count", block_read_count},
+    {"block_read_byte", block_read_byte},
+    {"block_read_time", block_read_time},
+    {"block_cache_hit_count", block_cache_hit_count},
+    {"bloom_filter_checked", bloom_filter_checked},
+    {"bloom_filter_useful", bloom_filter_useful},
+    {"get_read_bytes", get_read_bytes},
+    {"db_mutex_lock_time", db_mutex_lock_time},
+    {"write_thread_wait_time", write_thread_wait_time},
+  };
+  std::string result;
+  for (const auto& [name, value]: counters) {
+    if (!exclude_zero_counters || value != 0) {
+      result.append(fmt::format(kFormat, name, value));
+    }
+  }
+  if (!result.empty()) {
+    // the trailing ", "
+    result.resize(result.size() - 2);
+  }
+  return result;
+}
+
+}
@@ -0,0 +1,191 @@
+//
+// Token bucket rate limiter, modeled after RocksDB's GenericRateLimiter.
+//
+
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+
+#include "rate_limiter.h"
+
+namespace yedis {
+
+namespace {
+
+class GenericRateLimiter: public RateLimiter {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  GenericRateLimiter(int64_t rate_bytes_per_sec, int64_t refill_period_us, bool auto_tuned,
+                     uint64_t target_read_latency_us)
+    : refill_period_(std::chrono::microseconds(refill_period_us)),
+      auto_tuned_(auto_tuned),
+      target_read_latency_us_(target_read_latency_us),
+      max_bytes_per_sec_(rate_bytes_per_sec),
+      available_bytes_(0),
+      next_refill_(Clock::now()),
+      refills_since_tune_(0),
+      total_bytes_through_{0, 0},
+      latency_sum_(0),
+      latency_count_(0) {
+    SetBytesPerSecondLocked(rate_bytes_per_sec);
+  }
+
+  void SetBytesPerSecond(int64_t bytes_per_second) override {
+    assert(bytes_per_second > 0);
+    std::lock_guard<std::mutex> lk(mu_);
+    // with auto tuning this is the upper bound, tuning starts from there
+    max_bytes_per_sec_ = bytes_per_second;
+    SetBytesPerSecondLocked(bytes_per_second);
+  }
+
+  int64_t GetBytesPerSecond() const override {
+    std::lock_guard<std::mutex> lk(mu_);
+    return rate_bytes_per_sec_;
+  }
+
+  int64_t GetSingleBurstBytes() const override {
+    std::lock_guard<std::mutex> lk(mu_);
+    return refill_bytes_per_period_;
+  }
+
+  int64_t GetTotalBytesThrough(Priority pri) const override {
+    std::lock_guard<std::mutex> lk(mu_);
+    return total_bytes_through_[pri];
+  }
+
+  void Request(int64_t bytes, Priority pri) override {
+    std::unique_lock<std::mutex> lk(mu_);
+    bytes = std::min(bytes, refill_bytes_per_period_);
+    Req r{bytes, false};
+    queue_[pri].push_back(&r);
+    while (true) {
+      auto now = Clock::now();
+      if (now >= next_refill_) {
+        Refill(now);
+      }
+      Grant();
+      if (r.granted) {
+        break;
+      }
+      cv_.wait_until(lk, next_refill_);
+    }
+    total_bytes_through_[pri] += r.bytes;
+  }
+
+  void RecordReadLatency(uint64_t micros) override {
+    if (!auto_tuned_) {
+      return;
+    }
+    latency_sum_.fetch_add(micros, std::memory_order_relaxed);
+    latency_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+private:
+  struct Req {
+    int64_t bytes;
+    bool granted;
+  };
+
+  // low priority requests go first once every kFairness grants, so a
+  // steady flow of flushes cannot starve compactions completely
+  static constexpr int kFairness = 10;
+  // tune once per second with the default refill period
+  static constexpr int kRefillsPerTune = 10;
+
+  void SetBytesPerSecondLocked(int64_t bytes_per_second) {
+    rate_bytes_per_sec_ = bytes_per_second;
+    refill_bytes_per_period_ = std::max<int64_t>(
+        1, bytes_per_second * std::chrono::duration_cast<std::chrono::microseconds>(refill_period_).count() / 1000000);
+  }
+
+  // mu_ held
+  void Refill(Clock::time_point now) {
+    next_refill_ = now + refill_period_;
+    if (auto_tuned_ && ++refills_since_tune_ >= kRefillsPerTune) {
+      refills_since_tune_ = 0;
+      Tune();
+    }
+    // unused tokens do not accumulate beyond one period
+    if (available_bytes_ < refill_bytes_per_period_) {
+      available_bytes_ = refill_bytes_per_period_;
+    }
+  }
+
+  // mu_ held
+  void Grant() {
+    bool granted = false;
+    bool low_first = rnd_() % kFairness == 0;
+    for (int i = 0; i < kNumPriorities; i++) {
+      int pri = low_first ? i : kNumPriorities - 1 - i;
+      auto& queue = queue_[pri];
+      while (!queue.empty()) {
+        // the burst size may have shrunk since the request was queued
+        queue.front()->bytes = std::min(queue.front()->bytes, refill_bytes_per_period_);
+        if (queue.front()->bytes > available_bytes_) {
+          break;
+        }
+        available_bytes_ -= queue.front()->bytes;
+        queue.front()->granted = true;
+        queue.pop_front();
+        granted = true;
+      }
+      if (!queue.empty()) {
+        // keep the order, lower priorities wait for the next refill
+        break;
+      }
+    }
+    if (granted) {
+      cv_.notify_all();
+    }
+  }
+
+  // mu_ held
+  void Tune() {
+    uint64_t count = latency_count_.exchange(0, std::memory_order_relaxed);
+    uint64_t sum = latency_sum_.exchange(0, std::memory_order_relaxed);
+    int64_t rate = rate_bytes_per_sec_;
+    if (count > 0 && sum / count > target_read_latency_us_) {
+      // foreground reads suffer, back off quickly
+      rate = rate * 4 / 5;
+    } else {
+      rate = rate + std::max<int64_t>(1, rate / 20);
+    }
+    rate = std::max(rate, std::max<int64_t>(1, max_bytes_per_sec_ / 20));
+    rate = std::min(rate, max_bytes_per_sec_);
+    SetBytesPerSecondLocked(rate);
+  }
+
+  mutable std::mutex mu_;
+  std::condition_variable cv_;
+  const Clock::duration refill_period_;
+  const bool auto_tuned_;
+  const uint64_t target_read_latency_us_;
+
+  int64_t max_bytes_per_sec_;
+  int64_t rate_bytes_per_sec_;
+  int64_t refill_bytes_per_period_;
+  int64_t available_bytes_;
+  Clock::time_point next_refill_;
+  int refills_since_tune_;
+  std::deque<Req*> queue_[kNumPriorities];
+  int64_t total_bytes_through_[kNumPriorities];
+  std::minstd_rand rnd_;
+
+  std::atomic<uint64_t> latency_sum_;
+  std::atomic<uint64_t> latency_count_;
+};
+}
+
+RateLimiter* NewGenericRateLimiter(int64_t rate_bytes_per_sec, int64_t refill_period_us, bool auto_tuned,
+                                   uint64_t target_read_latency_us) {
+  assert(rate_bytes_per_sec > 0);
+  assert(refill_period_us > 0);
+  return new GenericRateLimiter(rate_bytes_per_sec, refill_period_us, auto_tuned, target_read_latency_us);
+}
+
+}
@@ -0,0 +1,215 @@
+//
+// Standard Ribbon filter, see "Ribbon filter: practically smaller than
+// Bloom and Xor" (Dillinger, Walzer).
+//
+
+#include <vector>
+
+#include "filter_policy.h"
+#include "util.hpp"
+#include "common/status.h"
+
+namespace yedis {
+
+namespace {
+
+// murmur3 finalizer
+inline uint64_t Mix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+inline uint64_t RibbonHash(const Slice& key, bool hash64) {
+  if (hash64) {
+    return Hash64(key.data(), key.size(), 0xbc9f1d34);
+  }
+  return (static_cast<uint64_t>(Hash(key.data(), key.size(), 0xbc9f1d34)) << 32) |
+         Hash(key.data(), key.size(), 0x9ae16a3b);
+}
+
+// Every key is mapped to a 64-bit coefficient row starting at slot "start"
+// and an r-bit fingerprint.  The filter stores a solution S of the linear
+// system over GF(2) so that for each key, and each result bit j,
+//   parity(S_j[start, start + 64) & coeff) == fingerprint bit j.
+//
+// Filter layout:
+//    solution   : uint64[num_blocks * r], block major, one word per result
+//                 bit per 64 slots so a query touches two adjacent blocks
+//    r          : uint8, 0 means the filter matches everything, the top
+//                 bit is set if keys were hashed with Hash64 (format 2)
+//    seed       : uint8
+class RibbonFilterPolicy: public FilterPolicy {
+public:
+  static constexpr size_t kCoeffBits = 64;
+  static constexpr int kMaxResultBits = 16;
+  static constexpr int kMaxAttempts = 32;
+  static constexpr uint8_t kHash64Flag = 0x80;
+
+  RibbonFilterPolicy(int bits_per_key, int format_version)
+      : hash64_(format_version >= 2) {
+    // a Bloom filter with b bits per key has an fp rate of about 0.6185^b,
+    // a Ribbon filter needs -log2(fp) = 0.69 * b result bits per slot
+    result_bits_ = static_cast<int>(bits_per_key * 0.69 + 0.5);
+    if (result_bits_ < 1) result_bits_ = 1;
+    if (result_bits_ > kMaxResultBits) result_bits_ = kMaxResultBits;
+  }
+
+  const char* Name() const override { return "yedis.RibbonFilter"; }
+
+  void CreateFilter(const Slice* keys, int n, std::string* dst) const override {
+    std::vector<uint64_t> hashes(n);
+    for (int i = 0; i < n; i++) {
+      hashes[i] = RibbonHash(keys[i], hash64_);
+    }
+
+    size_t slots = RoundUpSlots(n + n / 12 + kCoeffBits);
+    for (int attempt = 0; attempt < kMaxAttempts; attempt++) {
+      // banding failures get more likely the tighter the table, so grow it
+      // a little after every few seeds
+      if (attempt > 0 && attempt % 4 == 0) {
+        slots = RoundUpSlots(slots + slots / 16);
+      }
+      if (TryBuild(hashes, slots, static_cast<uint32_t>(attempt), dst)) {
+        return;
+      }
+    }
+    // give up, a filter that matches everything is still correct
+    dst->push_back(static_cast<char>(0));
+    dst->push_back(static_cast<char>(0));
+  }
+
+  bool KeyMayMatch(const Slice& key, const Slice& filter) const override {
+    const size_t len = filter.size();
+    if (len < 2) return true;
+
+    const char* data = filter.data();
+    const uint8_t r_byte = static_cast<uint8_t>(data[len - 2]);
+    const bool hash64 = (r_byte & kHash64Flag) != 0;
+    const int r = r_byte & ~kHash64Flag;
+    const uint32_t seed = static_cast<uint8_t>(data[len - 1]);
+    if (r == 0 || r > kMaxResultBits) {
+      return true;
+    }
+    const size_t words_bytes = len - 2;
+    if (words_bytes % (sizeof(uint64_t) * r) != 0) {
+      return true;
+    }
+    const size_t num_blocks = words_bytes / (sizeof(uint64_t) * r);
+    if (num_blocks == 0) {
+      // built from an empty key set
+      return false;
+    }
+
+    const size_t num_starts = num_blocks * kCoeffBits - kCoeffBits + 1;
+    uint64_t start, coeff;
+    uint32_t result;
+    Derive(RibbonHash(key, hash64), seed, num_starts, r, &start, &coeff, &result);
+
+    const size_t block = start / kCoeffBits;
+    const size_t shift = start % kCoeffBits;
+    const char* lo_base = data + block * r * sizeof(uint64_t);
+    const char* hi_base = lo_base + r * sizeof(uint64_t);
+    for (int j = 0; j < r; j++) {
+      uint64_t window = DecodeFixed64(lo_base + j * sizeof(uint64_t)) >> shift;
+      if (shift != 0) {
+        window |= DecodeFixed64(hi_base + j * sizeof(uint64_t)) << (kCoeffBits - shift);
+      }
+      if (static_cast<uint32_t>(__builtin_parityll(window & coeff)) != ((result >> j) & 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  static size_t RoundUpSlots(size_t slots) {
+    return (slots + kCoeffBits - 1) / kCoeffBits * kCoeffBits;
+  }
+
+  static void Derive(uint64_t h, uint32_t seed, size_t num_starts, int r,
+                     uint64_t* start, uint64_t* coeff, uint32_t* result) {
+    const uint64_t x = Mix64(h ^ (0x9e3779b97f4a7c15ull * (seed + 1)));
+    // map x onto [0, num_starts) without a division
+    *start = static_cast<uint64_t>((static_cast<unsigned __int128>(x) * num_starts) >> 64);
+    const uint64_t y = Mix64(x);
+    // the leading coefficient is always set, it is the pivot of the row
+    *coeff = y | 1;
+    *result = static_cast<uint32_t>(Mix64(y) >> 32) & ((1u << r) - 1);
+  }
+
+  // Gaussian elimination on the fly ("banding"), then back substitution.
+  // Returns false if the system has no solution for this seed.
+  bool TryBuild(const std::vector<uint64_t>& hashes, size_t slots, uint32_t seed,
+                std::string* dst) const {
+    const int r = result_bits_;
+    const size_t num_starts = slots - kCoeffBits + 1;
+    std::vector<uint64_t> coeff_rows(slots, 0);
+    std::vector<uint16_t> result_rows(slots, 0);
+
+    for (uint64_t h: hashes) {
+      uint64_t start, c;
+      uint32_t res;
+      Derive(h, seed, num_starts, r, &start, &c, &res);
+      size_t i = start;
+      while (true) {
+        if (coeff_rows[i] == 0) {
+          coeff_rows[i] = c;
+          result_rows[i] = static_cast<uint16_t>(res);
+          break;
+        }
+        c ^= coeff_rows[i];
+        res ^= result_rows[i];
+        if (c == 0) {
+          // linearly dependent, fine as long as it is consistent (e.g. a
+          // duplicate key)
+          if (res != 0) return false;
+          break;
+        }
+        const int tz = __builtin_ctzll(c);
+        i += tz;
+        c >>= tz;
+      }
+    }
+
+    const size_t num_blocks = slots / kCoeffBits;
+    std::vector<uint64_t> solution(num_blocks * r, 0);
+    // state[j] bit k holds the solution of result bit j for slot i + k
+    std::vector<uint64_t> state(r, 0);
+    for (size_t i = slots; i-- > 0;) {
+      const uint64_t cr = coeff_rows[i];
+      const uint32_t rr = result_rows[i];
+      uint64_t* words = &solution[(i / kCoeffBits) * r];
+      for (int j = 0; j < r; j++) {
+        uint64_t st = state[j] << 1;
+        uint64_t bit = 0;
+        // free variables (empty rows) are left as zero
+        if (cr != 0) {
+          bit = ((rr >> j) & 1) ^ static_cast<uint64_t>(__builtin_parityll(st & cr));
+        }
+        state[j] = st | bit;
+        words[j] |= bit << (i % kCoeffBits);
+      }
+    }
+
+    for (uint64_t w: solution) {
+      PutFixed<uint64_t>(dst, w);
+    }
+    dst->push_back(static_cast<char>(hash64_ ? (r | kHash64Flag) : r));
+    dst->push_back(static_cast<char>(seed));
+    return true;
+  }
+
+  int result_bits_;
+  bool hash64_;
+};
+}
+
+const FilterPolicy* NewRibbonFilterPolicy(int bits_per_key, int format_version) {
+  return new RibbonFilterPolicy(bits_per_key, format_version);
+}
+
+}
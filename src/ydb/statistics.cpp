@@ -0,0 +1,250 @@
+//
+// Statistics sharded by thread.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "statistics.h"
+
+namespace yedis {
+
+namespace {
+
+const char* const kTickerNames[kTickerMax] = {
+  "ydb.bytes.written",
+  "ydb.keys.written",
+  "ydb.bytes.read",
+  "ydb.keys.read",
+  "ydb.block.cache.hit",
+  "ydb.block.cache.miss",
+  "ydb.bloom.filter.useful",
+  "ydb.memtable.hit",
+  "ydb.memtable.miss",
+  "ydb.stall.micros",
+  "ydb.wal.syncs",
+  "ydb.table.file.opens",
+};
+
+const char* const kHistogramNames[kHistogramMax] = {
+  "ydb.get.micros",
+  "ydb.put.micros",
+  "ydb.write.micros",
+  "ydb.flush.micros",
+  "ydb.compaction.micros",
+};
+
+// Upper bounds of the histogram buckets: 1, 2, then growing by 1.5x
+// rounded to two significant digits, the last one is unbounded.
+class BucketLimits {
+public:
+  BucketLimits() {
+    limits_.push_back(1);
+    limits_.push_back(2);
+    const uint64_t kMax = std::numeric_limits<uint64_t>::max();
+    while (limits_.back() < kMax / 2) {
+      uint64_t next = static_cast<uint64_t>(limits_.back() * 1.5);
+      uint64_t pow10 = 1;
+      while (next / pow10 >= 100) {
+        pow10 *= 10;
+      }
+      next = next / pow10 * pow10;
+      limits_.push_back(std::max(next, limits_.back() + 1));
+    }
+    limits_.push_back(kMax);
+  }
+
+  size_t size() const { return limits_.size(); }
+  uint64_t operator[](size_t i) const { return limits_[i]; }
+
+  size_t IndexOf(uint64_t value) const {
+    return std::lower_bound(limits_.begin(), limits_.end(), value) - limits_.begin();
+  }
+
+private:
+  std::vector<uint64_t> limits_;
+};
+
+const BucketLimits& Buckets() {
+  static const BucketLimits buckets;
+  return buckets;
+}
+
+struct HistogramShard {
+  explicit HistogramShard(size_t num_buckets): buckets(new std::atomic<uint64_t>[num_buckets]) {}
+
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> sum;
+  std::atomic<uint64_t> min;
+  std::atomic<uint64_t> max;
+  std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+};
+
+// Only its own thread writes to a shard, except when threads outnumber
+// the shards, so relaxed increments stay uncontended.
+struct alignas(64) Shard {
+  Shard() {
+    for (auto& histogram: histograms) {
+      histogram = std::make_unique<HistogramShard>(Buckets().size());
+    }
+  }
+
+  std::atomic<uint64_t> tickers[kTickerMax];
+  std::unique_ptr<HistogramShard> histograms[kHistogramMax];
+};
+
+class StatisticsImpl: public Statistics {
+public:
+  StatisticsImpl(): shards_(new Shard[kShards]) {
+    Reset();
+  }
+
+  void RecordTick(uint32_t ticker, uint64_t count) override {
+    assert(ticker < kTickerMax);
+    ThreadShard().tickers[ticker].fetch_add(count, std::memory_order_relaxed);
+  }
+
+  void MeasureTime(uint32_t histogram, uint64_t micros) override {
+    assert(histogram < kHistogramMax);
+    HistogramShard& h = *ThreadShard().histograms[histogram];
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    h.sum.fetch_add(micros, std::memory_order_relaxed);
+    h.buckets[Buckets().IndexOf(micros)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t min = h.min.load(std::memory_order_relaxed);
+    while (micros < min && !h.min.compare_exchange_weak(min, micros, std::memory_order_relaxed)) {
+    }
+    uint64_t max = h.max.load(std::memory_order_relaxed);
+    while (micros > max && !h.max.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint64_t GetTickerCount(uint32_t ticker) const override {
+    assert(ticker < kTickerMax);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < kShards; i++) {
+      sum += shards_[i].tickers[ticker].load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  void GetHistogramData(uint32_t histogram, HistogramData* data) const override {
+    assert(histogram < kHistogramMax);
+    const BucketLimits& limits = Buckets();
+    std::vector<uint64_t> buckets(limits.size(), 0);
+    data->count = 0;
+    data->sum = 0;
+    data->min = std::numeric_limits<uint64_t>::max();
+    data->max = 0;
+    for (size_t i = 0; i < kShards; i++) {
+      const HistogramShard& h = *shards_[i].histograms[histogram];
+      data->count += h.count.load(std::memory_order_relaxed);
+      data->sum += h.sum.load(std::memory_order_relaxed);
+      data->min = std::min(data->min, h.min.load(std::memory_order_relaxed));
+      data->max = std::max(data->max, h.max.load(std::memory_order_relaxed));
+      for (size_t b = 0; b < limits.size(); b++) {
+        buckets[b] += h.buckets[b].load(std::memory_order_relaxed);
+      }
+    }
+    if (data->count == 0) {
+      data->min = 0;
+    }
+    data->average = data->count == 0 ? 0 : static_cast<double>(data->sum) / data->count;
+    data->median = Percentile(*data, buckets, 50);
+    data->percentile95 = Percentile(*data, buckets, 95);
+    data->percentile99 = Percentile(*data, buckets, 99);
+  }
+
+  void Reset() override {
+    for (size_t i = 0; i < kShards; i++) {
+      Shard& shard = shards_[i];
+      for (auto& ticker: shard.tickers) {
+        ticker.store(0, std::memory_order_relaxed);
+      }
+      for (auto& h: shard.histograms) {
+        h->count.store(0, std::memory_order_relaxed);
+        h->sum.store(0, std::memory_order_relaxed);
+        h->min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+        h->max.store(0, std::memory_order_relaxed);
+        for (size_t b = 0; b < Buckets().size(); b++) {
+          h->buckets[b].store(0, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+
+  std::string ToString() const override {
+    static constexpr const char* kTickerFormat = "{} COUNT : {}\n";
+    static constexpr const char* kHistogramFormat =
+        "{} P50 : {:.2f} P95 : {:.2f} P99 : {:.2f} MAX : {} COUNT : {} SUM : {}\n";
+    std::string result;
+    for (uint32_t i = 0; i < kTickerMax; i++) {
+      result.append(fmt::format(kTickerFormat, kTickerNames[i], GetTickerCount(i)));
+    }
+    for (uint32_t i = 0; i < kHistogramMax; i++) {
+      HistogramData data;
+      GetHistogramData(i, &data);
+      result.append(fmt::format(kHistogramFormat, kHistogramNames[i], data.median, data.percentile95,
+                                data.percentile99, data.max, data.count, data.sum));
+    }
+    return result;
+  }
+
+private:
+  static constexpr size_t kShards = 16;
+
+  Shard& ThreadShard() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shards_[shard];
+  }
+
+  // Interpolates linearly inside the bucket the percentile falls in.
+  static double Percentile(const HistogramData& data, const std::vector<uint64_t>& buckets, double p) {
+    if (data.count == 0) {
+      return 0;
+    }
+    const BucketLimits& limits = Buckets();
+    const double threshold = data.count * (p / 100.0);
+    uint64_t cumulative = 0;
+    for (size_t b = 0; b < buckets.size(); b++) {
+      cumulative += buckets[b];
+      if (buckets[b] > 0 && cumulative >= threshold) {
+        const double left = b == 0 ? 0 : static_cast<double>(limits[b - 1]);
+        const double right = static_cast<double>(limits[b]);
+        const double pos = (threshold - (cumulative - buckets[b])) / buckets[b];
+        double r = left + (right - left) * pos;
+        r = std::max(r, static_cast<double>(data.min));
+        r = std::min(r, static_cast<double>(data.max));
+        return r;
+      }
+    }
+    return static_cast<double>(data.max);
+  }
+
+  const std::unique_ptr<Shard[]> shards_;
+};
+
+}
+
+const char* TickerName(uint32_t ticker) {
+  assert(ticker < kTickerMax);
+  return kTickerNames[ticker];
+}
+
+const char* HistogramName(uint32_t histogram) {
+  assert(histogram < kHistogramMax);
+  return kHistogramNames[histogram];
+}
+
+Statistics* CreateDBStatistics() {
+  return new StatisticsImpl();
+}
+
+}
@@ -13,14 +13,19 @@
 #include "cache.h"
 #include "util.hpp"
 #include "iterator.h"
+#include "filter_policy.h"
+#include "statistics.h"
+#include "perf_context.h"
 
 
 namespace yedis {
 
 struct Table::Rep {
   ~Rep() {
-//    delete filter;
+    delete filter;
+    delete full_filter;
     delete[] filter_data;
+    delete filter_index;
     delete index_block;
   }
 
@@ -29,12 +34,30 @@ struct Table::Rep {
   FileHandle* file;
   uint64_t cache_id;
   FilterBlockReader* filter;
+  // whole-table filter, filter_data backs either this or filter
+  FullFilterBlockReader* full_filter;
   const char* filter_data;
+  // top-level index over the filter partitions, only set for partitioned filters
+  Block* filter_index;
 
+  IndexType index_type;
   BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
+  // top-level index over the index partitions when index_type is kTwoLevelIndexSearch
   Block* index_block;
 };
 
+// A filter partition kept in the block cache.
+struct FilterPartition {
+  explicit FilterPartition(const BlockContents& c): contents(c) {}
+  ~FilterPartition() {
+    if (contents.heap_allocated) {
+      delete[] contents.data.data();
+    }
+  }
+
+  BlockContents contents;
+};
+
 Status Table::Open(const Options &options, FileHandle *file, Table **table) {
   Status s;
   uint64_t size = file->FileSize();
@@ -64,6 +87,10 @@ Status Table::Open(const Options &options, FileHandle *file, Table **table) {
     rep->metaindex_handle = footer.metaindex_handle();
     rep->index_block = index_block;
     rep->filter_data = nullptr;
+    rep->filter = nullptr;
+    rep->full_filter = nullptr;
+    rep->filter_index = nullptr;
+    rep->index_type = kBinarySearch;
     rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
     *table = new Table(rep);
     (*table)->ReadMeta(footer);
@@ -76,10 +103,6 @@ Table::~Table() {
 }
 
 void Table::ReadMeta(const Footer &footer) {
-  if (rep_->options.filter_policy == nullptr) {
-    return;
-  }
-
   ReadOptions opt;
   if (rep_->options.paranoid_checks) {
     opt.verify_checksums = true;
@@ -92,18 +115,40 @@ void Table::ReadMeta(const Footer &footer) {
 
   Block* meta = new Block(contents);
   Iterator* iter = meta->NewIterator(BytewiseComparator());
-  std::string key = "filter.";
-  key.append(rep_->options.comparator->Name());
-  iter->Seek(key);
-  if (iter->Valid() && iter->key() == Slice(key)) {
-    ReadFilter(iter->value());
+  iter->Seek(kIndexTypeKey);
+  if (iter->Valid() && iter->key() == Slice(kIndexTypeKey) && iter->value().size() == 1) {
+    rep_->index_type = static_cast<IndexType>(iter->value()[0]);
+  }
+
+  const FilterPolicy* policy = rep_->options.filter_policy;
+  if (policy != nullptr) {
+    std::string key = kFilterPrefix;
+    key.append(policy->Name());
+    iter->Seek(key);
+    if (iter->Valid() && iter->key() == Slice(key)) {
+      ReadFilter(iter->value(), false);
+    } else {
+      key = kFullFilterPrefix;
+      key.append(policy->Name());
+      iter->Seek(key);
+      if (iter->Valid() && iter->key() == Slice(key)) {
+        ReadFilter(iter->value(), true);
+      } else {
+        key = kPartitionedFilterPrefix;
+        key.append(policy->Name());
+        iter->Seek(key);
+        if (iter->Valid() && iter->key() == Slice(key)) {
+          ReadFilterIndex(iter->value());
+        }
+      }
+    }
   }
 
   delete iter;
   delete meta;
 }
 
-void Table::ReadFilter(const Slice &filter_handle_value) {
+void Table::ReadFilter(const Slice &filter_handle_value, bool full) {
   Slice v = filter_handle_value;
   BlockHandle filter_handle;
   if (!filter_handle.DecodeFrom(&v).ok()) {
@@ -124,11 +169,108 @@ void Table::ReadFilter(const Slice &filter_handle_value) {
     rep_->filter_data = block_contents.data.data();
   }
 
-  rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block_contents.data);
+  if (full) {
+    rep_->full_filter = new FullFilterBlockReader(rep_->options.filter_policy, block_contents.data);
+  } else {
+    rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block_contents.data);
+  }
+}
+
+// Only the top-level filter index is kept in memory, the partitions are
+// loaded through the block cache on lookup.
+void Table::ReadFilterIndex(const Slice &filter_index_handle_value) {
+  Slice v = filter_index_handle_value;
+  BlockHandle filter_index_handle;
+  if (!filter_index_handle.DecodeFrom(&v).ok()) {
+    return;
+  }
+
+  ReadOptions opt;
+  if (rep_->options.paranoid_checks) {
+    opt.verify_checksums = true;
+  }
+
+  BlockContents block_contents;
+  if (!ReadBlock(rep_->file, opt, filter_index_handle, &block_contents).ok()) {
+    return;
+  }
+  rep_->filter_index = new Block(block_contents);
+}
+
+static void DeleteCachedFilterPartition(const Slice& key, void* value) {
+  delete reinterpret_cast<FilterPartition*>(value);
+}
+
+// ReadBlock for blocks of lookups, counted in the perf context.
+static Status ReadLookupBlock(FileHandle* file, const ReadOptions& options, const BlockHandle& handle,
+                              BlockContents* contents) {
+  perf::Timer timer(&PerfContext::block_read_time);
+  Status s = ReadBlock(file, options, handle, contents);
+  if (s.ok()) {
+    perf::Count(&PerfContext::block_read_count);
+    perf::Count(&PerfContext::block_read_byte, contents->data.size());
+  }
+  return s;
+}
+
+bool Table::PartitionedFilterMayMatch(const ReadOptions& options, const Slice& key) {
+  Iterator* iter = rep_->filter_index->NewIterator(rep_->options.comparator);
+  iter->Seek(key);
+  if (!iter->Valid()) {
+    // key is past the last partition, so it is not in this table
+    bool may_match = !iter->status().ok();
+    delete iter;
+    return may_match;
+  }
+
+  BlockHandle handle;
+  Slice input = iter->value();
+  Status s = handle.DecodeFrom(&input);
+  delete iter;
+  if (!s.ok()) {
+    return true;
+  }
+
+  Cache* block_cache = rep_->options.block_cache;
+  Cache::Handle* cache_handle = nullptr;
+  FilterPartition* partition = nullptr;
+  char cache_key_buffer[16];
+  EncodeFixed64(cache_key_buffer, rep_->cache_id);
+  EncodeFixed64(cache_key_buffer + 8, handle.offset());
+  Slice cache_key(cache_key_buffer, sizeof(cache_key_buffer));
+
+  if (block_cache != nullptr) {
+    cache_handle = block_cache->Lookup(cache_key);
+    if (cache_handle != nullptr) {
+      partition = reinterpret_cast<FilterPartition*>(block_cache->Value(cache_handle));
+    }
+    RecordTick(rep_->options.statistics, cache_handle != nullptr ? kBlockCacheHit : kBlockCacheMiss);
+    if (cache_handle != nullptr) {
+      perf::Count(&PerfContext::block_cache_hit_count);
+    }
+  }
+  if (partition == nullptr) {
+    BlockContents contents;
+    if (!ReadLookupBlock(rep_->file, options, handle, &contents).ok()) {
+      return true;
+    }
+    partition = new FilterPartition(contents);
+    if (block_cache != nullptr && contents.cachable && options.fill_cache) {
+      cache_handle = block_cache->Insert(cache_key, partition, contents.data.size(),
+                                         &DeleteCachedFilterPartition);
+    }
+  }
+
+  bool may_match = FullFilterBlockReader(rep_->options.filter_policy, partition->contents.data).KeyMayMatch(key);
+  if (cache_handle != nullptr) {
+    block_cache->Release(cache_handle);
+  } else {
+    delete partition;
+  }
+  return may_match;
 }
 
 static void DeleteBlock(void *arg, void* ignored) {
-  spdlog::info("deleteblock");
   delete reinterpret_cast<Block*>(arg);
 }
 
@@ -160,10 +302,12 @@ Iterator *Table::BlockReader(void *arg, const ReadOptions &option, const Slice &
       EncodeFixed64(cache_key_buffer + 8, handle.offset());
       Slice key(cache_key_buffer, sizeof(cache_key_buffer));
       cache_handle = block_cache->Lookup(key);
+      RecordTick(table->rep_->options.statistics, cache_handle != nullptr ? kBlockCacheHit : kBlockCacheMiss);
       if (cache_handle != nullptr) {
+        perf::Count(&PerfContext::block_cache_hit_count);
         block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
       } else {
-        s = ReadBlock(table->rep_->file, option, handle, &contents);
+        s = ReadLookupBlock(table->rep_->file, option, handle, &contents);
         if (s.ok()) {
           block = new Block(contents);
           if (contents.cachable && option.fill_cache) {
@@ -173,7 +317,7 @@ Iterator *Table::BlockReader(void *arg, const ReadOptions &option, const Slice &
       }
 
     } else {
-      s = ReadBlock(table->rep_->file, option, handle, &contents);
+      s = ReadLookupBlock(table->rep_->file, option, handle, &contents);
       if (s.ok()) {
         block = new Block(contents);
       }
@@ -196,25 +340,47 @@ Iterator *Table::BlockReader(void *arg, const ReadOptions &option, const Slice &
 }
 
 Status Table::InternalGet(const ReadOptions& options, const Slice &key, void *arg,
-                          void (*handle_result)(void *, const Slice &, const Slice &)) {
+                          bool (*handle_result)(void *, const Slice &, const Slice &)) {
   Status s;
-  Iterator* index_iter = rep_->index_block->NewIterator(rep_->options.comparator);
-  index_iter->Seek(key);
-  if (index_iter->Valid()) {
+  // a whole-table filter rejects the key before the index is searched
+  if (rep_->full_filter != nullptr || rep_->filter_index != nullptr) {
+    perf::Count(&PerfContext::bloom_filter_checked);
+  }
+  if (rep_->full_filter != nullptr && !rep_->full_filter->KeyMayMatch(key)) {
+    RecordTick(rep_->options.statistics, kBloomFilterUseful);
+    perf::Count(&PerfContext::bloom_filter_useful);
+    return s;
+  }
+  if (rep_->filter_index != nullptr && !PartitionedFilterMayMatch(options, key)) {
+    RecordTick(rep_->options.statistics, kBloomFilterUseful);
+    perf::Count(&PerfContext::bloom_filter_useful);
+    return s;
+  }
+  Iterator* index_iter = NewIndexIterator(options);
+  bool more = true;
+  // entries of one key may continue in the next blocks
+  for (index_iter->Seek(key); more && index_iter->Valid(); index_iter->Next()) {
     Slice handle_value = index_iter->value();
     FilterBlockReader* filter = rep_->filter;
     BlockHandle handle;
+    if (filter != nullptr) {
+      perf::Count(&PerfContext::bloom_filter_checked);
+    }
     if (filter != nullptr && handle.DecodeFrom(&handle_value).ok()
       &&!filter->KeyMayMatch(handle.offset(), key)) {
-    } else {
-      // index_block用于快速定位在哪一个block里，restarts用户在block里搜索
-      Iterator* block_iter = BlockReader(this, options, index_iter->value());
-      block_iter->Seek(key);
-      if (block_iter->Valid()) {
-        (*handle_result)(arg, block_iter->key(), block_iter->value());
-      }
-      s = block_iter->status();
-      delete block_iter;
+      RecordTick(rep_->options.statistics, kBloomFilterUseful);
+      perf::Count(&PerfContext::bloom_filter_useful);
+      break;
+    }
+    // index_block用于快速定位在哪一个block里，restarts用户在block里搜索
+    Iterator* block_iter = BlockReader(this, options, index_iter->value());
+    for (block_iter->Seek(key); more && block_iter->Valid(); block_iter->Next()) {
+      more = (*handle_result)(arg, block_iter->key(), block_iter->value());
+    }
+    s = block_iter->status();
+    delete block_iter;
+    if (!s.ok()) {
+      break;
     }
   }
   if (s.ok()) {
@@ -225,9 +391,19 @@ Status Table::InternalGet(const ReadOptions& options, const Slice &key, void *ar
 }
 
 
+Iterator* Table::NewIndexIterator(const ReadOptions &options) const {
+  Iterator* index_iter = rep_->index_block->NewIterator(rep_->options.comparator);
+  if (rep_->index_type != kTwoLevelIndexSearch) {
+    return index_iter;
+  }
+  // index partitions share the data block layout, so BlockReader loads them
+  // through the block cache as well
+  return NewTwoLevelIterator(index_iter, &Table::BlockReader, const_cast<Table*>(this), options);
+}
+
 Iterator* Table::NewIterator(const ReadOptions &options) const {
   return NewTwoLevelIterator(
-      rep_->index_block->NewIterator(rep_->options.comparator),
+      NewIndexIterator(options),
       &Table::BlockReader, const_cast<Table*>(this), options);
 }
 }
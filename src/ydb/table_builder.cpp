@@ -13,6 +13,7 @@
 #include "comparator.h"
 #include "filter_policy.h"
 
+#include <algorithm>
 #include <spdlog/spdlog.h>
 
 namespace yedis {
@@ -25,23 +26,46 @@ struct TableBuilder::Rep {
         offset(0),
         data_block(&options),
         index_block(&index_block_options),
+        top_level_index_block(&index_block_options),
+        filter_index_block(&index_block_options),
         num_entries(0),
         closed(false),
         pending_index_entry(false),
-        filter_block(nullptr) {
+        filter_block(nullptr),
+        full_filter_block(nullptr),
+        io_priority(RateLimiter::kLow) {
     index_block_options.block_restart_interval = 1;
     if (options.filter_policy != nullptr) {
-      filter_block = new FilterBlockBuilder(options.filter_policy);
+      if (partitioned_filters() || options.full_filter) {
+        full_filter_block = new FullFilterBlockBuilder(options.filter_policy);
+      } else {
+        filter_block = new FilterBlockBuilder(options.filter_policy);
+      }
     }
   }
 
+  bool partitioned_index() const {
+    return options.index_type == kTwoLevelIndexSearch;
+  }
+
+  bool partitioned_filters() const {
+    return partitioned_index() && options.partition_filters;
+  }
+
   Options options;
   Options index_block_options;
   uint64_t offset;
   Status status;
   BlockBuilder data_block;
+  // with kTwoLevelIndexSearch this is the current index partition
   BlockBuilder index_block;
+  // one entry per index partition, only used with kTwoLevelIndexSearch
+  BlockBuilder top_level_index_block;
+  // one entry per filter partition, only used with partition_filters
+  BlockBuilder filter_index_block;
   std::string last_key;
+  // last separator added to index_block
+  std::string last_index_key;
   int64_t num_entries;
   bool closed;
 
@@ -52,6 +76,9 @@ struct TableBuilder::Rep {
 
   std::string compressed_output;
   FilterBlockBuilder* filter_block;
+  // the current filter partition, or the whole-table filter with full_filter
+  FullFilterBlockBuilder* full_filter_block;
+  RateLimiter::Priority io_priority;
 };
 
 TableBuilder::TableBuilder(const yedis::Options &options, yedis::FileHandle *file): rep_(new Rep(options, file)) {
@@ -63,6 +90,7 @@ TableBuilder::TableBuilder(const yedis::Options &options, yedis::FileHandle *fil
 TableBuilder::~TableBuilder() {
   assert(rep_->closed);
   delete rep_->filter_block;
+  delete rep_->full_filter_block;
   delete rep_;
 }
 
@@ -70,15 +98,19 @@ void TableBuilder::Add(const yedis::Slice &key, const yedis::Slice &value) {
   Rep *r = rep_;
   if (r->pending_index_entry) {
     r->options.comparator->FindShortestSeparator(&r->last_key, key);
-    std::string index_value;
-    r->pending_handle.EncodeTo(&index_value);
-    r->index_block.Add(r->last_key, index_value);
+    AddIndexEntry(r->last_key);
     r->pending_index_entry = false;
+    // keys of the next data block must not leak into the finished
+    // partition's filter, so cut before adding the key below
+    MaybeCutIndexPartition(false);
   }
 
   if (r->filter_block != nullptr) {
     r->filter_block->AddKey(key);
   }
+  if (r->full_filter_block != nullptr) {
+    r->full_filter_block->AddKey(key);
+  }
 
   r->last_key.assign(key.data(), key.size());
   r->num_entries++;
@@ -106,6 +138,45 @@ void TableBuilder::Flush() {
   }
 }
 
+void TableBuilder::AddIndexEntry(const Slice& separator) {
+  Rep* r = rep_;
+  std::string index_value;
+  r->pending_handle.EncodeTo(&index_value);
+  r->index_block.Add(separator, index_value);
+  r->last_index_key.assign(separator.data(), separator.size());
+}
+
+// Cut the current index partition (and the matching filter partition) once
+// it reaches metadata_block_size, or unconditionally when force is set.
+void TableBuilder::MaybeCutIndexPartition(bool force) {
+  Rep* r = rep_;
+  if (!r->partitioned_index() || r->index_block.empty() || !r->status.ok()) {
+    return;
+  }
+  if (!force && r->index_block.CurrentSizeEstimate() < r->options.metadata_block_size) {
+    return;
+  }
+
+  std::string handle_encoding;
+  if (r->partitioned_filters() && r->full_filter_block != nullptr) {
+    BlockHandle filter_handle;
+    WriteRawBlock(r->full_filter_block->Finish(), kNoCompression, &filter_handle);
+    if (!r->status.ok()) {
+      return;
+    }
+    filter_handle.EncodeTo(&handle_encoding);
+    r->filter_index_block.Add(r->last_index_key, handle_encoding);
+  }
+
+  BlockHandle partition_handle;
+  WriteBlock(&r->index_block, &partition_handle);
+  if (r->status.ok()) {
+    handle_encoding.clear();
+    partition_handle.EncodeTo(&handle_encoding);
+    r->top_level_index_block.Add(r->last_index_key, handle_encoding);
+  }
+}
+
 void TableBuilder::WriteBlock(BlockBuilder *block, BlockHandle *handle) {
   Rep* r = rep_;
   Slice raw = block->Finish();
@@ -127,6 +198,15 @@ void TableBuilder::WriteBlock(BlockBuilder *block, BlockHandle *handle) {
 
 void TableBuilder::WriteRawBlock(const Slice &data, CompressionType cType, BlockHandle *handle) {
   Rep* r = rep_;
+  RateLimiter* limiter = r->options.rate_limiter;
+  if (limiter != nullptr) {
+    int64_t left = static_cast<int64_t>(data.size() + kBlockTrailerSize);
+    while (left > 0) {
+      int64_t bytes = std::min(left, limiter->GetSingleBurstBytes());
+      limiter->Request(bytes, r->io_priority);
+      left -= bytes;
+    }
+  }
   handle->set_offset(r->offset);
   handle->set_size(data.size());
   int64_t written = r->file->Write((void *) data.data(), data.size());
@@ -156,34 +236,54 @@ Status TableBuilder::Finish() {
   assert(!r->closed);
   r->closed = true;
 
+  // the last index entry has to be added before the last partition is cut
+  if (r->status.ok() && r->pending_index_entry) {
+    r->options.comparator->FindShortSuccessor(&r->last_key);
+    AddIndexEntry(r->last_key);
+    r->pending_index_entry = false;
+  }
+  MaybeCutIndexPartition(true);
+
   BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
 
   if (r->status.ok() && r->filter_block != nullptr) {
     WriteRawBlock(r->filter_block->Finish(), CompressionType::kNoCompression, &filter_block_handle);
   }
+  if (r->status.ok() && r->full_filter_block != nullptr) {
+    if (r->partitioned_filters()) {
+      WriteBlock(&r->filter_index_block, &filter_block_handle);
+    } else {
+      WriteRawBlock(r->full_filter_block->Finish(), CompressionType::kNoCompression, &filter_block_handle);
+    }
+  }
 
   if (r->status.ok()) {
     BlockBuilder meta_index_block(&r->options);
-    if (r->filter_block != nullptr) {
-      std::string key = "filter.";
+    // NOTE: keys of the metaindex block must be added in sorted order
+    if (r->filter_block != nullptr || r->full_filter_block != nullptr) {
+      std::string key = kFilterPrefix;
+      if (r->partitioned_filters()) {
+        key = kPartitionedFilterPrefix;
+      } else if (r->full_filter_block != nullptr) {
+        key = kFullFilterPrefix;
+      }
       key.append(r->options.filter_policy->Name());
       std::string handle_encoding;
       filter_block_handle.EncodeTo(&handle_encoding);
       meta_index_block.Add(key, handle_encoding);
     }
+    if (r->partitioned_index()) {
+      std::string index_type;
+      PutByte(&index_type, static_cast<char>(kTwoLevelIndexSearch));
+      meta_index_block.Add(kIndexTypeKey, index_type);
+    }
 
     WriteBlock(&meta_index_block, &metaindex_block_handle);
   }
 
   if (r->status.ok()) {
-    if (r->pending_index_entry) {
-      r->options.comparator->FindShortSuccessor(&r->last_key);
-      std::string handle_encoding;
-      r->pending_handle.EncodeTo(&handle_encoding);
-      r->index_block.Add(r->last_key, Slice(handle_encoding));
-      r->pending_index_entry = false;
-    }
-    WriteBlock(&r->index_block, &index_block_handle);
+    // with a partitioned index the footer points at the top-level index
+    WriteBlock(r->partitioned_index() ? &r->top_level_index_block : &r->index_block, &index_block_handle);
   }
 
   if (r->status.ok()) {
@@ -199,6 +299,11 @@ Status TableBuilder::Finish() {
   return r->status;
 }
 
+void TableBuilder::Abandon() {
+  assert(!rep_->closed);
+  rep_->closed = true;
+}
+
 uint64_t TableBuilder::NumEntries() const {
   return rep_->num_entries;
 }
@@ -207,4 +312,8 @@ uint64_t TableBuilder::FileSize() const {
   return rep_->offset;
 }
 
+void TableBuilder::SetIOPriority(RateLimiter::Priority pri) {
+  rep_->io_priority = pri;
+}
+
 }
@@ -9,6 +9,7 @@
 
 #include "common/status.h"
 #include "options.h"
+#include "rate_limiter.h"
 
 namespace yedis {
 class BlockBuilder;
@@ -37,7 +38,13 @@ public:
 
   uint64_t FileSize() const;
 
+  // Priority of this builder's writes at options.rate_limiter.
+  // Default: RateLimiter::kLow
+  void SetIOPriority(RateLimiter::Priority pri);
+
 private:
+  void AddIndexEntry(const Slice& separator);
+  void MaybeCutIndexPartition(bool force);
   void WriteBlock(BlockBuilder* block, BlockHandle* handle);
   void WriteRawBlock(const Slice& data, CompressionType, BlockHandle* handle);
 
@@ -0,0 +1,109 @@
+//
+// Thread-safe cache of open tables, keyed by file number.
+//
+#include "table_cache.h"
+#include "table.h"
+#include "fs.hpp"
+#include "iterator.h"
+#include "statistics.h"
+#include "util.hpp"
+
+namespace yedis {
+
+struct TableAndFile {
+  FileHandle* file;
+  Table* table;
+};
+
+static void DeleteEntry(const Slice& key, void* value) {
+  auto* tf = reinterpret_cast<TableAndFile*>(value);
+  delete tf->table;
+  delete tf->file;
+  delete tf;
+}
+
+static void UnrefEntry(void* arg1, void* arg2) {
+  auto* cache = reinterpret_cast<Cache*>(arg1);
+  auto* h = reinterpret_cast<Cache::Handle*>(arg2);
+  cache->Release(h);
+}
+
+TableCache::TableCache(std::string dbname, int entries)
+  : dbname_(std::move(dbname)),
+    cache_(NewLRUCache(entries)) {}
+
+TableCache::~TableCache() {
+  delete cache_;
+}
+
+Status TableCache::FindTable(const Options& options, uint64_t file_number, Cache::Handle** handle) {
+  Status s;
+  char buf[sizeof(file_number)];
+  EncodeFixed64(buf, file_number);
+  Slice key(buf, sizeof(buf));
+  *handle = cache_->Lookup(key);
+  if (*handle == nullptr) {
+    RecordTick(options.statistics, kTableFileOpens);
+    std::string fname = TableFileName(dbname_, file_number);
+    std::unique_ptr<FileHandle> file;
+    if (options.allow_mmap_reads) {
+      s = options.file_system->NewMmapReadableFile(fname, file);
+    } else {
+      s = options.file_system->NewReadableFile(fname, file);
+    }
+    Table* table = nullptr;
+    if (s.ok()) {
+      s = Table::Open(options, file.get(), &table);
+    }
+
+    if (s.ok()) {
+      auto* tf = new TableAndFile;
+      tf->file = file.release();
+      tf->table = table;
+      *handle = cache_->Insert(key, tf, 1, &DeleteEntry);
+    }
+    // errors are not cached, so a transient one is retried next time
+  }
+  return s;
+}
+
+Iterator* TableCache::NewIterator(const Options& options, const ReadOptions& read_options,
+                                  uint64_t file_number, Table** tableptr) {
+  if (tableptr != nullptr) {
+    *tableptr = nullptr;
+  }
+
+  Cache::Handle* handle = nullptr;
+  Status s = FindTable(options, file_number, &handle);
+  if (!s.ok()) {
+    return NewErrorIterator(s);
+  }
+
+  Table* table = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+  Iterator* result = table->NewIterator(read_options);
+  result->RegisterCleanup(&UnrefEntry, cache_, handle);
+  if (tableptr != nullptr) {
+    *tableptr = table;
+  }
+  return result;
+}
+
+Status TableCache::Get(const Options& options, const ReadOptions& read_options, uint64_t file_number,
+                       const Slice& k, void* arg, bool (*handle_result)(void*, const Slice&, const Slice&)) {
+  Cache::Handle* handle = nullptr;
+  Status s = FindTable(options, file_number, &handle);
+  if (s.ok()) {
+    Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+    s = t->InternalGet(read_options, k, arg, handle_result);
+    cache_->Release(handle);
+  }
+  return s;
+}
+
+void TableCache::Evict(uint64_t file_number) {
+  char buf[sizeof(file_number)];
+  EncodeFixed64(buf, file_number);
+  cache_->Erase(Slice(buf, sizeof(buf)));
+}
+
+}
@@ -0,0 +1,52 @@
+//
+// Thread-safe cache of open tables, keyed by file number.
+//
+
+#ifndef YEDIS_TABLE_CACHE_H
+#define YEDIS_TABLE_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include "cache.h"
+#include "common/status.h"
+#include "options.h"
+
+namespace yedis {
+
+class Iterator;
+class Table;
+
+class TableCache {
+public:
+  // Keeps up to "entries" tables open.
+  TableCache(std::string dbname, int entries);
+  ~TableCache();
+
+  TableCache(const TableCache&) = delete;
+  TableCache& operator=(const TableCache&) = delete;
+
+  // Iterator over table "file_number", opened with "options", the options
+  // of its column family.  If "tableptr" is non-null, *tableptr points to
+  // the table underlying the iterator, owned by the cache and valid while
+  // the iterator lives.
+  Iterator* NewIterator(const Options& options, const ReadOptions& read_options, uint64_t file_number,
+                        Table** tableptr = nullptr);
+
+  // Table::InternalGet on table "file_number".
+  Status Get(const Options& options, const ReadOptions& read_options, uint64_t file_number,
+             const Slice& k, void* arg, bool (*handle_result)(void*, const Slice&, const Slice&));
+
+  // Close table "file_number", once the file is deleted.
+  void Evict(uint64_t file_number);
+
+private:
+  Status FindTable(const Options& options, uint64_t file_number, Cache::Handle** handle);
+
+  const std::string dbname_;
+  Cache* const cache_;
+};
+
+}
+
+#endif //YEDIS_TABLE_CACHE_H
@@ -62,33 +62,48 @@ Status ReadBlock(FileHandle* file, const ReadOptions& options, const BlockHandle
   result->heap_allocated = false;
 
   size_t n = static_cast<size_t>(handle.size());
-  char* buf = new char[n + kBlockTrailerSize];
-  file->Read(buf, n + kBlockTrailerSize, handle.offset());
-  Slice contents{buf, n + kBlockTrailerSize};
-  if (contents.size() != n + kBlockTrailerSize) {
-    delete[] buf;
-    return Status::Corruption("truncated block read");
+  const char* base = file->MappedData();
+  char* buf = nullptr;
+  const char* data;
+  if (base != nullptr) {
+    // zero copy: the block is used directly out of the mapping
+    if (handle.offset() + n + kBlockTrailerSize > static_cast<uint64_t>(file->FileSize())) {
+      return Status::Corruption("truncated block read");
+    }
+    data = base + handle.offset();
+  } else {
+    buf = new char[n + kBlockTrailerSize];
+    file->Read(buf, n + kBlockTrailerSize, handle.offset());
+    data = buf;
   }
 
-  const char* data = contents.data();
-
   // compression type
-  auto cType = static_cast<CompressionType>(buf[n]);
-  if (cType != kNoCompression)
+  auto cType = static_cast<CompressionType>(data[n]);
+  if (cType != kNoCompression) {
+    delete[] buf;
     return Status::Corruption("unexpected compression type");
+  }
 
   if (options.verify_checksums) {
-    uint32_t crc = crc32::Value((uint8_t *) buf, n);
-    crc = crc32::Extend(crc, reinterpret_cast<uint8_t *>(buf + n), 1);  // Extend crc to cover block type
+    uint32_t crc = crc32::Value((uint8_t *) data, n);
+    crc = crc32::Extend(crc, (uint8_t *) (data + n), 1);  // Extend crc to cover block type
     crc = crc32::Mask(crc);
     if (crc != DecodeFixed32(data + n + 1)) {
+      delete[] buf;
       return Status::Corruption("unexpected checksum");
     }
   }
-  result->data = Slice(buf, n);
-  result->heap_allocated = true;
-  // TODO: what's the meaning of cacheable
-  result->cachable = true;
+  result->data = Slice(data, n);
+  if (buf != nullptr) {
+    result->heap_allocated = true;
+    // TODO: what's the meaning of cacheable
+    result->cachable = true;
+  } else {
+    // the page cache already holds mapped blocks, caching them again in
+    // block_cache would only duplicate the memory
+    result->heap_allocated = false;
+    result->cachable = false;
+  }
   return Status::OK();
 }
 
@@ -63,6 +63,12 @@ private:
 
 static const uint64_t kTableMagicNumber = 0xdb4775248b80fb57ull;
 
+// metaindex keys, the filter policy name is appended to the filter prefixes
+static const char kFilterPrefix[] = "filter.";
+static const char kFullFilterPrefix[] = "fullfilter.";
+static const char kPartitionedFilterPrefix[] = "partitionedfilter.";
+static const char kIndexTypeKey[] = "yedis.index.type";
+
 struct BlockContents {
   Slice data;           // Actual contents of data
   bool cachable;        // True iff data can be cached
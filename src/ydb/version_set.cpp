@@ -1,17 +1,24 @@
 //
 // Created by Shiping Yao on 2023/4/21.
 //
+#include <algorithm>
 #include <memory>
 #include <set>
 #include <utility>
-#include <iostream>
+
+#include <spdlog/spdlog.h>
 
 #include "version_set.h"
+#include "column_family.h"
 #include "util.hpp"
 #include "fs.hpp"
 #include "table.h"
+#include "table_cache.h"
 #include "iterator.h"
 #include "db_format.h"
+#include "merger.h"
+#include "two_level_iterator.h"
+#include "perf_context.h"
 
 namespace yedis {
 
@@ -47,16 +54,20 @@ enum class Tag: uint32_t {
   kDeletedFile = 6,
   kNewFile = 7,
   // 8 was used for large value refs
-  kPrevLogNumber = 9
+  kPrevLogNumber = 9,
+  // file changes that follow apply to this column family, absent means
+  // the default one
+  kColumnFamily = 10,
+  kColumnFamilyAdd = 11
 };
 
 void Version::Ref() { ++refs_; }
 void Version::Unref() {
-  assert(this != &vset_->dummy_versions_);
+  assert(this != &cfd_->dummy_versions_);
   assert(refs_ >= 1);
   --refs_;
   if (refs_ == 0) {
-    std::cout << "free here" << std::endl;
+    SPDLOG_TRACE("free version");
     delete this;
   }
 }
@@ -65,57 +76,271 @@ static bool NewestFile(FileMetaData* a, FileMetaData* b) {
   return a->number > b->number;
 }
 
-Status Version::Get(const ReadOptions& options, const LookupKey &key, std::string *val) {
-  // find in level 0
-  Status s;
+Version::~Version() {
+  assert(refs_ == 0);
+
+  // Remove from linked list
+  prev_->next_ = next_;
+  next_->prev_ = prev_;
+
+  // Drop references to files
+  for (auto& level_files : files_) {
+    for (auto* f : level_files) {
+      assert(f->refs > 0);
+      f->refs--;
+      if (f->refs <= 0) {
+        delete f;
+      }
+    }
+  }
+}
+
+int FindFile(const InternalKeyComparator& icmp, const std::vector<FileMetaData*> &files, const Slice& key) {
+  uint32_t left = 0;
+  uint32_t right = files.size();
+  while (left < right) {
+    uint32_t mid = (left + right) / 2;
+    const FileMetaData* f = files[mid];
+    if (icmp.Compare(f->largest.Encode(), key) < 0) {
+      // Key at "mid.largest" is < "target".  Therefore all
+      // files at or before "mid" are uninteresting.
+      left = mid + 1;
+    } else {
+      // Key at "mid.largest" is >= "target".  Therefore all files
+      // after "mid" are uninteresting.
+      right = mid;
+    }
+  }
+  return right;
+}
+
+static bool AfterFile(const Comparator* ucmp, const Slice* user_key, const FileMetaData* f) {
+  // null user_key occurs before all keys and is therefore never after *f
+  return (user_key != nullptr && ucmp->Compare(*user_key, f->largest.user_key()) > 0);
+}
+
+static bool BeforeFile(const Comparator* ucmp, const Slice* user_key, const FileMetaData* f) {
+  // null user_key occurs after all keys and is therefore never before *f
+  return (user_key != nullptr && ucmp->Compare(*user_key, f->smallest.user_key()) < 0);
+}
+
+bool SomeFileOverlapsRange(const InternalKeyComparator& icmp,
+                           bool disjoint_sorted_files,
+                           const std::vector<FileMetaData*>& files,
+                           const Slice* smallest_user_key,
+                           const Slice* largest_user_key) {
+  const Comparator* ucmp = icmp.user_comparator();
+  if (!disjoint_sorted_files) {
+    // Need to check against all files
+    for (auto* f : files) {
+      if (AfterFile(ucmp, smallest_user_key, f) || BeforeFile(ucmp, largest_user_key, f)) {
+        // No overlap
+      } else {
+        return true;  // Overlap
+      }
+    }
+    return false;
+  }
+
+  // Binary search over file list
+  uint32_t index = 0;
+  if (smallest_user_key != nullptr) {
+    // Find the earliest possible internal key for smallest_user_key
+    InternalKey small_key(*smallest_user_key, kMaxSequenceNumber, kValueTypeForSeek);
+    index = FindFile(icmp, files, small_key.Encode());
+  }
+
+  if (index >= files.size()) {
+    // beginning of range is after all files, so no overlap.
+    return false;
+  }
+
+  return !BeforeFile(ucmp, largest_user_key, files[index]);
+}
+
+static void DeleteTableAndFile(void* table, void* file) {
+  delete reinterpret_cast<Table*>(table);
+  delete reinterpret_cast<FileHandle*>(file);
+}
+
+Iterator* VersionSet::NewTableIterator(const ColumnFamilyData* cfd, const ReadOptions& options, uint64_t number,
+                                       bool for_compaction) const {
+  const Options& table_options = cfd->options();
+  if (!for_compaction || !table_options.use_direct_io_for_flush_and_compaction) {
+    return table_cache_->NewIterator(table_options, options, number);
+  }
+  // compaction inputs are read once, keep them out of the page cache and
+  // out of the table cache
+  std::unique_ptr<FileHandle> file;
+  Status s = table_options.file_system->NewDirectReadableFile(TableFileName(db_name_, number),
+                                                              table_options.compaction_readahead_size, file);
+  if (!s.ok()) {
+    return NewErrorIterator(s);
+  }
+  Table* table;
+  s = Table::Open(table_options, file.get(), &table);
+  if (!s.ok()) {
+    return NewErrorIterator(s);
+  }
+  Iterator* iter = table->NewIterator(options);
+  iter->RegisterCleanup(&DeleteTableAndFile, table, file.release());
+  return iter;
+}
+
+namespace {
+enum SaverState {
+  kNotFound,
+  kFound,
+  kDeleted,
+  kCorrupt,
+  kMergeWithoutOperands,
+};
+struct Saver {
+  SaverState state;
+  const Comparator* ucmp;
+  Slice user_key;
+  std::string* value;
+  std::vector<std::string>* merge_operands;
+};
+}  // namespace
+
+// Merge operands are followed by older entries of the same key, so keep
+// going until a value or a deletion shows up.
+static bool SaveValue(void* arg, const Slice& ikey, const Slice& v) {
+  auto* s = reinterpret_cast<Saver*>(arg);
+  ParsedInternalKey parsed;
+  if (!ParseInternalKey(ikey, &parsed)) {
+    s->state = kCorrupt;
+    return false;
+  }
+  if (s->ucmp->Compare(parsed.user_key, s->user_key) != 0) {
+    return false;
+  }
+  switch (parsed.type) {
+    case ValueType::kTypeMerge:
+      if (s->merge_operands == nullptr) {
+        s->state = kMergeWithoutOperands;
+        return false;
+      }
+      s->merge_operands->emplace_back(v.data(), v.size());
+      return true;
+    case ValueType::kTypeDeletion:
+      s->state = kDeleted;
+      return false;
+    case ValueType::kTypeValue:
+      s->state = kFound;
+      s->value->assign(v.data(), v.size());
+      return false;
+  }
+  return false;
+}
+
+Status Version::Get(const ReadOptions& options, const LookupKey &key, std::string *val,
+                    std::vector<std::string>* merge_operands) {
   auto internal_key = key.internal_key();
   auto user_key = key.user_key();
   auto ucmp = vset_->icmp_.user_comparator();
   std::vector<FileMetaData* > maybes;
-  for(auto &f: files_[0]) {
-    if (ucmp->Compare(user_key, f->smallest.user_key()) >= 0
-        && ucmp->Compare(user_key, f->largest.user_key()) <= 0) {
-      maybes.push_back(f);
-    }
-  }
-  std::sort(maybes.begin(), maybes.end(), NewestFile);
-  for(auto* f: maybes) {
-    // TableFileName()
-    auto tname = TableFileName(vset_->db_name_, f->number);
-    auto table_file_handle = vset_->options_->file_system->OpenFile(tname, O_RDONLY);
-    Table *table;
-    s = Table::Open(*vset_->options_, table_file_handle.get(), &table);
-    if (!s.ok()) {
-      return s;
-    }
-    auto it = table->NewIterator(options);
-    it->Seek(internal_key);
-    if (!it->Valid()) {
-      return it->status();
+  // level 0 files may overlap each other, search them from newest to oldest,
+  // deeper levels hold at most one candidate file each
+  for (int level = 0; level < config::kNumLevels; level++) {
+    maybes.clear();
+    if (level == 0) {
+      for (auto &f: files_[0]) {
+        if (ucmp->Compare(user_key, f->smallest.user_key()) >= 0
+            && ucmp->Compare(user_key, f->largest.user_key()) <= 0) {
+          maybes.push_back(f);
+        }
+      }
+      std::sort(maybes.begin(), maybes.end(), NewestFile);
+    } else if (!files_[level].empty()) {
+      uint32_t index = FindFile(vset_->icmp_, files_[level], internal_key);
+      if (index < files_[level].size()
+          && ucmp->Compare(user_key, files_[level][index]->smallest.user_key()) >= 0) {
+        maybes.push_back(files_[level][index]);
+      }
     }
-    InternalKey ikey;
-    ikey.DecodeFrom(it->key());
-    if (ucmp->Compare(ikey.user_key(), user_key) == 0) {
-      auto vt = ExtractValueType(it->key());
-      if (vt == ValueType::kTypeDeletion) {
-        return Status::NotFound("");
-      } else if (vt == ValueType::kTypeValue) {
-        val->assign(it->value().data(), it->value().size());
-        return Status::OK();
+
+    for (auto* f: maybes) {
+      perf::Count(&PerfContext::get_from_table_count);
+      perf::Timer timer(&PerfContext::get_from_table_time);
+      Saver saver;
+      saver.state = kNotFound;
+      saver.ucmp = ucmp;
+      saver.user_key = user_key;
+      saver.value = val;
+      saver.merge_operands = merge_operands;
+      Status s = vset_->table_cache_->Get(cfd_->options(), options, f->number, internal_key,
+                                          &saver, SaveValue);
+      if (!s.ok()) {
+        return s;
+      }
+      switch (saver.state) {
+        case kNotFound:
+          break;  // Keep searching in other files
+        case kFound:
+          return s;
+        case kDeleted:
+          return Status::NotFound("");
+        case kCorrupt:
+          return Status::Corruption("unexpect value type");
+        case kMergeWithoutOperands:
+          return Status::NotSupported("merge operand without merge_operands");
       }
-      return Status::Corruption("unexpect value type");
     }
   }
 
   return Status::NotFound("");
 }
 
+void Version::GetOverlappingInputs(int level, const InternalKey *begin, const InternalKey *end,
+                                   std::vector<FileMetaData *> *inputs) {
+  assert(level >= 0);
+  assert(level < config::kNumLevels);
+  inputs->clear();
+  Slice user_begin, user_end;
+  if (begin != nullptr) {
+    user_begin = begin->user_key();
+  }
+  if (end != nullptr) {
+    user_end = end->user_key();
+  }
+  const Comparator* user_cmp = vset_->icmp_.user_comparator();
+  for (size_t i = 0; i < files_[level].size();) {
+    FileMetaData* f = files_[level][i++];
+    const Slice file_start = f->smallest.user_key();
+    const Slice file_limit = f->largest.user_key();
+    if (begin != nullptr && user_cmp->Compare(file_limit, user_begin) < 0) {
+      // "f" is completely before specified range; skip it
+    } else if (end != nullptr && user_cmp->Compare(file_start, user_end) > 0) {
+      // "f" is completely after specified range; skip it
+    } else {
+      inputs->push_back(f);
+      if (level == 0) {
+        // Level-0 files may overlap each other.  So check if the newly
+        // added file has expanded the range.  If so, restart search.
+        if (begin != nullptr && user_cmp->Compare(file_start, user_begin) < 0) {
+          user_begin = file_start;
+          inputs->clear();
+          i = 0;
+        } else if (end != nullptr && user_cmp->Compare(file_limit, user_end) > 0) {
+          user_end = file_limit;
+          inputs->clear();
+          i = 0;
+        }
+      }
+    }
+  }
+}
+
 void VersionEdit::Clear() {
   comparator_ = std::nullopt;
   log_number_ = std::nullopt;
   prev_log_number_ = std::nullopt;
   next_file_number_ = std::nullopt;
   last_sequence_ = std::nullopt;
+  column_family_ = 0;
+  column_family_name_ = std::nullopt;
   compact_pointers_.clear();
   deleted_file_.clear();
   new_files_.clear();
@@ -124,17 +349,17 @@ void VersionEdit::Clear() {
 void VersionEdit::EncodeTo(std::string *dst) {
   if (comparator_.has_value()) {
     PutVarint32(dst, static_cast<uint32_t>(Tag::kComparator));
-    std::cout << "encode comparator: " << comparator_.value() << std::endl;
+    SPDLOG_TRACE("encode comparator: {}", comparator_.value());
     PutLengthPrefixedSlice(dst, comparator_.value());
   }
   if (log_number_.has_value()) {
     PutVarint32(dst, static_cast<uint32_t>(Tag::kLogNumber));
-    std::cout << "log number: " << log_number_.value() << std::endl;
+    SPDLOG_TRACE("encode log number: {}", log_number_.value());
     PutVarint64(dst, log_number_.value());
   }
   if (prev_log_number_.has_value()) {
     PutVarint32(dst, static_cast<uint32_t>(Tag::kPrevLogNumber));
-    std::cout << "prev log number: " << prev_log_number_.value() << std::endl;
+    SPDLOG_TRACE("encode prev log number: {}", prev_log_number_.value());
     PutVarint64(dst, prev_log_number_.value());
   }
   if (next_file_number_.has_value()) {
@@ -147,6 +372,15 @@ void VersionEdit::EncodeTo(std::string *dst) {
     PutVarint64(dst, last_sequence_.value());
   }
 
+  if (column_family_ != 0) {
+    PutVarint32(dst, static_cast<uint32_t>(Tag::kColumnFamily));
+    PutVarint32(dst, column_family_);
+  }
+  if (column_family_name_.has_value()) {
+    PutVarint32(dst, static_cast<uint32_t>(Tag::kColumnFamilyAdd));
+    PutLengthPrefixedSlice(dst, column_family_name_.value());
+  }
+
   // compactor pointer
 
   for(const auto& deleted_file_kvp: deleted_file_) {
@@ -181,15 +415,16 @@ Status VersionEdit::DecodeFrom(const Slice &src) {
         if (!succ) {
           return Status::Corruption("unexpected data");
         }
-        std::cout << "decode comparator: " << output.ToString() << std::endl;
+        SPDLOG_TRACE("decode comparator: {}", output.ToString());
         comparator_ = output.ToString();
+        p = output.data() + output.size();
         break;
       }
       case Tag::kLogNumber: {
         uint64_t log_number;
         p = GetVarint64Ptr(p, limit, &log_number);
         log_number_ = log_number;
-        std::cout << "decode log number: " << log_number << std::endl;
+        SPDLOG_TRACE("decode log number: {}", log_number);
         break;
       }
       case Tag::kPrevLogNumber: {
@@ -210,6 +445,23 @@ Status VersionEdit::DecodeFrom(const Slice &src) {
         last_sequence_ = lseq;
         break;
       }
+      case Tag::kColumnFamily: {
+        p = GetVarint32Ptr(p, limit, &column_family_);
+        if (p == nullptr) {
+          return Status::Corruption("bad column family id");
+        }
+        break;
+      }
+      case Tag::kColumnFamilyAdd: {
+        Slice input(p, limit - p);
+        Slice name;
+        if (!GetLengthPrefixedSlice(&input, &name)) {
+          return Status::Corruption("bad column family name");
+        }
+        column_family_name_ = name.ToString();
+        p = name.data() + name.size();
+        break;
+      }
       case Tag::kDeletedFile: {
         uint32_t first;
         uint64_t second;
@@ -297,7 +549,7 @@ public:
         }
       }
     }
-    std::cout << "unref in builder deconstruct" << std::endl;
+    SPDLOG_TRACE("unref base version in builder destructor");
     base_->Unref();
   }
 
@@ -344,8 +596,17 @@ public:
 
 Status VersionSet::LogAndApply(VersionEdit *edit, std::mutex *mu) {
   assert(!mu->try_lock());
+  {
+    std::unique_lock<std::mutex> lock(*mu, std::adopt_lock);
+    manifest_cv_.wait(lock, [this] { return !manifest_writing_; });
+    lock.release();
+  }
+  manifest_writing_ = true;
+
   if (edit->log_number_.has_value()) {
-    assert(edit->log_number_ >= log_number_);
+    // column families flush concurrently, an edit prepared before a later
+    // one was installed may carry an older log number
+    edit->SetLogNumber(std::max(edit->log_number_.value(), log_number_));
     assert(edit->log_number_ < next_file_number_);
   } else {
     edit->SetLogNumber(log_number_);
@@ -355,10 +616,11 @@ Status VersionSet::LogAndApply(VersionEdit *edit, std::mutex *mu) {
   }
   edit->SetNextFile(next_file_number_);
   edit->SetLastSequence(last_sequence_);
-  // TODO build version
-  auto* v = new Version(this);
+  ColumnFamilyData* cfd = GetColumnFamily(edit->column_family_);
+  assert(cfd != nullptr);
+  auto* v = new Version(this, cfd);
   {
-    Builder builder(this, current_);
+    Builder builder(this, cfd->current_);
     builder.Apply(edit);
     builder.SaveTo(v);
   }
@@ -371,19 +633,21 @@ Status VersionSet::LogAndApply(VersionEdit *edit, std::mutex *mu) {
     new_manifest_file = DescriptorFileName(db_name_, manifest_file_number_);
     descriptor_log_ = options_->file_system->OpenFile(new_manifest_file, O_RDWR | O_CREAT);
     if (!descriptor_log_) {
-      return Status::Corruption("create manifest error");
+      s = Status::Corruption("create manifest error");
+    } else {
+      descriptor_log_writer_ = std::make_unique<wal::Writer>(*descriptor_log_);
+      // a new MANIFEST starts with the current state, this also carries the
+      // column families over from the old one
+      s = WriteSnapshot(descriptor_log_writer_.get());
     }
-    descriptor_log_writer_ = std::make_unique<wal::Writer>(*descriptor_log_);
   }
 
   // write edit to manifest
-  {
+  if (s.ok()) {
     mu->unlock();
-    if (s.ok()) {
-      std::string record;
-      edit->EncodeTo(&record);
-      s = descriptor_log_writer_->AddRecord(record);
-    }
+    std::string record;
+    edit->EncodeTo(&record);
+    s = descriptor_log_writer_->AddRecord(record);
     // set current
     if (s.ok() && !new_manifest_file.empty()) {
       // NOTE: 为什么这里需要加锁
@@ -397,49 +661,105 @@ Status VersionSet::LogAndApply(VersionEdit *edit, std::mutex *mu) {
     prev_log_number_ = edit->prev_log_number_.value();
   } else {
     // TODO: error handle
+    delete v;
   }
 
+  manifest_writing_ = false;
+  manifest_cv_.notify_all();
   return s;
 }
 
 void VersionSet::AppendVersion(Version *v) {
   assert(v != nullptr);
   assert(v->refs_ == 0);
-  if (current_ != nullptr) {
-    current_->Unref();
+  ColumnFamilyData* cfd = v->cfd_;
+  if (cfd->current_ != nullptr) {
+    cfd->current_->Unref();
   }
-  current_ = v;
-  current_->Ref();
+  cfd->current_ = v;
+  cfd->current_->Ref();
+  cfd->pending_compaction_bytes_ = EstimatePendingCompactionBytes(v);
 
-  v->prev_ = dummy_versions_.prev_;
-  v->next_ = &dummy_versions_;
+  v->prev_ = cfd->dummy_versions_.prev_;
+  v->next_ = &cfd->dummy_versions_;
   v->prev_->next_ = v;
   v->next_->prev_ = v;
+
+  cfd->InstallSuperVersion();
 }
 
-VersionSet::VersionSet(std::string dbname, const Options *options, const InternalKeyComparator *icmp)
+VersionSet::VersionSet(std::string dbname, const Options *options, TableCache* table_cache,
+                       const InternalKeyComparator *icmp)
   : db_name_(std::move(dbname)),
     options_(options),
+    table_cache_(table_cache),
     icmp_(*icmp),
-    dummy_versions_(this),
     next_file_number_(1), // NOTE: init as 1
     log_number_(0),
     prev_log_number_(0),
     manifest_file_number_(next_file_number_),
     last_sequence_(0),
-    current_(nullptr),
     descriptor_log_writer_(nullptr),
-    descriptor_log_(nullptr) {
-  AppendVersion(new Version(this));
+    descriptor_log_(nullptr),
+    max_column_family_(0),
+    manifest_writing_(false) {
+  NewColumnFamilyData(0, kDefaultColumnFamilyName, *options_);
+}
+
+VersionSet::~VersionSet() {
+  for (auto& [id, cfd]: column_families_) {
+    delete cfd;
+  }
+}
+
+ColumnFamilyData* VersionSet::NewColumnFamilyData(uint32_t id, const std::string& name, const Options& options) {
+  auto* cfd = new ColumnFamilyData(id, name, this, options);
+  column_families_[id] = cfd;
+  max_column_family_ = std::max(max_column_family_, id);
+  AppendVersion(new Version(this, cfd));
+  return cfd;
+}
+
+ColumnFamilyData* VersionSet::GetColumnFamily(uint32_t id) const {
+  auto it = column_families_.find(id);
+  return it == column_families_.end() ? nullptr : it->second;
+}
+
+ColumnFamilyData* VersionSet::GetColumnFamily(const std::string& name) const {
+  for (auto& [id, cfd]: column_families_) {
+    if (cfd->GetName() == name) {
+      return cfd;
+    }
+  }
+  return nullptr;
+}
+
+Status VersionSet::CreateColumnFamily(const Options& options, const std::string& name, std::mutex* mu,
+                                      ColumnFamilyData** result) {
+  assert(GetColumnFamily(name) == nullptr);
+  ColumnFamilyData* cfd = NewColumnFamilyData(max_column_family_ + 1, name, options);
+  VersionEdit edit;
+  edit.SetColumnFamily(cfd->GetID());
+  edit.AddColumnFamily(name);
+  Status s = LogAndApply(&edit, mu);
+  if (!s.ok()) {
+    column_families_.erase(cfd->GetID());
+    delete cfd;
+    return s;
+  }
+  *result = cfd;
+  return s;
 }
 
 void VersionSet::AddLiveFiles(std::set<uint64_t>* live) {
-  for (Version* v = dummy_versions_.next_; v != &dummy_versions_;
-       v = v->next_) {
-    for (int level = 0; level < config::kNumLevels; level++) {
-      const std::vector<FileMetaData*>& files = v->files_[level];
-      for (size_t i = 0; i < files.size(); i++) {
-        live->insert(files[i]->number);
+  for (auto& [id, cfd]: column_families_) {
+    for (Version* v = cfd->dummy_versions_.next_; v != &cfd->dummy_versions_;
+         v = v->next_) {
+      for (int level = 0; level < config::kNumLevels; level++) {
+        const std::vector<FileMetaData*>& files = v->files_[level];
+        for (size_t i = 0; i < files.size(); i++) {
+          live->insert(files[i]->number);
+        }
       }
     }
   }
@@ -451,7 +771,7 @@ void VersionSet::MarkFileNumberUsed(uint64_t number) {
   }
 }
 
-Status VersionSet::Recover(bool *save_manifest) {
+Status VersionSet::Recover(bool *save_manifest, const std::vector<ColumnFamilyDescriptor>& column_families) {
   auto fs = options_->file_system;
   auto current_fname = CurrentFileName(db_name_);
   if (!fs->Exists(current_fname)) {
@@ -474,9 +794,15 @@ Status VersionSet::Recover(bool *save_manifest) {
   bool have_next_file = false;
   bool have_last_sequence = false;
 
-  Builder builder(this, current_);
+  std::map<uint32_t, std::unique_ptr<Builder>> builders;
+  builders[0] = std::make_unique<Builder>(this, GetDefault()->current_);
 
-  while(manifest_reader->ReadRecord(&record, &raw_record)) {
+  for (bool more = true; more; ) {
+    // the last record comes with more == false
+    more = manifest_reader->ReadRecord(&record, &raw_record);
+    if (record.empty()) {
+      break;
+    }
     VersionEdit replay_edit;
     s = replay_edit.DecodeFrom(record);
     if (!s.ok()) {
@@ -485,7 +811,25 @@ Status VersionSet::Recover(bool *save_manifest) {
     if (replay_edit.comparator_ && replay_edit.comparator_.value() != icmp_.user_comparator()->Name()) {
       return s = Status::InvalidArgument("unmatched comparator name");
     }
-    builder.Apply(&replay_edit);
+    const uint32_t cf_id = replay_edit.column_family_;
+    if (replay_edit.column_family_name_) {
+      const std::string& name = replay_edit.column_family_name_.value();
+      Options cf_options = *options_;
+      for (auto& descriptor: column_families) {
+        if (descriptor.name == name) {
+          cf_options = SanitizeColumnFamilyOptions(*options_, *descriptor.options);
+        }
+      }
+      if (GetColumnFamily(cf_id) == nullptr) {
+        ColumnFamilyData* cfd = NewColumnFamilyData(cf_id, name, cf_options);
+        builders[cf_id] = std::make_unique<Builder>(this, cfd->current_);
+      }
+    }
+    auto it = builders.find(cf_id);
+    if (it == builders.end()) {
+      return Status::Corruption("edit for unknown column family");
+    }
+    it->second->Apply(&replay_edit);
 
     if (replay_edit.log_number_) {
       log_number_ = replay_edit.log_number_.value();
@@ -504,6 +848,10 @@ Status VersionSet::Recover(bool *save_manifest) {
       have_last_sequence = true;
     }
   }
+  // the next LogAndApply starts a new MANIFEST
+  manifest_reader.reset();
+  descriptor_log_.reset();
+
   if (!have_next_file) {
     return Status::Corruption("no meta-nextfile entry in manifest");
   } else if (!have_log_number) {
@@ -517,9 +865,11 @@ Status VersionSet::Recover(bool *save_manifest) {
   MarkFileNumberUsed(prev_log_number_);
   MarkFileNumberUsed(log_number_);
 
-  auto *v = new Version(this);
-  builder.SaveTo(v);
-  AppendVersion(v);
+  for (auto& [cf_id, builder]: builders) {
+    auto *v = new Version(this, GetColumnFamily(cf_id));
+    builder->SaveTo(v);
+    AppendVersion(v);
+  }
   manifest_file_number_ = next_file_number_ + 1;
   next_file_number_++;
 
@@ -527,4 +877,385 @@ Status VersionSet::Recover(bool *save_manifest) {
   return s;
 }
 
+Status VersionSet::WriteSnapshot(wal::Writer* log) {
+  Status s;
+  for (auto& [id, cfd]: column_families_) {
+    VersionEdit edit;
+    if (id == 0) {
+      edit.SetComparatorName(icmp_.user_comparator()->Name());
+    } else {
+      edit.AddColumnFamily(cfd->GetName());
+    }
+    edit.SetColumnFamily(id);
+    for (int level = 0; level < config::kNumLevels; level++) {
+      for (auto* f: cfd->current_->files_[level]) {
+        edit.AddFile(level, f->number, f->file_size, f->smallest, f->largest);
+      }
+    }
+    std::string record;
+    edit.EncodeTo(&record);
+    s = log->AddRecord(record);
+    if (!s.ok()) {
+      break;
+    }
+  }
+  return s;
+}
+
+static int64_t TotalFileSize(const std::vector<FileMetaData*>& files) {
+  int64_t sum = 0;
+  for (auto* f: files) {
+    sum += f->file_size;
+  }
+  return sum;
+}
+
+static double MaxBytesForLevel(int level) {
+  // Note: the result for level zero is not really used since we set
+  // the level-0 compaction threshold based on number of files.
+
+  // Result for both level-0 and level-1
+  double result = 10. * 1048576.0;
+  while (level > 1) {
+    result *= 10;
+    level--;
+  }
+  return result;
+}
+
+// Stores the minimal range that covers all entries in inputs in
+// *smallest, *largest.
+// REQUIRES: inputs is not empty
+static void GetRange(const InternalKeyComparator& icmp, const std::vector<FileMetaData*>& inputs,
+                     InternalKey* smallest, InternalKey* largest) {
+  assert(!inputs.empty());
+  smallest->Clear();
+  largest->Clear();
+  for (size_t i = 0; i < inputs.size(); i++) {
+    FileMetaData* f = inputs[i];
+    if (i == 0) {
+      *smallest = f->smallest;
+      *largest = f->largest;
+    } else {
+      if (icmp.Compare(f->smallest, *smallest) < 0) {
+        *smallest = f->smallest;
+      }
+      if (icmp.Compare(f->largest, *largest) > 0) {
+        *largest = f->largest;
+      }
+    }
+  }
+}
+
+int64_t VersionSet::NumLevelBytes(const ColumnFamilyData* cfd, int level) const {
+  assert(level >= 0);
+  assert(level < config::kNumLevels);
+  return TotalFileSize(cfd->current_->files_[level]);
+}
+
+double VersionSet::LevelScore(const Version *v, int level) const {
+  if (level == 0) {
+    // We treat level-0 specially by bounding the number of files
+    // instead of number of bytes, because every level-0 file is read
+    // on a lookup and large write buffers make for few, big files.
+    return v->files_[level].size() / static_cast<double>(config::kL0_CompactionTrigger);
+  }
+  return static_cast<double>(TotalFileSize(v->files_[level])) / MaxBytesForLevel(level);
+}
+
+uint64_t VersionSet::EstimatePendingCompactionBytes(const Version *v) const {
+  uint64_t bytes = 0;
+  if (v->files_[0].size() >= config::kL0_CompactionTrigger) {
+    bytes += TotalFileSize(v->files_[0]);
+  }
+  for (int level = 1; level < config::kNumLevels - 1; level++) {
+    const double excess = static_cast<double>(TotalFileSize(v->files_[level])) - MaxBytesForLevel(level);
+    if (excess > 0) {
+      bytes += static_cast<uint64_t>(excess);
+    }
+  }
+  return bytes;
+}
+
+bool VersionSet::NeedsCompaction() const {
+  for (auto& [id, cfd]: column_families_) {
+    for (int level = 0; level < config::kNumLevels - 1; level++) {
+      if (LevelScore(cfd->current_, level) >= 1) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+Compaction* VersionSet::PickCompaction() {
+  struct Candidate {
+    double score;
+    ColumnFamilyData* cfd;
+    int level;
+  };
+  std::vector<Candidate> candidates;
+  for (auto& [id, cfd]: column_families_) {
+    for (int level = 0; level < config::kNumLevels - 1; level++) {
+      double score = LevelScore(cfd->current_, level);
+      if (score >= 1) {
+        candidates.push_back({score, cfd, level});
+      }
+    }
+  }
+  // the level furthest over budget first, whatever its column family,
+  // fall back to the others if its files are busy
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+  for (auto& candidate: candidates) {
+    Compaction* c = SetupCompaction(candidate.cfd, candidate.level);
+    if (c != nullptr) {
+      return c;
+    }
+  }
+  return nullptr;
+}
+
+Compaction* VersionSet::SetupCompaction(ColumnFamilyData* cfd, int level) {
+  if (level == 0) {
+    for (auto* running: running_compactions_) {
+      if (running->column_family() == cfd && running->level() == 0) {
+        return nullptr;
+      }
+    }
+  }
+
+  Version* v = cfd->current_;
+  std::string* compact_pointer = cfd->compact_pointer_;
+  // round robin over the level, starting after the last compacted key
+  FileMetaData* picked = nullptr;
+  for (auto* f: v->files_[level]) {
+    if (!f->being_compacted && (compact_pointer[level].empty()
+        || icmp_.Compare(f->largest.Encode(), compact_pointer[level]) > 0)) {
+      picked = f;
+      break;
+    }
+  }
+  if (picked == nullptr) {
+    for (auto* f: v->files_[level]) {
+      if (!f->being_compacted) {
+        picked = f;
+        break;
+      }
+    }
+  }
+  if (picked == nullptr) {
+    return nullptr;
+  }
+
+  auto* c = new Compaction(cfd, level);
+  c->inputs_[0].push_back(picked);
+  InternalKey smallest, largest;
+  if (level == 0) {
+    GetRange(icmp_, c->inputs_[0], &smallest, &largest);
+    v->GetOverlappingInputs(0, &smallest, &largest, &c->inputs_[0]);
+  }
+  GetRange(icmp_, c->inputs_[0], &smallest, &largest);
+  v->GetOverlappingInputs(level + 1, &smallest, &largest, &c->inputs_[1]);
+
+  std::vector<FileMetaData*> all = c->inputs_[0];
+  all.insert(all.end(), c->inputs_[1].begin(), c->inputs_[1].end());
+  GetRange(icmp_, all, &c->smallest_, &c->largest_);
+
+  bool conflict = false;
+  for (auto* f: all) {
+    if (f->being_compacted) {
+      conflict = true;
+      break;
+    }
+  }
+  // two compactions writing overlapping ranges into the same level would
+  // break the disjointness of that level
+  const Comparator* ucmp = icmp_.user_comparator();
+  for (auto* running: running_compactions_) {
+    if (conflict) {
+      break;
+    }
+    if (running->column_family() == cfd && running->level() == level
+        && ucmp->Compare(running->smallest_.user_key(), c->largest_.user_key()) <= 0
+        && ucmp->Compare(c->smallest_.user_key(), running->largest_.user_key()) <= 0) {
+      conflict = true;
+    }
+  }
+  if (conflict) {
+    delete c;
+    return nullptr;
+  }
+
+  compact_pointer[level] = largest.Encode().ToString();
+  c->input_version_ = v;
+  v->Ref();
+  for (auto* f: all) {
+    f->being_compacted = true;
+  }
+  running_compactions_.push_back(c);
+  return c;
+}
+
+void VersionSet::ReleaseCompaction(Compaction *c) {
+  for (auto& inputs: c->inputs_) {
+    for (auto* f: inputs) {
+      f->being_compacted = false;
+    }
+  }
+  std::erase(running_compactions_, c);
+  delete c;
+}
+
+// An internal iterator.  For a given version/level pair, yields
+// information about the files in the level.  For a given entry, key()
+// is the largest key that occurs in the file, and value() is an
+// 16-byte value containing the file number and file size, both
+// encoded using EncodeFixed64.
+class LevelFileNumIterator: public Iterator {
+public:
+  LevelFileNumIterator(const InternalKeyComparator& icmp, const std::vector<FileMetaData*>* flist)
+    : icmp_(icmp), flist_(flist), index_(flist->size()) {  // Marks as invalid
+  }
+  bool Valid() const override { return index_ < flist_->size(); }
+  void Seek(const Slice& target) override { index_ = FindFile(icmp_, *flist_, target); }
+  void SeekToFirst() override { index_ = 0; }
+  void SeekToLast() override { index_ = flist_->empty() ? 0 : flist_->size() - 1; }
+  void Next() override {
+    assert(Valid());
+    index_++;
+  }
+  void Prev() override {
+    assert(Valid());
+    if (index_ == 0) {
+      index_ = flist_->size();  // Marks as invalid
+    } else {
+      index_--;
+    }
+  }
+  Slice key() const override {
+    assert(Valid());
+    return (*flist_)[index_]->largest.Encode();
+  }
+  Slice value() const override {
+    assert(Valid());
+    EncodeFixed64(value_buf_, (*flist_)[index_]->number);
+    EncodeFixed64(value_buf_ + 8, (*flist_)[index_]->file_size);
+    return Slice(value_buf_, sizeof(value_buf_));
+  }
+  Status status() const override { return Status::OK(); }
+
+private:
+  const InternalKeyComparator icmp_;
+  const std::vector<FileMetaData*>* const flist_;
+  uint32_t index_;
+
+  // Backing store for value().  Holds the file number and size.
+  mutable char value_buf_[16];
+};
+
+Iterator* VersionSet::GetFileIterator(void *arg, const ReadOptions &options, const Slice &file_value) {
+  auto* c = reinterpret_cast<Compaction*>(arg);
+  if (file_value.size() != 16) {
+    return NewErrorIterator(Status::Corruption("FileReader invoked with unexpected value"));
+  }
+  return c->input_version_->vset_->NewTableIterator(c->column_family(), options,
+                                                    DecodeFixed64(file_value.data()), true);
+}
+
+Iterator* Version::GetFileIterator(void *arg, const ReadOptions &options, const Slice &file_value) {
+  auto* v = reinterpret_cast<Version*>(arg);
+  if (file_value.size() != 16) {
+    return NewErrorIterator(Status::Corruption("FileReader invoked with unexpected value"));
+  }
+  return v->vset_->NewTableIterator(v->cfd_, options, DecodeFixed64(file_value.data()), false);
+}
+
+void Version::AddIterators(const ReadOptions &options, std::vector<Iterator*> *iters) {
+  std::vector<FileMetaData*> level0 = files_[0];
+  std::sort(level0.begin(), level0.end(), NewestFile);
+  for (auto* f: level0) {
+    iters->push_back(vset_->NewTableIterator(cfd_, options, f->number, false));
+  }
+  // For levels > 0, we can use a concatenating iterator that sequentially
+  // walks through the non-overlapping files in the level, opening them
+  // lazily.
+  for (int level = 1; level < config::kNumLevels; level++) {
+    if (!files_[level].empty()) {
+      iters->push_back(NewTwoLevelIterator(new LevelFileNumIterator(vset_->icmp_, &files_[level]),
+                                           &Version::GetFileIterator, this, options));
+    }
+  }
+}
+
+Iterator* VersionSet::MakeInputIterator(Compaction *c) const {
+  ReadOptions options;
+  options.verify_checksums = options_->paranoid_checks;
+  options.fill_cache = false;
+
+  // Level-0 files have to be merged together.  For other levels,
+  // we will make a concatenating iterator per level.
+  const int space = (c->level() == 0 ? c->num_input_files(0) + 1 : 2);
+  std::vector<Iterator*> list;
+  list.reserve(space);
+  for (int which = 0; which < 2; which++) {
+    if (c->inputs_[which].empty()) {
+      continue;
+    }
+    if (c->level() + which == 0) {
+      for (auto* f: c->inputs_[which]) {
+        list.push_back(NewTableIterator(c->column_family(), options, f->number, true));
+      }
+    } else {
+      // Create concatenating iterator for the files from this level
+      list.push_back(NewTwoLevelIterator(new LevelFileNumIterator(icmp_, &c->inputs_[which]),
+                                         &VersionSet::GetFileIterator, c, options));
+    }
+  }
+  return NewMergingIterator(&icmp_, list.data(), static_cast<int>(list.size()));
+}
+
+Compaction::Compaction(ColumnFamilyData* cfd, int level)
+  : cfd_(cfd),
+    level_(level),
+    max_output_file_size_(cfd->options().max_file_size),
+    input_version_(nullptr) {
+  edit_.SetColumnFamily(cfd->GetID());
+}
+
+Compaction::~Compaction() {
+  if (input_version_ != nullptr) {
+    input_version_->Unref();
+  }
+}
+
+bool Compaction::IsTrivialMove() const {
+  // Avoid a move if there is lots of overlapping data at level+1, there
+  // is none here since level+1 has no input.
+  return num_input_files(0) == 1 && num_input_files(1) == 0;
+}
+
+void Compaction::AddInputDeletions(VersionEdit *edit) {
+  for (int which = 0; which < 2; which++) {
+    for (auto* f: inputs_[which]) {
+      edit->RemoveFile(level_ + which, f->number);
+    }
+  }
+}
+
+bool Compaction::IsBaseLevelForKey(const Slice &user_key) const {
+  // Maybe use binary search to find right entry instead of linear search?
+  const Comparator* user_cmp = input_version_->vset_->icmp_.user_comparator();
+  for (int lvl = level_ + 2; lvl < config::kNumLevels; lvl++) {
+    for (auto* f: input_version_->files_[lvl]) {
+      if (user_cmp->Compare(user_key, f->smallest.user_key()) >= 0
+          && user_cmp->Compare(user_key, f->largest.user_key()) <= 0) {
+        // We've advanced far enough
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 }
@@ -4,9 +4,12 @@
 
 #ifndef YEDIS_VERSION_SET_H
 #define YEDIS_VERSION_SET_H
+#include <atomic>
 #include <vector>
 #include <set>
+#include <map>
 #include <optional>
+#include <condition_variable>
 
 #include "slice.h"
 #include "db_format.h"
@@ -22,16 +25,23 @@ namespace yedis {
 class VersionSet;
 class Version;
 class VersionEdit;
+class Compaction;
 class DBImpl;
+class Iterator;
+class ColumnFamilyData;
+class TableCache;
+struct ColumnFamilyDescriptor;
 
 struct FileMetaData {
-  FileMetaData(): refs(0), allowed_seeks(1 << 30), file_size(0) {}
+  FileMetaData(): refs(0), allowed_seeks(1 << 30), file_size(0), being_compacted(false) {}
   int refs;
   int allowed_seeks;
   uint64_t number;
   uint64_t file_size;
   InternalKey smallest;
   InternalKey largest;
+  // input of a running compaction, protected by the db mutex
+  bool being_compacted;
 };
 
 int FindFile(const InternalKeyComparator& icmp, const std::vector<FileMetaData*> &files, const Slice& key);
@@ -46,12 +56,34 @@ class Version {
 public:
   void Ref();
   void Unref();
-  Status Get(const ReadOptions&, const LookupKey& key, std::string* val);
+  // Merge operands newer than the value found are appended to
+  // *merge_operands, newest first.  Returns NotFound if no value is found,
+  // with the operands collected so far.
+  Status Get(const ReadOptions&, const LookupKey& key, std::string* val,
+             std::vector<std::string>* merge_operands = nullptr);
+
+  // Store in "*inputs" all files in "level" that overlap [begin,end],
+  // nullptr means unbounded.  Level-0 files may overlap each other, so
+  // the range is widened until it covers every overlapping level-0 file.
+  void GetOverlappingInputs(int level, const InternalKey* begin, const InternalKey* end,
+                            std::vector<FileMetaData*>* inputs);
+
+  int NumFiles(int level) const { return static_cast<int>(files_[level].size()); }
+
+  // Append to *iters a sequence of iterators that will yield the contents
+  // of this Version when merged together: one per level-0 file, newest
+  // first, and one concatenating iterator per deeper level.
+  // REQUIRES: This version has been saved (see VersionSet::SaveTo)
+  void AddIterators(const ReadOptions& options, std::vector<Iterator*>* iters);
+
 private:
   friend class VersionSet;
+  friend class Compaction;
+  friend class ColumnFamilyData;
 
-  explicit Version(VersionSet* vset)
+  Version(VersionSet* vset, ColumnFamilyData* cfd)
     : vset_(vset),
+      cfd_(cfd),
       next_(this),
       prev_(this),
       refs_(0),
@@ -62,9 +94,12 @@ private:
 
   Version(const Version&) = delete;
   Version& operator=(const Version&) = delete;
-  ~Version() {};
+  ~Version();
+
+  static Iterator* GetFileIterator(void* arg, const ReadOptions& options, const Slice& file_value);
 
   VersionSet* vset_;
+  ColumnFamilyData* cfd_;
   Version* next_;
   Version* prev_;
   int refs_;
@@ -98,6 +133,20 @@ public:
     last_sequence_ = seq;
   }
 
+  // The column family the file changes of this edit apply to, 0 is the
+  // default column family.
+  void SetColumnFamily(uint32_t column_family_id) {
+    column_family_ = column_family_id;
+  }
+  // Marks this edit as the creation of column family "name".
+  void AddColumnFamily(const std::string& name) {
+    column_family_name_ = name;
+  }
+
+  void RemoveFile(int level, uint64_t file) {
+    deleted_file_.insert({level, file});
+  }
+
   void AddFile(int level, uint64_t file, uint64_t file_size,
                const InternalKey& smallest, const InternalKey &largest) {
     FileMetaData f;
@@ -122,6 +171,8 @@ private:
   std::optional<uint64_t> prev_log_number_;
   std::optional<uint64_t> next_file_number_;
   std::optional<SequenceNumber> last_sequence_;
+  uint32_t column_family_ = 0;
+  std::optional<std::string> column_family_name_;
 
   std::vector<std::pair<int, InternalKey>> compact_pointers_;
   DeletedFileSet deleted_file_;
@@ -130,31 +181,82 @@ private:
 
 class VersionSet {
 public:
-  VersionSet(std::string  dbname, const Options* options, const InternalKeyComparator*);
+  VersionSet(std::string  dbname, const Options* options, TableCache* table_cache, const InternalKeyComparator*);
+  ~VersionSet();
   uint64_t NewFileNumber() { return next_file_number_++; }
   uint64_t ManifestFileNumber() const { return manifest_file_number_; }
-  uint64_t LastSequence() const { return last_sequence_; }
-  void SetLastSequence(uint64_t s) { last_sequence_ = s; }
+  // Readers load it without the db mutex.
+  uint64_t LastSequence() const { return last_sequence_.load(std::memory_order_acquire); }
+  void SetLastSequence(uint64_t s) { last_sequence_.store(s, std::memory_order_release); }
   uint64_t LogNumber() const { return log_number_; }
   uint64_t PrevLogNumber() const { return prev_log_number_; }
 
-  Version* current() const { return current_; }
+  ColumnFamilyData* GetDefault() const { return column_families_.at(0); }
+  // nullptr if there is no such column family
+  ColumnFamilyData* GetColumnFamily(uint32_t id) const;
+  ColumnFamilyData* GetColumnFamily(const std::string& name) const;
+  // ordered by id
+  const std::map<uint32_t, ColumnFamilyData*>& column_families() const { return column_families_; }
 
+  // Create column family "name" with "options" (already sanitized) and
+  // record it in the MANIFEST.
+  // REQUIRES: *mu is held on entry.
+  Status CreateColumnFamily(const Options& options, const std::string& name, std::mutex* mu,
+                            ColumnFamilyData** result);
 
+  // Apply *edit to the current version of its column family.
   Status LogAndApply(VersionEdit* edit, std::mutex* mu);
-  Status Recover(bool *save_manifest);
+  // Column families found in the MANIFEST take their options from the
+  // matching entry of "column_families", the db options otherwise.
+  Status Recover(bool *save_manifest, const std::vector<ColumnFamilyDescriptor>& column_families);
   void AppendVersion(Version* v);
   void AddLiveFiles(std::set<uint64_t>* live);
 
   void MarkFileNumberUsed(uint64_t number);
 
+  int64_t NumLevelBytes(const ColumnFamilyData* cfd, int level) const;
+
+  // Returns true if some level of some column family is over its size
+  // (or file count) budget.
+  bool NeedsCompaction() const;
+
+  // Pick inputs for a new compaction that does not conflict with any
+  // running one: no shared input files and no overlapping output range
+  // at the same output level.  At most one compaction reads level 0.
+  // Returns nullptr if there is nothing to do.  The result must be
+  // handed back through ReleaseCompaction().
+  // REQUIRES: db mutex held
+  Compaction* PickCompaction();
+
+  // REQUIRES: db mutex held
+  void ReleaseCompaction(Compaction* c);
+
+  // Merging iterator over all inputs of "c".  Thread safe, subcompactions
+  // call it without the db mutex.
+  Iterator* MakeInputIterator(Compaction* c) const;
+
+  // Iterator over table "number", opened through the table cache.
+  // Compaction inputs read with direct I/O bypass it.
+  Iterator* NewTableIterator(const ColumnFamilyData* cfd, const ReadOptions& options, uint64_t number,
+                             bool for_compaction) const;
+
 
 private:
   friend class Version;
+  friend class Compaction;
   class Builder;
 
+  double LevelScore(const Version* v, int level) const;
+  uint64_t EstimatePendingCompactionBytes(const Version* v) const;
+  Compaction* SetupCompaction(ColumnFamilyData* cfd, int level);
+  // Save the files and column families of all current versions to "log".
+  Status WriteSnapshot(wal::Writer* log);
+  ColumnFamilyData* NewColumnFamilyData(uint32_t id, const std::string& name, const Options& options);
+  static Iterator* GetFileIterator(void* arg, const ReadOptions& options, const Slice& file_value);
+
   const std::string db_name_;
   const Options* const options_;
+  TableCache* const table_cache_;
   const InternalKeyComparator icmp_;
   // MANIFEST file handle
   std::unique_ptr<FileHandle> descriptor_log_;
@@ -162,15 +264,76 @@ private:
 
   uint64_t next_file_number_;
   uint64_t manifest_file_number_;
-  uint64_t last_sequence_;
+  std::atomic<uint64_t> last_sequence_;
   uint64_t log_number_;
   uint64_t prev_log_number_;
 
-  Version* current_;
-  Version dummy_versions_;
+  std::map<uint32_t, ColumnFamilyData*> column_families_;
+  uint32_t max_column_family_;
+
+  std::vector<Compaction*> running_compactions_;
+
+  // flushes and compactions finish concurrently, LogAndApply installs
+  // their edits one at a time
+  std::condition_variable manifest_cv_;
+  bool manifest_writing_;
+};
+
+// A Compaction encapsulates information about a compaction.
+class Compaction {
+public:
+  ~Compaction();
+
+  // Return the level that is being compacted.  Inputs from "level"
+  // and "level+1" will be merged to produce a set of "level+1" files.
+  int level() const { return level_; }
+
+  ColumnFamilyData* column_family() const { return cfd_; }
+
+  // Return the object that holds the edits to the descriptor done
+  // by this compaction.
+  VersionEdit* edit() { return &edit_; }
+
+  // "which" must be either 0 or 1
+  int num_input_files(int which) const { return static_cast<int>(inputs_[which].size()); }
+
+  // Return the ith input file at "level()+which" ("which" must be 0 or 1).
+  FileMetaData* input(int which, int i) const { return inputs_[which][i]; }
+
+  // Maximum size of files to build during this compaction.
+  uint64_t MaxOutputFileSize() const { return max_output_file_size_; }
+
+  // Is this a trivial compaction that can be implemented by just
+  // moving a single input file to the next level (no merging or splitting)
+  bool IsTrivialMove() const;
+
+  // Add all inputs to this compaction as delete operations to *edit.
+  void AddInputDeletions(VersionEdit* edit);
+
+  // Returns true if the information we have available guarantees that
+  // the compaction is producing data in "level+1" for which no data exists
+  // in levels greater than "level+1".  Does not modify any state, so
+  // subcompactions may call it concurrently.
+  bool IsBaseLevelForKey(const Slice& user_key) const;
+
+private:
+  friend class Version;
+  friend class VersionSet;
+
+  Compaction(ColumnFamilyData* cfd, int level);
+
+  ColumnFamilyData* cfd_;
+  int level_;
+  uint64_t max_output_file_size_;
+  Version* input_version_;
+  VersionEdit edit_;
 
-  size_t level_ptrs_[config::kNumLevels];
+  // Each compaction reads inputs from "level_" and "level_+1"
+  std::vector<FileMetaData*> inputs_[2];  // The two sets of inputs
 
+  // key range covered by all inputs
+  InternalKey smallest_;
+  InternalKey largest_;
 };
 }
 #endif //YEDIS_VERSION_SET_H
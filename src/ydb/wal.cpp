@@ -115,6 +115,10 @@ namespace yedis::wal {
     RecordType t;
     int64_t sz;
     int64_t size = 0;
+    if (offset_ >= handle_.FileSize()) {
+      *record = Slice();
+      return false;
+    }
     do {
       sz = handle_.Read(header_buf, kHeaderSize, offset_);
       if (sz != kHeaderSize) {
@@ -45,6 +45,9 @@ namespace wal {
 
     ~Reader();
 
+    // Read the next record into *record.  Returns false if no record
+    // follows it, the last record of a log comes with false.  *record is
+    // empty if the log holds no more records at all.
     bool ReadRecord(Slice* record, std::string *scratch);
   private:
     FileHandle& handle_;
@@ -7,16 +7,46 @@
 #include "table_format.h"
 #include "util.hpp"
 #include "db_format.h"
+#include "db.h"
 
 namespace yedis {
+  // WriteBatch::rep_ :=
+  //    sequence: fixed64
+  //    count: fixed32
+  //    data: record[count]
+  // record :=
+  //    kTypeValue varstring varstring         |
+  //    kTypeDeletion varstring                |
+  //    kTypeMerge varstring varstring         |
+  //    kTypeColumnFamilyValue varint32 varstring varstring |
+  //    kTypeColumnFamilyDeletion varint32 varstring |
+  //    kTypeColumnFamilyMerge varint32 varstring varstring
   static const size_t kHeader = 12;
 
+  // Batch-only record tags, the column family id follows the tag.  They
+  // never appear in internal keys.
+  static const char kTypeColumnFamilyDeletion = 0x4;
+  static const char kTypeColumnFamilyValue = 0x5;
+  static const char kTypeColumnFamilyMerge = 0x6;
+
   WriteBatch::WriteBatch() { Clear(); }
 
   WriteBatch::~WriteBatch() = default;
 
   WriteBatch::Handler::~Handler() = default;
 
+  void WriteBatch::Handler::PutCF(uint32_t column_family_id, const Slice& key, const Slice& value) {
+    Put(key, value);
+  }
+
+  void WriteBatch::Handler::DeleteCF(uint32_t column_family_id, const Slice& key) {
+    Delete(key);
+  }
+
+  void WriteBatch::Handler::MergeCF(uint32_t column_family_id, const Slice& key, const Slice& value) {
+    Merge(key, value);
+  }
+
   void WriteBatch::Clear() {
     rep_.clear();
     rep_.resize(kHeader);
@@ -32,13 +62,40 @@ namespace yedis {
 
     input.remove_prefix(kHeader);
     Slice key, value;
+    uint32_t column_family_id;
     int found = 0;
     while (!input.empty()) {
       found++;
-      auto tag = static_cast<ValueType>(input[0]);
+      const char tag = input[0];
       input.remove_prefix(1);
       switch (tag) {
-        case ValueType::kTypeValue:
+        case kTypeColumnFamilyValue:
+          if (GetVarint32(&input, &column_family_id) &&
+              GetLengthPrefixedSlice(&input, &key) &&
+              GetLengthPrefixedSlice(&input, &value)) {
+            handler->PutCF(column_family_id, key, value);
+          } else {
+            return Status::Corruption("bad WriteBatch Put");
+          }
+          break;
+        case kTypeColumnFamilyMerge:
+          if (GetVarint32(&input, &column_family_id) &&
+              GetLengthPrefixedSlice(&input, &key) &&
+              GetLengthPrefixedSlice(&input, &value)) {
+            handler->MergeCF(column_family_id, key, value);
+          } else {
+            return Status::Corruption("bad WriteBatch Merge");
+          }
+          break;
+        case kTypeColumnFamilyDeletion:
+          if (GetVarint32(&input, &column_family_id) &&
+              GetLengthPrefixedSlice(&input, &key)) {
+            handler->DeleteCF(column_family_id, key);
+          } else {
+            return Status::Corruption("bad WriteBatch Delete");
+          }
+          break;
+        case static_cast<char>(ValueType::kTypeValue):
           if (GetLengthPrefixedSlice(&input, &key) &&
               GetLengthPrefixedSlice(&input, &value)) {
             handler->Put(key, value);
@@ -46,7 +103,15 @@ namespace yedis {
             return Status::Corruption("bad WriteBatch Put");
           }
           break;
-        case ValueType::kTypeDeletion:
+        case static_cast<char>(ValueType::kTypeMerge):
+          if (GetLengthPrefixedSlice(&input, &key) &&
+              GetLengthPrefixedSlice(&input, &value)) {
+            handler->Merge(key, value);
+          } else {
+            return Status::Corruption("bad WriteBatch Merge");
+          }
+          break;
+        case static_cast<char>(ValueType::kTypeDeletion):
           if (GetLengthPrefixedSlice(&input, &key)) {
             handler->Delete(key);
           } else {
@@ -93,6 +158,48 @@ namespace yedis {
     PutLengthPrefixedSlice(&rep_, key);
   }
 
+  void WriteBatch::Put(ColumnFamilyHandle* column_family, const Slice& key, const Slice& value) {
+    if (column_family == nullptr || column_family->GetID() == 0) {
+      Put(key, value);
+      return;
+    }
+    WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+    rep_.push_back(kTypeColumnFamilyValue);
+    PutVarint32(&rep_, column_family->GetID());
+    PutLengthPrefixedSlice(&rep_, key);
+    PutLengthPrefixedSlice(&rep_, value);
+  }
+
+  void WriteBatch::Delete(ColumnFamilyHandle* column_family, const Slice& key) {
+    if (column_family == nullptr || column_family->GetID() == 0) {
+      Delete(key);
+      return;
+    }
+    WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+    rep_.push_back(kTypeColumnFamilyDeletion);
+    PutVarint32(&rep_, column_family->GetID());
+    PutLengthPrefixedSlice(&rep_, key);
+  }
+
+  void WriteBatch::Merge(const Slice& key, const Slice& value) {
+    WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+    rep_.push_back(static_cast<char>(ValueType::kTypeMerge));
+    PutLengthPrefixedSlice(&rep_, key);
+    PutLengthPrefixedSlice(&rep_, value);
+  }
+
+  void WriteBatch::Merge(ColumnFamilyHandle* column_family, const Slice& key, const Slice& value) {
+    if (column_family == nullptr || column_family->GetID() == 0) {
+      Merge(key, value);
+      return;
+    }
+    WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+    rep_.push_back(kTypeColumnFamilyMerge);
+    PutVarint32(&rep_, column_family->GetID());
+    PutLengthPrefixedSlice(&rep_, key);
+    PutLengthPrefixedSlice(&rep_, value);
+  }
+
   void WriteBatch::Append(const WriteBatch& source) {
     WriteBatchInternal::Append(this, &source);
   }
@@ -101,16 +208,68 @@ namespace yedis {
     class MemTableInserter : public WriteBatch::Handler {
     public:
       SequenceNumber sequence_;
-      MemTable* mem_;
+      // either a single memtable that takes every record, or one per
+      // column family
+      MemTable* mem_ = nullptr;
+      ColumnFamilyMemTables* cf_mems_ = nullptr;
 
       void Put(const Slice& key, const Slice& value) override {
-        mem_->Add(sequence_, ValueType::kTypeValue, key, value);
-        sequence_++;
+        PutCF(0, key, value);
       }
       void Delete(const Slice& key) override {
-        mem_->Add(sequence_, ValueType::kTypeDeletion, key, Slice());
+        DeleteCF(0, key);
+      }
+      void Merge(const Slice& key, const Slice& value) override {
+        MergeCF(0, key, value);
+      }
+      void PutCF(uint32_t column_family_id, const Slice& key, const Slice& value) override {
+        MemTable* mem = GetMemTable(column_family_id);
+        if (mem != nullptr) {
+          mem->Add(sequence_, ValueType::kTypeValue, key, value);
+        }
+        sequence_++;
+      }
+      void DeleteCF(uint32_t column_family_id, const Slice& key) override {
+        MemTable* mem = GetMemTable(column_family_id);
+        if (mem != nullptr) {
+          mem->Add(sequence_, ValueType::kTypeDeletion, key, Slice());
+        }
         sequence_++;
       }
+      void MergeCF(uint32_t column_family_id, const Slice& key, const Slice& value) override {
+        MemTable* mem = GetMemTable(column_family_id);
+        if (mem != nullptr) {
+          mem->Add(sequence_, ValueType::kTypeMerge, key, value);
+        }
+        sequence_++;
+      }
+
+    private:
+      MemTable* GetMemTable(uint32_t column_family_id) {
+        return cf_mems_ != nullptr ? cf_mems_->GetMemTable(column_family_id) : mem_;
+      }
+    };
+
+    class ColumnFamilyCollector : public WriteBatch::Handler {
+    public:
+      std::set<uint32_t>* ids_;
+      std::set<uint32_t>* merge_ids_;
+
+      void Put(const Slice& key, const Slice& value) override { ids_->insert(0); }
+      void Delete(const Slice& key) override { ids_->insert(0); }
+      void Merge(const Slice& key, const Slice& value) override { MergeCF(0, key, value); }
+      void PutCF(uint32_t column_family_id, const Slice& key, const Slice& value) override {
+        ids_->insert(column_family_id);
+      }
+      void DeleteCF(uint32_t column_family_id, const Slice& key) override {
+        ids_->insert(column_family_id);
+      }
+      void MergeCF(uint32_t column_family_id, const Slice& key, const Slice& value) override {
+        ids_->insert(column_family_id);
+        if (merge_ids_ != nullptr) {
+          merge_ids_->insert(column_family_id);
+        }
+      }
     };
   }  // namespace
 
@@ -121,6 +280,21 @@ namespace yedis {
     return b->Iterate(&inserter);
   }
 
+  Status WriteBatchInternal::InsertInto(const WriteBatch* b, ColumnFamilyMemTables* memtables) {
+    MemTableInserter inserter;
+    inserter.sequence_ = WriteBatchInternal::Sequence(b);
+    inserter.cf_mems_ = memtables;
+    return b->Iterate(&inserter);
+  }
+
+  Status WriteBatchInternal::ColumnFamilies(const WriteBatch* b, std::set<uint32_t>* ids,
+                                            std::set<uint32_t>* merge_ids) {
+    ColumnFamilyCollector collector;
+    collector.ids_ = ids;
+    collector.merge_ids_ = merge_ids;
+    return b->Iterate(&collector);
+  }
+
   void WriteBatchInternal::SetContents(WriteBatch* b, const Slice& contents) {
     assert(contents.size() >= kHeader);
     b->rep_.assign(contents.data(), contents.size());
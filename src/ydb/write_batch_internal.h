@@ -5,12 +5,22 @@
 #ifndef YEDIS_WRITE_BATCH_INTERNAL_H
 #define YEDIS_WRITE_BATCH_INTERNAL_H
 
+#include <set>
+
 #include "write_batch.h"
 #include "common/status.h"
 
 namespace yedis {
   class MemTable;
 
+  // Maps the column family of a batch record to the memtable it goes to.
+  class ColumnFamilyMemTables {
+  public:
+    virtual ~ColumnFamilyMemTables() = default;
+    // nullptr if there is no such column family
+    virtual MemTable* GetMemTable(uint32_t column_family_id) = 0;
+  };
+
 // WriteBatchInternal provides static methods for manipulating a
 // WriteBatch that we don't want in the public WriteBatch interface.
   class WriteBatchInternal {
@@ -35,6 +45,12 @@ namespace yedis {
     static void SetContents(WriteBatch* batch, const Slice& contents);
 
     static Status InsertInto(const WriteBatch* batch, MemTable* memtable);
+    static Status InsertInto(const WriteBatch* batch, ColumnFamilyMemTables* memtables);
+
+    // Ids of all column families "batch" writes to, and if "merge_ids" is
+    // non-null, of those it merges into.
+    static Status ColumnFamilies(const WriteBatch* batch, std::set<uint32_t>* ids,
+                                 std::set<uint32_t>* merge_ids = nullptr);
 
     static void Append(WriteBatch* dst, const WriteBatch* src);
   };
@@ -0,0 +1,90 @@
+//
+// Hashes stored as one key per field, see yedis_keyspace.hpp.
+//
+
+#include <map>
+#include <memory>
+
+#include <yedis_hash.hpp>
+#include <db.h>
+#include <iterator.h>
+#include <write_batch.h>
+
+namespace yedis {
+
+Status Hash::hset(const Slice &key, const FieldValues &field_values, int *added) {
+  // the last value of a field given twice wins
+  std::map<std::string, std::string> fields;
+  for (auto& [field, value]: field_values) {
+    fields[field] = value;
+  }
+  DB *db = keyspace_->db();
+  ColumnFamilyHandle *cf = keyspace_->column_family();
+  std::lock_guard<std::mutex> lock(keyspace_->KeyLock(key));
+  KeyMeta meta;
+  auto status = keyspace_->GetMeta(key, KeyType::kHash, &meta);
+  const bool created = status.IsNotFound();
+  if (created) {
+    meta = keyspace_->NewMeta(KeyType::kHash);
+  } else if (!status.ok()) {
+    return status;
+  }
+  WriteBatch batch;
+  int new_fields = 0;
+  for (auto& [field, value]: fields) {
+    const std::string member_key = MemberKey(KeyType::kHash, key, meta.version, field);
+    if (!created) {
+      std::string old_value;
+      status = db->Get(keyspace_->read_options(), cf, member_key, &old_value);
+      if (status.IsNotFound()) {
+        new_fields++;
+      } else if (!status.ok()) {
+        return status;
+      }
+    } else {
+      new_fields++;
+    }
+    batch.Put(cf, member_key, value);
+  }
+  if (new_fields > 0) {
+    meta.size += new_fields;
+    std::string meta_value;
+    EncodeMeta(meta, &meta_value);
+    batch.Put(cf, MetaKey(key), meta_value);
+  }
+  status = db->Write(keyspace_->write_options(), &batch);
+  if (status.ok() && added != nullptr) {
+    *added = new_fields;
+  }
+  return status;
+}
+
+Status Hash::hget(const Slice &key, const Slice &field, std::string *value) {
+  KeyMeta meta;
+  auto status = keyspace_->GetMeta(key, KeyType::kHash, &meta);
+  if (!status.ok()) {
+    return status;
+  }
+  return keyspace_->db()->Get(keyspace_->read_options(), keyspace_->column_family(),
+                              MemberKey(KeyType::kHash, key, meta.version, field), value);
+}
+
+Status Hash::hgetall(const Slice &key, FieldValues *result) {
+  result->clear();
+  KeyMeta meta;
+  auto status = keyspace_->GetMeta(key, KeyType::kHash, &meta);
+  if (status.IsNotFound()) {
+    return Status::OK();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  const std::string prefix = MemberPrefix(KeyType::kHash, key, meta.version);
+  std::unique_ptr<Iterator> it(keyspace_->db()->NewIterator(keyspace_->read_options(),
+                                                            keyspace_->column_family()));
+  for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix); it->Next()) {
+    result->emplace_back(it->key().ToString().substr(prefix.size()), it->value().ToString());
+  }
+  return it->status();
+}
+}
@@ -0,0 +1,279 @@
+//
+// Key encoding and meta versioning shared by hashes, sets and lists.
+//
+
+#include <chrono>
+
+#include <yedis_keyspace.hpp>
+#include <db.h>
+#include <util.hpp>
+
+namespace yedis {
+
+static const char kMetaPrefix = 'M';
+static const char *kWrongTypeMessage = "WRONGTYPE Operation against a key holding the wrong kind of value";
+
+void PutBigEndian64(std::string *dst, uint64_t value) {
+  char buf[sizeof(value)];
+  for (int i = sizeof(value) - 1; i >= 0; i--) {
+    buf[i] = static_cast<char>(value & 0xff);
+    value >>= 8;
+  }
+  dst->append(buf, sizeof(buf));
+}
+
+uint64_t DecodeBigEndian64(const char *p) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(value); i++) {
+    value = (value << 8) | static_cast<uint8_t>(p[i]);
+  }
+  return value;
+}
+
+std::string MetaKey(const Slice &key) {
+  std::string meta_key(1, kMetaPrefix);
+  PutLengthPrefixedSlice(&meta_key, key);
+  return meta_key;
+}
+
+std::string MemberPrefix(KeyType type, const Slice &key, uint64_t version) {
+  std::string prefix(1, static_cast<char>(type));
+  PutLengthPrefixedSlice(&prefix, key);
+  PutBigEndian64(&prefix, version);
+  return prefix;
+}
+
+std::string MemberKey(KeyType type, const Slice &key, uint64_t version, const Slice &sub_key) {
+  std::string member_key = MemberPrefix(type, key, version);
+  member_key.append(sub_key.data(), sub_key.size());
+  return member_key;
+}
+
+void EncodeMeta(const KeyMeta &meta, std::string *value) {
+  value->clear();
+  value->push_back(static_cast<char>(meta.type));
+  PutFixed<uint64_t>(value, meta.version);
+  PutFixed<uint64_t>(value, static_cast<uint64_t>(meta.size));
+  if (meta.type == KeyType::kList) {
+    PutFixed<uint64_t>(value, meta.head);
+    PutFixed<uint64_t>(value, meta.tail);
+  }
+}
+
+Status DecodeMeta(const Slice &value, KeyMeta *meta) {
+  static const size_t kBaseSize = 1 + 2 * sizeof(uint64_t);
+  if (value.size() < kBaseSize) {
+    return Status::Corruption("bad meta value");
+  }
+  const char *p = value.data();
+  switch (p[0]) {
+    case static_cast<char>(KeyType::kHash):
+    case static_cast<char>(KeyType::kSet):
+    case static_cast<char>(KeyType::kList):
+      meta->type = static_cast<KeyType>(p[0]);
+      break;
+    default:
+      return Status::Corruption("unknown key type");
+  }
+  const size_t expected = meta->type == KeyType::kList ? kBaseSize + 2 * sizeof(uint64_t) : kBaseSize;
+  if (value.size() != expected) {
+    return Status::Corruption("bad meta value");
+  }
+  meta->version = DecodeFixed64(p + 1);
+  meta->size = static_cast<int64_t>(DecodeFixed64(p + 1 + sizeof(uint64_t)));
+  if (meta->type == KeyType::kList) {
+    meta->head = DecodeFixed64(p + kBaseSize);
+    meta->tail = DecodeFixed64(p + kBaseSize + sizeof(uint64_t));
+  } else {
+    meta->head = meta->tail = 0;
+  }
+  return Status::OK();
+}
+
+Status WrongType() {
+  return Status::InvalidArgument(kWrongTypeMessage);
+}
+
+bool IsWrongType(const Status &s) {
+  return s.IsInvalidArgument() && s.ToString().find("WRONGTYPE") != std::string::npos;
+}
+
+uint64_t NewKeyVersion() {
+  static std::atomic<uint64_t> last_version(0);
+  const uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  uint64_t last = last_version.load(std::memory_order_relaxed);
+  uint64_t version;
+  do {
+    version = std::max(now, last + 1);
+  } while (!last_version.compare_exchange_weak(last, version, std::memory_order_relaxed));
+  return version;
+}
+
+void VersionGCFilter::Attach(DB *db, ColumnFamilyHandle *meta_cf) {
+  meta_cf_.store(meta_cf, std::memory_order_relaxed);
+  db_.store(db, std::memory_order_release);
+}
+
+void VersionGCFilter::Detach() {
+  db_.store(nullptr, std::memory_order_release);
+}
+
+namespace {
+// The meta version last read by a flush or compaction thread.  Members of
+// a collection are adjacent in its input, most of them are decided
+// without reading the meta key again.
+struct MetaVersionCache {
+  const VersionGCFilter *filter = nullptr;
+  std::string meta_key;
+  uint64_t version = 0;
+};
+thread_local MetaVersionCache meta_version_cache;
+}
+
+bool VersionGCFilter::Filter(const Slice &key, const Slice &value) const {
+  DB *db = db_.load(std::memory_order_acquire);
+  if (db == nullptr) {
+    return false;
+  }
+  std::string meta_key;
+  uint64_t version;
+  if (!ParseMemberKey(key, &meta_key, &version)) {
+    return false;
+  }
+  MetaVersionCache &cache = meta_version_cache;
+  // Versions only grow: a member older than a meta version seen before is
+  // garbage and a member of that version was alive.  A newer member, or a
+  // collection without a cached meta, needs a fresh look.
+  if (cache.filter == this && cache.meta_key == meta_key && version <= cache.version) {
+    return version < cache.version;
+  }
+  std::string meta_value;
+  auto status = db->Get(ReadOptions(), meta_cf_.load(std::memory_order_relaxed), meta_key, &meta_value);
+  if (status.IsNotFound()) {
+    return true;
+  }
+  uint64_t meta_version;
+  if (!status.ok() || !ParseMetaVersion(meta_value, &meta_version)) {
+    // keep what cannot be decided
+    return false;
+  }
+  cache.filter = this;
+  cache.meta_key = meta_key;
+  cache.version = meta_version;
+  return version != meta_version;
+}
+
+namespace {
+class KeySpaceGCFilter : public VersionGCFilter {
+public:
+  const char *Name() const override { return "yedis.KeySpaceGCFilter"; }
+
+protected:
+  bool ParseMemberKey(const Slice &key, std::string *meta_key, uint64_t *version) const override {
+    if (key.empty() || (key[0] != static_cast<char>(KeyType::kHash) && key[0] != static_cast<char>(KeyType::kSet)
+                        && key[0] != static_cast<char>(KeyType::kList))) {
+      return false;
+    }
+    Slice input(key.data() + 1, key.size() - 1);
+    Slice user_key;
+    if (!GetLengthPrefixedSlice(&input, &user_key) || input.size() < sizeof(uint64_t)) {
+      return false;
+    }
+    *meta_key = MetaKey(user_key);
+    *version = DecodeBigEndian64(input.data());
+    return true;
+  }
+
+  bool ParseMetaVersion(const Slice &meta_value, uint64_t *version) const override {
+    KeyMeta meta;
+    if (!DecodeMeta(meta_value, &meta).ok()) {
+      return false;
+    }
+    *version = meta.version;
+    return true;
+  }
+};
+}
+
+VersionGCFilter *NewKeySpaceGCFilter() {
+  return new KeySpaceGCFilter();
+}
+
+KeySpace::KeySpace(DB *db, ColumnFamilyHandle *column_family)
+    : db_(db),
+      column_family_(column_family != nullptr ? column_family : db->DefaultColumnFamily()) {}
+
+std::mutex &KeySpace::KeyLock(const Slice &key) {
+  return key_locks_[Hash64(key.data(), key.size(), 0) % kNumKeyLocks];
+}
+
+KeyMeta KeySpace::NewMeta(KeyType type) {
+  KeyMeta meta;
+  meta.type = type;
+  meta.version = NewKeyVersion();
+  // room to grow in both directions
+  meta.head = meta.tail = 1ull << 63;
+  return meta;
+}
+
+Status KeySpace::GetMeta(const Slice &key, KeyType type, KeyMeta *meta) {
+  std::string value;
+  auto status = db_->Get(read_options_, column_family_, MetaKey(key), &value);
+  if (!status.ok()) {
+    return status;
+  }
+  status = DecodeMeta(value, meta);
+  if (status.ok() && meta->type != type) {
+    return WrongType();
+  }
+  return status;
+}
+
+Status KeySpace::del(const Slice &key, bool *existed) {
+  const std::string meta_key = MetaKey(key);
+  std::lock_guard<std::mutex> lock(KeyLock(key));
+  std::string value;
+  auto status = db_->Get(read_options_, column_family_, meta_key, &value);
+  if (status.IsNotFound()) {
+    *existed = false;
+    return Status::OK();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  status = db_->Delete(write_options_, column_family_, meta_key);
+  if (status.ok()) {
+    *existed = true;
+  }
+  return status;
+}
+
+Status KeySpace::type(const Slice &key, std::string *type) {
+  std::string value;
+  auto status = db_->Get(read_options_, column_family_, MetaKey(key), &value);
+  if (status.IsNotFound()) {
+    *type = "none";
+    return Status::OK();
+  }
+  KeyMeta meta;
+  if (status.ok()) {
+    status = DecodeMeta(value, &meta);
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  switch (meta.type) {
+    case KeyType::kHash:
+      *type = "hash";
+      break;
+    case KeyType::kSet:
+      *type = "set";
+      break;
+    case KeyType::kList:
+      *type = "list";
+      break;
+  }
+  return Status::OK();
+}
+}
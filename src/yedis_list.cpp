@@ -0,0 +1,112 @@
+//
+// Lists stored as one key per element, see yedis_keyspace.hpp.
+//
+
+#include <memory>
+
+#include <yedis_list.hpp>
+#include <db.h>
+#include <iterator.h>
+#include <write_batch.h>
+
+namespace yedis {
+
+static std::string ElementKey(const Slice &key, uint64_t version, uint64_t index) {
+  std::string element_key = MemberPrefix(KeyType::kList, key, version);
+  PutBigEndian64(&element_key, index);
+  return element_key;
+}
+
+Status List::lpush(const Slice &key, const StrList &values, int64_t *length) {
+  DB *db = keyspace_->db();
+  ColumnFamilyHandle *cf = keyspace_->column_family();
+  std::lock_guard<std::mutex> lock(keyspace_->KeyLock(key));
+  KeyMeta meta;
+  auto status = keyspace_->GetMeta(key, KeyType::kList, &meta);
+  if (status.IsNotFound()) {
+    meta = keyspace_->NewMeta(KeyType::kList);
+  } else if (!status.ok()) {
+    return status;
+  }
+  WriteBatch batch;
+  for (auto& value: values) {
+    meta.head--;
+    batch.Put(cf, ElementKey(key, meta.version, meta.head), value);
+  }
+  meta.size += static_cast<int64_t>(values.size());
+  std::string meta_value;
+  EncodeMeta(meta, &meta_value);
+  batch.Put(cf, MetaKey(key), meta_value);
+  status = db->Write(keyspace_->write_options(), &batch);
+  if (status.ok() && length != nullptr) {
+    *length = meta.size;
+  }
+  return status;
+}
+
+Status List::rpop(const Slice &key, std::string *value) {
+  DB *db = keyspace_->db();
+  ColumnFamilyHandle *cf = keyspace_->column_family();
+  std::lock_guard<std::mutex> lock(keyspace_->KeyLock(key));
+  KeyMeta meta;
+  auto status = keyspace_->GetMeta(key, KeyType::kList, &meta);
+  if (!status.ok()) {
+    return status;
+  }
+  if (meta.size == 0) {
+    return Status::NotFound("empty list");
+  }
+  const std::string element_key = ElementKey(key, meta.version, meta.tail - 1);
+  status = db->Get(keyspace_->read_options(), cf, element_key, value);
+  if (status.IsNotFound()) {
+    return Status::Corruption("missing list element");
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  WriteBatch batch;
+  batch.Delete(cf, element_key);
+  meta.tail--;
+  meta.size--;
+  if (meta.size == 0) {
+    // an empty list does not exist
+    batch.Delete(cf, MetaKey(key));
+  } else {
+    std::string meta_value;
+    EncodeMeta(meta, &meta_value);
+    batch.Put(cf, MetaKey(key), meta_value);
+  }
+  return db->Write(keyspace_->write_options(), &batch);
+}
+
+Status List::lrange(const Slice &key, int64_t start, int64_t stop, StrList *result) {
+  result->clear();
+  KeyMeta meta;
+  auto status = keyspace_->GetMeta(key, KeyType::kList, &meta);
+  if (status.IsNotFound()) {
+    return Status::OK();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  if (start < 0) {
+    start = std::max<int64_t>(meta.size + start, 0);
+  }
+  if (stop < 0) {
+    stop = meta.size + stop;
+  }
+  stop = std::min(stop, meta.size - 1);
+  if (start > stop) {
+    return Status::OK();
+  }
+  const std::string prefix = MemberPrefix(KeyType::kList, key, meta.version);
+  std::unique_ptr<Iterator> it(keyspace_->db()->NewIterator(keyspace_->read_options(),
+                                                            keyspace_->column_family()));
+  int64_t count = stop - start + 1;
+  for (it->Seek(ElementKey(key, meta.version, meta.head + start));
+       count > 0 && it->Valid() && it->key().starts_with(prefix); it->Next(), count--) {
+    result->push_back(it->value().ToString());
+  }
+  return it->status();
+}
+}
@@ -0,0 +1,96 @@
+//
+// Sets stored as one key per member, see yedis_keyspace.hpp.
+//
+
+#include <memory>
+#include <set>
+
+#include <yedis_set.hpp>
+#include <db.h>
+#include <iterator.h>
+#include <write_batch.h>
+
+namespace yedis {
+
+Status Set::sadd(const Slice &key, const StrList &members, int *added) {
+  const std::set<std::string> unique(members.begin(), members.end());
+  DB *db = keyspace_->db();
+  ColumnFamilyHandle *cf = keyspace_->column_family();
+  std::lock_guard<std::mutex> lock(keyspace_->KeyLock(key));
+  KeyMeta meta;
+  auto status = keyspace_->GetMeta(key, KeyType::kSet, &meta);
+  const bool created = status.IsNotFound();
+  if (created) {
+    meta = keyspace_->NewMeta(KeyType::kSet);
+  } else if (!status.ok()) {
+    return status;
+  }
+  WriteBatch batch;
+  int new_members = 0;
+  for (auto& member: unique) {
+    const std::string member_key = MemberKey(KeyType::kSet, key, meta.version, member);
+    if (!created) {
+      std::string value;
+      status = db->Get(keyspace_->read_options(), cf, member_key, &value);
+      if (status.ok()) {
+        continue;
+      }
+      if (!status.IsNotFound()) {
+        return status;
+      }
+    }
+    new_members++;
+    batch.Put(cf, member_key, Slice());
+  }
+  if (new_members > 0) {
+    meta.size += new_members;
+    std::string meta_value;
+    EncodeMeta(meta, &meta_value);
+    batch.Put(cf, MetaKey(key), meta_value);
+  }
+  status = db->Write(keyspace_->write_options(), &batch);
+  if (status.ok() && added != nullptr) {
+    *added = new_members;
+  }
+  return status;
+}
+
+Status Set::sismember(const Slice &key, const Slice &member, bool *is_member) {
+  *is_member = false;
+  KeyMeta meta;
+  auto status = keyspace_->GetMeta(key, KeyType::kSet, &meta);
+  if (status.IsNotFound()) {
+    return Status::OK();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  std::string value;
+  status = keyspace_->db()->Get(keyspace_->read_options(), keyspace_->column_family(),
+                                MemberKey(KeyType::kSet, key, meta.version, member), &value);
+  if (status.IsNotFound()) {
+    return Status::OK();
+  }
+  *is_member = status.ok();
+  return status;
+}
+
+Status Set::smembers(const Slice &key, StrList *result) {
+  result->clear();
+  KeyMeta meta;
+  auto status = keyspace_->GetMeta(key, KeyType::kSet, &meta);
+  if (status.IsNotFound()) {
+    return Status::OK();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  const std::string prefix = MemberPrefix(KeyType::kSet, key, meta.version);
+  std::unique_ptr<Iterator> it(keyspace_->db()->NewIterator(keyspace_->read_options(),
+                                                            keyspace_->column_family()));
+  for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix); it->Next()) {
+    result->push_back(it->key().ToString().substr(prefix.size()));
+  }
+  return it->status();
+}
+}
@@ -2,73 +2,669 @@
 // Created by skyitachi on 2020/8/12.
 //
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+
 #include <yedis_zset.hpp>
 #include <spdlog/spdlog.h>
 #include <write_batch.h>
 #include <options.h>
 #include <db.h>
+#include <filter_policy.h>
+#include <iterator.h>
+#include <merge_operator.h>
 
 namespace yedis {
 
-Status ZSet::zadd(const Slice &key, const std::vector<ScoreMember> &member) {
-  const std::string key_str = key.ToString();
-  std::string meta_key = kMetaKey + key_str;
-  WriteBatch batch;
-  std::lock_guard<std::mutex> lock(mutex_);
-  // fetch meta data need transaction or mutex
+ZSet::ZSet(DB *db)
+    : db_(db),
+      meta_cf_(db->DefaultColumnFamily()),
+      index_cf_(db->DefaultColumnFamily()),
+      data_cf_(db->DefaultColumnFamily()) {}
+
+Options ZSet::MetaColumnFamilyOptions(const Options &base) {
+  static const FilterPolicy* bloom = NewBloomFilterPolicy(10);
+  Options options = base;
+  options.block_size = 1024;
+  options.filter_policy = bloom;
+  options.full_filter = true;
+  static const MergeOperator* counter = NewInt64AddOperator();
+  options.merge_operator = counter;
+  return options;
+}
+
+Options ZSet::IndexColumnFamilyOptions(const Options &base) {
+  Options options = base;
+  options.block_size = 16 * 1024;
+  options.filter_policy = nullptr;
+  return options;
+}
+
+Options ZSet::DataColumnFamilyOptions(const Options &base) {
+  Options options = base;
+  options.block_size = 64 * 1024;
+  options.filter_policy = nullptr;
+  return options;
+}
+
+// Flipping the sign bit of positive doubles and all bits of negative ones
+// makes their big-endian bytes compare like the numbers do.
+static void PutScore(std::string *dst, double score) {
+  if (score == 0) {
+    // -0.0 == 0.0, they must not end up as different index keys
+    score = 0;
+  }
+  uint64_t bits;
+  memcpy(&bits, &score, sizeof(bits));
+  if (bits & (1ull << 63)) {
+    bits = ~bits;
+  } else {
+    bits |= 1ull << 63;
+  }
+  char buf[sizeof(bits)];
+  for (int i = sizeof(bits) - 1; i >= 0; i--) {
+    buf[i] = static_cast<char>(bits & 0xff);
+    bits >>= 8;
+  }
+  dst->append(buf, sizeof(buf));
+}
+
+static double DecodeScore(const char *p) {
+  uint64_t bits = 0;
+  for (size_t i = 0; i < sizeof(bits); i++) {
+    bits = (bits << 8) | static_cast<uint8_t>(p[i]);
+  }
+  if (bits & (1ull << 63)) {
+    bits &= ~(1ull << 63);
+  } else {
+    bits = ~bits;
+  }
+  double score;
+  memcpy(&score, &bits, sizeof(score));
+  return score;
+}
+
+static const size_t kScoreSize = sizeof(uint64_t);
+
+static std::string EncodeCount(int64_t count) {
   std::string value;
-  int count = 0;
-  std::string meta_value;
-  auto status = db_->Get(default_read_options_, meta_key, &value);
+  PutFixed<uint64_t>(&value, static_cast<uint64_t>(count));
+  return value;
+}
 
+std::mutex &ZSet::KeyLock(const Slice &key) {
+  return key_locks_[Hash64(key.data(), key.size(), 0) % kNumKeyLocks];
+}
+
+std::string ZSet::MetaKey(const Slice &key) const {
+  return kMetaKey + key.ToString();
+}
+
+std::string ZSet::VersionedKey(const Slice &key, uint64_t version) {
+  std::string vkey;
+  PutLengthPrefixedSlice(&vkey, key);
+  PutBigEndian64(&vkey, version);
+  return vkey;
+}
+
+std::string ZSet::DataKey(const Slice &vkey, const Slice &member) const {
+  std::string data_key = kDataKeyPrefix;
+  data_key.append(vkey.data(), vkey.size());
+  data_key.append(member.data(), member.size());
+  return data_key;
+}
+
+std::string ZSet::IndexPrefix(const Slice &vkey) const {
+  std::string prefix = kIndexKeyPrefix;
+  prefix.append(vkey.data(), vkey.size());
+  return prefix;
+}
+
+std::string ZSet::RankKey(const Slice &vkey, int level, const Slice &bucket) const {
+  std::string rank_key = kRankKeyPrefix;
+  rank_key.append(vkey.data(), vkey.size());
+  rank_key.push_back(static_cast<char>(level));
+  rank_key.append(bucket.data(), bucket.size());
+  return rank_key;
+}
+
+Status ZSet::GetVersion(const Slice &key, uint64_t *version) {
+  std::string value;
+  auto status = db_->Get(default_read_options_, meta_cf_, MetaKey(key), &value);
+  if (!status.ok()) {
+    return status;
+  }
+  if (value.size() != sizeof(uint64_t)) {
+    return Status::Corruption("bad zset meta value");
+  }
+  *version = DecodeFixed64(value.data());
+  return status;
+}
+
+Status ZSet::GetOrCreateVersion(WriteBatch *batch, const Slice &key, uint64_t *version) {
+  auto status = GetVersion(key, version);
+  if (!status.IsNotFound()) {
+    return status;
+  }
+  *version = NewKeyVersion();
+  std::string value;
+  PutFixed<uint64_t>(&value, *version);
+  batch->Put(meta_cf_, MetaKey(key), value);
+  return Status::OK();
+}
+
+static std::string EncodeScore(double score) {
+  std::string encoded;
+  PutScore(&encoded, score);
+  return encoded;
+}
+
+static std::string IndexKey(const std::string &prefix, double score, const Slice &member) {
+  std::string index_key = prefix;
+  PutScore(&index_key, score);
+  index_key.append(member.data(), member.size());
+  return index_key;
+}
+
+Status ZSet::GetScore(const std::string &data_key, bool *found, double *score) {
+  std::string value;
+  auto status = db_->Get(default_read_options_, data_cf_, data_key, &value);
+  *found = false;
   if (status.IsNotFound()) {
-    PutFixed32(&meta_value, 0);
-    batch.Put(meta_key, meta_value);
-  } else {
-    count = DecodeFixed32(value.c_str());
-    count += 1;
-    PutFixed32(&meta_value, count);
-    batch.Put(meta_key, meta_value);
+    return Status::OK();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  if (value.size() != kScoreSize) {
+    return Status::Corruption("bad zset score");
+  }
+  *found = true;
+  *score = DecodeScore(value.data());
+  return status;
+}
+
+// The encoded score and as many leading member bytes as there are levels
+// below the score ones.
+static std::string RankPath(double score, const Slice &member, size_t levels) {
+  std::string path = EncodeScore(score);
+  path.append(member.data(), std::min(member.size(), levels - kScoreSize));
+  return path;
+}
+
+int ZSet::RankDepth(const std::string &path) {
+  return static_cast<int>(std::min<size_t>(kRankLevels, path.size() + 1));
+}
+
+// The level "level" bucket of "path", the whole path if it is shorter.
+static Slice RankBucket(const std::string &path, int level) {
+  return Slice(path.data(), std::min<size_t>(level, path.size()));
+}
+
+void ZSet::UpdateRankCounts(RankDeltas *deltas, const Slice &vkey, double score, const Slice &member,
+                            int64_t delta) {
+  const std::string path = RankPath(score, member, kRankLevels);
+  // the level 0 bucket holds every member, a path ends in the level one
+  // deeper than its length
+  for (int level = 0; level <= RankDepth(path); level++) {
+    (*deltas)[RankKey(vkey, level, RankBucket(path, level))] += delta;
+  }
+}
+
+void ZSet::WriteRankCounts(WriteBatch *batch, const RankDeltas &deltas) {
+  for (auto& [rank_key, delta]: deltas) {
+    // the buckets a member moves within cancel out
+    if (delta != 0) {
+      batch->Merge(meta_cf_, rank_key, EncodeCount(delta));
+    }
+  }
+}
+
+static Status DecodeCount(const Slice &value, int64_t *count) {
+  if (value.size() != sizeof(uint64_t)) {
+    return Status::Corruption("bad zset count");
+  }
+  *count = static_cast<int64_t>(DecodeFixed64(value.data()));
+  return Status::OK();
+}
+
+Status ZSet::CountLowerBuckets(Iterator *rank_iter, const Slice &vkey, int level,
+                               const std::string &bucket, int64_t *count) {
+  *count = 0;
+  // the bucket of a path shorter than the level is the first of its siblings
+  const std::string siblings = RankKey(vkey, level, RankBucket(bucket, level - 1));
+  const std::string limit = RankKey(vkey, level, bucket);
+  for (rank_iter->Seek(siblings); rank_iter->Valid() && rank_iter->key().compare(limit) < 0;
+       rank_iter->Next()) {
+    int64_t bucket_count;
+    auto status = DecodeCount(rank_iter->value(), &bucket_count);
+    if (!status.ok()) {
+      return status;
+    }
+    *count += bucket_count;
+  }
+  return rank_iter->status();
+}
+
+Status ZSet::SeekToRank(Iterator *rank_iter, Iterator *index_iter, const Slice &vkey, int64_t rank) {
+  if (rank < 0) {
+    return Status::NotFound("rank out of range");
+  }
+  // descend into the bucket holding the rank, one level at a time
+  std::string bucket;
+  for (int level = 1; level <= kRankLevels; level++) {
+    const size_t level_prefix_size = RankKey(vkey, level, Slice()).size();
+    const std::string children = RankKey(vkey, level, bucket);
+    bool found = false;
+    for (rank_iter->Seek(children); rank_iter->Valid() && rank_iter->key().starts_with(children);
+         rank_iter->Next()) {
+      int64_t bucket_count;
+      auto status = DecodeCount(rank_iter->value(), &bucket_count);
+      if (!status.ok()) {
+        return status;
+      }
+      if (rank < bucket_count) {
+        // one byte longer, or the same path if it ends here
+        bucket.assign(rank_iter->key().data() + level_prefix_size,
+                      rank_iter->key().size() - level_prefix_size);
+        found = true;
+        break;
+      }
+      rank -= bucket_count;
+    }
+    if (!rank_iter->status().ok()) {
+      return rank_iter->status();
+    }
+    if (!found) {
+      return Status::NotFound("rank out of range");
+    }
+    if (bucket.size() < static_cast<size_t>(level)) {
+      // the members of an ended path have no deeper buckets
+      break;
+    }
   }
-  spdlog::info("current count {}", count);
+  index_iter->Seek(IndexPrefix(vkey) + bucket);
+  for (; rank > 0 && index_iter->Valid(); rank--) {
+    index_iter->Next();
+  }
+  return index_iter->status();
+}
+
+Status ZSet::CountMembers(const Slice &vkey, int64_t *count) {
+  std::string value;
+  auto status = db_->Get(default_read_options_, meta_cf_, RankKey(vkey, 0, Slice()), &value);
+  if (status.IsNotFound()) {
+    *count = 0;
+    return Status::OK();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  return DecodeCount(value, count);
+}
+
+Status ZSet::zadd(const Slice &key, const std::vector<ScoreMember> &member, int *added) {
+  // the last score of a member given twice wins
+  std::map<std::string, double> scores;
   for (auto& score_member: member) {
-    std::string value_key = key_str;
-    PutFixed32(&value_key, score_member.score);
-    value_key.append(score_member.member);
-    batch.Put(value_key, Slice());
+    if (std::isnan(score_member.score)) {
+      return Status::InvalidArgument("zset score is not a number");
+    }
+    scores[score_member.member] = score_member.score;
+  }
+  if (scores.empty()) {
+    // an empty zset does not exist
+    if (added != nullptr) {
+      *added = 0;
+    }
+    return Status::OK();
+  }
+  std::lock_guard<std::mutex> lock(KeyLock(key));
+  WriteBatch batch;
+  uint64_t version;
+  auto status = GetOrCreateVersion(&batch, key, &version);
+  if (!status.ok()) {
+    return status;
+  }
+  const std::string vkey = VersionedKey(key, version);
+  const std::string prefix = IndexPrefix(vkey);
+  int new_members = 0;
+  RankDeltas deltas;
+  for (auto& [m, score]: scores) {
+    const std::string data_key = DataKey(vkey, m);
+    bool found;
+    double old_score;
+    status = GetScore(data_key, &found, &old_score);
+    if (!status.ok()) {
+      return status;
+    }
+    if (found && old_score == score) {
+      continue;
+    }
+    if (found) {
+      batch.Delete(index_cf_, IndexKey(prefix, old_score, m));
+      UpdateRankCounts(&deltas, vkey, old_score, m, -1);
+    } else {
+      new_members++;
+    }
+    UpdateRankCounts(&deltas, vkey, score, m, 1);
+    std::string value;
+    PutScore(&value, score);
+    batch.Put(data_cf_, data_key, value);
+    batch.Put(index_cf_, IndexKey(prefix, score, m), Slice());
+  }
+  WriteRankCounts(&batch, deltas);
+  status = db_->Write(default_write_options_, &batch);
+  if (status.ok() && added != nullptr) {
+    *added = new_members;
+  }
+  return status;
+}
+
+Status ZSet::zcard(const Slice &key, int64_t *count) {
+  uint64_t version;
+  auto status = GetVersion(key, &version);
+  if (status.IsNotFound()) {
+    *count = 0;
+    return Status::OK();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  return CountMembers(VersionedKey(key, version), count);
+}
+
+Status ZSet::zincrby(const Slice &key, double increment, const std::string &member, double *score) {
+  std::lock_guard<std::mutex> lock(KeyLock(key));
+  WriteBatch batch;
+  uint64_t version;
+  auto status = GetOrCreateVersion(&batch, key, &version);
+  if (!status.ok()) {
+    return status;
+  }
+  const std::string vkey = VersionedKey(key, version);
+  const std::string data_key = DataKey(vkey, member);
+  const std::string prefix = IndexPrefix(vkey);
+  bool found;
+  double old_score;
+  status = GetScore(data_key, &found, &old_score);
+  if (!status.ok()) {
+    return status;
+  }
+  double new_score = increment;
+  if (found) {
+    new_score += old_score;
+  }
+  if (std::isnan(new_score)) {
+    return Status::InvalidArgument("zset score is not a number");
+  }
+  RankDeltas deltas;
+  if (found) {
+    batch.Delete(index_cf_, IndexKey(prefix, old_score, member));
+    UpdateRankCounts(&deltas, vkey, old_score, member, -1);
+  }
+  UpdateRankCounts(&deltas, vkey, new_score, member, 1);
+  WriteRankCounts(&batch, deltas);
+  std::string value;
+  PutScore(&value, new_score);
+  batch.Put(data_cf_, data_key, value);
+  batch.Put(index_cf_, IndexKey(prefix, new_score, member), Slice());
+  status = db_->Write(default_write_options_, &batch);
+  if (status.ok()) {
+    *score = new_score;
+  }
+  return status;
+}
 
-    std::string index_key = kIndexKeyPrefix + key_str;
-    PutFixed32(&index_key, count);
-    spdlog::info("index_key: {}", index_key.size());
-    spdlog::info("member value: {}", score_member.member);
-    batch.Put(index_key, score_member.member);
-    count += 1;
+Status ZSet::zscore(const Slice &key, const std::string &member, double *score) {
+  uint64_t version;
+  auto status = GetVersion(key, &version);
+  if (!status.ok()) {
+    return status;
+  }
+  bool found;
+  status = GetScore(DataKey(VersionedKey(key, version), member), &found, score);
+  if (status.ok() && !found) {
+    return Status::NotFound(member);
+  }
+  return status;
+}
+
+Status ZSet::zrank(const Slice &key, const std::string &member, int64_t *rank) {
+  uint64_t version;
+  auto status = GetVersion(key, &version);
+  if (!status.ok()) {
+    return status;
+  }
+  const std::string vkey = VersionedKey(key, version);
+  bool found;
+  double score;
+  status = GetScore(DataKey(vkey, member), &found, &score);
+  if (!status.ok()) {
+    return status;
   }
-  return db_->Write(default_write_options_, &batch);
+  if (!found) {
+    return Status::NotFound(member);
+  }
+  const std::string path = RankPath(score, member, kRankLevels);
+  std::unique_ptr<Iterator> rank_iter(db_->NewIterator(default_read_options_, meta_cf_));
+  int64_t position = 0;
+  for (int level = 1; level <= RankDepth(path); level++) {
+    int64_t lower;
+    status = CountLowerBuckets(rank_iter.get(), vkey, level, RankBucket(path, level).ToString(), &lower);
+    if (!status.ok()) {
+      return status;
+    }
+    position += lower;
+  }
+  // the members of the deepest bucket ranked below
+  const std::string bucket = IndexPrefix(vkey) + path;
+  const std::string target = IndexKey(IndexPrefix(vkey), score, member);
+  std::unique_ptr<Iterator> it(db_->NewIterator(default_read_options_, index_cf_));
+  for (it->Seek(bucket); it->Valid() && it->key().starts_with(bucket); it->Next()) {
+    if (it->key() == Slice(target)) {
+      *rank = position;
+      return Status::OK();
+    }
+    position++;
+  }
+  if (!it->status().ok()) {
+    return it->status();
+  }
+  // removed since the score was read
+  return Status::NotFound(member);
 }
 
 ZSet::StrList ZSet::zrange(const std::string& key, int start, int stop) {
-  std::string index_key = kIndexKeyPrefix + key;
-  PutFixed32(&index_key, start);
-
-  // use iterator
-  ReadOptions read_options;
-  Slice lower_bound(index_key);
-  read_options.iterate_lower_bound = lower_bound;
-  auto it = db_->NewIterator(read_options);
   std::vector<std::string> ret;
-  int count = 0;
-  for (it->Seek(lower_bound); it->Valid(); it->Next()) {
-    ret.push_back(it->value().ToString());
-    if (start + count >= stop) {
-      break;
+  uint64_t version;
+  if (!GetVersion(key, &version).ok()) {
+    return ret;
+  }
+  const std::string vkey = VersionedKey(key, version);
+  if (start < 0 || stop < 0) {
+    int64_t count;
+    if (!CountMembers(vkey, &count).ok()) {
+      return ret;
+    }
+    if (start < 0) {
+      start = std::max<int64_t>(count + start, 0);
+    }
+    if (stop < 0) {
+      stop = static_cast<int>(count + stop);
     }
-    count += 1;
+  }
+  if (start > stop) {
+    return ret;
+  }
+  const std::string prefix = IndexPrefix(vkey);
+  std::unique_ptr<Iterator> rank_iter(db_->NewIterator(default_read_options_, meta_cf_));
+  std::unique_ptr<Iterator> it(db_->NewIterator(default_read_options_, index_cf_));
+  if (!SeekToRank(rank_iter.get(), it.get(), vkey, start).ok()) {
+    return ret;
+  }
+  for (int rank = start; it->Valid() && it->key().starts_with(prefix) && rank <= stop; it->Next()) {
+    ret.push_back(it->key().ToString().substr(prefix.size() + kScoreSize));
+    rank += 1;
   }
   return ret;
 }
 
+Status ZSet::zrangebyscore(const Slice &key, double min, double max, std::vector<ScoreMember> *result) {
+  result->clear();
+  if (std::isnan(min) || std::isnan(max)) {
+    return Status::InvalidArgument("zset score is not a number");
+  }
+  uint64_t version;
+  auto status = GetVersion(key, &version);
+  if (status.IsNotFound()) {
+    return Status::OK();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  const std::string prefix = IndexPrefix(VersionedKey(key, version));
+  std::string start = prefix;
+  PutScore(&start, min);
+  std::unique_ptr<Iterator> it(db_->NewIterator(default_read_options_, index_cf_));
+  for (it->Seek(start); it->Valid() && it->key().starts_with(prefix); it->Next()) {
+    Slice index_key = it->key();
+    if (index_key.size() < prefix.size() + kScoreSize) {
+      return Status::Corruption("bad zset index key");
+    }
+    double score = DecodeScore(index_key.data() + prefix.size());
+    if (score > max) {
+      break;
+    }
+    const size_t member_offset = prefix.size() + kScoreSize;
+    result->push_back({score, std::string(index_key.data() + member_offset,
+                                          index_key.size() - member_offset)});
+  }
+  return it->status();
+}
+
 Status ZSet::zrem(const std::string &key, const StrList &members, int* removed) {
-  return Status::NotSupported("not implement");
+  const std::set<std::string> unique(members.begin(), members.end());
+  std::lock_guard<std::mutex> lock(KeyLock(key));
+  uint64_t version;
+  auto status = GetVersion(key, &version);
+  if (status.IsNotFound()) {
+    *removed = 0;
+    return Status::OK();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  const std::string vkey = VersionedKey(key, version);
+  const std::string prefix = IndexPrefix(vkey);
+  WriteBatch batch;
+  RankDeltas deltas;
+  int count = 0;
+  for (auto& member: unique) {
+    const std::string data_key = DataKey(vkey, member);
+    bool found;
+    double score;
+    status = GetScore(data_key, &found, &score);
+    if (!status.ok()) {
+      return status;
+    }
+    if (!found) {
+      continue;
+    }
+    batch.Delete(data_cf_, data_key);
+    batch.Delete(index_cf_, IndexKey(prefix, score, member));
+    UpdateRankCounts(&deltas, vkey, score, member, -1);
+    count++;
+  }
+  WriteRankCounts(&batch, deltas);
+  int64_t size;
+  status = CountMembers(vkey, &size);
+  if (!status.ok()) {
+    return status;
+  }
+  if (count > 0 && count == size) {
+    // an empty zset does not exist, the GC filter drops its rank keys
+    batch.Delete(meta_cf_, MetaKey(key));
+  }
+  status = db_->Write(default_write_options_, &batch);
+  if (status.ok()) {
+    *removed = count;
+  }
+  return status;
+}
+
+Status ZSet::del(const Slice &key, bool *existed) {
+  std::lock_guard<std::mutex> lock(KeyLock(key));
+  uint64_t version;
+  auto status = GetVersion(key, &version);
+  *existed = false;
+  if (status.IsNotFound()) {
+    return Status::OK();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  status = db_->Delete(default_write_options_, meta_cf_, MetaKey(key));
+  *existed = status.ok();
+  return status;
+}
+
+namespace {
+class ZSetGCFilter : public VersionGCFilter {
+public:
+  ZSetGCFilter(const char *meta_key, const char *rank_prefix, std::vector<std::string> prefixes)
+      : meta_key_(meta_key), rank_prefix_(rank_prefix), prefixes_(std::move(prefixes)) {}
+
+  const char *Name() const override { return "yedis.ZSetGCFilter"; }
+
+  // Also drops the rank buckets all members left.  A missing bucket counts
+  // 0 as well, so reads need not skip them.
+  bool Filter(const Slice &key, const Slice &value) const override {
+    if (key.starts_with(rank_prefix_) && value.size() == sizeof(uint64_t)
+        && DecodeFixed64(value.data()) == 0) {
+      return true;
+    }
+    return VersionGCFilter::Filter(key, value);
+  }
+
+protected:
+  bool ParseMemberKey(const Slice &key, std::string *meta_key, uint64_t *version) const override {
+    for (auto& prefix: prefixes_) {
+      if (!key.starts_with(prefix)) {
+        continue;
+      }
+      Slice input(key.data() + prefix.size(), key.size() - prefix.size());
+      Slice user_key;
+      if (!GetLengthPrefixedSlice(&input, &user_key) || input.size() < sizeof(uint64_t)) {
+        return false;
+      }
+      *meta_key = meta_key_ + user_key.ToString();
+      *version = DecodeBigEndian64(input.data());
+      return true;
+    }
+    return false;
+  }
+
+  bool ParseMetaVersion(const Slice &meta_value, uint64_t *version) const override {
+    if (meta_value.size() != sizeof(uint64_t)) {
+      return false;
+    }
+    *version = DecodeFixed64(meta_value.data());
+    return true;
+  }
+
+private:
+  const std::string meta_key_;
+  const std::string rank_prefix_;
+  const std::vector<std::string> prefixes_;
+};
+}
+
+VersionGCFilter *ZSet::NewGCFilter() {
+  return new ZSetGCFilter(kMetaKey, kRankKeyPrefix, {kDataKeyPrefix, kIndexKeyPrefix, kRankKeyPrefix});
 }
 }
@@ -80,6 +80,21 @@ TEST_F(BTreeNodePageTest, SplitInsert) {
   }
 }
 
+// every key goes in front of the leaf, which shifts the whole leaf up
+TEST_F(BTreeNodePageTest, DescendingInsert) {
+  int limit = 300;
+  for (int i = limit; i >= 0; i--) {
+    auto s = root->add(i, "v" + std::to_string(i));
+    ASSERT_TRUE(s.ok());
+  }
+  for (int i = 0; i <= limit; i++) {
+    std::string tmp;
+    auto s = root->read(i, &tmp);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(tmp, "v" + std::to_string(i));
+  }
+}
+
 TEST_F(BTreeNodePageTest, RandomInsert) {
   std::unordered_map<int64_t, std::string*> presets_;
   int limit = 30;
@@ -141,6 +156,45 @@ TEST_F(BTreeNodePageTest, LeafNodePrevAndNextTest) {
   }
 }
 
+// the page buffer is malloc'ed, asan reports a mismatched delete
+TEST(PageTest, NewAndDelete) {
+  BTreeOptions options;
+  options.page_size = 512;
+  auto page = new Page(options);
+  page->SetPageID(3);
+  ASSERT_EQ(page->GetPageId(), 3);
+  ASSERT_EQ(page->getPageSize(), 512);
+  delete page;
+}
+
+TEST(BufferPoolManagerTest, PinAndUnPin) {
+  auto disk_manager = new DiskManager("buffer_pool_manager_test.idx");
+  auto yedis_instance = new YedisInstance();
+  yedis_instance->disk_manager = disk_manager;
+  auto buffer_pool_manager = new BufferPoolManager(MinPoolSize, yedis_instance);
+  yedis_instance->buffer_pool_manager = buffer_pool_manager;
+
+  page_id_t page_id;
+  Page* page = buffer_pool_manager->NewPage(&page_id);
+  ASSERT_NE(page, nullptr);
+  buffer_pool_manager->Pin(page);
+  ASSERT_TRUE(page->Pinned());
+  ASSERT_EQ(buffer_pool_manager->PinnedSize(), 1);
+  // the page goes back to the lru list, where the next fetch finds it
+  buffer_pool_manager->UnPin(page);
+  ASSERT_FALSE(page->Pinned());
+  ASSERT_EQ(buffer_pool_manager->PinnedSize(), 0);
+  ASSERT_EQ(buffer_pool_manager->FetchPage(page_id), page);
+  // unpinning a page that is not pinned does nothing
+  buffer_pool_manager->UnPin(page_id);
+  ASSERT_EQ(buffer_pool_manager->FetchPage(page_id), page);
+
+  disk_manager->ShutDown();
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete yedis_instance;
+}
+
 }
 
 int main(int argc, char **argv) {
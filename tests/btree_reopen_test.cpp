@@ -28,6 +28,10 @@ class BTreeReopenTest : public testing::Test {
   void Open() {
     BTreeOptions options;
     options.page_size = 128;
+    Open(options);
+  }
+
+  void Open(const BTreeOptions& options) {
     disk_manager_ = new DiskManager("btree_reopen_test.idx", options);
     yedis_instance_ = new YedisInstance();
     yedis_instance_->disk_manager = disk_manager_;
@@ -80,6 +84,41 @@ TEST_F(BTreeReopenTest, NoramlTest) {
   Close();
 }
 
+// the root is an index page and new pages are allocated after the reopen
+TEST_F(BTreeReopenTest, ReopenIndexRoot) {
+  std::remove("btree_reopen_test.idx");
+  BTreeOptions options;
+  const int kNumKeys = 2000;
+  Open(options);
+  for (int i = 0; i < kNumKeys; i++) {
+    auto s = root->add(i, "v" + std::to_string(i));
+    ASSERT_TRUE(s.ok());
+  }
+  Close();
+
+  Open(options);
+  std::string value;
+  for (int i = 0; i < kNumKeys; i++) {
+    auto s = root->read(i, &value);
+    ASSERT_TRUE(s.ok()) << i;
+    ASSERT_EQ(value, "v" + std::to_string(i));
+  }
+  for (int i = kNumKeys; i < 2 * kNumKeys; i++) {
+    auto s = root->add(i, "v" + std::to_string(i));
+    ASSERT_TRUE(s.ok());
+  }
+  Close();
+
+  Open(options);
+  for (int i = 0; i < 2 * kNumKeys; i++) {
+    auto s = root->read(i, &value);
+    ASSERT_TRUE(s.ok()) << i;
+    ASSERT_EQ(value, "v" + std::to_string(i));
+  }
+  root->destroy();
+  Close();
+}
+
 }
 
 int main(int argc, char **argv) {
@@ -3,10 +3,25 @@
 //
 #include <gtest/gtest.h>
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "db.h"
 #include "options.h"
+#include "write_batch.h"
+#include "compaction_filter.h"
+#include "merge_operator.h"
+#include "statistics.h"
+#include "perf_context.h"
+#include "event_trace.h"
+#include "filter_policy.h"
+#include "cache.h"
+#include "util.hpp"
 
 TEST(DBTestRecover, Basic) {
   using namespace yedis;
@@ -76,6 +91,956 @@ TEST(DBTest, Basic) {
   delete db;
 }
 
+TEST(DBTest, ParallelCompaction) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_compaction";
+  fs::remove_all(db_name);
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 4096;
+  options.max_file_size = 8192;
+  options.compression = CompressionType::kNoCompression;
+  options.max_background_compactions = 4;
+  options.max_subcompactions = 4;
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  WriteOptions w_opt;
+  const int kNumKeys = 2000;
+  // every key is written twice, the second value has to win after the
+  // older versions are dropped by compactions
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i < kNumKeys; i++) {
+      std::string key = fmt::format("key{:06d}", (i * 7919) % kNumKeys);
+      s = db->Put(w_opt, key, fmt::format("value{}-{}", round, key));
+      ASSERT_TRUE(s.ok());
+    }
+  }
+
+  ReadOptions ropt;
+  std::string value;
+  for (int i = 0; i < kNumKeys; i++) {
+    std::string key = fmt::format("key{:06d}", i);
+    s = db->Get(ropt, key, &value);
+    ASSERT_TRUE(s.ok()) << key;
+    ASSERT_EQ(value, "value1-" + key);
+  }
+  delete db;
+}
+
+TEST(DBTest, WriteStall) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_write_stall";
+  fs::remove_all(db_name);
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 4096;
+  options.compression = CompressionType::kNoCompression;
+  options.level0_slowdown_writes_trigger = 1;
+  options.level0_stop_writes_trigger = 6;
+  options.write_stall_delay_micros = 100;
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  WriteOptions w_opt;
+  for (int i = 0; i < 1000; i++) {
+    s = db->Put(w_opt, fmt::format("key{:06d}", i), fmt::format("value{}", i));
+    ASSERT_TRUE(s.ok());
+  }
+
+  std::string value;
+  ASSERT_TRUE(db->GetProperty("ydb.num-files-at-level0", &value));
+  ASSERT_LT(std::stoi(value), options.level0_stop_writes_trigger);
+  ASSERT_FALSE(db->GetProperty("ydb.num-files-at-level99", &value));
+  ASSERT_TRUE(db->GetProperty("ydb.pending-compaction-bytes", &value));
+
+  ASSERT_TRUE(db->GetProperty("ydb.write-stall", &value));
+  spdlog::info("write stall: {}", value);
+  ASSERT_EQ(value.find("slowdown count: 0\n"), std::string::npos);
+
+  ReadOptions ropt;
+  for (int i = 0; i < 1000; i++) {
+    s = db->Get(ropt, fmt::format("key{:06d}", i), &value);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(value, fmt::format("value{}", i));
+  }
+  delete db;
+}
+
+TEST(DBTest, MultipleImmutableMemTables) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_multi_imm";
+  fs::remove_all(db_name);
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 2048;
+  options.compression = CompressionType::kNoCompression;
+  options.max_write_buffer_number = 4;
+  options.max_background_flushes = 2;
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  WriteOptions w_opt;
+  ReadOptions ropt;
+  std::string value;
+  const int kNumKeys = 500;
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < kNumKeys; i++) {
+      std::string key = fmt::format("key{:06d}", i);
+      s = db->Put(w_opt, key, fmt::format("value{}-{}", round, i));
+      ASSERT_TRUE(s.ok());
+      // reads see the newest version, wherever it is queued
+      s = db->Get(ropt, fmt::format("key{:06d}", i / 2), &value);
+      ASSERT_TRUE(s.ok());
+      ASSERT_EQ(value, fmt::format("value{}-{}", round, i / 2));
+    }
+  }
+  delete db;
+}
+
+TEST(DBTest, ColumnFamilies) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_column_families";
+  fs::remove_all(db_name);
+  Options options;
+  options.create_if_missing = true;
+  options.compression = CompressionType::kNoCompression;
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  Options meta_options = options;
+  meta_options.block_size = 1024;
+  Options data_options = options;
+  data_options.write_buffer_size = 4096;
+  data_options.block_size = 16 * 1024;
+  ColumnFamilyHandle* meta;
+  ColumnFamilyHandle* data;
+  ASSERT_TRUE(db->CreateColumnFamily(meta_options, "meta", &meta).ok());
+  ASSERT_TRUE(db->CreateColumnFamily(data_options, "data", &data).ok());
+  ColumnFamilyHandle* duplicate;
+  ASSERT_FALSE(db->CreateColumnFamily(data_options, "data", &duplicate).ok());
+  ASSERT_EQ(db->DefaultColumnFamily()->GetID(), 0);
+  ASSERT_EQ(meta->GetName(), "meta");
+  ASSERT_NE(meta->GetID(), data->GetID());
+
+  // the same key is independent in every column family
+  WriteOptions w_opt;
+  ReadOptions ropt;
+  std::string value;
+  ASSERT_TRUE(db->Put(w_opt, "key", "default").ok());
+  ASSERT_TRUE(db->Put(w_opt, meta, "key", "meta").ok());
+  s = db->Get(ropt, data, "key", &value);
+  ASSERT_TRUE(s.IsNotFound());
+  s = db->Get(ropt, meta, "key", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "meta");
+  s = db->Get(ropt, "key", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "default");
+
+  // one batch, several column families
+  WriteBatch batch;
+  batch.Put(data, "key", "data");
+  batch.Delete(meta, "key");
+  batch.Put("other", "default");
+  ASSERT_TRUE(db->Write(w_opt, &batch).ok());
+  s = db->Get(ropt, data, "key", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "data");
+  s = db->Get(ropt, meta, "key", &value);
+  ASSERT_TRUE(s.IsNotFound());
+  s = db->Get(ropt, "key", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "default");
+
+  // only the data column family fills its small write buffers
+  for (int i = 0; i < 500; i++) {
+    s = db->Put(w_opt, data, fmt::format("key{:06d}", i), fmt::format("value{}", i));
+    ASSERT_TRUE(s.ok());
+  }
+  for (int i = 0; i < 500; i++) {
+    s = db->Get(ropt, data, fmt::format("key{:06d}", i), &value);
+    ASSERT_TRUE(s.ok());
+    ASSERT_EQ(value, fmt::format("value{}", i));
+    s = db->Get(ropt, fmt::format("key{:06d}", i), &value);
+    ASSERT_TRUE(s.IsNotFound());
+  }
+  const uint32_t data_id = data->GetID();
+  delete db;
+
+  // column families are recorded in the MANIFEST
+  std::vector<ColumnFamilyDescriptor> descriptors = {
+      {kDefaultColumnFamilyName, &options}, {"data", &data_options}, {"index", &options}};
+  std::vector<ColumnFamilyHandle*> handles;
+  s = DB::Open(options, db_name, descriptors, &handles, &db);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(handles.size(), 3);
+  ASSERT_EQ(handles[0], db->DefaultColumnFamily());
+  ASSERT_EQ(handles[1]->GetID(), data_id);
+  ASSERT_EQ(handles[2]->GetName(), "index");
+  ASSERT_GT(handles[2]->GetID(), data_id);
+  ASSERT_TRUE(db->Put(w_opt, handles[2], "key", "index").ok());
+  s = db->Get(ropt, handles[2], "key", &value);
+  ASSERT_TRUE(s.ok());
+  ASSERT_EQ(value, "index");
+  delete db;
+}
+
+TEST(DBTest, TTLCompactionFilter) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_ttl";
+  fs::remove_all(db_name);
+  std::unique_ptr<const CompactionFilter> filter(NewTTLCompactionFilter());
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 4096;
+  options.compression = CompressionType::kNoCompression;
+  options.compaction_filter = filter.get();
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  const uint64_t expired = 1;
+  const uint64_t never = 0;
+  const uint64_t future = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count() + 3600 * 1000;
+  auto make_value = [](const std::string& value, uint64_t expire_at_ms) {
+    std::string result = value;
+    AppendExpiration(&result, expire_at_ms);
+    return result;
+  };
+
+  WriteOptions w_opt;
+  const int kNumKeys = 2000;
+  // an expired overwrite must not bring the older value back once it
+  // is compacted
+  for (int i = 0; i < kNumKeys; i++) {
+    s = db->Put(w_opt, fmt::format("key{:06d}", i), make_value(fmt::format("old{}", i), never));
+    ASSERT_TRUE(s.ok());
+  }
+  for (int i = 0; i < kNumKeys; i++) {
+    uint64_t expire_at = i % 3 == 0 ? expired : (i % 3 == 1 ? future : never);
+    s = db->Put(w_opt, fmt::format("key{:06d}", i), make_value(fmt::format("new{}", i), expire_at));
+    ASSERT_TRUE(s.ok());
+  }
+
+  ReadOptions ropt;
+  std::string stored;
+  for (int i = 0; i < kNumKeys; i++) {
+    s = db->Get(ropt, fmt::format("key{:06d}", i), &stored);
+    if (i % 3 == 0) {
+      ASSERT_TRUE(s.IsNotFound()) << i;
+      continue;
+    }
+    ASSERT_TRUE(s.ok()) << i;
+    Slice value;
+    uint64_t expire_at;
+    ASSERT_TRUE(ParseExpiration(stored, &value, &expire_at));
+    ASSERT_EQ(value.ToString(), fmt::format("new{}", i));
+    ASSERT_EQ(expire_at, i % 3 == 1 ? future : never);
+  }
+  delete db;
+}
+
+TEST(DBTest, MergeOperator) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_merge";
+  fs::remove_all(db_name);
+  std::unique_ptr<const MergeOperator> counter(NewInt64AddOperator());
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 4096;
+  options.compression = CompressionType::kNoCompression;
+  Options plain_options = options;
+  options.merge_operator = counter.get();
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+  WriteOptions w_opt;
+  // the merge operator is a column family option
+  ColumnFamilyHandle* plain;
+  ASSERT_TRUE(db->CreateColumnFamily(plain_options, "plain", &plain).ok());
+  ASSERT_TRUE(db->Merge(w_opt, plain, "key", "operand").IsNotSupportedError());
+  {
+    // a batch is rejected as a whole, its put is not applied either
+    WriteBatch batch;
+    batch.Put(plain, "key", "value");
+    batch.Merge(plain, "key", "operand");
+    ASSERT_TRUE(db->Write(w_opt, &batch).IsNotSupportedError());
+    std::string value;
+    ASSERT_TRUE(db->Get(ReadOptions(), plain, "key", &value).IsNotFound());
+  }
+  auto encode = [](int64_t n) {
+    std::string value;
+    PutFixed<uint64_t>(&value, static_cast<uint64_t>(n));
+    return value;
+  };
+  auto key = [](int i) { return fmt::format("counter{:06d}", i); };
+
+  // operands land on top of values, deletions and nothing, spread over
+  // memtables, level-0 files and compaction outputs
+  const int kNumKeys = 2000;
+  const int kRounds = 4;
+  for (int i = 0; i < kNumKeys; i++) {
+    if (i % 3 == 0) {
+      ASSERT_TRUE(db->Put(w_opt, key(i), encode(100)).ok());
+    } else if (i % 3 == 1) {
+      ASSERT_TRUE(db->Put(w_opt, key(i), encode(100)).ok());
+      ASSERT_TRUE(db->Delete(w_opt, key(i)).ok());
+    }
+  }
+  for (int round = 0; round < kRounds; round++) {
+    for (int i = 0; i < kNumKeys; i++) {
+      ASSERT_TRUE(db->Merge(w_opt, key(i), encode(i)).ok());
+    }
+  }
+
+  auto verify = [&](DB* db) {
+    ReadOptions ropt;
+    std::string value;
+    for (int i = 0; i < kNumKeys; i++) {
+      Status s = db->Get(ropt, key(i), &value);
+      ASSERT_TRUE(s.ok()) << i << " " << s.ToString();
+      ASSERT_EQ(value.size(), sizeof(uint64_t));
+      int64_t expected = (i % 3 == 0 ? 100 : 0) + kRounds * i;
+      ASSERT_EQ(static_cast<int64_t>(DecodeFixed64(value.data())), expected) << i;
+    }
+  };
+  verify(db);
+  delete db;
+
+  s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+  verify(db);
+  delete db;
+}
+
+TEST(DBTest, Iterator) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_iter";
+  fs::remove_all(db_name);
+  std::unique_ptr<const MergeOperator> counter(NewInt64AddOperator());
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 4096;
+  options.compression = CompressionType::kNoCompression;
+  options.merge_operator = counter.get();
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+  auto encode = [](int64_t n) {
+    std::string value;
+    PutFixed<uint64_t>(&value, static_cast<uint64_t>(n));
+    return value;
+  };
+  auto key = [](int i) { return fmt::format("key{:06d}", i); };
+
+  // values, deletions and merge operands spread over memtables and tables
+  WriteOptions w_opt;
+  const int kNumKeys = 3000;
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_TRUE(db->Put(w_opt, key(i), encode(i)).ok());
+  }
+  for (int i = 0; i < kNumKeys; i++) {
+    if (i % 3 == 0) {
+      ASSERT_TRUE(db->Delete(w_opt, key(i)).ok());
+    } else if (i % 3 == 1) {
+      ASSERT_TRUE(db->Merge(w_opt, key(i), encode(1)).ok());
+    }
+  }
+
+  std::unique_ptr<Iterator> it(db->NewIterator(ReadOptions()));
+  // later writes are not visible
+  ASSERT_TRUE(db->Put(w_opt, key(0), encode(0)).ok());
+  int i = 1;
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    ASSERT_EQ(it->key().ToString(), key(i));
+    ASSERT_EQ(static_cast<int64_t>(DecodeFixed64(it->value().data())), i % 3 == 1 ? i + 1 : i);
+    i += i % 3 == 1 ? 1 : 2;
+  }
+  ASSERT_TRUE(it->status().ok());
+  ASSERT_EQ(i, kNumKeys + 1);
+
+  it->Seek(key(1500));
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->key().ToString(), key(1501));
+  it.reset();
+  delete db;
+}
+
+TEST(DBTest, PartitionedFilter) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_partitioned_filter";
+  fs::remove_all(db_name);
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  std::unique_ptr<Statistics> stats(CreateDBStatistics());
+  Options options;
+  options.create_if_missing = true;
+  options.compression = CompressionType::kNoCompression;
+  options.filter_policy = policy.get();
+  options.block_size = 1024;
+  options.index_type = kTwoLevelIndexSearch;
+  options.partition_filters = true;
+  options.metadata_block_size = 256;
+  options.statistics = stats.get();
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  // even keys only, the odd ones fall inside the key range of the table
+  const int kNumKeys = 2000;
+  auto key = [](int i) { return fmt::format("key{:06d}", i); };
+  for (int i = 0; i < kNumKeys; i += 2) {
+    ASSERT_TRUE(db->Put(WriteOptions(), key(i), "value").ok());
+  }
+  // recovery writes the log out to level-0, every read below hits a table
+  delete db;
+  s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  std::string value;
+  for (int i = 0; i < kNumKeys; i += 2) {
+    ASSERT_TRUE(db->Get(ReadOptions(), key(i), &value).ok()) << key(i);
+    ASSERT_EQ(value, "value");
+  }
+  ASSERT_EQ(stats->GetTickerCount(kBloomFilterUseful), 0);
+  for (int i = 1; i < kNumKeys; i += 2) {
+    ASSERT_TRUE(db->Get(ReadOptions(), key(i), &value).IsNotFound()) << key(i);
+  }
+  // 10 bits per key give about 1% false positives
+  ASSERT_GT(stats->GetTickerCount(kBloomFilterUseful), kNumKeys / 2 * 9 / 10);
+  delete db;
+}
+
+TEST(DBTest, FullFilter) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::unique_ptr<const FilterPolicy> policies[] = {
+      std::unique_ptr<const FilterPolicy>(NewBloomFilterPolicy(10)),
+      std::unique_ptr<const FilterPolicy>(NewBlockedBloomFilterPolicy(10)),
+      std::unique_ptr<const FilterPolicy>(NewRibbonFilterPolicy(10)),
+  };
+  for (auto& policy: policies) {
+    std::string db_name = "ydb_full_filter";
+    fs::remove_all(db_name);
+    std::unique_ptr<Statistics> stats(CreateDBStatistics());
+    Options options;
+    options.create_if_missing = true;
+    options.compression = CompressionType::kNoCompression;
+    options.filter_policy = policy.get();
+    options.full_filter = true;
+    options.statistics = stats.get();
+    DB* db;
+    Status s = DB::Open(options, db_name, &db);
+    ASSERT_TRUE(s.ok());
+
+    // every even key twice, filters hold user keys so both versions match
+    const int kNumKeys = 2000;
+    auto key = [](int i) { return fmt::format("key{:06d}", i); };
+    for (int i = 0; i < kNumKeys; i += 2) {
+      ASSERT_TRUE(db->Put(WriteOptions(), key(i), "old").ok());
+      ASSERT_TRUE(db->Put(WriteOptions(), key(i), "new").ok());
+    }
+    delete db;
+    s = DB::Open(options, db_name, &db);
+    ASSERT_TRUE(s.ok());
+
+    std::string value;
+    for (int i = 0; i < kNumKeys; i += 2) {
+      ASSERT_TRUE(db->Get(ReadOptions(), key(i), &value).ok()) << policy->Name() << " " << key(i);
+      ASSERT_EQ(value, "new");
+    }
+    ASSERT_EQ(stats->GetTickerCount(kBloomFilterUseful), 0) << policy->Name();
+    for (int i = 1; i < kNumKeys; i += 2) {
+      ASSERT_TRUE(db->Get(ReadOptions(), key(i), &value).IsNotFound()) << policy->Name() << " " << key(i);
+    }
+    ASSERT_GT(stats->GetTickerCount(kBloomFilterUseful), kNumKeys / 2 * 9 / 10) << policy->Name();
+    delete db;
+  }
+}
+
+TEST(DBTest, ConcurrentReads) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_concurrent_reads";
+  fs::remove_all(db_name);
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 4096;
+  options.max_file_size = 8192;
+  options.compression = CompressionType::kNoCompression;
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  WriteOptions w_opt;
+  const int kNumKeys = 500;
+  const int kRounds = 10;
+  auto key = [](int i) { return fmt::format("key{:06d}", i); };
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_TRUE(db->Put(w_opt, key(i), "0").ok());
+  }
+
+  // readers race with memtable switches, flushes and compactions, each
+  // key must stay readable and never go back to an older round
+  std::atomic<bool> done{false};
+  std::atomic<int> errors{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&, t] {
+      std::vector<int> seen(kNumKeys, 0);
+      std::string value;
+      for (int n = t; !done.load(); n += 7) {
+        int i = n % kNumKeys;
+        if (!db->Get(ReadOptions(), key(i), &value).ok() || std::stoi(value) < seen[i]) {
+          errors.fetch_add(1);
+          continue;
+        }
+        seen[i] = std::stoi(value);
+      }
+    });
+  }
+  for (int round = 1; round <= kRounds; round++) {
+    for (int i = 0; i < kNumKeys; i++) {
+      ASSERT_TRUE(db->Put(w_opt, key(i), std::to_string(round)).ok());
+    }
+  }
+  done.store(true);
+  for (auto& th: readers) {
+    th.join();
+  }
+  ASSERT_EQ(errors.load(), 0);
+
+  std::string value;
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_TRUE(db->Get(ReadOptions(), key(i), &value).ok());
+    ASSERT_EQ(value, std::to_string(kRounds));
+  }
+  delete db;
+}
+
+TEST(DBTest, ConcurrentReadsSeeLatestWrites) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_concurrent_reads_latest";
+  fs::remove_all(db_name);
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 2048;
+  options.compression = CompressionType::kNoCompression;
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  // memtables switch and flush every few puts, installing new super
+  // versions under the readers, a read that starts after a put returned
+  // must see it
+  const int kNumKeys = 50;
+  const int kRounds = 40;
+  auto key = [](int i) { return fmt::format("key{:06d}", i); };
+  std::vector<std::atomic<int>> committed(kNumKeys);
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_TRUE(db->Put(WriteOptions(), key(i), "0").ok());
+    committed[i].store(0);
+  }
+
+  std::atomic<bool> done{false};
+  std::atomic<int> errors{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 8; t++) {
+    readers.emplace_back([&, t] {
+      std::string value;
+      for (int n = t; !done.load(); n++) {
+        int i = n % kNumKeys;
+        int expected = committed[i].load();
+        if (!db->Get(ReadOptions(), key(i), &value).ok() || std::stoi(value) < expected) {
+          errors.fetch_add(1);
+        }
+      }
+    });
+  }
+  for (int round = 1; round <= kRounds; round++) {
+    for (int i = 0; i < kNumKeys; i++) {
+      ASSERT_TRUE(db->Put(WriteOptions(), key(i), std::to_string(round)).ok());
+      committed[i].store(round);
+    }
+  }
+  done.store(true);
+  for (auto& th: readers) {
+    th.join();
+  }
+  ASSERT_EQ(errors.load(), 0);
+  delete db;
+}
+
+TEST(DBTest, ConcurrentWrites) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_concurrent_writes";
+  fs::remove_all(db_name);
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 4096;
+  options.compression = CompressionType::kNoCompression;
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  // writers overlap on every key and switch memtables and WALs under
+  // each other, no write may get lost
+  const int kNumKeys = 500;
+  const int kThreads = 4;
+  auto key = [](int i) { return fmt::format("key{:06d}", i); };
+  std::atomic<int> errors{0};
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kThreads; t++) {
+    writers.emplace_back([&, t] {
+      for (int i = 0; i < kNumKeys; i++) {
+        if (!db->Put(WriteOptions(), key(i), fmt::format("{}-{}", t, i)).ok()) {
+          errors.fetch_add(1);
+        }
+        if (!db->Put(WriteOptions(), key(kNumKeys * (t + 1) + i), "v").ok()) {
+          errors.fetch_add(1);
+        }
+      }
+    });
+  }
+  for (auto& th: writers) {
+    th.join();
+  }
+  ASSERT_EQ(errors.load(), 0);
+
+  std::string value;
+  for (int i = 0; i < kNumKeys * (kThreads + 1); i++) {
+    ASSERT_TRUE(db->Get(ReadOptions(), key(i), &value).ok()) << key(i);
+    if (i < kNumKeys) {
+      ASSERT_EQ(value.substr(value.find('-') + 1), std::to_string(i));
+    }
+  }
+
+  // and the WAL replays them all
+  delete db;
+  s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+  for (int i = 0; i < kNumKeys * (kThreads + 1); i++) {
+    ASSERT_TRUE(db->Get(ReadOptions(), key(i), &value).ok()) << key(i);
+  }
+  delete db;
+}
+
+TEST(DBTest, Statistics) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_statistics";
+  fs::remove_all(db_name);
+  std::unique_ptr<Statistics> stats(CreateDBStatistics());
+  std::unique_ptr<Cache> cache(NewLRUCache(1 << 20));
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 4096;
+  options.compression = CompressionType::kNoCompression;
+  options.statistics = stats.get();
+  options.block_cache = cache.get();
+  options.filter_policy = policy.get();
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  WriteOptions w_opt;
+  const int kNumKeys = 1000;
+  auto key = [](int i) { return fmt::format("key{:06d}", i); };
+  std::string value;
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_TRUE(db->Put(w_opt, key(i), "value").ok());
+  }
+  ASSERT_TRUE(db->Put(w_opt, key(kNumKeys), "value").ok());
+  ASSERT_EQ(stats->GetTickerCount(kKeysWritten), kNumKeys + 1);
+  ASSERT_GT(stats->GetTickerCount(kBytesWritten), 0);
+  // reopening writes the log out to level-0, the reads below hit tables
+  delete db;
+  s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i <= kNumKeys; i++) {
+      ASSERT_TRUE(db->Get(ReadOptions(), key(i), &value).ok());
+    }
+  }
+  ASSERT_TRUE(db->Get(ReadOptions(), "missing", &value).IsNotFound());
+  ASSERT_EQ(stats->GetTickerCount(kKeysRead), 2 * (kNumKeys + 1));
+  ASSERT_EQ(stats->GetTickerCount(kBytesRead), 2 * (kNumKeys + 1) * 5);
+  ASSERT_EQ(stats->GetTickerCount(kMemtableHit) + stats->GetTickerCount(kMemtableMiss), 2 * (kNumKeys + 1) + 1);
+  ASSERT_GT(stats->GetTickerCount(kMemtableMiss), 0);
+  ASSERT_GT(stats->GetTickerCount(kBlockCacheMiss), 0);
+  // tables stay open, the second round reads the blocks of the first
+  ASSERT_GT(stats->GetTickerCount(kBlockCacheHit), 0);
+  // inside the key range of the flushed tables, but in none of them
+  ASSERT_EQ(stats->GetTickerCount(kBloomFilterUseful), 0);
+  ASSERT_TRUE(db->Get(ReadOptions(), key(0) + "-missing", &value).IsNotFound());
+  ASSERT_GT(stats->GetTickerCount(kBloomFilterUseful), 0);
+
+  HistogramData data;
+  stats->GetHistogramData(kGetMicros, &data);
+  ASSERT_EQ(data.count, 2 * (kNumKeys + 1) + 2);
+  ASSERT_LE(data.min, data.median);
+  ASSERT_LE(data.median, data.percentile99);
+  ASSERT_LE(data.percentile99, data.max);
+  stats->GetHistogramData(kPutMicros, &data);
+  ASSERT_EQ(data.count, kNumKeys + 1);
+  stats->GetHistogramData(kFlushMicros, &data);
+  ASSERT_GT(data.count, 0);
+
+  ASSERT_TRUE(db->GetProperty("ydb.stats", &value));
+  ASSERT_NE(value.find("ydb.keys.read COUNT : 2002"), std::string::npos) << value;
+  ASSERT_NE(value.find("ydb.get.micros P50"), std::string::npos) << value;
+
+  stats->Reset();
+  ASSERT_EQ(stats->GetTickerCount(kKeysRead), 0);
+  delete db;
+}
+
+TEST(DBTest, SyncWrites) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_sync_writes";
+  fs::remove_all(db_name);
+  std::unique_ptr<Statistics> stats(CreateDBStatistics());
+  Options options;
+  options.create_if_missing = true;
+  options.compression = CompressionType::kNoCompression;
+  options.statistics = stats.get();
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  WriteOptions w_opt;
+  ASSERT_TRUE(db->Put(w_opt, "key1", "value1").ok());
+  ASSERT_EQ(stats->GetTickerCount(kWALSyncs), 0);
+  w_opt.sync = true;
+  ASSERT_TRUE(db->Put(w_opt, "key2", "value2").ok());
+  WriteBatch batch;
+  batch.Put("key3", "value3");
+  batch.Delete("key1");
+  ASSERT_TRUE(db->Write(w_opt, &batch).ok());
+  // one sync per WAL record
+  ASSERT_EQ(stats->GetTickerCount(kWALSyncs), 2);
+
+  delete db;
+  s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+  std::string value;
+  ASSERT_TRUE(db->Get(ReadOptions(), "key1", &value).IsNotFound());
+  ASSERT_TRUE(db->Get(ReadOptions(), "key2", &value).ok());
+  ASSERT_EQ(value, "value2");
+  ASSERT_TRUE(db->Get(ReadOptions(), "key3", &value).ok());
+  ASSERT_EQ(value, "value3");
+  delete db;
+}
+
+TEST(DBTest, MmapTablesOpenOnce) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_mmap_tables_open_once";
+  fs::remove_all(db_name);
+  std::unique_ptr<Statistics> stats(CreateDBStatistics());
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 4096;
+  options.compression = CompressionType::kNoCompression;
+  options.allow_mmap_reads = true;
+  options.statistics = stats.get();
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  const int kNumKeys = 1000;
+  auto key = [](int i) { return fmt::format("key{:06d}", i); };
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_TRUE(db->Put(WriteOptions(), key(i), "value").ok());
+  }
+  delete db;
+  s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  int tables = 0;
+  for (auto& entry: fs::directory_iterator(db_name)) {
+    if (entry.path().extension() == ".ydb") {
+      tables++;
+    }
+  }
+  ASSERT_GT(tables, 1);
+  stats->Reset();
+  std::string value;
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < kNumKeys; i++) {
+      ASSERT_TRUE(db->Get(ReadOptions(), key(i), &value).ok()) << key(i);
+      ASSERT_EQ(value, "value");
+    }
+  }
+  // each table is mapped by its first Get and stays mapped
+  ASSERT_GT(stats->GetTickerCount(kTableFileOpens), 0);
+  ASSERT_LE(stats->GetTickerCount(kTableFileOpens), tables);
+  delete db;
+}
+
+TEST(DBTest, PerfContext) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+  std::string db_name = "ydb_perf_context";
+  fs::remove_all(db_name);
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 4096;
+  options.compression = CompressionType::kNoCompression;
+  options.filter_policy = policy.get();
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+
+  WriteOptions w_opt;
+  const int kNumKeys = 1000;
+  auto key = [](int i) { return fmt::format("key{:06d}", i); };
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_TRUE(db->Put(w_opt, key(i), "value").ok());
+  }
+  std::string value;
+  PerfContext* ctx = get_perf_context();
+
+  // disabled by default
+  ctx->Reset();
+  ASSERT_TRUE(db->Get(ReadOptions(), key(0), &value).ok());
+  ASSERT_EQ(ctx->get_from_memtable_count, 0);
+  ASSERT_EQ(ctx->ToString(true), "");
+
+  SetPerfLevel(PerfLevel::kEnableCount);
+  ctx->Reset();
+  ASSERT_TRUE(db->Get(ReadOptions(), key(kNumKeys - 1), &value).ok());
+  ASSERT_GT(ctx->get_from_memtable_count, 0);
+  ASSERT_EQ(ctx->get_from_memtable_time, 0);
+  ASSERT_EQ(ctx->get_read_bytes, 5);
+
+  // the first keys were flushed long ago
+  SetPerfLevel(PerfLevel::kEnableTime);
+  ctx->Reset();
+  ASSERT_TRUE(db->Get(ReadOptions(), key(0), &value).ok());
+  ASSERT_GT(ctx->get_from_memtable_count, 0);
+  ASSERT_GT(ctx->get_from_table_count, 0);
+  ASSERT_GT(ctx->get_from_table_time, 0);
+  ASSERT_GT(ctx->block_read_count, 0);
+  ASSERT_GT(ctx->block_read_byte, 0);
+  ASSERT_GT(ctx->block_read_time, 0);
+  ASSERT_EQ(ctx->get_read_bytes, 5);
+  ASSERT_GT(ctx->bloom_filter_checked, 0);
+  ASSERT_EQ(ctx->bloom_filter_useful, 0);
+  std::string perf = ctx->ToString(true);
+  ASSERT_NE(perf.find("get_from_table_count = "), std::string::npos) << perf;
+  ASSERT_EQ(perf.find("bloom_filter_useful"), std::string::npos) << perf;
+
+  // inside the key range of the first table, the filter rules it out
+  ctx->Reset();
+  ASSERT_TRUE(db->Get(ReadOptions(), key(0) + "-missing", &value).IsNotFound());
+  ASSERT_GT(ctx->get_from_table_count, 0);
+  ASSERT_GT(ctx->bloom_filter_checked, 0);
+  ASSERT_GT(ctx->bloom_filter_useful, 0);
+  ASSERT_EQ(ctx->get_read_bytes, 0);
+  perf = ctx->ToString(true);
+  ASSERT_NE(perf.find("bloom_filter_useful = "), std::string::npos) << perf;
+
+  // a write waits for the writer queue and for the db mutex, timed apart
+  ctx->Reset();
+  ASSERT_TRUE(db->Put(w_opt, key(0), "value").ok());
+  perf = ctx->ToString();
+  ASSERT_NE(perf.find("write_thread_wait_time = "), std::string::npos) << perf;
+  ASSERT_NE(perf.find("db_mutex_lock_time = "), std::string::npos) << perf;
+
+  // another thread has a context of its own
+  std::thread([] {
+    ASSERT_EQ(GetPerfLevel(), PerfLevel::kDisable);
+    ASSERT_EQ(get_perf_context()->get_from_table_count, 0);
+  }).join();
+
+  SetPerfLevel(PerfLevel::kDisable);
+  ctx->Reset();
+  delete db;
+}
+
+TEST(DBTest, EventTrace) {
+  using namespace yedis;
+  namespace fs = std::filesystem;
+
+  class CollectingSink: public EventTraceSink {
+  public:
+    void Write(const TraceEvent& event) override {
+      std::lock_guard<std::mutex> lock(mu);
+      events.push_back(event);
+    }
+    int Count(TraceEventType type) {
+      std::lock_guard<std::mutex> lock(mu);
+      return std::count_if(events.begin(), events.end(), [type](const TraceEvent& e) { return e.type == type; });
+    }
+    std::mutex mu;
+    std::vector<TraceEvent> events;
+  };
+
+  std::string db_name = "ydb_event_trace";
+  fs::remove_all(db_name);
+  Options options;
+  options.create_if_missing = true;
+  options.write_buffer_size = 4096;
+  options.compression = CompressionType::kNoCompression;
+
+  CollectingSink sink;
+  SetEventTraceSink(&sink);
+  DB* db;
+  Status s = DB::Open(options, db_name, &db);
+  ASSERT_TRUE(s.ok());
+  WriteOptions w_opt;
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_TRUE(db->Put(w_opt, fmt::format("key{:06d}", i), "value").ok());
+  }
+  // waits for the background flushes
+  delete db;
+  SetEventTraceSink(nullptr);
+
+  ASSERT_GT(sink.Count(TraceEventType::kMemTableSwitch), 0);
+  ASSERT_GT(sink.Count(TraceEventType::kFlush), 0);
+  for (auto& event: sink.events) {
+    if (event.type == TraceEventType::kFlush) {
+      ASSERT_GT(event.timestamp_micros, 0);
+      std::string line = event.ToString();
+      ASSERT_EQ(line.find("event=flush ts="), 0) << line;
+      ASSERT_NE(line.find(" ok=1"), std::string::npos) << line;
+    }
+  }
+
+  // one in three of each type
+  CollectingSink sampled;
+  SetEventTraceSink(&sampled, 3);
+  int evaluated = 0;
+  for (int i = 0; i < 10; i++) {
+    YEDIS_TRACE_EVENT(TraceEventType::kPageEvict, {"page_id", ++evaluated});
+  }
+  SetEventTraceSink(nullptr);
+  YEDIS_TRACE_EVENT(TraceEventType::kPageEvict, {"page_id", ++evaluated});
+  ASSERT_EQ(sampled.Count(TraceEventType::kPageEvict), 4);
+  ASSERT_EQ(evaluated, 4);
+  ASSERT_EQ(sampled.events[1].fields[0].value, 2);
+}
+
 int main(int argc, char **argv) {
   spdlog::set_level(spdlog::level::debug);
   spdlog::enable_backtrace(16);
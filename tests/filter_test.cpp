@@ -0,0 +1,182 @@
+//
+// Filter policy tests.
+//
+
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <spdlog/spdlog.h>
+
+#include "filter_policy.h"
+#include "util.hpp"
+
+namespace yedis {
+
+static Slice Key(int i, char* buffer) {
+  EncodeFixed32(buffer, i);
+  return Slice(buffer, sizeof(uint32_t));
+}
+
+static const FilterPolicy* NewPolicy(int type, int format_version) {
+  switch (type) {
+    case 0:
+      return NewBloomFilterPolicy(10, format_version);
+    case 1:
+      return NewBlockedBloomFilterPolicy(10, format_version);
+    default:
+      return NewRibbonFilterPolicy(10, format_version);
+  }
+}
+
+// Params: policy type, filter format version.
+class FilterTest : public testing::TestWithParam<std::tuple<int, int>> {
+public:
+  FilterTest() {
+    policy_ = NewPolicy(std::get<0>(GetParam()), std::get<1>(GetParam()));
+  }
+
+  ~FilterTest() override { delete policy_; }
+
+  void Build(int n) {
+    std::vector<std::string> key_data(n);
+    std::vector<Slice> keys(n);
+    char buffer[sizeof(uint32_t)];
+    for (int i = 0; i < n; i++) {
+      key_data[i] = Key(i, buffer).ToString();
+      keys[i] = key_data[i];
+    }
+    filter_.clear();
+    policy_->CreateFilter(keys.data(), n, &filter_);
+  }
+
+  bool Matches(int i) {
+    char buffer[sizeof(uint32_t)];
+    return policy_->KeyMayMatch(Key(i, buffer), filter_);
+  }
+
+  double FalsePositiveRate() {
+    int result = 0;
+    for (int i = 0; i < 10000; i++) {
+      if (Matches(i + 1000000000)) {
+        result++;
+      }
+    }
+    return result / 10000.0;
+  }
+
+  const FilterPolicy* policy_;
+  std::string filter_;
+};
+
+TEST_P(FilterTest, EmptyFilter) {
+  Build(0);
+  ASSERT_FALSE(Matches(0));
+  ASSERT_FALSE(Matches(100));
+}
+
+TEST_P(FilterTest, VaryingLengths) {
+  for (int length = 1; length <= 100000; length *= 10) {
+    Build(length);
+    for (int i = 0; i < length; i++) {
+      ASSERT_TRUE(Matches(i)) << "length " << length << "; key " << i;
+    }
+    double rate = FalsePositiveRate();
+    spdlog::info("{} v{}: {} keys, {} bytes, fp rate {}", policy_->Name(), std::get<1>(GetParam()),
+                 length, filter_.size(), rate);
+    ASSERT_LE(rate, 0.03);
+  }
+}
+
+// a reader with either setting understands filters of both versions
+TEST_P(FilterTest, ReadsOtherFormatVersion) {
+  Build(1000);
+  const int other_version = std::get<1>(GetParam()) == kFilterFormatVersion
+      ? kLegacyFilterFormatVersion : kFilterFormatVersion;
+  const FilterPolicy* reader = NewPolicy(std::get<0>(GetParam()), other_version);
+  char buffer[sizeof(uint32_t)];
+  int false_positives = 0;
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_TRUE(reader->KeyMayMatch(Key(i, buffer), filter_)) << i;
+    ASSERT_EQ(reader->KeyMayMatch(Key(i + 1000000000, buffer), filter_), Matches(i + 1000000000));
+    false_positives += Matches(i + 1000000000);
+  }
+  ASSERT_LT(false_positives, 30);
+  delete reader;
+}
+
+INSTANTIATE_TEST_SUITE_P(Policies, FilterTest,
+                         testing::Combine(testing::Values(0, 1, 2),
+                                          testing::Values(kLegacyFilterFormatVersion, kFilterFormatVersion)));
+
+// Readers from before format 2 look at the low bits of the trailing
+// parameter byte only if the top one is clear.
+TEST(FilterFormatTest, Version2IsFlagged) {
+  char buffer[sizeof(uint32_t)];
+  std::vector<std::string> key_data;
+  std::vector<Slice> keys;
+  for (int i = 0; i < 100; i++) {
+    key_data.push_back(Key(i, buffer).ToString());
+  }
+  keys.assign(key_data.begin(), key_data.end());
+  for (int type = 0; type < 3; type++) {
+    for (int version: {kLegacyFilterFormatVersion, kFilterFormatVersion}) {
+      const FilterPolicy* policy = NewPolicy(type, version);
+      std::string filter;
+      policy->CreateFilter(keys.data(), keys.size(), &filter);
+      // the Ribbon filter ends with r and the seed, the Bloom filters with k
+      const size_t pos = type == 2 ? filter.size() - 2 : filter.size() - 1;
+      const bool flagged = (static_cast<uint8_t>(filter[pos]) & 0x80) != 0;
+      ASSERT_EQ(flagged, version == kFilterFormatVersion) << policy->Name();
+      delete policy;
+    }
+  }
+}
+
+TEST(HashTest, Hash64) {
+  std::string data;
+  for (int i = 0; i < 5000; i++) {
+    data.push_back(static_cast<char>(i * 31 + (i >> 7)));
+  }
+  // every length class, and long inputs that end inside and on a block
+  std::set<uint64_t> seen;
+  for (size_t n: {0, 1, 3, 4, 8, 9, 16, 17, 32, 33, 64, 65, 96, 97, 128, 129, 200, 240,
+                  241, 1023, 1024, 1025, 4096, 5000}) {
+    for (uint64_t seed: {0ull, 0xbc9f1d34ull}) {
+      const uint64_t h = Hash64(data.data(), n, seed);
+      ASSERT_EQ(h, Hash64Portable(data.data(), n, seed)) << n;
+      ASSERT_EQ(h, Hash64(std::string(data.data(), n).data(), n, seed)) << n;
+      ASSERT_TRUE(seen.insert(h).second) << n;
+    }
+  }
+  // filters persist the values
+  ASSERT_EQ(Hash64("", 0, 0), 0x2eac39fbc1031a68ull);
+  ASSERT_EQ(Hash64("yedis", 5, 0), 0x6a12ed1cee57f366ull);
+  ASSERT_EQ(Hash64(data.data(), 1000, 0xbc9f1d34), 0x766dd74684f13283ull);
+}
+
+TEST(RibbonFilterTest, SmallerThanBloom) {
+  const FilterPolicy* bloom = NewBloomFilterPolicy(10);
+  const FilterPolicy* ribbon = NewRibbonFilterPolicy(10);
+  const int n = 10000;
+  std::vector<std::string> key_data(n);
+  std::vector<Slice> keys(n);
+  char buffer[sizeof(uint32_t)];
+  for (int i = 0; i < n; i++) {
+    key_data[i] = Key(i, buffer).ToString();
+    keys[i] = key_data[i];
+  }
+  std::string bloom_filter, ribbon_filter;
+  bloom->CreateFilter(keys.data(), n, &bloom_filter);
+  ribbon->CreateFilter(keys.data(), n, &ribbon_filter);
+  ASSERT_LT(ribbon_filter.size(), bloom_filter.size() * 0.8);
+  delete bloom;
+  delete ribbon;
+}
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
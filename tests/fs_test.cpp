@@ -183,6 +183,39 @@ TEST(WALTEST4, ByGoLeveldb) {
   spdlog::info("read {} pairs", count);
 }
 
+TEST(DirectIOTest, AppendAndRead) {
+  LocalFileSystem fs;
+  std::unique_ptr<FileHandle> write_handle;
+  ASSERT_TRUE(fs.NewDirectWritableFile("direct.data", 8192, write_handle).ok());
+  Random* rnd = new Random();
+  std::string dest;
+  // unaligned appends crossing several buffer boundaries
+  for (int i = 0; i < 100; i++) {
+    std::string piece;
+    test::RandomString(rnd, 1 + rnd->IntN(1000), &piece);
+    write_handle->Write(piece.data(), piece.size());
+    dest.append(piece);
+  }
+  ASSERT_EQ(write_handle->FileSize(), dest.size());
+  write_handle->Close();
+
+  auto plain_handle = fs.OpenFile("direct.data", O_RDONLY);
+  ASSERT_EQ(plain_handle->FileSize(), dest.size());
+
+  std::unique_ptr<FileHandle> read_handle;
+  ASSERT_TRUE(fs.NewDirectReadableFile("direct.data", 4096, read_handle).ok());
+  ASSERT_EQ(read_handle->FileSize(), dest.size());
+  for (int i = 0; i < 100; i++) {
+    size_t offset = rnd->IntN(dest.size());
+    size_t len = std::min<size_t>(rnd->IntN(10000), dest.size() - offset);
+    std::string data;
+    data.resize(len);
+    read_handle->Read(data.data(), len, offset);
+    ASSERT_EQ(data, dest.substr(offset, len));
+  }
+  delete rnd;
+}
+
 int main(int argc, char **argv) {
   spdlog::set_level(spdlog::level::debug);
   spdlog::enable_backtrace(16);
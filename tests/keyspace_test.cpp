@@ -0,0 +1,194 @@
+//
+// Hash, set and list tests.
+//
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <fmt/format.h>
+
+#include "db.h"
+#include "iterator.h"
+#include "options.h"
+#include "yedis_hash.hpp"
+#include "yedis_keyspace.hpp"
+#include "yedis_list.hpp"
+#include "yedis_set.hpp"
+
+namespace yedis {
+
+class KeySpaceTest: public testing::Test {
+protected:
+  void SetUp() override {
+    std::filesystem::remove_all(db_name_);
+    Open();
+  }
+
+  void TearDown() override {
+    Close();
+  }
+
+  void Open() {
+    Options options;
+    options.create_if_missing = true;
+    options.write_buffer_size = write_buffer_size_;
+    options.compression = CompressionType::kNoCompression;
+    options.compaction_filter = gc_.get();
+    ASSERT_TRUE(DB::Open(options, db_name_, &db_).ok());
+    gc_->Attach(db_, db_->DefaultColumnFamily());
+    keyspace_ = std::make_unique<KeySpace>(db_);
+    hash_ = std::make_unique<Hash>(keyspace_.get());
+    set_ = std::make_unique<Set>(keyspace_.get());
+    list_ = std::make_unique<List>(keyspace_.get());
+  }
+
+  void Close() {
+    list_.reset();
+    set_.reset();
+    hash_.reset();
+    keyspace_.reset();
+    gc_->Detach();
+    delete db_;
+    db_ = nullptr;
+  }
+
+  const std::string db_name_ = "ydb_keyspace";
+  size_t write_buffer_size_ = 4096;
+  std::unique_ptr<VersionGCFilter> gc_{NewKeySpaceGCFilter()};
+  DB* db_ = nullptr;
+  std::unique_ptr<KeySpace> keyspace_;
+  std::unique_ptr<Hash> hash_;
+  std::unique_ptr<Set> set_;
+  std::unique_ptr<List> list_;
+};
+
+TEST_F(KeySpaceTest, Hash) {
+  int added;
+  ASSERT_TRUE(hash_->hset("user", {{"name", "a"}, {"age", "1"}, {"name", "b"}}, &added).ok());
+  ASSERT_EQ(added, 2);
+  ASSERT_TRUE(hash_->hset("user", {{"age", "2"}, {"city", "c"}}, &added).ok());
+  ASSERT_EQ(added, 1);
+  // a key that is a prefix of another must not see its fields
+  ASSERT_TRUE(hash_->hset("use", {{"x", "y"}}).ok());
+
+  std::string value;
+  ASSERT_TRUE(hash_->hget("user", "name", &value).ok());
+  ASSERT_EQ(value, "b");
+  ASSERT_TRUE(hash_->hget("user", "nope", &value).IsNotFound());
+  ASSERT_TRUE(hash_->hget("nope", "name", &value).IsNotFound());
+
+  Hash::FieldValues all;
+  ASSERT_TRUE(hash_->hgetall("user", &all).ok());
+  Hash::FieldValues expected = {{"age", "2"}, {"city", "c"}, {"name", "b"}};
+  ASSERT_EQ(all, expected);
+  std::string type;
+  ASSERT_TRUE(keyspace_->type("user", &type).ok());
+  ASSERT_EQ(type, "hash");
+}
+
+TEST_F(KeySpaceTest, Set) {
+  int added;
+  ASSERT_TRUE(set_->sadd("tags", {"b", "a", "b"}, &added).ok());
+  ASSERT_EQ(added, 2);
+  ASSERT_TRUE(set_->sadd("tags", {"c", "a"}, &added).ok());
+  ASSERT_EQ(added, 1);
+  bool is_member;
+  ASSERT_TRUE(set_->sismember("tags", "a", &is_member).ok());
+  ASSERT_TRUE(is_member);
+  ASSERT_TRUE(set_->sismember("tags", "d", &is_member).ok());
+  ASSERT_FALSE(is_member);
+  Set::StrList members;
+  ASSERT_TRUE(set_->smembers("tags", &members).ok());
+  ASSERT_EQ(members, Set::StrList({"a", "b", "c"}));
+}
+
+TEST_F(KeySpaceTest, List) {
+  int64_t length;
+  ASSERT_TRUE(list_->lpush("queue", {"a", "b"}, &length).ok());
+  ASSERT_EQ(length, 2);
+  ASSERT_TRUE(list_->lpush("queue", {"c"}, &length).ok());
+  ASSERT_EQ(length, 3);
+  List::StrList elements;
+  ASSERT_TRUE(list_->lrange("queue", 0, -1, &elements).ok());
+  ASSERT_EQ(elements, List::StrList({"c", "b", "a"}));
+  ASSERT_TRUE(list_->lrange("queue", -2, 10, &elements).ok());
+  ASSERT_EQ(elements, List::StrList({"b", "a"}));
+  ASSERT_TRUE(list_->lrange("queue", 2, 1, &elements).ok());
+  ASSERT_TRUE(elements.empty());
+
+  std::string value;
+  for (auto expected: {"a", "b", "c"}) {
+    ASSERT_TRUE(list_->rpop("queue", &value).ok());
+    ASSERT_EQ(value, expected);
+  }
+  ASSERT_TRUE(list_->rpop("queue", &value).IsNotFound());
+  std::string type;
+  ASSERT_TRUE(keyspace_->type("queue", &type).ok());
+  ASSERT_EQ(type, "none");
+}
+
+TEST_F(KeySpaceTest, DeleteAndRecreate) {
+  // Nothing is flushed before the reopen, which flushes the log with the
+  // GC filter still detached: all the garbage is left for the count below.
+  Close();
+  write_buffer_size_ = 64 << 20;
+  Open();
+  std::vector<std::string> members;
+  for (int i = 0; i < 500; i++) {
+    members.push_back(fmt::format("member{:04d}", i));
+  }
+  ASSERT_TRUE(set_->sadd("big", members).ok());
+
+  std::string value;
+  ASSERT_TRUE(IsWrongType(hash_->hset("big", {{"f", "v"}})));
+  ASSERT_TRUE(IsWrongType(list_->rpop("big", &value)));
+
+  bool existed;
+  ASSERT_TRUE(keyspace_->del("big", &existed).ok());
+  ASSERT_TRUE(existed);
+  ASSERT_TRUE(keyspace_->del("big", &existed).ok());
+  ASSERT_FALSE(existed);
+
+  // the old members stay invisible to a new collection under the key
+  ASSERT_TRUE(set_->sadd("big", {"member0001", "new"}).ok());
+  Set::StrList result;
+  ASSERT_TRUE(set_->smembers("big", &result).ok());
+  ASSERT_EQ(result, Set::StrList({"member0001", "new"}));
+
+  ASSERT_TRUE(keyspace_->del("big", &existed).ok());
+  ASSERT_TRUE(hash_->hset("big", {{"f", "v"}}).ok());
+  Close();
+  Open();
+  Hash::FieldValues all;
+  ASSERT_TRUE(hash_->hgetall("big", &all).ok());
+  ASSERT_EQ(all, Hash::FieldValues({{"f", "v"}}));
+  bool is_member;
+  ASSERT_TRUE(IsWrongType(set_->sismember("big", "new", &is_member)));
+
+  // the members of both deleted sets are garbage, the hash is not
+  int filtered = 0;
+  int kept = 0;
+  std::unique_ptr<Iterator> it(db_->NewIterator(ReadOptions()));
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    const bool garbage = gc_->Filter(it->key(), it->value());
+    ASSERT_EQ(garbage, it->key()[0] == static_cast<char>(KeyType::kSet));
+    if (garbage) {
+      filtered++;
+    } else {
+      kept++;
+    }
+  }
+  ASSERT_TRUE(it->status().ok());
+  ASSERT_EQ(filtered, static_cast<int>(members.size()) + 2);
+  // the hash field and meta key
+  ASSERT_EQ(kept, 2);
+}
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,189 @@
+//
+// Tests of the lock-free MPMC queue and the blocking queues built on it.
+//
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <spdlog/spdlog.h>
+
+#include "mpmc_queue.h"
+#include "concurrent_blocking_queue.h"
+
+namespace yedis {
+
+TEST(MPMCQueueTest, Basic) {
+  MPMCQueue<int> queue(5);
+  ASSERT_EQ(queue.capacity(), 8);
+  ASSERT_TRUE(queue.empty());
+  int value;
+  ASSERT_FALSE(queue.try_pop(&value));
+
+  for (int i = 0; i < 8; i++) {
+    ASSERT_TRUE(queue.try_push(i));
+  }
+  ASSERT_FALSE(queue.try_push(8));
+  ASSERT_EQ(queue.size(), 8);
+
+  for (int i = 0; i < 8; i++) {
+    ASSERT_TRUE(queue.try_pop(&value));
+    ASSERT_EQ(value, i);
+  }
+  ASSERT_FALSE(queue.try_pop(&value));
+  ASSERT_TRUE(queue.empty());
+}
+
+TEST(MPMCQueueTest, Batch) {
+  MPMCQueue<std::string> queue(8);
+  std::string items[8];
+  std::string out[8];
+  int next = 0;
+  int expected = 0;
+  // runs of 5 wrap around the ring and stop at the ends
+  for (int round = 0; round < 100; round++) {
+    for (int i = 0; i < 5; i++) {
+      items[i] = std::to_string(next + i);
+    }
+    size_t room = 8 - queue.size();
+    size_t pushed = queue.try_push_n(items, 5);
+    ASSERT_EQ(pushed, std::min<size_t>(5, room));
+    next += static_cast<int>(pushed);
+
+    size_t popped = queue.try_pop_n(out, 3);
+    for (size_t i = 0; i < popped; i++) {
+      ASSERT_EQ(out[i], std::to_string(expected++));
+    }
+  }
+  size_t popped = queue.try_pop_n(out, 8);
+  for (size_t i = 0; i < popped; i++) {
+    ASSERT_EQ(out[i], std::to_string(expected++));
+  }
+  ASSERT_EQ(expected, next);
+  ASSERT_TRUE(queue.empty());
+  ASSERT_EQ(queue.try_pop_n(out, 8), 0);
+}
+
+TEST(MPMCQueueTest, MultiThread) {
+  constexpr int kProducers = 4;
+  constexpr int kConsumers = 4;
+  constexpr int kItems = 100000;
+  MPMCQueue<int64_t> queue(64);
+  std::atomic<int64_t> sum{0};
+  std::atomic<int> count{0};
+  std::vector<std::thread> threads;
+
+  for (int p = 0; p < kProducers; p++) {
+    threads.emplace_back([&, p] {
+      int64_t batch[4];
+      int i = 0;
+      while (i < kItems) {
+        // odd producers push in batches
+        size_t n = p % 2 ? std::min(4, kItems - i) : 1;
+        for (size_t j = 0; j < n; j++) {
+          batch[j] = i + j + 1;
+        }
+        size_t pushed = queue.try_push_n(batch, n);
+        i += static_cast<int>(pushed);
+        if (pushed == 0) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (int c = 0; c < kConsumers; c++) {
+    threads.emplace_back([&, c] {
+      int64_t batch[8];
+      while (count.load() < kProducers * kItems) {
+        size_t n = queue.try_pop_n(batch, c % 2 ? 8 : 1);
+        for (size_t j = 0; j < n; j++) {
+          sum.fetch_add(batch[j]);
+        }
+        count.fetch_add(static_cast<int>(n));
+        if (n == 0) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& t: threads) {
+    t.join();
+  }
+  ASSERT_EQ(count.load(), kProducers * kItems);
+  ASSERT_EQ(sum.load(), int64_t(kProducers) * kItems * (kItems + 1) / 2);
+  ASSERT_TRUE(queue.empty());
+}
+
+TEST(BlockingMPMCQueueTest, Basic) {
+  constexpr int kItems = 10000;
+  BlockingMPMCQueue<int> queue(4);
+  std::vector<int> results;
+
+  std::thread consumer([&] {
+    while (results.size() < kItems) {
+      results.push_back(queue.pop());
+    }
+  });
+  for (int i = 0; i < kItems; i++) {
+    queue.push(i);
+  }
+  consumer.join();
+
+  ASSERT_EQ(results.size(), kItems);
+  for (int i = 0; i < kItems; i++) {
+    ASSERT_EQ(results[i], i);
+  }
+  int value;
+  ASSERT_FALSE(queue.try_pop(&value));
+}
+
+TEST(ConcurrentBlockingQueueTest, TakeAll) {
+  constexpr int kItems = 10000;
+  ConcurrentBlockingQueue<int> queue(128);
+  std::vector<int> results;
+
+  std::thread producer([&] {
+    for (int i = 0; i < kItems; i++) {
+      queue.put(i);
+    }
+  });
+  while (results.size() < kItems) {
+    std::vector<int> batch = queue.takeAll();
+    ASSERT_FALSE(batch.empty());
+    results.insert(results.end(), batch.begin(), batch.end());
+  }
+  producer.join();
+
+  for (int i = 0; i < kItems; i++) {
+    ASSERT_EQ(results[i], i);
+  }
+  ASSERT_TRUE(queue.empty());
+}
+
+TEST(ConcurrentBlockingQueueTest, UnboundedByDefault) {
+  // no default constructor, puts never wait however many are queued
+  struct Item {
+    explicit Item(int v): value(v) {}
+    int value;
+  };
+  constexpr int kItems = 10000;
+  ConcurrentBlockingQueue<Item> queue;
+  for (int i = 0; i < kItems; i++) {
+    queue.put(Item(i));
+  }
+  ASSERT_EQ(queue.size(), kItems);
+  ASSERT_EQ(queue.take().value, 0);
+  std::vector<Item> results = queue.takeAll();
+  ASSERT_EQ(results.size(), kItems - 1);
+  for (int i = 1; i < kItems; i++) {
+    ASSERT_EQ(results[i - 1].value, i);
+  }
+  ASSERT_TRUE(queue.empty());
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,89 @@
+//
+// Rate limiter tests.
+//
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "rate_limiter.h"
+
+namespace yedis {
+
+using Clock = std::chrono::steady_clock;
+
+static int64_t ElapsedMillis(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+TEST(RateLimiterTest, Rate) {
+  // 1MB/s with 10ms periods, 10KB per period
+  std::unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(1024 * 1024, 10 * 1000));
+  ASSERT_EQ(limiter->GetSingleBurstBytes(), 10485);
+
+  auto start = Clock::now();
+  int64_t total = 0;
+  while (total < 300 * 1024) {
+    limiter->Request(4096, RateLimiter::kLow);
+    total += 4096;
+  }
+  // the first period is granted right away
+  ASSERT_GE(ElapsedMillis(start), 250);
+  ASSERT_EQ(limiter->GetTotalBytesThrough(RateLimiter::kLow), total);
+  ASSERT_EQ(limiter->GetTotalBytesThrough(RateLimiter::kHigh), 0);
+}
+
+TEST(RateLimiterTest, Priority) {
+  std::unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(1024 * 1024, 10 * 1000));
+  std::atomic<bool> stop{false};
+  auto writer = [&](RateLimiter::Priority pri) {
+    while (!stop.load()) {
+      limiter->Request(4096, pri);
+    }
+  };
+  // enough writers to keep both queues non-empty
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back(writer, RateLimiter::kLow);
+    threads.emplace_back(writer, RateLimiter::kHigh);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  stop.store(true);
+  for (auto& t: threads) {
+    t.join();
+  }
+
+  int64_t low_bytes = limiter->GetTotalBytesThrough(RateLimiter::kLow);
+  int64_t high_bytes = limiter->GetTotalBytesThrough(RateLimiter::kHigh);
+  ASSERT_GT(high_bytes, low_bytes);
+  // fairness keeps low priority requests going
+  ASSERT_GT(low_bytes, 0);
+}
+
+TEST(RateLimiterTest, AutoTuneBacksOff) {
+  const int64_t rate = 10 * 1024 * 1024;
+  std::unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(rate, 1000, true, 100));
+  auto drive = [&](uint64_t latency) {
+    for (int i = 0; i < 200; i++) {
+      limiter->RecordReadLatency(latency);
+      limiter->Request(limiter->GetSingleBurstBytes(), RateLimiter::kLow);
+    }
+  };
+
+  drive(1000);
+  int64_t slowed = limiter->GetBytesPerSecond();
+  ASSERT_LT(slowed, rate);
+  ASSERT_GE(slowed, rate / 20);
+
+  drive(10);
+  ASSERT_GT(limiter->GetBytesPerSecond(), slowed);
+}
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,7 @@
+#include <atomic>
 #include <thread>
 #include <chrono>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include <spdlog/spdlog.h>
@@ -81,6 +83,87 @@ TEST(RWLatchTest, RWLatchTest) {
   th3.join();
   th4.join();
 }
+
+TEST(RWLatchTest, ManyReaders) {
+  ReaderWriterLatch rw_latch;
+  // written in two halves, readers must never see them differ
+  int64_t first = 0;
+  int64_t second = 0;
+  std::atomic<bool> stop{false};
+  std::atomic<int> torn{0};
+  std::atomic<int64_t> reads{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 16; i++) {
+    readers.emplace_back([&] {
+      while (!stop.load()) {
+        rw_latch.RLock();
+        if (first != second) {
+          torn.fetch_add(1);
+        }
+        rw_latch.RUnLock();
+        reads.fetch_add(1);
+      }
+    });
+  }
+  std::thread writer([&] {
+    for (int i = 1; i <= 1000; i++) {
+      rw_latch.WLock();
+      first = i;
+      second = i;
+      rw_latch.WUnLock();
+    }
+    stop.store(true);
+  });
+  writer.join();
+  for (auto& th: readers) {
+    th.join();
+  }
+  EXPECT_EQ(torn.load(), 0);
+  EXPECT_EQ(second, 1000);
+  EXPECT_GT(reads.load(), 0);
+}
+
+TEST(OptimisticLatchTest, ReadValidate) {
+  OptimisticLatch latch;
+  std::atomic<int64_t> first{0};
+  std::atomic<int64_t> second{0};
+  std::atomic<bool> stop{false};
+  std::atomic<int> torn{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+      while (!stop.load()) {
+        int64_t a, b;
+        uint64_t version;
+        do {
+          version = latch.ReadBegin();
+          a = first.load(std::memory_order_relaxed);
+          b = second.load(std::memory_order_relaxed);
+        } while (!latch.Validate(version));
+        if (a != b) {
+          torn.fetch_add(1);
+        }
+      }
+    });
+  }
+  for (int i = 1; i <= 10000; i++) {
+    latch.WLock();
+    first.store(i, std::memory_order_relaxed);
+    second.store(i, std::memory_order_relaxed);
+    latch.WUnLock();
+  }
+  stop.store(true);
+  for (auto& th: readers) {
+    th.join();
+  }
+  EXPECT_EQ(torn.load(), 0);
+
+  uint64_t version = latch.ReadBegin();
+  ASSERT_TRUE(latch.Validate(version));
+  latch.WLock();
+  latch.WUnLock();
+  ASSERT_FALSE(latch.Validate(version));
+}
 }
 
 int main(int argc, char **argv) {
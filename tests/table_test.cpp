@@ -20,6 +20,7 @@
 #include "table.h"
 #include "iterator.h"
 #include "cache.h"
+#include "statistics.h"
 
 #include "random.h"
 #include "test_util.h"
@@ -104,6 +105,145 @@ TEST(TableBuildTest, Basic) {
   spdlog::info("total usage: {}", options.block_cache->TotalCharge());
 }
 
+TEST(TableBuildTest, PartitionedIndexAndFilter) {
+  using namespace yedis;
+  LocalFileSystem fs;
+  auto file_handle = fs.OpenFile("000002.ydb", O_CREAT | O_RDWR | O_TRUNC);
+  Options options{};
+  options.compression = CompressionType::kNoCompression;
+  options.filter_policy = NewBloomFilterPolicy(8);
+  options.block_size = 1024;
+  options.index_type = kTwoLevelIndexSearch;
+  options.partition_filters = true;
+  options.metadata_block_size = 256;
+  auto table_builder = new TableBuilder(options, file_handle.get());
+
+  std::vector<std::pair<std::string, std::string>> kvs = prepare(4096);
+  std::sort(kvs.begin(), kvs.end(), [](const KVType & p1, const KVType & p2) {
+    return p1.first < p2.first;
+  });
+  kvs.erase(std::unique(kvs.begin(), kvs.end(), [](const KVType & p1, const KVType & p2) {
+    return p1.first == p2.first;
+  }), kvs.end());
+
+  for(auto kv: kvs) {
+    table_builder->Add(kv.first, kv.second);
+  }
+  ASSERT_TRUE(table_builder->Finish().ok());
+  delete table_builder;
+
+  auto read_file_handle = fs.OpenFile("000002.ydb", O_RDONLY);
+  options.block_cache = NewLRUCache(64 * 1024);
+
+  Table* table;
+  Status status = Table::Open(options, read_file_handle.get(), &table);
+  ASSERT_TRUE(status.ok());
+
+  ReadOptions read_opt;
+  read_opt.verify_checksums = true;
+
+  auto iter = table->NewIterator(read_opt);
+  iter->SeekToFirst();
+  int idx = 0;
+  while (iter->Valid()) {
+    ASSERT_TRUE(idx < kvs.size());
+    ASSERT_EQ(iter->key().ToString(), kvs[idx].first);
+    ASSERT_EQ(iter->value().ToString(), kvs[idx].second);
+    iter->Next();
+    idx++;
+  }
+  ASSERT_EQ(idx, kvs.size());
+
+  for (int i = 0; i < kvs.size(); i += 97) {
+    iter->Seek(kvs[i].first);
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(iter->key().ToString(), kvs[i].first);
+  }
+  delete iter;
+
+  // point lookups go through the filter partitions
+  auto first_key = [](void* arg, const Slice& k, const Slice& v) {
+    *reinterpret_cast<std::string*>(arg) = k.ToString();
+    return false;
+  };
+  for (int i = 0; i < kvs.size(); i += 97) {
+    std::string found;
+    ASSERT_TRUE(table->InternalGet(read_opt, kvs[i].first, &found, first_key).ok());
+    ASSERT_EQ(found, kvs[i].first);
+  }
+  std::unique_ptr<Statistics> stats(CreateDBStatistics());
+  delete table;
+  options.statistics = stats.get();
+  ASSERT_TRUE(Table::Open(options, read_file_handle.get(), &table).ok());
+  Random rnd;
+  const int kMissing = 1000;
+  for (int i = 0; i < kMissing; i++) {
+    // 23 bytes, never one of the 24 byte keys of the table
+    std::string missing;
+    test::RandomString(&rnd, 23, &missing);
+    std::string found;
+    ASSERT_TRUE(table->InternalGet(read_opt, missing, &found, first_key).ok());
+    ASSERT_NE(found, missing);
+  }
+  // 8 bits per key give about 2% false positives
+  ASSERT_GT(stats->GetTickerCount(kBloomFilterUseful), kMissing * 9 / 10);
+  delete table;
+}
+
+TEST(TableReaderTest, MmapReads) {
+  using namespace yedis;
+  LocalFileSystem fs;
+  auto file_handle = fs.OpenFile("000003.ydb", O_CREAT | O_RDWR | O_TRUNC);
+  Options options{};
+  options.compression = CompressionType::kNoCompression;
+  options.block_size = 1024;
+  auto table_builder = new TableBuilder(options, file_handle.get());
+
+  std::vector<std::pair<std::string, std::string>> kvs = prepare(1024);
+  std::sort(kvs.begin(), kvs.end(), [](const KVType & p1, const KVType & p2) {
+    return p1.first < p2.first;
+  });
+  kvs.erase(std::unique(kvs.begin(), kvs.end(), [](const KVType & p1, const KVType & p2) {
+    return p1.first == p2.first;
+  }), kvs.end());
+
+  for(auto kv: kvs) {
+    table_builder->Add(kv.first, kv.second);
+  }
+  ASSERT_TRUE(table_builder->Finish().ok());
+  delete table_builder;
+
+  std::unique_ptr<FileHandle> read_file_handle;
+  ASSERT_TRUE(fs.NewMmapReadableFile("000003.ydb", read_file_handle).ok());
+  ASSERT_TRUE(read_file_handle->MappedData() != nullptr);
+  options.allow_mmap_reads = true;
+  options.block_cache = NewLRUCache(64 * 1024);
+
+  Table* table;
+  Status status = Table::Open(options, read_file_handle.get(), &table);
+  ASSERT_TRUE(status.ok());
+
+  ReadOptions read_opt;
+  read_opt.verify_checksums = true;
+
+  auto iter = table->NewIterator(read_opt);
+  iter->SeekToFirst();
+  int idx = 0;
+  while (iter->Valid()) {
+    ASSERT_TRUE(idx < kvs.size());
+    ASSERT_EQ(iter->key().ToString(), kvs[idx].first);
+    ASSERT_EQ(iter->value().ToString(), kvs[idx].second);
+    iter->Next();
+    idx++;
+  }
+  ASSERT_EQ(idx, kvs.size());
+  // mapped blocks are never copied into the block cache
+  ASSERT_EQ(options.block_cache->TotalCharge(), 0);
+  delete iter;
+  delete table;
+  delete options.block_cache;
+}
+
 TEST(TableReaderTest, Basic) {
   using namespace yedis;
   LocalFileSystem fs;
@@ -0,0 +1,354 @@
+//
+// Sorted set tests.
+//
+
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <fmt/format.h>
+
+#include "db.h"
+#include "iterator.h"
+#include "options.h"
+#include "util.hpp"
+#include "yedis_zset.hpp"
+
+namespace yedis {
+
+class ZSetTest: public testing::Test {
+protected:
+  void SetUp() override {
+    std::filesystem::remove_all(db_name_);
+    Options options;
+    options.create_if_missing = true;
+    options.write_buffer_size = 4096;
+    options.compression = CompressionType::kNoCompression;
+    options = ZSet::MetaColumnFamilyOptions(options);
+    options.compaction_filter = gc_.get();
+    ASSERT_TRUE(DB::Open(options, db_name_, &db_).ok());
+    gc_->Attach(db_, db_->DefaultColumnFamily());
+    zset_ = std::make_unique<ZSet>(db_);
+  }
+
+  void TearDown() override {
+    zset_.reset();
+    gc_->Detach();
+    delete db_;
+  }
+
+  const std::string db_name_ = "ydb_zset";
+  std::unique_ptr<VersionGCFilter> gc_{ZSet::NewGCFilter()};
+  DB* db_ = nullptr;
+  std::unique_ptr<ZSet> zset_;
+};
+
+TEST_F(ZSetTest, ScoreOrder) {
+  const double inf = std::numeric_limits<double>::infinity();
+  std::vector<ScoreMember> members = {
+      {3.5, "c"}, {-2, "b"}, {1e10, "e"}, {-inf, "a"}, {0, "d"}, {inf, "f"}, {-0.5, "ab"}};
+  int added;
+  ASSERT_TRUE(zset_->zadd("z", members, &added).ok());
+  ASSERT_EQ(added, 7);
+  // another zset whose name starts with the same bytes
+  ASSERT_TRUE(zset_->zadd("z1", {{1, "other"}}).ok());
+
+  ASSERT_EQ(zset_->zrange("z", 0, -1), ZSet::StrList({"a", "b", "ab", "d", "c", "e", "f"}));
+  ASSERT_EQ(zset_->zrange("z", 2, 3), ZSet::StrList({"ab", "d"}));
+  ASSERT_EQ(zset_->zrange("z", -2, -1), ZSet::StrList({"e", "f"}));
+
+  std::vector<ScoreMember> range;
+  ASSERT_TRUE(zset_->zrangebyscore("z", -2, 3.5, &range).ok());
+  ASSERT_EQ(range, std::vector<ScoreMember>({{-2, "b"}, {-0.5, "ab"}, {0, "d"}, {3.5, "c"}}));
+  ASSERT_TRUE(zset_->zrangebyscore("z", 4, 5, &range).ok());
+  ASSERT_TRUE(range.empty());
+
+  int64_t rank;
+  ASSERT_TRUE(zset_->zrank("z", "d", &rank).ok());
+  ASSERT_EQ(rank, 3);
+  ASSERT_TRUE(zset_->zrank("z", "missing", &rank).IsNotFound());
+  double score;
+  ASSERT_TRUE(zset_->zscore("z", "e", &score).ok());
+  ASSERT_EQ(score, 1e10);
+  ASSERT_TRUE(zset_->zadd("z", {{std::nan(""), "g"}}).IsInvalidArgument());
+}
+
+TEST_F(ZSetTest, UpdateAndRemove) {
+  const int kNumMembers = 500;
+  std::vector<ScoreMember> members;
+  for (int i = 0; i < kNumMembers; i++) {
+    members.push_back({static_cast<double>(i), fmt::format("m{}", i)});
+  }
+  ASSERT_TRUE(zset_->zadd("z", members).ok());
+
+  // moving a member must not leave its old index entry behind
+  int added;
+  ASSERT_TRUE(zset_->zadd("z", {{-1, "m10"}}, &added).ok());
+  ASSERT_EQ(added, 0);
+  double score;
+  ASSERT_TRUE(zset_->zincrby("z", 1000, "m20", &score).ok());
+  ASSERT_EQ(score, 1020);
+  ASSERT_TRUE(zset_->zincrby("z", 2.5, "new", &score).ok());
+  ASSERT_EQ(score, 2.5);
+
+  int removed;
+  ASSERT_TRUE(zset_->zrem("z", {"m0", "m1", "m1", "missing"}, &removed).ok());
+  ASSERT_EQ(removed, 2);
+
+  int64_t count;
+  ASSERT_TRUE(zset_->zcard("z", &count).ok());
+  ASSERT_EQ(count, kNumMembers - 1);
+  auto all = zset_->zrange("z", 0, -1);
+  ASSERT_EQ(all.size(), count);
+  ASSERT_EQ(all.front(), "m10");
+  ASSERT_EQ(all[2], "new");
+  ASSERT_EQ(all.back(), "m20");
+
+  int64_t rank;
+  ASSERT_TRUE(zset_->zrank("z", "m20", &rank).ok());
+  ASSERT_EQ(rank, count - 1);
+  ASSERT_TRUE(zset_->zscore("z", "m0", &score).IsNotFound());
+}
+TEST_F(ZSetTest, RankAfterUpdates) {
+  // ties, negative and fractional scores, far apart and close together
+  std::mt19937 rnd(301);
+  std::map<std::string, double> expected;
+  auto random_score = [&]() -> double {
+    switch (rnd() % 4) {
+      case 0: return static_cast<double>(rnd() % 20);
+      case 1: return -static_cast<double>(rnd() % 100000) / 7;
+      case 2: return static_cast<double>(rnd()) * 1e6;
+      default: return 1 + static_cast<double>(rnd() % 1000) / 1e9;
+    }
+  };
+  const int kNumMembers = 2000;
+  std::vector<ScoreMember> members;
+  for (int i = 0; i < kNumMembers; i++) {
+    members.push_back({random_score(), fmt::format("m{}", i)});
+    expected[members.back().member] = members.back().score;
+  }
+  ASSERT_TRUE(zset_->zadd("board", members).ok());
+  for (int i = 0; i < 300; i++) {
+    std::string member = fmt::format("m{}", rnd() % kNumMembers);
+    if (i % 3 == 0) {
+      int removed;
+      ASSERT_TRUE(zset_->zrem("board", {member}, &removed).ok());
+      expected.erase(member);
+    } else {
+      double score = random_score();
+      ASSERT_TRUE(zset_->zadd("board", {{score, member}}).ok());
+      expected[member] = score;
+    }
+  }
+
+  std::set<std::pair<double, std::string>> ordered;
+  for (auto& [member, score]: expected) {
+    ordered.insert({score, member});
+  }
+  std::vector<std::string> by_rank;
+  for (auto& [score, member]: ordered) {
+    by_rank.push_back(member);
+  }
+  for (size_t i = 0; i < by_rank.size(); i += 7) {
+    int64_t rank;
+    ASSERT_TRUE(zset_->zrank("board", by_rank[i], &rank).ok()) << by_rank[i];
+    ASSERT_EQ(rank, i) << by_rank[i];
+  }
+  for (int start: {0, 1, 17, 500, static_cast<int>(by_rank.size()) - 3}) {
+    std::vector<std::string> window(by_rank.begin() + start,
+                                    by_rank.begin() + std::min<size_t>(start + 10, by_rank.size()));
+    ASSERT_EQ(zset_->zrange("board", start, start + 9), window) << start;
+  }
+  ASSERT_TRUE(zset_->zrange("board", by_rank.size(), by_rank.size() + 5).empty());
+}
+
+TEST_F(ZSetTest, RankOfEqualScores) {
+  // ranked by member bytes: prefixes of each other, long shared prefixes
+  std::set<std::string> expected = {"", "a", "ab", "abc", "b", "\xff"};
+  std::mt19937 rnd(301);
+  for (int i = 0; i < 500; i++) {
+    expected.insert(fmt::format("member:{:06d}", rnd() % 100000));
+    expected.insert(fmt::format("{:x}", rnd()));
+  }
+  std::vector<ScoreMember> members;
+  for (auto& member: expected) {
+    members.push_back({7, member});
+  }
+  ASSERT_TRUE(zset_->zadd("z", members).ok());
+  ASSERT_TRUE(zset_->zadd("z", {{6, "low"}, {8, "high"}}).ok());
+
+  std::vector<std::string> by_rank = {"low"};
+  by_rank.insert(by_rank.end(), expected.begin(), expected.end());
+  by_rank.push_back("high");
+  for (size_t i = 0; i < by_rank.size(); i += (i < 8 ? 1 : 7)) {
+    int64_t rank;
+    ASSERT_TRUE(zset_->zrank("z", by_rank[i], &rank).ok()) << by_rank[i];
+    ASSERT_EQ(rank, i) << by_rank[i];
+  }
+  for (int start: {0, 1, 2, 5, 500, static_cast<int>(by_rank.size()) - 4}) {
+    std::vector<std::string> window(by_rank.begin() + start,
+                                    by_rank.begin() + std::min<size_t>(start + 10, by_rank.size()));
+    ASSERT_EQ(zset_->zrange("z", start, start + 9), window) << start;
+  }
+}
+
+TEST_F(ZSetTest, RankOfSharedPrefixes) {
+  // leaderboard members: equal scores, 8 or more shared leading bytes
+  const int kNumMembers = 2000;
+  auto member = [](int i) { return fmt::format("user:{:06d}", i); };
+  std::vector<ScoreMember> members;
+  for (int i = 0; i < kNumMembers; i++) {
+    members.push_back({100, member(i)});
+  }
+  ASSERT_TRUE(zset_->zadd("z", members).ok());
+  for (int i = 0; i < kNumMembers; i += 7) {
+    int64_t rank;
+    ASSERT_TRUE(zset_->zrank("z", member(i), &rank).ok()) << member(i);
+    ASSERT_EQ(rank, i) << member(i);
+  }
+  ASSERT_EQ(zset_->zrange("z", 1500, 1502), ZSet::StrList({member(1500), member(1501), member(1502)}));
+
+  // each member has a deepest bucket of its own, zrank scans no others
+  const size_t path_size = sizeof(uint64_t) + member(0).size();
+  // "rank_", the length prefixed "z", the version, then the level
+  const size_t level_offset = strlen("rank_") + 2 + sizeof(uint64_t);
+  int deepest = 0;
+  std::unique_ptr<Iterator> it(db_->NewIterator(ReadOptions()));
+  for (it->Seek("rank_"); it->Valid() && it->key().starts_with("rank_"); it->Next()) {
+    const size_t level = static_cast<uint8_t>(it->key()[level_offset]);
+    if (level == path_size && it->key().size() == level_offset + 1 + path_size) {
+      ASSERT_EQ(DecodeFixed64(it->value().data()), 1);
+      deepest++;
+    }
+  }
+  ASSERT_TRUE(it->status().ok());
+  ASSERT_EQ(deepest, kNumMembers);
+}
+
+TEST_F(ZSetTest, EmptyRankBucketsFiltered) {
+  const int kNumMembers = 100;
+  std::vector<ScoreMember> members;
+  for (int i = 0; i < kNumMembers; i++) {
+    members.push_back({1, fmt::format("m{:04d}", i)});
+  }
+  ASSERT_TRUE(zset_->zadd("z", members).ok());
+  // every bucket below score 1 is left empty
+  for (auto& score_member: members) {
+    score_member.score = 2;
+  }
+  ASSERT_TRUE(zset_->zadd("z", members).ok());
+  int64_t rank;
+  ASSERT_TRUE(zset_->zrank("z", "m0050", &rank).ok());
+  ASSERT_EQ(rank, 50);
+
+  int empty = 0;
+  int counted = 0;
+  std::unique_ptr<Iterator> it(db_->NewIterator(ReadOptions()));
+  for (it->Seek("rank_"); it->Valid() && it->key().starts_with("rank_"); it->Next()) {
+    ASSERT_EQ(it->value().size(), sizeof(uint64_t));
+    if (DecodeFixed64(it->value().data()) == 0) {
+      ASSERT_TRUE(gc_->Filter(it->key(), it->value()));
+      empty++;
+    } else {
+      ASSERT_FALSE(gc_->Filter(it->key(), it->value()));
+      counted++;
+    }
+  }
+  ASSERT_TRUE(it->status().ok());
+  ASSERT_GT(empty, kNumMembers);
+  ASSERT_GT(counted, kNumMembers);
+}
+
+TEST(ZSetOptionsTest, NoMergeOperator) {
+  const std::string db_name = "ydb_zset_plain";
+  std::filesystem::remove_all(db_name);
+  Options options;
+  options.create_if_missing = true;
+  options.compression = CompressionType::kNoCompression;
+  DB* db;
+  ASSERT_TRUE(DB::Open(options, db_name, &db).ok());
+  {
+    ZSet zset(db);
+    // the rank counts are rejected, and the rest of the write with them
+    ASSERT_TRUE(zset.zadd("z", {{1, "a"}}).IsNotSupportedError());
+    int64_t count;
+    ASSERT_TRUE(zset.zcard("z", &count).ok());
+    ASSERT_EQ(count, 0);
+    double score;
+    ASSERT_TRUE(zset.zincrby("z", 1, "a", &score).IsNotSupportedError());
+  }
+  delete db;
+}
+
+TEST_F(ZSetTest, DeleteAndGC) {
+  const int kNumMembers = 300;
+  std::vector<ScoreMember> members;
+  for (int i = 0; i < kNumMembers; i++) {
+    members.push_back({static_cast<double>(i), fmt::format("m{:04d}", i)});
+  }
+  ASSERT_TRUE(zset_->zadd("big", members).ok());
+  ASSERT_TRUE(zset_->zadd("small", {{1, "a"}, {2, "b"}}).ok());
+
+  bool existed;
+  ASSERT_TRUE(zset_->del("big", &existed).ok());
+  ASSERT_TRUE(existed);
+  ASSERT_TRUE(zset_->del("big", &existed).ok());
+  ASSERT_FALSE(existed);
+  int64_t count;
+  ASSERT_TRUE(zset_->zcard("big", &count).ok());
+  ASSERT_EQ(count, 0);
+  ASSERT_TRUE(zset_->zrange("big", 0, -1).empty());
+  double score;
+  ASSERT_TRUE(zset_->zscore("big", "m0001", &score).IsNotFound());
+
+  // a new zset under the key does not see the old members
+  ASSERT_TRUE(zset_->zadd("big", {{5, "m0001"}}).ok());
+  ASSERT_TRUE(zset_->zcard("big", &count).ok());
+  ASSERT_EQ(count, 1);
+  ASSERT_EQ(zset_->zrange("big", 0, -1), ZSet::StrList({"m0001"}));
+  int64_t rank;
+  ASSERT_TRUE(zset_->zrank("big", "m0001", &rank).ok());
+  ASSERT_EQ(rank, 0);
+
+  // removing the last member deletes the zset
+  int removed;
+  ASSERT_TRUE(zset_->zrem("small", {"a", "b"}, &removed).ok());
+  ASSERT_EQ(removed, 2);
+  ASSERT_TRUE(zset_->del("small", &existed).ok());
+  ASSERT_FALSE(existed);
+
+  // reads do not run the filter, the old keys are still there for it
+  std::map<std::string, int> filtered;
+  std::map<std::string, int> kept;
+  std::unique_ptr<Iterator> it(db_->NewIterator(ReadOptions()));
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    const std::string key = it->key().ToString();
+    const std::string type = key.substr(0, key.find('_'));
+    if (gc_->Filter(it->key(), it->value())) {
+      filtered[type]++;
+    } else {
+      kept[type]++;
+    }
+  }
+  ASSERT_TRUE(it->status().ok());
+  ASSERT_EQ(filtered["data"], kNumMembers);
+  ASSERT_EQ(filtered["index"], kNumMembers);
+  ASSERT_GT(filtered["rank"], 0);
+  ASSERT_EQ(filtered["meta"], 0);
+  ASSERT_EQ(kept["data"], 1);
+  ASSERT_EQ(kept["index"], 1);
+  ASSERT_EQ(kept["meta"], 1);
+}
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}